@@ -0,0 +1,68 @@
+# bubble: bubble sort of 640 signed words
+# result: a0 = hash of the sorted array, a1 = out of order pairs (0)
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# array
+	li	s1, 640			# elements
+	slli	s5, s1, 2
+	add	s5, s5, s0		# end of the array
+
+	li	a0, 0x2545F491		# xorshift32 state
+	mv	t0, s0
+fill:
+	jal	ra, xorshift
+	sw	a0, 0(t0)
+	addi	t0, t0, 4
+	bltu	t0, s5, fill
+
+	# after each pass the largest element left is in place
+	addi	s2, s5, -4		# last pair starts below this
+outer:
+	li	t3, 0			# swapped
+	mv	t0, s0
+inner:
+	lw	a1, 0(t0)
+	lw	a2, 4(t0)
+	bge	a2, a1, noswap
+	sw	a2, 0(t0)
+	sw	a1, 4(t0)
+	li	t3, 1
+noswap:
+	addi	t0, t0, 4
+	bltu	t0, s2, inner
+	beqz	t3, sorted
+	addi	s2, s2, -4
+	bltu	s0, s2, outer
+sorted:
+
+	jal	ra, check
+	ecall
+
+# a0 = hash of the array s0..s5, a1 = pairs out of order
+check:
+	li	a0, 0
+	li	a1, 0
+	mv	t0, s0
+	lw	t1, 0(t0)
+check_loop:
+	lw	t2, 0(t0)
+	slli	a2, a0, 5
+	add	a0, a0, a2
+	xor	a0, a0, t2
+	bge	t2, t1, check_next
+	addi	a1, a1, 1
+check_next:
+	mv	t1, t2
+	addi	t0, t0, 4
+	bltu	t0, s5, check_loop
+	ret
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
@@ -0,0 +1,15 @@
+#!/bin/sh
+# Rebuilds the kernel images NAME.mem from NAME.s, run from bench/.
+# Needs llvm-mc and llvm-objcopy; the images are checked in.
+set -e
+for s in ${@:-*.s}; do
+	k=${s%.s}
+	llvm-mc -triple=riscv32 -mattr=-relax -filetype=obj $k.s -o $k.o
+	llvm-objcopy -O binary -j .text $k.o $k.bin
+	od -An -v -tu4 -w4 $k.bin | awk '{
+		b = ""
+		for (i = 0; i < 32; i++) { b = ($1 % 2) b; $1 = int($1 / 2) }
+		print b
+	}' > $k.mem
+	rm -f $k.o $k.bin
+done
@@ -0,0 +1,71 @@
+# crc32: table-driven CRC-32 (IEEE 802.3) of a 64 KiB buffer, 3 passes
+# result: a0 = CRC of the last pass, s6/s7 = CRC of the others
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# buffer
+	li	s1, 0x8000		# table of 256 words
+	li	s5, 0x20000		# end of the buffer
+
+	li	a0, 0x6C078965		# xorshift32 state
+	mv	t0, s0
+fill:
+	jal	ra, xorshift
+	sw	a0, 0(t0)
+	addi	t0, t0, 4
+	bltu	t0, s5, fill
+
+	# table[n] = CRC of the byte n, bit by bit
+	li	t5, 0xEDB88320		# reflected polynomial
+	li	t4, 256
+	li	t0, 0
+table:
+	mv	a0, t0
+	li	t1, 8
+table_bit:
+	andi	t2, a0, 1
+	srli	a0, a0, 1
+	beqz	t2, table_next
+	xor	a0, a0, t5
+table_next:
+	addi	t1, t1, -1
+	bnez	t1, table_bit
+	slli	t2, t0, 2
+	add	t2, t2, s1
+	sw	a0, 0(t2)
+	addi	t0, t0, 1
+	bne	t0, t4, table
+
+	li	s4, 3			# passes
+pass:
+	li	a0, -1
+	mv	t0, s0
+crc:
+	lbu	t1, 0(t0)
+	xor	t1, t1, a0
+	andi	t1, t1, 0xFF
+	slli	t1, t1, 2
+	add	t1, t1, s1
+	lw	t1, 0(t1)
+	srli	a0, a0, 8
+	xor	a0, a0, t1
+	addi	t0, t0, 1
+	bne	t0, s5, crc
+	not	a0, a0
+
+	# the CRC goes into the buffer, the next pass sees other data
+	sw	a0, 0(s0)
+	mv	s7, s6
+	mv	s6, a0
+	addi	s4, s4, -1
+	bnez	s4, pass
+	ecall
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
@@ -0,0 +1,443 @@
+# dhry: Dhrystone-like mix of calls, record and string copies, string
+# compares, array indexing and branches, after Dhrystone 2.1
+# data: dhry_data.mem, the strings
+# result: a0 = hash of the locals and globals after the last run,
+# which end as in Dhrystone: Int_1_Loc 5, Int_2_Loc 13, Int_3_Loc 7
+
+	.equ	INT_GLOB, 0x100
+	.equ	BOOL_GLOB, 0x104
+	.equ	CH_1_GLOB, 0x108
+	.equ	CH_2_GLOB, 0x10C
+	.equ	PTR_GLOB, 0x110
+	.equ	NEXT_PTR_GLOB, 0x114
+	.equ	STR_1, 0x1000
+	.equ	STR_2, 0x1040
+	.equ	STR_3, 0x1080
+	.equ	STR_SOME, 0x10C0
+	.equ	REC_A, 0x2000
+	.equ	REC_B, 0x2040
+	.equ	ARR_1, 0x3000
+	.equ	ARR_2, 0x4000		# 50x50 words, 200 bytes a row
+	.equ	RUNS, 5000
+
+# record: Ptr_Comp 0, Discr 4, Enum_Comp 8, Int_Comp 12, Str_Comp 16..47
+# enumeration: Ident_1 0 .. Ident_5 4
+# frame of main: Int_1_Loc 0, Int_3_Loc 4, Enum_Loc 8,
+# Str_1_Loc 16, Str_2_Loc 48
+
+	li	sp, 0x100000
+	addi	sp, sp, -80
+	li	t0, REC_B
+	sw	t0, NEXT_PTR_GLOB(zero)
+	li	t1, REC_A
+	sw	t1, PTR_GLOB(zero)
+	sw	t0, 0(t1)
+	sw	zero, 4(t1)
+	li	t0, 2
+	sw	t0, 8(t1)
+	li	t0, 40
+	sw	t0, 12(t1)
+	addi	a0, t1, 16
+	li	a1, STR_SOME
+	jal	ra, strcpy
+	addi	a0, sp, 16
+	li	a1, STR_1
+	jal	ra, strcpy
+	li	t0, ARR_2 + 8*200 + 7*4
+	li	t1, 10
+	sw	t1, 0(t0)
+
+	li	s0, 1			# Run_Index
+	li	s1, RUNS
+run:
+	jal	ra, proc_5
+	jal	ra, proc_4
+	li	s2, 2			# Int_1_Loc
+	li	s3, 3			# Int_2_Loc
+	addi	a0, sp, 48
+	li	a1, STR_2
+	jal	ra, strcpy
+	li	t0, 1
+	sw	t0, 8(sp)
+	addi	a0, sp, 16
+	addi	a1, sp, 48
+	jal	ra, func_2
+	seqz	a0, a0
+	sw	a0, BOOL_GLOB(zero)
+while:
+	bge	s2, s3, while_end
+	slli	t0, s2, 2
+	add	t0, t0, s2
+	sub	t0, t0, s3
+	sw	t0, 4(sp)		# Int_3_Loc = 5 * Int_1_Loc - Int_2_Loc
+	mv	a0, s2
+	mv	a1, s3
+	addi	a2, sp, 4
+	jal	ra, proc_7
+	addi	s2, s2, 1
+	j	while
+while_end:
+	li	a0, ARR_1
+	li	a1, ARR_2
+	mv	a2, s2
+	lw	a3, 4(sp)
+	jal	ra, proc_8
+	lw	a0, PTR_GLOB(zero)
+	jal	ra, proc_1
+
+	li	s4, 'A'			# Ch_Index
+for:
+	lw	t0, CH_2_GLOB(zero)
+	blt	t0, s4, for_end
+	mv	a0, s4
+	li	a1, 'C'
+	jal	ra, func_1
+	lw	t0, 8(sp)
+	bne	a0, t0, for_next
+	li	a0, 0
+	addi	a1, sp, 8
+	jal	ra, proc_6
+	addi	a0, sp, 48
+	li	a1, STR_3
+	jal	ra, strcpy
+	mv	s3, s0
+	sw	s0, INT_GLOB(zero)
+for_next:
+	addi	s4, s4, 1
+	j	for
+for_end:
+	mv	a0, s3
+	mv	a1, s2
+	jal	ra, mul
+	mv	s3, a0			# Int_2_Loc = Int_2_Loc * Int_1_Loc
+	lw	a1, 4(sp)
+	jal	ra, div
+	mv	s2, a0			# Int_1_Loc = Int_2_Loc / Int_3_Loc
+	lw	t0, 4(sp)
+	sub	t0, s3, t0
+	slli	t1, t0, 3
+	sub	t0, t1, t0
+	sub	s3, t0, s2		# Int_2_Loc = 7 * (Int_2_Loc - Int_3_Loc) - Int_1_Loc
+	sw	s2, 0(sp)
+	mv	a0, sp
+	jal	ra, proc_2
+	lw	s2, 0(sp)
+
+	addi	s0, s0, 1
+	bge	s1, s0, run
+
+	li	a0, 0
+	mv	a1, s2
+	jal	ra, mix
+	mv	a1, s3
+	jal	ra, mix
+	lw	a1, 4(sp)
+	jal	ra, mix
+	lw	a1, 8(sp)
+	jal	ra, mix
+	lw	a1, INT_GLOB(zero)
+	jal	ra, mix
+	lw	a1, BOOL_GLOB(zero)
+	jal	ra, mix
+	lw	a1, CH_1_GLOB(zero)
+	jal	ra, mix
+	lw	a1, CH_2_GLOB(zero)
+	jal	ra, mix
+	ecall
+
+proc_1:
+	addi	sp, sp, -16
+	sw	ra, 12(sp)
+	sw	s0, 8(sp)
+	sw	s1, 4(sp)
+	mv	s0, a0			# Ptr_Val_Par
+	lw	s1, 0(s0)		# Next_Record
+	lw	a1, PTR_GLOB(zero)
+	mv	a0, s1
+	jal	ra, rec_copy		# *Next_Record = *Ptr_Glob
+	li	t0, 5
+	sw	t0, 12(s0)
+	sw	t0, 12(s1)
+	lw	t0, 0(s0)
+	sw	t0, 0(s1)
+	mv	a0, s1
+	jal	ra, proc_3
+	lw	t0, 4(s1)
+	bnez	t0, proc_1_else
+	li	t0, 6
+	sw	t0, 12(s1)
+	lw	a0, 8(s0)
+	addi	a1, s1, 8
+	jal	ra, proc_6
+	lw	t0, PTR_GLOB(zero)
+	lw	t0, 0(t0)
+	sw	t0, 0(s1)
+	lw	a0, 12(s1)
+	li	a1, 10
+	addi	a2, s1, 12
+	jal	ra, proc_7
+	j	proc_1_ret
+proc_1_else:
+	mv	a0, s0
+	lw	a1, 0(s0)
+	jal	ra, rec_copy		# *Ptr_Val_Par = *Ptr_Val_Par->Ptr_Comp
+proc_1_ret:
+	lw	ra, 12(sp)
+	lw	s0, 8(sp)
+	lw	s1, 4(sp)
+	addi	sp, sp, 16
+	ret
+
+proc_2:
+	lw	t0, 0(a0)
+	addi	t0, t0, 10		# Int_Loc
+proc_2_loop:
+	lw	t1, CH_1_GLOB(zero)
+	li	t2, 'A'
+	bne	t1, t2, proc_2_loop
+	addi	t0, t0, -1
+	lw	t1, INT_GLOB(zero)
+	sub	t0, t0, t1
+	sw	t0, 0(a0)
+	ret
+
+proc_3:
+	lw	t0, PTR_GLOB(zero)
+	beqz	t0, proc_3_skip
+	lw	t1, 0(t0)
+	sw	t1, 0(a0)
+proc_3_skip:
+	li	a0, 10
+	lw	a1, INT_GLOB(zero)
+	addi	a2, t0, 12
+	j	proc_7
+
+proc_4:
+	lw	t0, CH_1_GLOB(zero)
+	addi	t0, t0, -'A'
+	seqz	t0, t0
+	lw	t1, BOOL_GLOB(zero)
+	or	t0, t0, t1
+	sw	t0, BOOL_GLOB(zero)
+	li	t0, 'B'
+	sw	t0, CH_2_GLOB(zero)
+	ret
+
+proc_5:
+	li	t0, 'A'
+	sw	t0, CH_1_GLOB(zero)
+	sw	zero, BOOL_GLOB(zero)
+	ret
+
+# a0 = Enum_Val_Par, a1 = Enum_Ref_Par
+proc_6:
+	sw	a0, 0(a1)
+	li	t0, 2
+	beq	a0, t0, proc_6_switch	# Func_3
+	li	t1, 3
+	sw	t1, 0(a1)
+proc_6_switch:
+	beqz	a0, proc_6_1
+	li	t1, 1
+	beq	a0, t1, proc_6_2
+	beq	a0, t0, proc_6_3
+	li	t1, 4
+	beq	a0, t1, proc_6_5
+	ret
+proc_6_1:
+	sw	zero, 0(a1)
+	ret
+proc_6_2:
+	lw	t1, INT_GLOB(zero)
+	li	t2, 100
+	li	t3, 3
+	bge	t2, t1, proc_6_2_set
+	li	t3, 0
+proc_6_2_set:
+	sw	t3, 0(a1)
+	ret
+proc_6_3:
+	li	t1, 1
+	sw	t1, 0(a1)
+	ret
+proc_6_5:
+	li	t1, 2
+	sw	t1, 0(a1)
+	ret
+
+# *a2 = a0 + a1 + 2
+proc_7:
+	addi	t0, a0, 2
+	add	t0, t0, a1
+	sw	t0, 0(a2)
+	ret
+
+# a0 = Arr_1, a1 = Arr_2, a2 = Int_1, a3 = Int_2
+proc_8:
+	addi	t0, a2, 5		# Int_Loc
+	slli	t1, t0, 2
+	add	t1, t1, a0		# &Arr_1[Int_Loc]
+	sw	a3, 0(t1)
+	sw	a3, 4(t1)
+	sw	t0, 120(t1)
+	slli	t2, t0, 7
+	slli	t3, t0, 6
+	add	t2, t2, t3
+	slli	t3, t0, 3
+	add	t2, t2, t3
+	add	t2, t2, a1		# &Arr_2[Int_Loc][0]
+	mv	t4, t0
+	addi	t5, t0, 1
+proc_8_loop:
+	slli	t6, t4, 2
+	add	t6, t6, t2
+	sw	t0, 0(t6)
+	addi	t4, t4, 1
+	bge	t5, t4, proc_8_loop
+	slli	t3, t0, 2
+	add	t3, t3, t2		# &Arr_2[Int_Loc][Int_Loc]
+	lw	t4, -4(t3)
+	addi	t4, t4, 1
+	sw	t4, -4(t3)
+	lw	t4, 0(t1)
+	li	t5, 20*200
+	add	t5, t5, t3
+	sw	t4, 0(t5)		# Arr_2[Int_Loc+20][Int_Loc] = Arr_1[Int_Loc]
+	li	t4, 5
+	sw	t4, INT_GLOB(zero)
+	ret
+
+# a0 = Ident_2 and Ch_1_Glob = a0 when a0 == a1, else Ident_1
+func_1:
+	beq	a0, a1, func_1_eq
+	li	a0, 0
+	ret
+func_1_eq:
+	sw	a0, CH_1_GLOB(zero)
+	li	a0, 1
+	ret
+
+# a0 = Str_1, a1 = Str_2
+func_2:
+	addi	sp, sp, -32
+	sw	ra, 28(sp)
+	sw	s0, 24(sp)
+	sw	s1, 20(sp)
+	sw	s2, 16(sp)
+	sw	s3, 12(sp)
+	mv	s0, a0
+	mv	s1, a1
+	li	s2, 2			# Int_Loc
+	li	s3, 0			# Ch_Loc
+func_2_loop:
+	li	t0, 2
+	blt	t0, s2, func_2_cmp
+	add	t1, s0, s2
+	lbu	a0, 0(t1)
+	add	t1, s1, s2
+	lbu	a1, 1(t1)
+	jal	ra, func_1
+	bnez	a0, func_2_loop
+	li	s3, 'A'
+	addi	s2, s2, 1
+	j	func_2_loop
+func_2_cmp:
+	addi	t0, s3, -'W'
+	li	t1, 3
+	bgeu	t0, t1, func_2_r
+	li	s2, 7
+func_2_r:
+	li	t0, 'R'
+	beq	s3, t0, func_2_true
+	mv	a0, s0
+	mv	a1, s1
+	jal	ra, strcmp
+	blez	a0, func_2_false
+	addi	s2, s2, 7
+	sw	s2, INT_GLOB(zero)
+func_2_true:
+	li	a0, 1
+	j	func_2_ret
+func_2_false:
+	li	a0, 0
+func_2_ret:
+	lw	ra, 28(sp)
+	lw	s0, 24(sp)
+	lw	s1, 20(sp)
+	lw	s2, 16(sp)
+	lw	s3, 12(sp)
+	addi	sp, sp, 32
+	ret
+
+# copy the 12 words of record a1 to a0
+rec_copy:
+	addi	t2, a1, 48
+rec_copy_loop:
+	lw	t0, 0(a1)
+	sw	t0, 0(a0)
+	addi	a0, a0, 4
+	addi	a1, a1, 4
+	bne	a1, t2, rec_copy_loop
+	ret
+
+strcpy:
+	lbu	t0, 0(a1)
+	sb	t0, 0(a0)
+	addi	a0, a0, 1
+	addi	a1, a1, 1
+	bnez	t0, strcpy
+	ret
+
+strcmp:
+	lbu	t0, 0(a0)
+	lbu	t1, 0(a1)
+	bne	t0, t1, strcmp_diff
+	addi	a0, a0, 1
+	addi	a1, a1, 1
+	bnez	t0, strcmp
+strcmp_diff:
+	sub	a0, t0, t1
+	ret
+
+# a0 = a0 * a1, one step per bit of a1
+mul:
+	li	t6, 0
+	beqz	a1, mul_done
+mul_loop:
+	andi	t5, a1, 1
+	beqz	t5, mul_skip
+	add	t6, t6, a0
+mul_skip:
+	slli	a0, a0, 1
+	srli	a1, a1, 1
+	bnez	a1, mul_loop
+mul_done:
+	mv	a0, t6
+	ret
+
+# a0 = a0 / a1 unsigned, one step per bit
+div:
+	li	t0, 0
+	li	t1, 0
+	li	t2, 32
+div_loop:
+	slli	t1, t1, 1
+	srli	t3, a0, 31
+	or	t1, t1, t3
+	slli	a0, a0, 1
+	slli	t0, t0, 1
+	bltu	t1, a1, div_next
+	sub	t1, t1, a1
+	ori	t0, t0, 1
+div_next:
+	addi	t2, t2, -1
+	bnez	t2, div_loop
+	mv	a0, t0
+	ret
+
+# a0 = a0 * 33 ^ a1
+mix:
+	slli	t0, a0, 5
+	add	a0, a0, t0
+	xor	a0, a0, a1
+	ret
@@ -0,0 +1,93 @@
+# list: traversal of a singly linked list of 8192 nodes laid out
+# in a random order, 40 times
+# result: a0 = hash of the sums of the traversals
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# permutation of the node numbers
+	li	s1, 0x20000		# nodes: next pointer, value
+	li	s2, 8192		# nodes
+
+	# perm[i] = i
+	li	t0, 0
+	mv	t1, s0
+ident:
+	sw	t0, 0(t1)
+	addi	t0, t0, 1
+	addi	t1, t1, 4
+	bne	t0, s2, ident
+
+	# Fisher-Yates shuffle, j = random & mask until j <= i
+	li	a0, 0x3C6EF372		# xorshift32 state
+	addi	s3, s2, -1		# i
+	mv	s4, s3			# smallest 2^k-1 >= i
+shuffle:
+	srli	t0, s4, 1
+	bltu	t0, s3, retry
+	mv	s4, t0
+retry:
+	jal	ra, xorshift
+	and	t1, a0, s4
+	bltu	s3, t1, retry
+	slli	t2, s3, 2
+	add	t2, t2, s0
+	slli	t3, t1, 2
+	add	t3, t3, s0
+	lw	t4, 0(t2)
+	lw	t5, 0(t3)
+	sw	t5, 0(t2)
+	sw	t4, 0(t3)
+	addi	s3, s3, -1
+	bnez	s3, shuffle
+
+	# node perm[k] links to node perm[k+1]
+	lw	t0, 0(s0)
+	slli	t0, t0, 3
+	add	s6, s1, t0		# head
+	mv	t2, s6
+	li	s3, 1
+link:
+	slli	t0, s3, 2
+	add	t0, t0, s0
+	lw	t0, 0(t0)
+	slli	t0, t0, 3
+	add	t0, t0, s1
+	sw	t0, 0(t2)
+	jal	ra, xorshift
+	sw	a0, 4(t2)
+	mv	t2, t0
+	addi	s3, s3, 1
+	bne	s3, s2, link
+	sw	zero, 0(t2)
+	jal	ra, xorshift
+	sw	a0, 4(t2)
+
+	li	s5, 40			# traversals
+	li	a0, 0
+walk_rep:
+	li	a1, 0
+	mv	t0, s6
+walk:
+	lw	t1, 4(t0)
+	lw	t0, 0(t0)
+	add	a1, a1, t1
+	bnez	t0, walk
+	slli	a2, a0, 5
+	add	a0, a0, a2
+	xor	a0, a0, a1
+	# the head value changes, so does the next sum
+	lw	t1, 4(s6)
+	addi	t1, t1, 1
+	sw	t1, 4(s6)
+	addi	s5, s5, -1
+	bnez	s5, walk_rep
+	ecall
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
@@ -0,0 +1,88 @@
+# matmul: 32x32 integer matrix product, RV32I has no multiply so
+# every product calls a shift-and-add routine
+# result: a0 = hash of C
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# A
+	li	s1, 0x11000		# B
+	li	s2, 0x12000		# C
+	li	s9, 32			# rows and columns
+
+	# A and B hold bytes 0..255, one per word
+	li	a0, 0x1F123BB5		# xorshift32 state
+	mv	t0, s0
+	mv	t2, s2
+fill:
+	jal	ra, xorshift
+	andi	t1, a0, 0xFF
+	sw	t1, 0(t0)
+	addi	t0, t0, 4
+	bltu	t0, t2, fill
+
+	li	s3, 0			# i
+row:
+	li	s4, 0			# j
+col:
+	li	s5, 0			# C[i][j]
+	slli	t0, s3, 7
+	add	s6, s0, t0		# &A[i][0]
+	slli	t0, s4, 2
+	add	s7, s1, t0		# &B[0][j]
+	mv	s8, s9			# k left
+dot:
+	lw	a0, 0(s6)
+	lw	a1, 0(s7)
+	jal	ra, mul
+	add	s5, s5, a0
+	addi	s6, s6, 4
+	addi	s7, s7, 128
+	addi	s8, s8, -1
+	bnez	s8, dot
+
+	slli	t0, s3, 7
+	add	t0, t0, s2
+	slli	t1, s4, 2
+	add	t0, t0, t1
+	sw	s5, 0(t0)
+	addi	s4, s4, 1
+	bne	s4, s9, col
+	addi	s3, s3, 1
+	bne	s3, s9, row
+
+	li	a0, 0
+	mv	t0, s2
+	li	t2, 0x13000
+sum:
+	lw	a1, 0(t0)
+	slli	a2, a0, 5
+	add	a0, a0, a2
+	xor	a0, a0, a1
+	addi	t0, t0, 4
+	bltu	t0, t2, sum
+	ecall
+
+# a0 = a0 * a1, one step per bit of a1
+mul:
+	li	t6, 0
+	beqz	a1, mul_done
+mul_loop:
+	andi	t5, a1, 1
+	beqz	t5, mul_skip
+	add	t6, t6, a0
+mul_skip:
+	slli	a0, a0, 1
+	srli	a1, a1, 1
+	bnez	a1, mul_loop
+mul_done:
+	mv	a0, t6
+	ret
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
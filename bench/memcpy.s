@@ -0,0 +1,77 @@
+# memcpy: word copy and unaligned byte copy of a 16 KiB buffer
+# result: a0 = hash of the byte copy
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# source
+	li	s1, 0x20000		# word copy
+	li	s2, 0x30000		# byte copy
+	li	s3, 4096		# words in the buffer
+	slli	s5, s3, 2
+	add	s5, s5, s0		# end of the source
+
+	li	a0, 0x12345678		# xorshift32 state
+	mv	t0, s0
+fill:
+	jal	ra, xorshift
+	sw	a0, 0(t0)
+	addi	t0, t0, 4
+	bltu	t0, s5, fill
+
+	li	s4, 20			# passes
+pass:
+	# four words per iteration
+	mv	t0, s0
+	mv	t1, s1
+wcopy:
+	lw	a1, 0(t0)
+	lw	a2, 4(t0)
+	lw	a3, 8(t0)
+	lw	a4, 12(t0)
+	sw	a1, 0(t1)
+	sw	a2, 4(t1)
+	sw	a3, 8(t1)
+	sw	a4, 12(t1)
+	addi	t0, t0, 16
+	addi	t1, t1, 16
+	bltu	t0, s5, wcopy
+
+	# odd source to a destination 3 bytes into a word
+	addi	t0, s0, 1
+	addi	t1, s2, 3
+	addi	t2, s5, -1
+bcopy:
+	lbu	a1, 0(t0)
+	sb	a1, 0(t1)
+	addi	t0, t0, 1
+	addi	t1, t1, 1
+	bne	t0, t2, bcopy
+
+	# the next pass copies a different source
+	lw	a1, 0(s0)
+	addi	a1, a1, 1
+	sw	a1, 0(s0)
+	addi	s4, s4, -1
+	bnez	s4, pass
+
+	li	a0, 0
+	mv	t0, s2
+	sub	t2, s5, s0
+	add	t2, t2, s2
+sum:
+	lw	a1, 0(t0)
+	slli	a2, a0, 5
+	add	a0, a0, a2
+	xor	a0, a0, a1
+	addi	t0, t0, 4
+	bltu	t0, t2, sum
+	ecall
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
@@ -0,0 +1,95 @@
+# qsort: recursive quicksort of 16384 signed words
+# result: a0 = hash of the sorted array, a1 = out of order pairs (0)
+
+	li	sp, 0x100000
+	li	s0, 0x10000		# array
+	li	s1, 16384		# elements
+	slli	s5, s1, 2
+	add	s5, s5, s0		# end of the array
+
+	li	a0, 0x0BADF00D		# xorshift32 state
+	mv	t0, s0
+fill:
+	jal	ra, xorshift
+	sw	a0, 0(t0)
+	addi	t0, t0, 4
+	bltu	t0, s5, fill
+
+	mv	a0, s0
+	addi	a1, s5, -4
+	jal	ra, qsort
+
+	jal	ra, check
+	ecall
+
+# sort the words a0..a1 (both included), Lomuto partition
+qsort:
+	bgeu	a0, a1, qsort_ret
+	addi	sp, sp, -16
+	sw	ra, 12(sp)
+	sw	s0, 8(sp)
+	sw	s1, 4(sp)
+	sw	s2, 0(sp)
+	mv	s0, a0
+	mv	s1, a1
+	lw	t0, 0(s1)		# pivot
+	mv	t1, s0			# next slot of the lower part
+	mv	t2, s0
+part:
+	lw	t3, 0(t2)
+	bge	t3, t0, part_next
+	lw	t4, 0(t1)
+	sw	t3, 0(t1)
+	sw	t4, 0(t2)
+	addi	t1, t1, 4
+part_next:
+	addi	t2, t2, 4
+	bltu	t2, s1, part
+	lw	t4, 0(t1)
+	sw	t0, 0(t1)
+	sw	t4, 0(s1)
+	mv	s2, t1
+
+	mv	a0, s0
+	addi	a1, s2, -4
+	jal	ra, qsort
+	addi	a0, s2, 4
+	mv	a1, s1
+	jal	ra, qsort
+
+	lw	ra, 12(sp)
+	lw	s0, 8(sp)
+	lw	s1, 4(sp)
+	lw	s2, 0(sp)
+	addi	sp, sp, 16
+qsort_ret:
+	ret
+
+# a0 = hash of the array s0..s5, a1 = pairs out of order
+check:
+	li	a0, 0
+	li	a1, 0
+	mv	t0, s0
+	lw	t1, 0(t0)
+check_loop:
+	lw	t2, 0(t0)
+	slli	a2, a0, 5
+	add	a0, a0, a2
+	xor	a0, a0, t2
+	bge	t2, t1, check_next
+	addi	a1, a1, 1
+check_next:
+	mv	t1, t2
+	addi	t0, t0, 4
+	bltu	t0, s5, check_loop
+	ret
+
+# a0 = next xorshift32 of a0
+xorshift:
+	slli	t6, a0, 13
+	xor	a0, a0, t6
+	srli	t6, a0, 17
+	xor	a0, a0, t6
+	slli	t6, a0, 5
+	xor	a0, a0, t6
+	ret
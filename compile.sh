@@ -1 +1,14 @@
-gcc -g rv32i_pipe.c -o PipelineCPU 
+LIB_SRC="rv32i_sim.c rv32i_pipe.c rv32i_units.c rv32i_decode.c rv32i_func.c rv32i_trace.c rv32i_pool.c rv32i_batch.c rv32i_loader.c rv32i_mem.c rv32i_cache.c rv32i_bpred.c rv32i_fwd.c rv32i_stats.c rv32i_prof.c rv32i_ckpt.c rv32i_sample.c rv32i_jit.c rv32i_hart.c rv32i_config.c rv32i_sweep.c rv32i_bench.c rv32i_ooo.c rv32i_wide.c rv32i_muldiv.c rv32i_rvc.c rv32i_csr.c"
+LIB_OBJ=$(echo $LIB_SRC | sed "s/\.c/.o/g")
+
+gcc -g -O2 -fPIC -c $LIB_SRC
+ar rcs libpipecpu.a $LIB_OBJ
+gcc -shared $LIB_OBJ -o libpipecpu.so -pthread -lm
+gcc -g -O2 rv32i_main.c libpipecpu.a -pthread -lm -o PipelineCPU
+gcc -g -O2 trace_decode.c libpipecpu.a -lm -o TraceDecode
+
+# sh compile.sh bench [options]: host throughput on the kernels of bench/
+if [ "$1" = "bench" ]; then
+	shift
+	exec ./PipelineCPU --bench bench/bench.list "$@"
+fi
@@ -6,16 +6,36 @@
  * **************************************
  */
 
+#ifndef RV32I_H
+#define RV32I_H
+
 // headers
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
 
 // defines
+#ifndef DEBUG
+#define DEBUG 0
+#endif
+
+#define D_PRINTF(x, ...) \
+	do {\
+		if(DEBUG){ \
+		printf("%s: ", x);\
+		printf(__VA_ARGS__);\
+		printf("\n");\
+		}\
+	}while(0)\
+
+
 #define REG_WIDTH 32
-#define IMEM_DEPTH 1024
-#define DMEM_DEPTH 1024
+#define IMEM_DEPTH 1024	// initial imem capacity, grows with the program
 #define WORD_SIZE 4
+#define PARCEL_SIZE 2	// instruction alignment with RVC, one uop table entry each
 #define BYTE_BIT 8
 
 // Opcode
@@ -28,6 +48,7 @@
 #define U_LU_TYPE 0b0110111
 #define U_AU_TYPE 0b0010111
 #define UJ_TYPE 0b1101111
+#define SYSTEM_TYPE 0b1110011
 
 // Func3(Loads)
 #define LB 0b000
@@ -51,6 +72,17 @@
 #define F3_SLT 0b010
 #define F3_SLTU 0b011
 
+// Func7 and func3(Multiply & Divide), R_TYPE
+#define F7_MULDIV 0b0000001
+#define F3_MUL 0b000
+#define F3_MULH 0b001
+#define F3_MULHSU 0b010
+#define F3_MULHU 0b011
+#define F3_DIV 0b100
+#define F3_DIVU 0b101
+#define F3_REM 0b110
+#define F3_REMU 0b111
+
 // Func3(Branches)
 #define F3_BEQ 0b000
 #define F3_BNE 0b001
@@ -59,6 +91,17 @@
 #define F3_BLTU 0b110
 #define F3_BGEU 0b111
 
+// Func3(System), bit 2 of the Zicsr ones selects the immediate form
+#define F3_PRIV 0b000
+#define F3_CSRRW 0b001
+#define F3_CSRRS 0b010
+#define F3_CSRRC 0b011
+#define F3_CSR_IMM 0b100
+
+// Imm(System)
+#define IMM_ECALL 0x000
+#define IMM_EBREAK 0x001
+
 // Alu control
 #define C_AND 0b0000
 #define C_OR 0b0001
@@ -71,12 +114,27 @@
 
 
 // configs
-#define CLK_NUM 1000000
+#define TOHOST_NONE 0xFFFFFFFF
+
+// Halt reason (also used as the exit code)
+enum HALT {
+  HALT_NONE = 0,
+  HALT_ECALL,
+  HALT_EBREAK,
+  HALT_TOHOST,
+  HALT_PC_OUT,
+  HALT_SELF_LOOP,
+  HALT_MAX_CYCLES,
+  HALT_MAX_INSTS,
+  HALT_FAULT
+};
 
-// Register
-enum REG {
-  READ = 0,
-  WRITE
+// Execution mode
+enum MODE {
+  MODE_PIPE = 0,
+  MODE_FUNC,
+  MODE_OOO,	// out-of-order back end in place of the pipeline
+  MODE_WIDE	// pipeline issuing several instructions per cycle
 };
 
 // structures
@@ -123,29 +181,44 @@ struct dmem_input_t {
 
 struct dmem_output_t {
   uint32_t dout;
+  uint8_t fault;	// address outside of the memory, nothing accessed
+};
+
+// branch prediction made in IF, checked in EX
+struct bpred_output_t {
+	uint8_t taken;
+	uint32_t target;
+	uint32_t idx;	// PHT entry used
+	uint32_t ras_tos;	// RAS top after this instruction, restored on a mispredict
 };
 
 // structures for pipeline registers
 struct pipe_if_id_t {
     uint8_t enable;
+    uint8_t cause;	// enum CPI_CAT of a bubble
 
     //From IF
     uint32_t pc_curr;
     struct imem_output_t imem_out;
+    struct bpred_output_t pred;
 
 };
 
 struct pipe_id_ex_t {
     uint8_t enable;
+    uint8_t cause;	// enum CPI_CAT of a bubble
 
     //From IF
     uint32_t pc_curr;
+    struct bpred_output_t pred;
 
     //From ID
     uint8_t opcode;
 	uint32_t imm;
 	uint8_t func3;
 	uint8_t func7;
+	uint8_t len;	// bytes of the instruction, 2 when compressed
+	uint8_t resolved;	// control flow already checked in ID
     struct regfile_input_t regfile_in;
     struct alu_input_t alu_in;
     struct regfile_output_t regfile_out;
@@ -154,6 +227,7 @@ struct pipe_id_ex_t {
 
 struct pipe_ex_mem_t {
     uint8_t enable;
+    uint8_t cause;	// enum CPI_CAT of a bubble
 
     //From IF
     uint32_t pc_curr;
@@ -171,6 +245,7 @@ struct pipe_ex_mem_t {
 
 struct pipe_mem_wb_t {
     uint8_t enable;
+    uint8_t cause;	// enum CPI_CAT of a bubble
 
     //From IF
     uint32_t pc_curr;
@@ -179,7 +254,6 @@ struct pipe_mem_wb_t {
     uint8_t opcode;
 	uint32_t imm;
 	uint8_t func3;
-	uint8_t rd;
     struct regfile_input_t regfile_in;
 
     //From EX
@@ -188,3 +262,12 @@ struct pipe_mem_wb_t {
     //From MEM
     struct dmem_output_t dmem_out;
 };
+
+struct mem_t;
+
+// functions
+uint8_t alu_control_gen(uint8_t opcode, uint8_t func3, uint8_t func7);
+const char *halt_name(enum HALT halt);
+uint64_t parse_size(const char *str);
+
+#endif
@@ -0,0 +1,309 @@
+/* **************************************
+ * Module: batch runner for many programs
+ *
+ * **************************************
+ */
+#include "rv32i_batch.h"
+#include "rv32i_pool.h"
+
+#define BATCH_LINE_MAX 4096
+
+struct batch_t {
+	struct sim_config_t cfg;
+
+	struct batch_job_t *job;
+	uint32_t n_jobs;
+
+	// one image per distinct (imem, dmem) pair
+	struct sim_image_t **image;
+	uint32_t *image_job;	// first job of each image
+	uint32_t n_images;
+
+	struct sim_t **sim;	// one per worker
+};
+
+uint32_t batch_reg_hash(const uint32_t *reg_data) {
+	uint32_t hash = 0x811C9DC5;
+
+	for(int i = 0; i < 32; i++){
+		for(int j = 0; j < WORD_SIZE; j++){
+			hash ^= (reg_data[i] >> j*BYTE_BIT) & 0xFF;
+			hash *= 0x01000193;
+		}
+	}
+
+	return hash;
+}
+
+char *batch_path(const char *dir, uint32_t dir_len, const char *path) {
+	char *full;
+
+	if(path[0] == '/')
+		dir_len = 0;
+	if ( (full = (char*)malloc(dir_len + strlen(path) + 1)) == NULL ) {
+		printf("Out of host memory!!\n");
+		return NULL;
+	}
+	memcpy(full, dir, dir_len);
+	strcpy(full + dir_len, path);
+
+	return full;
+}
+
+void batch_json_string(FILE *f, const char *s) {
+	fputc('"', f);
+	for(; *s; s++){
+		if(*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if((unsigned char)*s < 0x20)
+			fprintf(f, "\\u%04x", (unsigned char)*s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static int batch_parse(struct batch_t *batch, const char *manifest_path) {
+	FILE *f;
+	char line[BATCH_LINE_MAX];
+	char imem_path[BATCH_LINE_MAX], dmem_path[BATCH_LINE_MAX];
+	uint32_t cap = 0;
+	struct batch_job_t *job;
+	int ret = 0;
+	const char *slash = strrchr(manifest_path, '/');
+	uint32_t dir_len = slash ? slash - manifest_path + 1 : 0;
+
+	if ( (f = fopen(manifest_path, "r")) == NULL ) {
+		printf("Cannot find %s\n", manifest_path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *comment = strchr(line, '#');
+		if(comment)
+			*comment = '\0';
+
+		int n = sscanf(line, "%s %s", imem_path, dmem_path);
+		if(n <= 0)
+			continue;
+
+		if(batch->n_jobs == cap){
+			cap = cap ? cap*2 : 64;
+			if ( (job = (struct batch_job_t*)realloc(batch->job, cap*sizeof(struct batch_job_t))) == NULL ) {
+				printf("Out of host memory!!\n");
+				ret = -1;
+				break;
+			}
+			batch->job = job;
+		}
+		job = &batch->job[batch->n_jobs++];
+		memset(job, 0, sizeof(struct batch_job_t));
+		job->imem_path = batch_path(manifest_path, dir_len, imem_path);
+		job->dmem_path = (n == 2) ? batch_path(manifest_path, dir_len, dmem_path) : NULL;
+		if(job->imem_path == NULL || (n == 2 && job->dmem_path == NULL)){
+			ret = -1;
+			break;
+		}
+	}
+
+	fclose(f);
+	return ret;
+}
+
+// Order of two job pointers by image paths
+static int batch_cmp(const void *a, const void *b) {
+	const struct batch_job_t *ja = *(const struct batch_job_t* const*)a;
+	const struct batch_job_t *jb = *(const struct batch_job_t* const*)b;
+	int r = strcmp(ja->imem_path, jb->imem_path);
+
+	if(r || ja->dmem_path == jb->dmem_path)
+		return r;
+	if(ja->dmem_path == NULL || jb->dmem_path == NULL)
+		return ja->dmem_path ? 1 : -1;
+	return strcmp(ja->dmem_path, jb->dmem_path);
+}
+
+// Give every job the id of its image, equal paths share one
+static int batch_dedup(struct batch_t *batch) {
+	struct batch_job_t **order = (struct batch_job_t**)malloc(batch->n_jobs*sizeof(struct batch_job_t*));
+	uint32_t i;
+
+	batch->image_job = (uint32_t*)malloc(batch->n_jobs*sizeof(uint32_t));
+	if(order == NULL || batch->image_job == NULL){
+		printf("Out of host memory!!\n");
+		free(order);
+		return -1;
+	}
+
+	for(i = 0; i < batch->n_jobs; i++)
+		order[i] = &batch->job[i];
+	qsort(order, batch->n_jobs, sizeof(struct batch_job_t*), batch_cmp);
+
+	batch->n_images = 0;
+	for(i = 0; i < batch->n_jobs; i++){
+		if(i == 0 || batch_cmp(&order[i-1], &order[i]))
+			batch->image_job[batch->n_images++] = order[i] - batch->job;
+		order[i]->image_id = batch->n_images - 1;
+	}
+
+	free(order);
+	return 0;
+}
+
+static void batch_load_task(void *arg, uint32_t worker, uint32_t idx) {
+	struct batch_t *batch = (struct batch_t*)arg;
+	struct batch_job_t *job = &batch->job[batch->image_job[idx]];
+
+	(void)worker;
+	batch->image[idx] = sim_image_load(job->imem_path, job->dmem_path, 0);
+}
+
+static void batch_run_task(void *arg, uint32_t worker, uint32_t idx) {
+	struct batch_t *batch = (struct batch_t*)arg;
+	struct batch_job_t *job = &batch->job[idx];
+	struct sim_image_t *image = batch->image[job->image_id];
+	struct sim_t *sim = batch->sim[worker];
+	struct timespec t_start, t_end;
+
+	if(sim == NULL)
+		sim = batch->sim[worker] = sim_create(&batch->cfg);
+	if(sim == NULL || image == NULL || sim_attach_image(sim, image)){
+		job->err = 1;
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	sim_run(sim);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	job->host_sec = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	sim_get_stats(sim, &job->stats);
+	job->reg_hash = batch_reg_hash(sim->reg_data);
+}
+
+static void batch_write(struct batch_t *batch, FILE *f, uint8_t json) {
+	struct batch_job_t *job;
+	uint32_t i;
+
+	if(json)
+		fprintf(f, "[\n");
+	else
+		fprintf(f, "imem,dmem,halt,halt_pc,tohost_val,cycles,instructions,"
+				"func_instructions,hazards,branches,icache_misses,dcache_misses,reg_hash,host_sec\n");
+
+	for(i = 0; i < batch->n_jobs; i++){
+		job = &batch->job[i];
+		const char *halt = job->err ? "error" : halt_name(job->stats.halt);
+
+		if(json){
+			fprintf(f, "  {\"imem\": ");
+			batch_json_string(f, job->imem_path);
+			fprintf(f, ", \"dmem\": ");
+			batch_json_string(f, job->dmem_path ? job->dmem_path : "");
+			fprintf(f, ", \"halt\": \"%s\", "
+					"\"halt_pc\": %u, \"tohost_val\": %u, \"cycles\": %u, \"instructions\": %u, "
+					"\"func_instructions\": %llu, \"hazards\": %u, \"branches\": %u, "
+					"\"icache_misses\": %llu, \"dcache_misses\": %llu, \"reg_hash\": \"%08x\", \"host_sec\": %.6f}%s\n",
+					halt, job->stats.halt_pc, job->stats.tohost_val, job->stats.cycles,
+					job->stats.inst_cnt, (unsigned long long)job->stats.func_inst_cnt,
+					job->stats.hazard_cnt, job->stats.branch_cnt,
+					(unsigned long long)job->stats.icache.misses,
+					(unsigned long long)job->stats.dcache.misses,
+					job->reg_hash, job->host_sec, i+1 < batch->n_jobs ? "," : "");
+		}
+		else {
+			fprintf(f, "%s,%s,%s,0x%X,0x%08X,%u,%u,%llu,%u,%u,%llu,%llu,%08x,%.6f\n",
+					job->imem_path, job->dmem_path ? job->dmem_path : "", halt,
+					job->stats.halt_pc, job->stats.tohost_val, job->stats.cycles,
+					job->stats.inst_cnt, (unsigned long long)job->stats.func_inst_cnt,
+					job->stats.hazard_cnt, job->stats.branch_cnt,
+					(unsigned long long)job->stats.icache.misses,
+					(unsigned long long)job->stats.dcache.misses,
+					job->reg_hash, job->host_sec);
+		}
+	}
+
+	if(json)
+		fprintf(f, "]\n");
+}
+
+int batch_run(const struct sim_config_t *cfg, const char *manifest_path,
+		uint32_t n_workers, const char *out_path) {
+	struct batch_t batch;
+	struct timespec t_start, t_end;
+	FILE *f_out = stdout;
+	uint32_t i;
+	int n_err = 0;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.cfg = *cfg;
+	// sims run side by side, they must not print or share a trace file
+	batch.cfg.trace_level = TRACE_NONE;
+	batch.cfg.trace_path = NULL;
+	batch.cfg.echo_load = 0;
+
+	if(n_workers == 0)
+		n_workers = pool_default_workers();
+
+	if(batch_parse(&batch, manifest_path)){
+		n_err = -1;
+		goto out;
+	}
+	if(out_path && (f_out = fopen(out_path, "w")) == NULL){
+		printf("Cannot open %s\n", out_path);
+		n_err = -1;
+		goto out;
+	}
+
+	if(batch_dedup(&batch)){
+		n_err = -1;
+		goto out;
+	}
+	batch.image = (struct sim_image_t**)calloc(batch.n_images, sizeof(struct sim_image_t*));
+	batch.sim = (struct sim_t**)calloc(n_workers, sizeof(struct sim_t*));
+	if(batch.image == NULL || batch.sim == NULL){
+		printf("Out of host memory!!\n");
+		n_err = -1;
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	if(pool_run(batch.n_images, n_workers, batch_load_task, &batch)
+			|| pool_run(batch.n_jobs, n_workers, batch_run_task, &batch)){
+		n_err = -1;
+		goto out;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	for(i = 0; i < batch.n_jobs; i++)
+		n_err += batch.job[i].err;
+
+	size_t len = out_path ? strlen(out_path) : 0;
+	batch_write(&batch, f_out, len >= 5 && !strcmp(out_path + len - 5, ".json"));
+
+	double sec = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	fprintf(stderr, "Batch : %u programs (%u images) on %u workers in %.3f s, %d failed\n",
+			batch.n_jobs, batch.n_images, n_workers, sec, n_err);
+
+out:
+	if(f_out && f_out != stdout)
+		fclose(f_out);
+	if(batch.sim){
+		for(i = 0; i < n_workers; i++)
+			sim_destroy(batch.sim[i]);
+	}
+	if(batch.image){
+		for(i = 0; i < batch.n_images; i++)
+			sim_image_free(batch.image[i]);
+	}
+	for(i = 0; i < batch.n_jobs; i++){
+		free(batch.job[i].imem_path);
+		free(batch.job[i].dmem_path);
+	}
+	free(batch.job);
+	free(batch.image_job);
+	free(batch.image);
+	free(batch.sim);
+
+	return n_err;
+}
@@ -0,0 +1,40 @@
+/* **************************************
+ * Module: batch runner for many programs
+ *
+ * A manifest lists one "imem_file [dmem_file]" pair per
+ * line ('#' starts a comment, relative paths are taken
+ * from the manifest directory). Every program runs on its
+ * own sim_t on the worker pool. Programs listed more than
+ * once share one read-only image.
+ *
+ * **************************************
+ */
+#ifndef RV32I_BATCH_H
+#define RV32I_BATCH_H
+
+#include "rv32i_sim.h"
+
+struct batch_job_t {
+	char *imem_path;
+	char *dmem_path;	// NULL: none
+	uint32_t image_id;
+
+	int err;
+	struct sim_stats_t stats;
+	uint32_t reg_hash;	// FNV-1a of the final x0..x31
+	double host_sec;
+};
+
+uint32_t batch_reg_hash(const uint32_t *reg_data);
+// path of a manifest entry, relative ones start with the first dir_len bytes of dir
+char *batch_path(const char *dir, uint32_t dir_len, const char *path);
+// s as a JSON string, quotes, backslashes and control characters escaped
+void batch_json_string(FILE *f, const char *s);
+
+// Runs every program of the manifest with cfg, writes the results as
+// CSV (or JSON when out_path ends with .json, stdout when NULL).
+// Returns the number of programs that could not be loaded, -1 on error.
+int batch_run(const struct sim_config_t *cfg, const char *manifest_path,
+		uint32_t n_workers, const char *out_path);
+
+#endif
@@ -0,0 +1,154 @@
+/* **************************************
+ * Module: host throughput benchmark
+ *
+ * **************************************
+ */
+#include "rv32i_bench.h"
+#include "rv32i_batch.h"
+
+#define BENCH_LINE_MAX 4096
+#define BENCH_NAME_MAX 64
+
+static uint32_t bench_fnv(uint32_t hash, uint32_t word) {
+	for(int j = 0; j < WORD_SIZE; j++){
+		hash ^= (word >> j*BYTE_BIT) & 0xFF;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+uint32_t bench_state_hash(const struct sim_t *sim) {
+	uint32_t hash = batch_reg_hash(sim->reg_data);
+	uint32_t addr = 0;
+	uint8_t *page;
+
+	while((page = mem_next_page(sim->dmem, &addr)) != NULL){
+		for(uint32_t off = 0; off < MEM_PAGE_SIZE; off += WORD_SIZE){
+			uint32_t word;
+			memcpy(&word, page + off, WORD_SIZE);
+			if(word){
+				hash = bench_fnv(hash, addr + off);
+				hash = bench_fnv(hash, word);
+			}
+		}
+		if(addr == (uint32_t)-MEM_PAGE_SIZE)
+			break;
+		addr += MEM_PAGE_SIZE;
+	}
+
+	return hash;
+}
+
+// Fastest of BENCH_REPS runs, -1 when the kernel cannot be loaded or run
+static int bench_kernel(const struct sim_config_t *cfg, const struct sim_image_t *image,
+		struct sim_stats_t *stats, uint32_t *hash, double *host_sec) {
+	struct timespec t_start, t_end;
+
+	memset(stats, 0, sizeof(*stats));
+	*host_sec = 0;
+	for(int rep = 0; rep < BENCH_REPS; rep++){
+		struct sim_t *sim;
+
+		if((sim = sim_create(cfg)) == NULL || sim_attach_image(sim, image)){
+			sim_destroy(sim);
+			return -1;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t_start);
+		sim_run(sim);
+		clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+		double sec = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+		if(rep == 0 || sec < *host_sec)
+			*host_sec = sec;
+		sim_get_stats(sim, stats);
+		*hash = bench_state_hash(sim);
+		sim_destroy(sim);
+	}
+
+	return stats->halt == HALT_ECALL ? 0 : -1;
+}
+
+int bench_run(const struct sim_config_t *cfg, const char *manifest_path) {
+	FILE *f;
+	char line[BENCH_LINE_MAX];
+	char name[BENCH_NAME_MAX], hash_str[BENCH_NAME_MAX];
+	char imem_path[BENCH_LINE_MAX], dmem_path[BENCH_LINE_MAX];
+	const char *slash = strrchr(manifest_path, '/');
+	uint32_t dir_len = slash ? slash - manifest_path + 1 : 0;
+	struct sim_config_t bench_cfg = *cfg;
+	double total_sec = 0, total_cycles = 0, total_insts = 0;
+	int n_err = 0;
+
+	bench_cfg.trace_level = TRACE_NONE;
+	bench_cfg.trace_path = NULL;
+	bench_cfg.echo_load = 0;
+	bench_cfg.profile = 0;
+	if(bench_cfg.max_cycles < BENCH_MAX_CYCLES)
+		bench_cfg.max_cycles = BENCH_MAX_CYCLES;
+
+	if ( (f = fopen(manifest_path, "r")) == NULL ) {
+		printf("Cannot find %s\n", manifest_path);
+		return -1;
+	}
+
+	printf("%-10s %12s %12s %7s %9s %9s %9s %-8s\n",
+			"kernel", "insts", "cycles", "CPI", "host s", "Mcycle/s", "MIPS", "hash");
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *comment = strchr(line, '#');
+		struct sim_image_t *image;
+		struct sim_stats_t stats;
+		uint32_t hash = 0;
+		double sec;
+
+		if(comment)
+			*comment = '\0';
+		int n = sscanf(line, "%63s %63s %s %s", name, hash_str, imem_path, dmem_path);
+		if(n <= 0)
+			continue;
+		if(n < 3){
+			printf("%s: %s has no image\n", manifest_path, name);
+			n_err++;
+			continue;
+		}
+
+		char *imem = batch_path(manifest_path, dir_len, imem_path);
+		char *dmem = (n == 4) ? batch_path(manifest_path, dir_len, dmem_path) : NULL;
+		image = (imem && (n < 4 || dmem)) ? sim_image_load(imem, dmem, 0) : NULL;
+		free(imem);
+		free(dmem);
+		if(image == NULL || bench_kernel(&bench_cfg, image, &stats, &hash, &sec)){
+			printf("%-10s failed (%s)\n", name, image ? halt_name(stats.halt) : "load");
+			sim_image_free(image);
+			n_err++;
+			continue;
+		}
+		sim_image_free(image);
+
+		// the pipeline counts cycles, a functional run only instructions
+		double insts = (double)stats.inst_cnt + stats.func_inst_cnt;
+		double cycles = stats.inst_cnt ? (double)stats.cycles : 0;
+		uint8_t ok = !strcmp(hash_str, "-") || strtoul(hash_str, NULL, 16) == hash;
+
+		printf("%-10s %12.0f %12.0f ", name, insts, cycles);
+		if(stats.inst_cnt)
+			printf("%7.3f ", cycles / stats.inst_cnt);
+		else
+			printf("%7s ", "-");
+		printf("%9.3f %9.2f %9.2f %08x %s\n", sec, cycles / sec / 1e6, insts / sec / 1e6, hash,
+				!strcmp(hash_str, "-") ? "" : ok ? "ok" : "MISMATCH");
+
+		n_err += !ok;
+		total_sec += sec;
+		total_cycles += cycles;
+		total_insts += insts;
+	}
+	fclose(f);
+
+	if(total_sec > 0)
+		printf("%-10s %12.0f %12.0f %7s %9.3f %9.2f %9.2f\n", "total", total_insts, total_cycles,
+				"", total_sec, total_cycles / total_sec / 1e6, total_insts / total_sec / 1e6);
+
+	return n_err;
+}
@@ -0,0 +1,34 @@
+/* **************************************
+ * Module: host throughput benchmark
+ *
+ * Runs the kernels of a manifest (bench/bench.list) one
+ * after the other and reports how fast the simulator
+ * runs them on this host: simulated cycles and
+ * instructions per second, and the CPI of the guest.
+ * One line per kernel:
+ *   NAME HASH imem_file [dmem_file]
+ * '#' starts a comment, relative paths are taken from the
+ * manifest directory. HASH is the expected final state
+ * (bench_state_hash()), "-" only prints it.
+ *
+ * Every kernel runs BENCH_REPS times and the fastest run
+ * is kept. Tracing, load echo and the profiler are off.
+ *
+ * **************************************
+ */
+#ifndef RV32I_BENCH_H
+#define RV32I_BENCH_H
+
+#include "rv32i_sim.h"
+
+#define BENCH_REPS 3
+#define BENCH_MAX_CYCLES 100000000	// at least, the kernels run to their ecall
+
+// FNV-1a of x0..x31 then of every non-zero data word and its address,
+// the same in every mode since untouched and zero pages are skipped
+uint32_t bench_state_hash(const struct sim_t *sim);
+
+// Returns the number of kernels that failed or ended in another state, -1 on error
+int bench_run(const struct sim_config_t *cfg, const char *manifest_path);
+
+#endif
@@ -0,0 +1,240 @@
+/* **************************************
+ * Module: branch predictor
+ *
+ * **************************************
+ */
+#include "rv32i_bpred.h"
+#include "rv32i_config.h"
+
+#define BPRED_PHT_BITS_MAX 24
+
+void bpred_config_default(struct bpred_config_t *cfg) {
+	cfg->type = BPRED_NT;
+	cfg->pht_bits = 12;
+	cfg->hist_bits = 12;
+	cfg->btb_entries = 0;
+	cfg->ras_depth = 0;
+}
+
+const char *bpred_name(enum BPRED_TYPE type) {
+	switch(type){
+		case BPRED_BTFN:
+			return "btfn";
+		case BPRED_BIMODAL:
+			return "bimodal";
+		case BPRED_GSHARE:
+			return "gshare";
+		default:
+			return "nt";
+	}
+}
+
+static enum CONFIG_OPT bpred_option(void *obj, const char *key, const char *val) {
+	struct bpred_config_t *cfg = (struct bpred_config_t*)obj;
+
+	if(val == NULL){
+		if(!strcmp(key, "nt"))
+			cfg->type = BPRED_NT;
+		else if(!strcmp(key, "btfn"))
+			cfg->type = BPRED_BTFN;
+		else if(!strcmp(key, "bimodal"))
+			cfg->type = BPRED_BIMODAL;
+		else if(!strcmp(key, "gshare"))
+			cfg->type = BPRED_GSHARE;
+		else
+			return CONFIG_UNKNOWN;
+		return CONFIG_OK;
+	}
+	if(!strcmp(key, "pht"))
+		return config_u32(val, &cfg->pht_bits);
+	if(!strcmp(key, "hist"))
+		return config_u32(val, &cfg->hist_bits);
+	if(!strcmp(key, "btb"))
+		return config_u32(val, &cfg->btb_entries);
+	if(!strcmp(key, "ras"))
+		return config_u32(val, &cfg->ras_depth);
+	return CONFIG_UNKNOWN;
+}
+
+// "gshare,pht=12,hist=12,btb=512,ras=8", a word without '=' is the type
+int bpred_config_parse(struct bpred_config_t *cfg, const char *str) {
+	return config_spec_parse(str, "branch predictor", 1, bpred_option, cfg);
+}
+
+struct bpred_t *bpred_create(const struct bpred_config_t *cfg) {
+	struct bpred_t *bp;
+
+	if(cfg->pht_bits > BPRED_PHT_BITS_MAX || cfg->hist_bits > 31){
+		printf("Branch predictor tables are limited to %d index bits\n", BPRED_PHT_BITS_MAX);
+		return NULL;
+	}
+	if(cfg->btb_entries & (cfg->btb_entries - 1)){
+		printf("BTB entries must be a power of two\n");
+		return NULL;
+	}
+
+	bp = (struct bpred_t*)calloc(1, sizeof(struct bpred_t));
+	if(bp == NULL)
+		return NULL;
+
+	bp->cfg = *cfg;
+	bp->active = cfg->type != BPRED_NT || cfg->btb_entries || cfg->ras_depth;
+	bp->pht_mask = (1u << cfg->pht_bits) - 1;
+	bp->hist_mask = (1u << cfg->hist_bits) - 1;
+	bp->btb_mask = cfg->btb_entries - 1;
+
+	bp->pht = (uint8_t*)malloc(bp->pht_mask + 1);
+	bp->btb_pc = (uint32_t*)malloc((cfg->btb_entries + 1)*sizeof(uint32_t));
+	bp->btb_target = (uint32_t*)malloc((cfg->btb_entries + 1)*sizeof(uint32_t));
+	bp->ras = (uint32_t*)calloc(cfg->ras_depth + 1, sizeof(uint32_t));
+	if(bp->pht == NULL || bp->btb_pc == NULL || bp->btb_target == NULL || bp->ras == NULL){
+		bpred_destroy(bp);
+		return NULL;
+	}
+
+	bpred_reset(bp);
+
+	return bp;
+}
+
+void bpred_destroy(struct bpred_t *bp) {
+	if(bp == NULL)
+		return;
+	free(bp->pht);
+	free(bp->btb_pc);
+	free(bp->btb_target);
+	free(bp->ras);
+	free(bp);
+}
+
+void bpred_reset(struct bpred_t *bp) {
+	// weakly not taken
+	memset(bp->pht, 1, bp->pht_mask + 1);
+	bp->ghr = 0;
+
+	// pc 0xFFFFFFFF is never fetched
+	for(uint32_t i = 0; i < bp->cfg.btb_entries; i++)
+		bp->btb_pc[i] = 0xFFFFFFFF;
+
+	memset(bp->ras, 0, bp->cfg.ras_depth*sizeof(uint32_t));
+	bp->ras_tos = 0;
+
+	memset(&bp->stats, 0, sizeof(bp->stats));
+}
+
+static uint8_t is_link(uint8_t reg) {
+	return reg == 1 || reg == 5;
+}
+
+// Target of a taken control instruction, 0 when it is unknown in IF
+static uint8_t bpred_target(struct bpred_t *bp, uint32_t pc, uint32_t direct, uint32_t *target) {
+	if(bp->cfg.btb_entries){
+		uint32_t i = (pc >> 2) & bp->btb_mask;
+		bp->stats.btb_lookups++;
+		if(bp->btb_pc[i] != pc)
+			return 0;
+		bp->stats.btb_hits++;
+		*target = bp->btb_target[i];
+		return 1;
+	}
+	if(bp->cfg.type == BPRED_NT)
+		return 0;
+	*target = direct;
+	return 1;
+}
+
+struct bpred_output_t bpred_predict(struct bpred_t *bp, uint32_t pc, const struct uop_t *uop) {
+	struct bpred_output_t pred;
+	uint8_t dir = 0;
+
+	pred.taken = 0;
+	pred.target = pc + uop->len;
+	pred.idx = 0;
+
+	switch(uop->opcode){
+		case SB_TYPE:
+			switch(bp->cfg.type){
+				case BPRED_NT:
+					break;
+				case BPRED_BTFN:
+					dir = (int32_t)uop->imm < 0;
+					break;
+				case BPRED_BIMODAL:
+					pred.idx = (pc >> 2) & bp->pht_mask;
+					dir = bp->pht[pred.idx] >= 2;
+					break;
+				case BPRED_GSHARE:
+					pred.idx = ((pc >> 2) ^ bp->ghr) & bp->pht_mask;
+					dir = bp->pht[pred.idx] >= 2;
+					break;
+			}
+			if(dir)
+				pred.taken = bpred_target(bp, pc, pc + uop->imm, &pred.target);
+			break;
+
+		case UJ_TYPE:
+			pred.taken = bpred_target(bp, pc, pc + uop->imm, &pred.target);
+			break;
+
+		case I_J_TYPE:
+			if(bp->cfg.ras_depth && is_link(uop->rs1) && !is_link(uop->rd)){
+				// return
+				pred.taken = 1;
+				pred.target = bp->ras[bp->ras_tos];
+				bp->ras_tos = (bp->ras_tos + bp->cfg.ras_depth - 1) % bp->cfg.ras_depth;
+			}
+			else if(bp->cfg.btb_entries)
+				pred.taken = bpred_target(bp, pc, 0, &pred.target);
+			break;
+	}
+
+	// call
+	if(bp->cfg.ras_depth && (uop->opcode == UJ_TYPE || uop->opcode == I_J_TYPE) && is_link(uop->rd)){
+		bp->ras_tos = (bp->ras_tos + 1) % bp->cfg.ras_depth;
+		bp->ras[bp->ras_tos] = pc + uop->len;
+	}
+
+	if(!pred.taken)
+		pred.target = pc + uop->len;
+	pred.ras_tos = bp->ras_tos;
+
+	return pred;
+}
+
+// Train with the outcome from EX, returns 1 on a mispredict
+uint8_t bpred_update(struct bpred_t *bp, uint32_t pc, const struct regfile_input_t *regs, uint8_t opcode,
+		uint8_t taken, uint32_t target, const struct bpred_output_t *pred) {
+	uint8_t miss = (taken != pred->taken) || (taken && target != pred->target);
+
+	if(opcode == SB_TYPE){
+		bp->stats.branches++;
+		bp->stats.branch_miss += miss;
+
+		if(bp->cfg.type == BPRED_BIMODAL || bp->cfg.type == BPRED_GSHARE){
+			uint8_t *ctr = &bp->pht[pred->idx];
+			if(taken && *ctr < 3)
+				(*ctr)++;
+			else if(!taken && *ctr > 0)
+				(*ctr)--;
+		}
+		bp->ghr = ((bp->ghr << 1) | taken) & bp->hist_mask;
+	}
+	else {
+		bp->stats.jumps++;
+		bp->stats.jump_miss += miss;
+	}
+
+	// returns are left to the RAS
+	if(taken && bp->cfg.btb_entries
+			&& !(bp->cfg.ras_depth && opcode == I_J_TYPE && is_link(regs->rs1) && !is_link(regs->rd))){
+		uint32_t i = (pc >> 2) & bp->btb_mask;
+		bp->btb_pc[i] = pc;
+		bp->btb_target[i] = target;
+	}
+
+	// younger instructions were fetched down the wrong path
+	if(miss)
+		bp->ras_tos = pred->ras_tos;
+
+	return miss;
+}
@@ -0,0 +1,89 @@
+/* **************************************
+ * Module: branch predictor
+ *
+ * Called from IF with the pre-decoded instruction to pick
+ * the next fetch address, and from EX (ID with the full
+ * forwarding network) with the resolved outcome. A wrong
+ * prediction redirects the fetch through branch_taken and
+ * flushes IF and ID (IF only from ID).
+ *
+ * Direction of conditional branches:
+ *   nt       always not taken (no prediction at all)
+ *   btfn     backward taken, forward not taken
+ *   bimodal  2-bit counters indexed by pc
+ *   gshare   2-bit counters indexed by pc xor global history
+ *
+ * Targets come from the BTB when it is enabled, a BTB miss
+ * is predicted not taken. Without it, direct targets are
+ * taken from the pre-decoded immediate (except for nt) and
+ * jalr is not predicted. The RAS pushes the return address
+ * (pc+2 after a compressed call, else pc+4) on a call
+ * (rd x1/x5) and predicts a return (jalr from x1/x5).
+ *
+ * **************************************
+ */
+#ifndef RV32I_BPRED_H
+#define RV32I_BPRED_H
+
+#include "rv32i.h"
+#include "rv32i_decode.h"
+
+#define BPRED_FLUSH_CYCLES 2	// IF and ID work lost per mispredict resolved in EX
+
+enum BPRED_TYPE {
+  BPRED_NT = 0,
+  BPRED_BTFN,
+  BPRED_BIMODAL,
+  BPRED_GSHARE
+};
+
+struct bpred_config_t {
+	enum BPRED_TYPE type;
+	uint32_t pht_bits;	// log2 of the counters
+	uint32_t hist_bits;	// gshare global history
+	uint32_t btb_entries;	// 0: no BTB
+	uint32_t ras_depth;	// 0: no RAS
+};
+
+struct bpred_stats_t {
+	uint64_t branches;	// conditional branches resolved
+	uint64_t branch_miss;
+	uint64_t jumps;	// jal and jalr
+	uint64_t jump_miss;
+	uint64_t btb_hits;
+	uint64_t btb_lookups;
+};
+
+struct bpred_t {
+	struct bpred_config_t cfg;
+	uint8_t active;	// 0: nt without BTB and RAS never predicts taken
+
+	uint8_t *pht;
+	uint32_t pht_mask;
+	uint32_t ghr;
+	uint32_t hist_mask;
+
+	// direct-mapped BTB, structure of arrays
+	uint32_t *btb_pc;
+	uint32_t *btb_target;
+	uint32_t btb_mask;
+
+	uint32_t *ras;	// circular, the oldest entries are overwritten
+	uint32_t ras_tos;
+
+	struct bpred_stats_t stats;
+};
+
+void bpred_config_default(struct bpred_config_t *cfg);
+int bpred_config_parse(struct bpred_config_t *cfg, const char *str);
+const char *bpred_name(enum BPRED_TYPE type);
+
+struct bpred_t *bpred_create(const struct bpred_config_t *cfg);
+void bpred_destroy(struct bpred_t *bp);
+void bpred_reset(struct bpred_t *bp);
+
+struct bpred_output_t bpred_predict(struct bpred_t *bp, uint32_t pc, const struct uop_t *uop);
+uint8_t bpred_update(struct bpred_t *bp, uint32_t pc, const struct regfile_input_t *regs, uint8_t opcode,
+		uint8_t taken, uint32_t target, const struct bpred_output_t *pred);
+
+#endif
@@ -0,0 +1,266 @@
+/* **************************************
+ * Module: L1 cache timing model
+ *
+ * **************************************
+ */
+#include "rv32i_cache.h"
+#include "rv32i_config.h"
+
+void cache_config_default(struct cache_config_t *cfg) {
+	cfg->size = 0;
+	cfg->line = 32;
+	cfg->assoc = 4;
+	cfg->repl = CACHE_LRU;
+	cfg->write_back = 1;
+	cfg->hit_lat = 1;
+	cfg->miss_lat = 20;
+}
+
+static enum CONFIG_OPT cache_option(void *obj, const char *key, const char *val) {
+	struct cache_config_t *cfg = (struct cache_config_t*)obj;
+	uint64_t size;
+
+	if(!strcmp(key, "size")){
+		if(config_size(val, &size) || size > UINT32_MAX)
+			return CONFIG_BAD_VALUE;
+		cfg->size = (uint32_t)size;
+		return CONFIG_OK;
+	}
+	if(!strcmp(key, "line"))
+		return config_u32(val, &cfg->line);
+	if(!strcmp(key, "assoc"))
+		return config_u32(val, &cfg->assoc);
+	if(!strcmp(key, "hit"))
+		return config_u32(val, &cfg->hit_lat);
+	if(!strcmp(key, "miss"))
+		return config_u32(val, &cfg->miss_lat);
+	if(!strcmp(key, "repl")){
+		if(!strcmp(val, "lru"))
+			cfg->repl = CACHE_LRU;
+		else if(!strcmp(val, "plru"))
+			cfg->repl = CACHE_PLRU;
+		else if(!strcmp(val, "random"))
+			cfg->repl = CACHE_RANDOM;
+		else
+			return CONFIG_BAD_VALUE;
+		return CONFIG_OK;
+	}
+	if(!strcmp(key, "write")){
+		if(!strcmp(val, "wb"))
+			cfg->write_back = 1;
+		else if(!strcmp(val, "wt"))
+			cfg->write_back = 0;
+		else
+			return CONFIG_BAD_VALUE;
+		return CONFIG_OK;
+	}
+	return CONFIG_UNKNOWN;
+}
+
+// "size=16K,line=32,assoc=4,repl=lru|plru|random,write=wb|wt,hit=1,miss=20",
+// the keys left out keep their value
+int cache_config_parse(struct cache_config_t *cfg, const char *str) {
+	if(cfg->size == 0)
+		cfg->size = 16 << 10;
+
+	return config_spec_parse(str, "cache", 0, cache_option, cfg);
+}
+
+static uint8_t is_pow2(uint32_t n) {
+	return n && !(n & (n - 1));
+}
+
+static uint32_t log2_u32(uint32_t n) {
+	uint32_t bits = 0;
+
+	while(n >>= 1)
+		bits++;
+	return bits;
+}
+
+struct cache_t *cache_create(const struct cache_config_t *cfg) {
+	struct cache_t *cache;
+	uint32_t lines;
+
+	if(!is_pow2(cfg->size) || !is_pow2(cfg->line) || !is_pow2(cfg->assoc)
+			|| cfg->line < WORD_SIZE || cfg->size < cfg->line*cfg->assoc){
+		printf("Cache of %u bytes, %u byte lines, %u ways is not a power of two geometry\n",
+				cfg->size, cfg->line, cfg->assoc);
+		return NULL;
+	}
+	if(cfg->repl == CACHE_PLRU && cfg->assoc > CACHE_PLRU_MAX){
+		printf("PLRU supports up to %d ways\n", CACHE_PLRU_MAX);
+		return NULL;
+	}
+	if(cfg->repl == CACHE_LRU && cfg->assoc > 256){
+		printf("LRU supports up to 256 ways\n");
+		return NULL;
+	}
+	if(cfg->hit_lat == 0 || cfg->miss_lat < cfg->hit_lat){
+		printf("Cache latency must be hit >= 1 and miss >= hit\n");
+		return NULL;
+	}
+
+	cache = (struct cache_t*)calloc(1, sizeof(struct cache_t));
+	if(cache == NULL)
+		return NULL;
+
+	lines = cfg->size / cfg->line;
+	cache->cfg = *cfg;
+	cache->line_bits = log2_u32(cfg->line);
+	cache->set_mask = lines / cfg->assoc - 1;
+
+	cache->tag = (uint32_t*)malloc(lines*sizeof(uint32_t));
+	cache->dirty = (uint8_t*)malloc(lines);
+	cache->age = (uint8_t*)malloc(lines);
+	cache->plru = (uint64_t*)malloc((cache->set_mask + 1)*sizeof(uint64_t));
+	if(cache->tag == NULL || cache->dirty == NULL || cache->age == NULL || cache->plru == NULL){
+		cache_destroy(cache);
+		return NULL;
+	}
+
+	cache_reset(cache);
+
+	return cache;
+}
+
+void cache_destroy(struct cache_t *cache) {
+	if(cache == NULL)
+		return;
+	free(cache->tag);
+	free(cache->dirty);
+	free(cache->age);
+	free(cache->plru);
+	free(cache);
+}
+
+// Invalidate every line and clear the statistics
+void cache_reset(struct cache_t *cache) {
+	uint32_t lines = cache->cfg.size / cache->cfg.line;
+
+	for(uint32_t i = 0; i < lines; i++){
+		cache->tag[i] = CACHE_NO_LINE;
+		cache->age[i] = (uint8_t)(i % cache->cfg.assoc);
+	}
+	memset(cache->dirty, 0, lines);
+	memset(cache->plru, 0, (cache->set_mask + 1)*sizeof(uint64_t));
+
+	cache->last_line = CACHE_NO_LINE;
+	cache->last_idx = 0;
+	cache->rand_state = 0x9E3779B9;
+	memset(&cache->stats, 0, sizeof(cache->stats));
+}
+
+// Mark way as the most recently used of the set
+static void cache_touch(struct cache_t *cache, uint32_t set, uint32_t way) {
+	uint32_t assoc = cache->cfg.assoc;
+
+	if(cache->cfg.repl == CACHE_LRU){
+		uint8_t *age = &cache->age[set*assoc];
+		uint8_t cur = age[way];
+		for(uint32_t w = 0; w < assoc; w++){
+			if(age[w] < cur)
+				age[w]++;
+		}
+		age[way] = 0;
+	}
+	else if(cache->cfg.repl == CACHE_PLRU){
+		// node n has children 2n+1 and 2n+2, a set bit points to the right half
+		uint64_t bits = cache->plru[set];
+		uint32_t node = 0;
+		for(uint32_t half = assoc >> 1; half; half >>= 1){
+			uint8_t right = (way & half) ? 1 : 0;
+			if(right)
+				bits &= ~(1ULL << node);
+			else
+				bits |= 1ULL << node;
+			node = 2*node + 1 + right;
+		}
+		cache->plru[set] = bits;
+	}
+}
+
+static uint32_t cache_victim(struct cache_t *cache, uint32_t set) {
+	uint32_t assoc = cache->cfg.assoc;
+	uint32_t way = 0;
+
+	for(uint32_t w = 0; w < assoc; w++){
+		if(cache->tag[set*assoc + w] == CACHE_NO_LINE)
+			return w;
+	}
+
+	switch(cache->cfg.repl){
+		case CACHE_LRU:
+			for(uint32_t w = 0; w < assoc; w++){
+				if(cache->age[set*assoc + w] == assoc - 1)
+					way = w;
+			}
+			break;
+		case CACHE_PLRU: {
+			uint64_t bits = cache->plru[set];
+			uint32_t node = 0;
+			for(uint32_t half = assoc >> 1; half; half >>= 1){
+				uint8_t right = (bits >> node) & 1;
+				if(right)
+					way |= half;
+				node = 2*node + 1 + right;
+			}
+			break;
+		}
+		case CACHE_RANDOM:
+			// xorshift32
+			cache->rand_state ^= cache->rand_state << 13;
+			cache->rand_state ^= cache->rand_state >> 17;
+			cache->rand_state ^= cache->rand_state << 5;
+			way = cache->rand_state & (assoc - 1);
+			break;
+	}
+
+	return way;
+}
+
+// Lookup outside of the last accessed line
+uint32_t cache_access_slow(struct cache_t *cache, uint32_t addr, uint8_t write) {
+	uint32_t line = addr >> cache->line_bits;
+	uint32_t set = line & cache->set_mask;
+	uint32_t assoc = cache->cfg.assoc;
+	uint32_t *tag = &cache->tag[set*assoc];
+	uint32_t way, idx;
+
+	for(way = 0; way < assoc; way++){
+		if(tag[way] == line)
+			break;
+	}
+
+	if(way < assoc){
+		idx = set*assoc + way;
+		cache->stats.hits++;
+		if(write && cache->cfg.write_back)
+			cache->dirty[idx] = 1;
+		cache_touch(cache, set, way);
+		cache->last_line = line;
+		cache->last_idx = idx;
+		return cache->cfg.hit_lat;
+	}
+
+	cache->stats.misses++;
+
+	// write-through: no allocation, the store goes to the write buffer
+	if(write && !cache->cfg.write_back)
+		return cache->cfg.hit_lat;
+
+	way = cache_victim(cache, set);
+	idx = set*assoc + way;
+	if(tag[way] != CACHE_NO_LINE){
+		cache->stats.evictions++;
+		if(cache->dirty[idx])
+			cache->stats.writebacks++;
+	}
+	tag[way] = line;
+	cache->dirty[idx] = write;
+	cache_touch(cache, set, way);
+	cache->last_line = line;
+	cache->last_idx = idx;
+
+	return cache->cfg.miss_lat;
+}
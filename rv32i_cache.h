@@ -0,0 +1,91 @@
+/* **************************************
+ * Module: L1 cache timing model
+ *
+ * Set-associative cache that only tracks tags, the data
+ * itself stays in imem/dmem. An access returns the number
+ * of cycles it takes, the pipeline stalls for the cycles
+ * above one.
+ *
+ * Write-back caches allocate on a store miss. Write-through
+ * caches do not, their stores go to a write buffer and take
+ * the hit latency whether they hit or not.
+ *
+ * The tag array is kept as structure of arrays indexed by
+ * set*assoc + way, an invalid line holds CACHE_NO_LINE.
+ *
+ * **************************************
+ */
+#ifndef RV32I_CACHE_H
+#define RV32I_CACHE_H
+
+#include "rv32i.h"
+
+#define CACHE_NO_LINE 0xFFFFFFFF
+#define CACHE_PLRU_MAX 64	// tree bits of a set fit in 64 bits
+
+// Replacement policy
+enum CACHE_REPL {
+  CACHE_LRU = 0,
+  CACHE_PLRU,
+  CACHE_RANDOM
+};
+
+// size 0: no cache, every access takes one cycle
+struct cache_config_t {
+	uint32_t size;	// bytes
+	uint32_t line;	// bytes per line
+	uint32_t assoc;
+	enum CACHE_REPL repl;
+	uint8_t write_back;
+	uint32_t hit_lat;	// cycles
+	uint32_t miss_lat;
+};
+
+struct cache_stats_t {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t writebacks;	// dirty lines evicted
+};
+
+struct cache_t {
+	struct cache_config_t cfg;
+	uint32_t line_bits;
+	uint32_t set_mask;
+
+	// structure of arrays, set*assoc + way
+	uint32_t *tag;	// line address, CACHE_NO_LINE when invalid
+	uint8_t *dirty;
+	uint8_t *age;	// LRU: 0 is the most recent way of the set
+	uint64_t *plru;	// PLRU: tree bits, one word per set
+
+	// line of the last access, hitting it again changes no state
+	uint32_t last_line;
+	uint32_t last_idx;
+
+	uint32_t rand_state;
+
+	struct cache_stats_t stats;
+};
+
+void cache_config_default(struct cache_config_t *cfg);
+int cache_config_parse(struct cache_config_t *cfg, const char *str);
+
+struct cache_t *cache_create(const struct cache_config_t *cfg);
+void cache_destroy(struct cache_t *cache);
+void cache_reset(struct cache_t *cache);
+
+uint32_t cache_access_slow(struct cache_t *cache, uint32_t addr, uint8_t write);
+
+// Cycles of a read or write of addr
+static inline uint32_t cache_access(struct cache_t *cache, uint32_t addr, uint8_t write) {
+	if((addr >> cache->line_bits) != cache->last_line)
+		return cache_access_slow(cache, addr, write);
+
+	cache->stats.hits++;
+	if(write && cache->cfg.write_back)
+		cache->dirty[cache->last_idx] = 1;
+	return cache->cfg.hit_lat;
+}
+
+#endif
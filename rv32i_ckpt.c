@@ -0,0 +1,505 @@
+/* **************************************
+ * Module: checkpoint and restore of a simulator
+ *
+ * **************************************
+ */
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "rv32i_ckpt.h"
+
+static const uint8_t ckpt_zero[MEM_PAGE_SIZE];
+
+// Pad the file with zeros up to a multiple of align
+static int ckpt_pad(FILE *f, uint32_t align) {
+	long off = ftell(f);
+	size_t pad;
+
+	if(off < 0)
+		return -1;
+	pad = (align - off % align) % align;
+	if(pad && fwrite(ckpt_zero, 1, pad, f) != pad)
+		return -1;
+	return 0;
+}
+
+// Section header, the len bytes of data follow
+static int ckpt_sect(FILE *f, uint32_t tag, uint32_t len) {
+	struct ckpt_sect_t sect = { tag, len };
+
+	if(ckpt_pad(f, 8))
+		return -1;
+	return fwrite(&sect, sizeof(sect), 1, f) == 1 ? 0 : -1;
+}
+
+static void ckpt_core_get(const struct sim_t *sim, struct ckpt_core_t *core) {
+	memset(core, 0, sizeof(*core));
+	memcpy(core->reg, sim->reg_data, sizeof(core->reg));
+	core->pc_next = sim->pc_next;
+	core->cc = sim->cc;
+
+	core->id = sim->id;
+	core->ex = sim->ex;
+	core->mem = sim->mem;
+	core->wb = sim->wb;
+
+	core->id_flush = sim->id_flush;
+	core->id_stall = sim->id_stall;
+	core->if_flush = sim->if_flush;
+	core->if_stall = sim->if_stall;
+	core->pc_write = sim->pc_write;
+	core->branch_taken = sim->branch_taken;
+	core->branch_early = sim->branch_early;
+	core->if_busy = sim->if_busy;
+	core->mem_busy = sim->mem_busy;
+	core->if_wait = sim->if_wait;
+	core->mem_wait = sim->mem_wait;
+	core->div_wait = sim->div_wait;
+	core->div_busy = sim->div_busy;
+	core->fb_fill = sim->fb_fill;
+	core->forward = sim->cfg.forward;
+	core->sb = sim->sb;
+
+	core->hazard_cnt = sim->hazard_cnt;
+	core->inst_cnt = sim->inst_cnt;
+	core->branch_cnt = sim->branch_cnt;
+	core->icache_stall_cnt = sim->icache_stall_cnt;
+	core->dcache_stall_cnt = sim->dcache_stall_cnt;
+	core->mul_cnt = sim->mul_cnt;
+	core->div_cnt = sim->div_cnt;
+	core->mul_stall_cnt = sim->mul_stall_cnt;
+	core->div_stall_cnt = sim->div_stall_cnt;
+	core->fetch_insts = sim->fetch_insts;
+	core->fetch_rvc = sim->fetch_rvc;
+	core->fetch_words = sim->fetch_words;
+	core->taken_cnt = sim->taken_cnt;
+	core->func_inst_cnt = sim->func_inst_cnt;
+	memcpy(core->csr_base, sim->csr.base, sizeof(core->csr_base));
+	memcpy(core->csr_event, sim->csr.event, sizeof(core->csr_event));
+	memcpy(core->cpi, sim->cpi, sizeof(core->cpi));
+	memcpy(core->retired, sim->retired, sizeof(core->retired));
+
+	core->halt = sim->halt;
+	core->last_retire_pc = sim->last_retire_pc;
+	core->pipe_start_inst = sim->pipe_start_inst;
+	core->tohost = sim->tohost;
+	core->tohost_val = sim->tohost_val;
+	core->fault_pc = sim->fault_pc;
+	core->fault_addr = sim->fault_addr;
+}
+
+static void ckpt_core_set(struct sim_t *sim, const struct ckpt_core_t *core) {
+	memcpy(sim->reg_data, core->reg, sizeof(core->reg));
+	sim->pc_next = core->pc_next;
+	sim->cc = core->cc;
+
+	sim->id = core->id;
+	sim->ex = core->ex;
+	sim->mem = core->mem;
+	sim->wb = core->wb;
+
+	sim->id_flush = core->id_flush;
+	sim->id_stall = core->id_stall;
+	sim->if_flush = core->if_flush;
+	sim->if_stall = core->if_stall;
+	sim->pc_write = core->pc_write;
+	sim->branch_taken = core->branch_taken;
+	sim->branch_early = core->branch_early;
+	sim->if_busy = core->if_busy;
+	sim->mem_busy = core->mem_busy;
+	sim->if_wait = core->if_wait;
+	sim->mem_wait = core->mem_wait;
+	sim->div_wait = core->div_wait;
+	sim->div_busy = core->div_busy;
+	sim->fb_fill = core->fb_fill;
+	sim->sb = core->sb;
+
+	sim->hazard_cnt = core->hazard_cnt;
+	sim->inst_cnt = core->inst_cnt;
+	sim->branch_cnt = core->branch_cnt;
+	sim->icache_stall_cnt = core->icache_stall_cnt;
+	sim->dcache_stall_cnt = core->dcache_stall_cnt;
+	sim->mul_cnt = core->mul_cnt;
+	sim->div_cnt = core->div_cnt;
+	sim->mul_stall_cnt = core->mul_stall_cnt;
+	sim->div_stall_cnt = core->div_stall_cnt;
+	sim->fetch_insts = core->fetch_insts;
+	sim->fetch_rvc = core->fetch_rvc;
+	sim->fetch_words = core->fetch_words;
+	sim->taken_cnt = core->taken_cnt;
+	sim->func_inst_cnt = core->func_inst_cnt;
+	memcpy(sim->csr.base, core->csr_base, sizeof(core->csr_base));
+	memcpy(sim->csr.event, core->csr_event, sizeof(core->csr_event));
+	memcpy(sim->cpi, core->cpi, sizeof(core->cpi));
+	memcpy(sim->retired, core->retired, sizeof(core->retired));
+
+	sim->halt = (enum HALT)core->halt;
+	sim->last_retire_pc = core->last_retire_pc;
+	sim->pipe_start_inst = core->pipe_start_inst;
+	if(sim->cfg.tohost == TOHOST_NONE)
+		sim->tohost = core->tohost;
+	sim->tohost_val = core->tohost_val;
+	sim->fault_pc = core->fault_pc;
+	sim->fault_addr = core->fault_addr;
+}
+
+static uint32_t ckpt_cache_len(const struct cache_t *cache) {
+	uint32_t lines = cache->cfg.size / cache->cfg.line;
+
+	return sizeof(struct cache_config_t) + lines*(sizeof(uint32_t) + 2) + (cache->set_mask + 1)*sizeof(uint64_t)
+			+ 3*sizeof(uint32_t) + sizeof(struct cache_stats_t);
+}
+
+static int ckpt_cache_save(FILE *f, uint32_t tag, const struct cache_t *cache) {
+	uint32_t lines = cache->cfg.size / cache->cfg.line;
+	int err = 0;
+
+	if(ckpt_sect(f, tag, ckpt_cache_len(cache)))
+		return -1;
+	err |= fwrite(&cache->cfg, sizeof(cache->cfg), 1, f) != 1;
+	err |= fwrite(cache->tag, sizeof(uint32_t), lines, f) != lines;
+	err |= fwrite(cache->dirty, 1, lines, f) != lines;
+	err |= fwrite(cache->age, 1, lines, f) != lines;
+	err |= fwrite(cache->plru, sizeof(uint64_t), cache->set_mask + 1, f) != cache->set_mask + 1;
+	err |= fwrite(&cache->last_line, sizeof(uint32_t), 1, f) != 1;
+	err |= fwrite(&cache->last_idx, sizeof(uint32_t), 1, f) != 1;
+	err |= fwrite(&cache->rand_state, sizeof(uint32_t), 1, f) != 1;
+	err |= fwrite(&cache->stats, sizeof(cache->stats), 1, f) != 1;
+
+	return err ? -1 : 0;
+}
+
+// Section p was written by a cache configured like this one
+static uint8_t ckpt_cache_match(const struct cache_t *cache, const uint8_t *p, uint32_t len) {
+	struct cache_config_t cfg;
+
+	if(p == NULL || len != ckpt_cache_len(cache))
+		return 0;
+	memcpy(&cfg, p, sizeof(cfg));
+	return cfg.size == cache->cfg.size && cfg.line == cache->cfg.line && cfg.assoc == cache->cfg.assoc
+			&& cfg.repl == cache->cfg.repl && cfg.write_back == cache->cfg.write_back
+			&& cfg.hit_lat == cache->cfg.hit_lat && cfg.miss_lat == cache->cfg.miss_lat;
+}
+
+// The section was written by a cache of the same config, so the sizes match
+static void ckpt_cache_restore(struct cache_t *cache, const uint8_t *p) {
+	uint32_t lines = cache->cfg.size / cache->cfg.line;
+
+	p += sizeof(struct cache_config_t);
+	memcpy(cache->tag, p, lines*sizeof(uint32_t));
+	p += lines*sizeof(uint32_t);
+	memcpy(cache->dirty, p, lines);
+	p += lines;
+	memcpy(cache->age, p, lines);
+	p += lines;
+	memcpy(cache->plru, p, (cache->set_mask + 1)*sizeof(uint64_t));
+	p += (cache->set_mask + 1)*sizeof(uint64_t);
+	memcpy(&cache->last_line, p, sizeof(uint32_t));
+	memcpy(&cache->last_idx, p + 4, sizeof(uint32_t));
+	memcpy(&cache->rand_state, p + 8, sizeof(uint32_t));
+	memcpy(&cache->stats, p + 12, sizeof(cache->stats));
+}
+
+static uint32_t ckpt_bpred_len(const struct bpred_t *bp) {
+	return sizeof(struct bpred_config_t) + 2*sizeof(uint32_t) + sizeof(struct bpred_stats_t)
+			+ (bp->pht_mask + 1) + 2*(bp->cfg.btb_entries + 1)*sizeof(uint32_t)
+			+ (bp->cfg.ras_depth + 1)*sizeof(uint32_t);
+}
+
+static int ckpt_bpred_save(FILE *f, const struct bpred_t *bp) {
+	uint32_t btb = bp->cfg.btb_entries + 1, ras = bp->cfg.ras_depth + 1;
+	int err = 0;
+
+	if(ckpt_sect(f, CKPT_BPRED, ckpt_bpred_len(bp)))
+		return -1;
+	err |= fwrite(&bp->cfg, sizeof(bp->cfg), 1, f) != 1;
+	err |= fwrite(&bp->ghr, sizeof(uint32_t), 1, f) != 1;
+	err |= fwrite(&bp->ras_tos, sizeof(uint32_t), 1, f) != 1;
+	err |= fwrite(&bp->stats, sizeof(bp->stats), 1, f) != 1;
+	err |= fwrite(bp->pht, 1, bp->pht_mask + 1, f) != bp->pht_mask + 1;
+	err |= fwrite(bp->btb_pc, sizeof(uint32_t), btb, f) != btb;
+	err |= fwrite(bp->btb_target, sizeof(uint32_t), btb, f) != btb;
+	err |= fwrite(bp->ras, sizeof(uint32_t), ras, f) != ras;
+
+	return err ? -1 : 0;
+}
+
+static void ckpt_bpred_restore(struct bpred_t *bp, const uint8_t *p) {
+	uint32_t btb = bp->cfg.btb_entries + 1, ras = bp->cfg.ras_depth + 1;
+
+	p += sizeof(struct bpred_config_t);
+	memcpy(&bp->ghr, p, sizeof(uint32_t));
+	memcpy(&bp->ras_tos, p + 4, sizeof(uint32_t));
+	p += 2*sizeof(uint32_t);
+	memcpy(&bp->stats, p, sizeof(bp->stats));
+	p += sizeof(bp->stats);
+	memcpy(bp->pht, p, bp->pht_mask + 1);
+	p += bp->pht_mask + 1;
+	memcpy(bp->btb_pc, p, btb*sizeof(uint32_t));
+	p += btb*sizeof(uint32_t);
+	memcpy(bp->btb_target, p, btb*sizeof(uint32_t));
+	p += btb*sizeof(uint32_t);
+	memcpy(bp->ras, p, ras*sizeof(uint32_t));
+}
+
+// Index of the pages worth saving, all-zero pages read back as zero anyway
+static uint32_t *ckpt_mem_pages(const struct mem_t *mem, uint32_t *cnt) {
+	uint32_t *addr = (uint32_t*)malloc((mem->page_cnt + 1)*sizeof(uint32_t));
+	uint32_t a = 0, n = 0;
+	uint8_t *page;
+
+	if(addr == NULL)
+		return NULL;
+	while( (page = mem_next_page(mem, &a)) != NULL ){
+		if(n < mem->page_cnt && memcmp(page, ckpt_zero, MEM_PAGE_SIZE))
+			addr[n++] = a;
+		if(a + MEM_PAGE_SIZE == 0)
+			break;
+		a += MEM_PAGE_SIZE;
+	}
+	*cnt = n;
+	return addr;
+}
+
+static int ckpt_mem_save(FILE *f, struct mem_t *mem) {
+	struct ckpt_mem_t hdr;
+	uint32_t *addr;
+	long off;
+	int err = 0;
+
+	if ( (addr = ckpt_mem_pages(mem, &hdr.page_cnt)) == NULL )
+		return -1;
+	hdr.base = mem->base;
+	hdr.size = mem->size;
+
+	if(ckpt_sect(f, CKPT_MEM, sizeof(hdr) + hdr.page_cnt*sizeof(uint32_t)) || (off = ftell(f)) < 0){
+		free(addr);
+		return -1;
+	}
+	off += sizeof(hdr) + hdr.page_cnt*sizeof(uint32_t);
+	hdr.data_off = (off + MEM_PAGE_SIZE - 1) & ~(long)MEM_PAGE_MASK;
+
+	err |= fwrite(&hdr, sizeof(hdr), 1, f) != 1;
+	err |= fwrite(addr, sizeof(uint32_t), hdr.page_cnt, f) != hdr.page_cnt;
+	err |= ckpt_pad(f, MEM_PAGE_SIZE);
+	for(uint32_t i = 0; i < hdr.page_cnt && !err; i++)
+		err |= fwrite(mem_page_walk(mem, addr[i], 0), MEM_PAGE_SIZE, 1, f) != 1;
+
+	free(addr);
+	return err ? -1 : 0;
+}
+
+int ckpt_save(struct sim_t *sim, const char *path) {
+	struct ckpt_header_t hdr;
+	struct ckpt_core_t core;
+	struct ckpt_imem_t imem;
+	FILE *f;
+	int err = 0;
+
+	if ( (f = fopen(path, "wb")) == NULL ) {
+		printf("Cannot open %s\n", path);
+		return -1;
+	}
+
+	hdr.magic = CKPT_MAGIC;
+	hdr.version = CKPT_VERSION;
+	hdr.core_size = sizeof(struct ckpt_core_t);
+	hdr.flags = 0;
+	err |= fwrite(&hdr, sizeof(hdr), 1, f) != 1;
+
+	ckpt_core_get(sim, &core);
+	err |= ckpt_sect(f, CKPT_CORE, sizeof(core));
+	err |= fwrite(&core, sizeof(core), 1, f) != 1;
+
+	imem.imem_base = sim->imem_base;
+	imem.imem_size = sim->imem_size;
+	imem.entry = sim->entry;
+	imem.tohost = sim->image->tohost;
+	imem.dmem_base = sim->image->dmem_base;
+	imem.dmem_end = sim->image->dmem_end;
+	err |= ckpt_sect(f, CKPT_IMEM, sizeof(imem) + sim->imem_size*sizeof(uint32_t));
+	err |= fwrite(&imem, sizeof(imem), 1, f) != 1;
+	err |= fwrite(sim->imem_data, sizeof(uint32_t), sim->imem_size, f) != sim->imem_size;
+
+	if(sim->icache)
+		err |= ckpt_cache_save(f, CKPT_ICACHE, sim->icache);
+	if(sim->dcache)
+		err |= ckpt_cache_save(f, CKPT_DCACHE, sim->dcache);
+	err |= ckpt_bpred_save(f, sim->bpred);
+
+	// last, the page data runs up to the end of the file
+	err |= ckpt_mem_save(f, sim->dmem);
+
+	if(fclose(f) || err){
+		printf("Cannot write checkpoint %s\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+// Rebuild the program image the checkpoint was taken on
+static struct sim_image_t *ckpt_image(const uint8_t *p, uint32_t len) {
+	struct ckpt_imem_t imem;
+	struct sim_image_t *image;
+
+	if(len < sizeof(imem))
+		return NULL;
+	memcpy(&imem, p, sizeof(imem));
+	if(sizeof(imem) + (uint64_t)imem.imem_size*sizeof(uint32_t) > len)
+		return NULL;
+	if ( (image = sim_image_create()) == NULL )
+		return NULL;
+
+	if(imem.imem_size > image->imem_cap){
+		free(image->imem_data);
+		image->imem_data = (uint32_t*)malloc(imem.imem_size*sizeof(uint32_t));
+		image->imem_cap = imem.imem_size;
+	}
+	if(image->imem_data == NULL){
+		sim_image_free(image);
+		return NULL;
+	}
+	memcpy(image->imem_data, p + sizeof(imem), imem.imem_size*sizeof(uint32_t));
+	image->imem_size = imem.imem_size;
+	image->imem_base = imem.imem_base;
+	image->entry = imem.entry;
+	image->tohost = imem.tohost;
+	image->dmem_base = imem.dmem_base;
+	image->dmem_end = imem.dmem_end;
+
+	image->uop_table = decode_table_create(image->imem_data, image->imem_size ? image->imem_size : 1);
+	if(image->uop_table == NULL){
+		sim_image_free(image);
+		return NULL;
+	}
+	return image;
+}
+
+// Point dmem at the pages of the mapped file, the sim owns the mapping after this
+static int ckpt_mem_restore(struct mem_t *mem, uint8_t *map, size_t map_len, const uint8_t *p, uint32_t len) {
+	struct ckpt_mem_t hdr;
+	uint32_t addr;
+
+	// the page list and the pages must lie in the section and the file
+	if(len < sizeof(hdr))
+		return -1;
+	memcpy(&hdr, p, sizeof(hdr));
+	if(sizeof(hdr) + (uint64_t)hdr.page_cnt*sizeof(uint32_t) > len
+			|| hdr.data_off % MEM_PAGE_SIZE || hdr.data_off > map_len
+			|| (uint64_t)hdr.page_cnt*MEM_PAGE_SIZE > map_len - hdr.data_off)
+		return -1;
+	mem->base = hdr.base;
+	mem->size = hdr.size;
+	if(mem_adopt_map(mem, map, map_len))
+		return -1;
+
+	for(uint32_t i = 0; i < hdr.page_cnt; i++){
+		memcpy(&addr, p + sizeof(hdr) + i*sizeof(uint32_t), sizeof(addr));
+		if(mem_adopt_page(mem, addr, map + hdr.data_off + (uint64_t)i*MEM_PAGE_SIZE))
+			return -1;
+	}
+	return 0;
+}
+
+int ckpt_restore(struct sim_t *sim, const char *path) {
+	const uint8_t *sect[CKPT_SECT_NUM] = { NULL };
+	uint32_t sect_len[CKPT_SECT_NUM] = { 0 };
+	struct ckpt_header_t hdr;
+	const struct ckpt_core_t *core;
+	struct ckpt_sect_t s;
+	struct sim_image_t *image;
+	struct bpred_config_t bpred_cfg;
+	struct stat st;
+	uint8_t *map;
+	size_t off;
+	int fd;
+
+	if ( (fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) ) {
+		printf("Cannot open %s\n", path);
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	// private and writable: stores to dmem copy the page, the file is not changed
+	map = (uint8_t*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED || (size_t)st.st_size < sizeof(hdr)){
+		printf("Cannot map %s\n", path);
+		if(map != MAP_FAILED)
+			munmap(map, st.st_size);
+		return -1;
+	}
+
+	memcpy(&hdr, map, sizeof(hdr));
+	if(hdr.magic != CKPT_MAGIC || hdr.version != CKPT_VERSION || hdr.core_size != sizeof(struct ckpt_core_t)){
+		printf("%s: not a checkpoint of this simulator version\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	for(off = sizeof(hdr); off + sizeof(s) <= (size_t)st.st_size; ){
+		memcpy(&s, map + off, sizeof(s));
+		off += sizeof(s);
+		if(s.tag == CKPT_END || off + s.len > (size_t)st.st_size)
+			break;
+		if(s.tag < CKPT_SECT_NUM){
+			sect[s.tag] = map + off;
+			sect_len[s.tag] = s.len;
+		}
+		off = (off + s.len + 7) & ~(size_t)7;
+		if(s.tag == CKPT_MEM)
+			break;
+	}
+	if(sect[CKPT_CORE] == NULL || sect_len[CKPT_CORE] != sizeof(struct ckpt_core_t)
+			|| sect[CKPT_IMEM] == NULL || sect[CKPT_MEM] == NULL
+			|| ((const struct ckpt_core_t*)sect[CKPT_CORE])->forward >= FWD_NUM){
+		printf("%s: truncated checkpoint\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+
+	if ( (image = ckpt_image(sect[CKPT_IMEM], sect_len[CKPT_IMEM])) == NULL || sim_own_image(sim, image) ) {
+		printf("%s: bad program section\n", path);
+		munmap(map, st.st_size);
+		return -1;
+	}
+	if(ckpt_mem_restore(sim->dmem, map, st.st_size, sect[CKPT_MEM], sect_len[CKPT_MEM])){
+		printf("%s: bad memory section\n", path);
+		if(sim->dmem->map == NULL)
+			munmap(map, st.st_size);
+		mem_clear(sim->dmem);
+		return -1;
+	}
+	ckpt_core_set(sim, (const struct ckpt_core_t*)sect[CKPT_CORE]);
+
+	// The scoreboard and the latches of a running pipeline only make
+	// sense with the network that filled them; an empty one takes any
+	core = (const struct ckpt_core_t*)sect[CKPT_CORE];
+	if(sim->cc != SIM_CC_START && core->forward != sim->cfg.forward){
+		printf("%s: taken with --forward %s, the run goes on with it\n", path, fwd_name((enum FWD)core->forward));
+		sim->cfg.forward = (enum FWD)core->forward;
+		sim->fwd = fwd_get(sim->cfg.forward);
+	}
+
+	// Warm state only carries over to the same configuration
+	if(sim->icache){
+		if(ckpt_cache_match(sim->icache, sect[CKPT_ICACHE], sect_len[CKPT_ICACHE]))
+			ckpt_cache_restore(sim->icache, sect[CKPT_ICACHE]);
+		else
+			printf("%s: I-cache configuration differs, it starts cold\n", path);
+	}
+	if(sim->dcache){
+		if(ckpt_cache_match(sim->dcache, sect[CKPT_DCACHE], sect_len[CKPT_DCACHE]))
+			ckpt_cache_restore(sim->dcache, sect[CKPT_DCACHE]);
+		else
+			printf("%s: D-cache configuration differs, it starts cold\n", path);
+	}
+	if(sect[CKPT_BPRED] && !memcmp(memcpy(&bpred_cfg, sect[CKPT_BPRED], sizeof(bpred_cfg)),
+			&sim->bpred->cfg, sizeof(bpred_cfg)) && sect_len[CKPT_BPRED] == ckpt_bpred_len(sim->bpred))
+		ckpt_bpred_restore(sim->bpred, sect[CKPT_BPRED]);
+	else if(sim->bpred->active)
+		printf("%s: branch predictor configuration differs, it starts cold\n", path);
+
+	return 0;
+}
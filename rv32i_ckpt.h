@@ -0,0 +1,130 @@
+/* **************************************
+ * Module: checkpoint and restore of a simulator
+ *
+ * A checkpoint holds everything needed to continue a run
+ * in another process: registers, pc, pipeline registers,
+ * hazard flags, scoreboard, counters and CSRs, the program,
+ * the data memory and the cache and branch predictor state.
+ *
+ * File layout, little-endian:
+ *   struct ckpt_header_t
+ *   sections of struct ckpt_sect_t + len bytes, 8 byte
+ *   aligned, up to CKPT_END
+ * The MEM section lists the addresses of the non-zero
+ * pages, their data follows from data_off, page aligned,
+ * so a restore maps the pages instead of reading them.
+ *
+ * The cache and predictor contents are only restored into
+ * a sim with the same configuration, otherwise they start
+ * cold. The profiler starts empty.
+ *
+ * **************************************
+ */
+#ifndef RV32I_CKPT_H
+#define RV32I_CKPT_H
+
+#include "rv32i_sim.h"
+
+#define CKPT_MAGIC 0x4B435652	// "RVCK"
+#define CKPT_VERSION 8
+
+// Section tags
+enum CKPT_SECT {
+  CKPT_END = 0,
+  CKPT_CORE,
+  CKPT_IMEM,
+  CKPT_ICACHE,
+  CKPT_DCACHE,
+  CKPT_BPRED,
+  CKPT_MEM,
+  CKPT_SECT_NUM
+};
+
+struct ckpt_header_t {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t core_size;	// sizeof(struct ckpt_core_t) of the writer
+	uint32_t flags;
+};
+
+struct ckpt_sect_t {
+	uint32_t tag;
+	uint32_t len;
+};
+
+// Processor state, written as is
+struct ckpt_core_t {
+	uint32_t reg[32];
+	uint32_t pc_next;
+	uint32_t cc;
+
+	struct pipe_if_id_t id;
+	struct pipe_id_ex_t ex;
+	struct pipe_ex_mem_t mem;
+	struct pipe_mem_wb_t wb;
+
+	uint8_t id_flush;
+	uint8_t id_stall;
+	uint8_t if_flush;
+	uint8_t if_stall;
+	uint8_t pc_write;
+	uint8_t branch_taken;
+	uint8_t branch_early;
+	uint8_t if_busy;
+	uint8_t mem_busy;
+	uint32_t if_wait;
+	uint32_t mem_wait;
+	uint32_t div_wait;
+	uint8_t div_busy;
+	uint8_t fb_fill;
+	uint8_t forward;	// enum FWD the scoreboard and the latches were built under
+	struct scoreboard_t sb;
+
+	uint32_t hazard_cnt;
+	uint32_t inst_cnt;
+	uint32_t branch_cnt;
+	uint32_t icache_stall_cnt;
+	uint32_t dcache_stall_cnt;
+	uint32_t mul_cnt;
+	uint32_t div_cnt;
+	uint32_t mul_stall_cnt;
+	uint32_t div_stall_cnt;
+	uint32_t fetch_insts;
+	uint32_t fetch_rvc;
+	uint32_t fetch_words;
+	uint32_t taken_cnt;
+	uint64_t func_inst_cnt;
+	uint64_t csr_base[CSR_CNT_NUM];
+	uint8_t csr_event[CSR_CNT_NUM];
+	uint64_t cpi[CPI_NUM];
+	uint64_t retired[RC_NUM];
+
+	uint32_t halt;
+	uint32_t last_retire_pc;
+	uint32_t pipe_start_inst;
+	uint32_t tohost;
+	uint32_t tohost_val;
+	uint32_t fault_pc;
+	uint32_t fault_addr;
+};
+
+struct ckpt_imem_t {
+	uint32_t imem_base;
+	uint32_t imem_size;	// words that follow
+	uint32_t entry;
+	uint32_t tohost;
+	uint32_t dmem_base;
+	uint32_t dmem_end;
+};
+
+struct ckpt_mem_t {
+	uint32_t base;
+	uint32_t page_cnt;	// page addresses that follow
+	uint64_t size;
+	uint64_t data_off;	// file offset of the first page
+};
+
+int ckpt_save(struct sim_t *sim, const char *path);
+int ckpt_restore(struct sim_t *sim, const char *path);
+
+#endif
@@ -0,0 +1,313 @@
+/* **************************************
+ * Module: runtime configuration files
+ *
+ * **************************************
+ */
+#include <ctype.h>
+#include <errno.h>
+#include "rv32i_config.h"
+
+int config_spec_parse(const char *spec, const char *unit, uint8_t words, config_option_fn fn, void *obj) {
+	char buf[CONFIG_LINE_MAX];
+	char *key, *val, *save;
+
+	if(strlen(spec) >= sizeof(buf)){
+		printf("The %s spec is longer than %d characters\n", unit, CONFIG_LINE_MAX - 1);
+		return -1;
+	}
+	strcpy(buf, spec);
+
+	for(key = strtok_r(buf, ",", &save); key; key = strtok_r(NULL, ",", &save)){
+		if((val = strchr(key, '=')) != NULL)
+			*val++ = '\0';
+		else if(!words){
+			printf("No value for %s option %s\n", unit, key);
+			return -1;
+		}
+
+		switch(fn(obj, key, val)){
+			case CONFIG_OK:
+				break;
+			case CONFIG_BAD_VALUE:
+				printf("Bad value for %s option %s=%s\n", unit, key, val);
+				return -1;
+			default:
+				if(val)
+					printf("Unknown %s option %s=%s\n", unit, key, val);
+				else
+					printf("Unknown %s %s\n", unit, key);
+				return -1;
+		}
+	}
+
+	return 0;
+}
+
+enum CONFIG_OPT config_size(const char *val, uint64_t *out) {
+	char *end;
+	uint64_t n;
+	uint32_t shift = 0;
+
+	errno = 0;
+	n = strtoull(val, &end, 0);
+	if(end == val || *val == '-' || errno)
+		return CONFIG_BAD_VALUE;
+	switch(*end){
+		case 'k': case 'K':
+			shift = 10;
+			end++;
+			break;
+		case 'm': case 'M':
+			shift = 20;
+			end++;
+			break;
+		case 'g': case 'G':
+			shift = 30;
+			end++;
+			break;
+	}
+	if(*end || n > (UINT64_MAX >> shift))
+		return CONFIG_BAD_VALUE;
+	*out = n << shift;
+	return CONFIG_OK;
+}
+
+enum CONFIG_OPT config_u32(const char *val, uint32_t *out) {
+	char *end;
+	unsigned long long n;
+
+	errno = 0;
+	n = strtoull(val, &end, 0);
+	if(end == val || *end || *val == '-' || errno || n > UINT32_MAX)
+		return CONFIG_BAD_VALUE;
+	*out = (uint32_t)n;
+	return CONFIG_OK;
+}
+
+enum CONFIG_OPT config_double(const char *val, double *out) {
+	char *end;
+	double d = strtod(val, &end);
+
+	if(end == val || *end)
+		return CONFIG_BAD_VALUE;
+	*out = d;
+	return CONFIG_OK;
+}
+
+// "sub=val" for the option parser of a unit, "val" alone when sub is NULL
+static const char *config_unit(char *buf, size_t len, const char *sub, const char *val) {
+	if(sub)
+		snprintf(buf, len, "%s=%s", sub, val);
+	else
+		snprintf(buf, len, "%s", val);
+	return buf;
+}
+
+static int config_cache(struct cache_config_t *cc, const char *sub, const char *val) {
+	char buf[CONFIG_LINE_MAX];
+
+	if(sub == NULL && !strcmp(val, "none")){
+		cc->size = 0;
+		return 0;
+	}
+	return cache_config_parse(cc, config_unit(buf, sizeof(buf), sub, val));
+}
+
+int config_set(struct sim_config_t *cfg, const char *key, const char *val) {
+	char buf[CONFIG_LINE_MAX];
+	const char *dot = strchr(key, '.');
+	const char *sub = dot ? dot + 1 : NULL;
+	size_t len = dot ? (size_t)(dot - key) : strlen(key);
+
+	if(!strncmp(key, "icache", len) && len == 6)
+		return config_cache(&cfg->icache, sub, val);
+	if(!strncmp(key, "dcache", len) && len == 6)
+		return config_cache(&cfg->dcache, sub, val);
+	if(!strncmp(key, "bpred", len) && len == 5)
+		return bpred_config_parse(&cfg->bpred,
+				config_unit(buf, sizeof(buf), sub && strcmp(sub, "type") ? sub : NULL, val));
+	if(!strncmp(key, "ooo", len) && len == 3)
+		return ooo_config_parse(&cfg->ooo, config_unit(buf, sizeof(buf), sub, val));
+	if(!strncmp(key, "wide", len) && len == 4)
+		return wide_config_parse(&cfg->wide, config_unit(buf, sizeof(buf), sub, val));
+	if(!strncmp(key, "muldiv", len) && len == 6)
+		return muldiv_config_parse(&cfg->muldiv, config_unit(buf, sizeof(buf), sub, val));
+
+	if(!strcmp(key, "max_cycles"))
+		cfg->max_cycles = (uint32_t)parse_size(val);
+	else if(!strcmp(key, "max_insts"))
+		cfg->max_insts = parse_size(val);
+	else if(!strcmp(key, "tohost"))
+		cfg->tohost = strtoul(val, NULL, 0);
+	else if(!strcmp(key, "mem_size"))
+		cfg->mem_size = parse_size(val);
+	else if(!strcmp(key, "mem_base"))
+		cfg->mem_base = strtoul(val, NULL, 0);
+	else if(!strcmp(key, "ff"))
+		cfg->ff_insts = parse_size(val);
+	else if(!strcmp(key, "ff_pc"))
+		cfg->ff_pc = strtoul(val, NULL, 0);
+	else if(!strcmp(key, "forward"))
+		return fwd_parse(&cfg->forward, val);
+	else if(!strcmp(key, "jit"))
+		cfg->jit = strtoul(val, NULL, 0) != 0;
+	else if(!strcmp(key, "mode") && !strcmp(val, "pipe"))
+		cfg->mode = MODE_PIPE;
+	else if(!strcmp(key, "mode") && !strcmp(val, "func"))
+		cfg->mode = MODE_FUNC;
+	else if(!strcmp(key, "mode") && !strcmp(val, "ooo"))
+		cfg->mode = MODE_OOO;
+	else if(!strcmp(key, "mode") && !strcmp(val, "wide"))
+		cfg->mode = MODE_WIDE;
+	else {
+		printf("Unknown setting %s = %s\n", key, val);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void config_add_value(struct config_param_t *param, const char *val) {
+	param->val = (char**)realloc(param->val, (param->n_val + 1) * sizeof(char*));
+	param->val[param->n_val++] = strdup(val);
+}
+
+// "A..B+STEP", "A..B*FACTOR" or "A..B", -1 on a malformed range
+static int config_add_range(struct config_param_t *param, const char *tok) {
+	char buf[64];
+	const char *dots = strstr(tok, "..");
+	const char *op = strpbrk(dots + 2, "+*");
+	uint64_t v = parse_size(tok);
+	uint64_t end = parse_size(dots + 2);
+	uint64_t step = op ? parse_size(op + 1) : 1;
+
+	if(v > end || (op && *op == '*' ? step < 2 : step < 1)){
+		printf("Bad range %s\n", tok);
+		return -1;
+	}
+
+	for(; v <= end; v = (op && *op == '*') ? v * step : v + step){
+		if(param->n_val == CONFIG_VALUES_MAX){
+			printf("Range %s has more than %d values\n", tok, CONFIG_VALUES_MAX);
+			return -1;
+		}
+		snprintf(buf, sizeof(buf), "%llu", (unsigned long long)v);
+		config_add_value(param, buf);
+	}
+
+	return 0;
+}
+
+struct config_file_t *config_file_load(const char *path) {
+	FILE *f;
+	struct config_file_t *file;
+	char line[CONFIG_LINE_MAX];
+	uint32_t line_no = 0;
+
+	if ( (f = fopen(path, "r")) == NULL ) {
+		printf("Cannot find %s\n", path);
+		return NULL;
+	}
+	file = (struct config_file_t*)calloc(1, sizeof(struct config_file_t));
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		char *comment = strchr(line, '#');
+		char *key, *eq, *tok, *save;
+		struct config_param_t *param;
+
+		line_no++;
+		if(comment)
+			*comment = '\0';
+		for(key = line; isspace((unsigned char)*key); key++)
+			;
+		if(*key == '\0')
+			continue;
+		if((eq = strchr(key, '=')) == NULL){
+			printf("%s:%u: no '=' in %s", path, line_no, key);
+			goto err;
+		}
+		*eq = '\0';
+		strtok_r(key, " \t", &save);
+
+		file->param = (struct config_param_t*)realloc(file->param,
+				(file->n_params + 1) * sizeof(struct config_param_t));
+		param = &file->param[file->n_params++];
+		param->key = strdup(key);
+		param->val = NULL;
+		param->n_val = 0;
+
+		for(tok = strtok_r(eq + 1, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save)){
+			if(strstr(tok, "..")){
+				if(config_add_range(param, tok))
+					goto err;
+			}
+			else
+				config_add_value(param, tok);
+		}
+		if(param->n_val == 0){
+			printf("%s:%u: %s has no value\n", path, line_no, key);
+			goto err;
+		}
+	}
+
+	fclose(f);
+	return file;
+
+err:
+	fclose(f);
+	config_file_free(file);
+	return NULL;
+}
+
+void config_file_free(struct config_file_t *file) {
+	if(file == NULL)
+		return;
+	for(uint32_t i = 0; i < file->n_params; i++){
+		for(uint32_t j = 0; j < file->param[i].n_val; j++)
+			free(file->param[i].val[j]);
+		free(file->param[i].val);
+		free(file->param[i].key);
+	}
+	free(file->param);
+	free(file);
+}
+
+uint64_t config_points(const struct config_file_t *file) {
+	uint64_t n = 1;
+
+	for(uint32_t i = 0; i < file->n_params; i++)
+		n *= file->param[i].n_val;
+	return n;
+}
+
+// Settings in file order, the value of the last key changes fastest
+int config_apply_point(struct sim_config_t *cfg, const struct config_file_t *file, uint64_t point) {
+	uint32_t idx[file->n_params ? file->n_params : 1];
+
+	for(uint32_t i = file->n_params; i-- > 0; ){
+		idx[i] = point % file->param[i].n_val;
+		point /= file->param[i].n_val;
+	}
+	for(uint32_t i = 0; i < file->n_params; i++)
+		if(config_set(cfg, file->param[i].key, file->param[i].val[idx[i]]))
+			return -1;
+
+	return 0;
+}
+
+int config_load(struct sim_config_t *cfg, const char *path) {
+	struct config_file_t *file;
+	int err;
+
+	if ( (file = config_file_load(path)) == NULL )
+		return -1;
+	if(config_points(file) != 1){
+		printf("%s lists several values of a key, use it with --sweep\n", path);
+		config_file_free(file);
+		return -1;
+	}
+	err = config_apply_point(cfg, file, 0);
+	config_file_free(file);
+
+	return err;
+}
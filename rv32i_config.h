@@ -0,0 +1,71 @@
+/* **************************************
+ * Module: runtime configuration files
+ *
+ * One "key = value" per line, '#' starts a comment:
+ *   max_cycles = 2000000
+ *   dcache = size=4K,line=32,assoc=2
+ *   dcache.miss = 40
+ *   bpred.type = gshare
+ * A key may list several values separated by spaces, and
+ * ranges "A..B+STEP" or "A..B*FACTOR":
+ *   dcache.size = 1K..16K*2
+ *   bpred.pht = 8 10 12
+ * Such a file describes a design space, the Cartesian
+ * product of the values (see rv32i_sweep.h).
+ *
+ * **************************************
+ */
+#ifndef RV32I_CONFIG_H
+#define RV32I_CONFIG_H
+
+#include "rv32i_sim.h"
+
+#define CONFIG_LINE_MAX 1024
+#define CONFIG_VALUES_MAX 4096	// per key, after expanding the ranges
+
+struct config_param_t {
+	char *key;
+	char **val;
+	uint32_t n_val;
+};
+
+struct config_file_t {
+	struct config_param_t *param;	// in file order
+	uint32_t n_params;
+};
+
+// Result of one option of a unit spec
+enum CONFIG_OPT {
+  CONFIG_OK = 0,
+  CONFIG_BAD_VALUE,	// trailing junk or out of range
+  CONFIG_UNKNOWN
+};
+
+// Option key=val of a unit spec, val is NULL for a bare word
+typedef enum CONFIG_OPT (*config_option_fn)(void *obj, const char *key, const char *val);
+
+// "key=val,key=val,..." of the unit named unit, one call of fn per
+// option. Bare words are only passed on when words is set. -1, with a
+// message, on the first option fn does not take or a spec longer than
+// CONFIG_LINE_MAX
+int config_spec_parse(const char *spec, const char *unit, uint8_t words, config_option_fn fn, void *obj);
+
+// The whole of val as a number, CONFIG_BAD_VALUE on trailing junk or
+// overflow. config_size also takes a K/M/G suffix
+enum CONFIG_OPT config_u32(const char *val, uint32_t *out);
+enum CONFIG_OPT config_size(const char *val, uint64_t *out);
+enum CONFIG_OPT config_double(const char *val, double *out);
+
+int config_set(struct sim_config_t *cfg, const char *key, const char *val);
+
+struct config_file_t *config_file_load(const char *path);
+void config_file_free(struct config_file_t *file);
+
+// Number of configurations of the file, its points are 0..n-1
+uint64_t config_points(const struct config_file_t *file);
+int config_apply_point(struct sim_config_t *cfg, const struct config_file_t *file, uint64_t point);
+
+// A file with one value per key, applied over cfg
+int config_load(struct sim_config_t *cfg, const char *path);
+
+#endif
@@ -0,0 +1,88 @@
+/* **************************************
+ * Module: control and status registers (Zicsr)
+ *
+ * **************************************
+ */
+#include "rv32i_csr.h"
+
+static const char *hpm_event_names[HPM_NUM] = {
+	"none", "load_use", "taken", "flush", "mem", "cycle", "instret"
+};
+
+const char *hpm_event_name(enum HPM_EVENT ev) {
+	return ev < HPM_NUM ? hpm_event_names[ev] : "?";
+}
+
+void csr_reset(struct csr_t *csr, uint32_t hartid) {
+	memset(csr, 0, sizeof(*csr));
+	csr->event[0] = HPM_CYCLE;
+	csr->event[2] = HPM_INSTRET;
+	csr->hartid = hartid;
+}
+
+// Counter of a counter CSR, -1 for the other CSRs
+static int csr_counter(uint32_t addr) {
+	uint32_t group = addr & ~(CSR_HIGH | 0x1F);
+	uint32_t n = addr & 0x1F;
+
+	if(group == CSR_CYCLE && n == 1)	// time reads cycle
+		return 0;
+	if((group != CSR_CYCLE && group != CSR_MCYCLE) || n == 1 || n >= CSR_CNT_NUM)
+		return -1;
+	return n;
+}
+
+uint32_t csr_op(struct csr_t *csr, const uint64_t *count, uint32_t imm, uint8_t func3, uint8_t rs1,
+		uint32_t rs1_val) {
+	uint32_t addr = imm & 0xFFF;
+	uint32_t src = (func3 & F3_CSR_IMM) ? rs1 : rs1_val;
+	uint8_t write = (func3 & 0x3) == F3_CSRRW || rs1 != 0;
+	uint8_t high = (addr & CSR_HIGH) != 0;
+	int n = csr_counter(addr);
+	uint32_t old = 0, val;
+
+	// Read
+	if(n >= 0){
+		uint64_t cnt = count[csr->event[n]] - csr->base[n];
+		old = high ? (uint32_t)(cnt >> 32) : (uint32_t)cnt;
+	}
+	else if(addr >= CSR_MHPMEVENT3 && addr < CSR_MHPMEVENT3 + CSR_HPM_NUM)
+		old = csr->event[CSR_HPM_FIRST + addr - CSR_MHPMEVENT3];
+	else if(addr == CSR_MHARTID)
+		old = csr->hartid;
+
+	if(!write)
+		return old;
+	switch(func3 & 0x3){
+		case F3_CSRRW:
+			val = src;
+			break;
+		case F3_CSRRS:
+			val = old | src;
+			break;
+		default:
+			val = old & ~src;
+			break;
+	}
+
+	// Write: only the machine counters and the event selectors
+	if(n >= 0 && (addr & ~(CSR_HIGH | 0x1F)) == CSR_MCYCLE){
+		uint64_t cnt = count[csr->event[n]] - csr->base[n];
+
+		if(high)
+			cnt = (cnt & 0xFFFFFFFF) | (uint64_t)val << 32;
+		else
+			cnt = (cnt & ~(uint64_t)0xFFFFFFFF) | val;
+		csr->base[n] = count[csr->event[n]] - cnt;
+	}
+	else if(addr >= CSR_MHPMEVENT3 && addr < CSR_MHPMEVENT3 + CSR_HPM_NUM){
+		int k = CSR_HPM_FIRST + addr - CSR_MHPMEVENT3;
+		uint64_t cnt = count[csr->event[k]] - csr->base[k];
+
+		// the counter goes on from its value with the new event
+		csr->event[k] = val < HPM_NUM ? val : HPM_NONE;
+		csr->base[k] = count[csr->event[k]] - cnt;
+	}
+
+	return old;
+}
@@ -0,0 +1,65 @@
+/* **************************************
+ * Module: control and status registers (Zicsr)
+ *
+ * csrrw/csrrs/csrrc and their immediate forms read and
+ * write a small CSR file of counters:
+ *   cycle, time      0xC00/0xC01, read-only
+ *   instret          0xC02, read-only
+ *   hpmcounter3-6    0xC03-0xC06, read-only
+ *   mcycle           0xB00, minstret 0xB02
+ *   mhpmcounter3-6   0xB03-0xB06
+ *   mhpmevent3-6     0x323-0x326, enum HPM_EVENT counted
+ *   mhartid          0xF14, read-only
+ * The upper halves of the counters are at +0x80.
+ *
+ * The engines do not count for the CSRs. Each counter is
+ * the count of its event, taken from the engine when the
+ * CSR is accessed, minus an offset that a write sets.
+ * Unimplemented CSRs read as zero and writes to them or to
+ * read-only ones are dropped, as nothing traps here.
+ *
+ * **************************************
+ */
+#ifndef RV32I_CSR_H
+#define RV32I_CSR_H
+
+#include "rv32i.h"
+
+#define CSR_HPM_FIRST 3	// mhpmcounter3, the first programmable one
+#define CSR_HPM_NUM 4	// mhpmcounter3-6, the others read as zero
+#define CSR_CNT_NUM (CSR_HPM_FIRST + CSR_HPM_NUM)	// cycle, time, instret, mhpmcounters
+
+#define CSR_MHPMEVENT3 0x323
+#define CSR_MCYCLE 0xB00
+#define CSR_CYCLE 0xC00
+#define CSR_MHARTID 0xF14
+#define CSR_HIGH 0x80	// upper half of a counter
+
+// Events of mhpmevent, counts of the engine
+enum HPM_EVENT {
+  HPM_NONE = 0,	// the counter keeps its value
+  HPM_LOAD_USE,	// cycles ID waited on a source still in flight
+  HPM_TAKEN,	// branches and jumps taken
+  HPM_FLUSH,	// fetch redirects, each flushing the wrong path
+  HPM_MEM,	// loads and stores retired
+  HPM_CYCLE,	// the source of cycle
+  HPM_INSTRET,	// the source of instret
+  HPM_NUM
+};
+
+struct csr_t {
+	uint8_t event[CSR_CNT_NUM];	// enum HPM_EVENT of each counter, time is unused
+	uint64_t base[CSR_CNT_NUM];	// event count at which the counter read zero
+	uint32_t hartid;
+};
+
+void csr_reset(struct csr_t *csr, uint32_t hartid);
+const char *hpm_event_name(enum HPM_EVENT ev);
+
+// Zicsr instruction on csr, count[] holds the engine counts by enum
+// HPM_EVENT. rs1 is the register number, or the immediate, and rs1_val
+// its value. Returns the old value of the CSR for rd.
+uint32_t csr_op(struct csr_t *csr, const uint64_t *count, uint32_t imm, uint8_t func3, uint8_t rs1,
+		uint32_t rs1_val);
+
+#endif
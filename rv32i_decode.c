@@ -0,0 +1,192 @@
+/* **************************************
+ * Module: pre-decoded instruction table
+ *
+ * **************************************
+ */
+#include "rv32i_decode.h"
+
+struct uop_t decode(uint32_t inst) {
+	struct uop_t uop;
+
+	uop.opcode = inst & 0x7F;
+	uop.rd = (inst >> 7) & 0x1F;
+	uop.rs1 = (inst >> 15) & 0x1F;
+	uop.rs2 = (inst >> 20) & 0x1F;
+	uop.func3 = 0;
+	uop.func7 = 0;
+	uop.imm = 0;
+	uop.src_mask = 0;
+	uop.len = WORD_SIZE;
+
+	if (!(uop.opcode == U_LU_TYPE || uop.opcode == U_AU_TYPE
+				|| uop.opcode == UJ_TYPE))
+		uop.func3 = (inst >> 12) & 0x7;
+
+	// func7 selects SUB/SRA and the M extension, also SRAI
+	if (uop.opcode == R_TYPE
+			|| (uop.opcode == I_R_TYPE && uop.func3 == F3_SR))
+		uop.func7 = (inst >> 25) & 0x7F;
+
+	//Immediate generation
+	switch(uop.opcode){
+		case I_L_TYPE:
+		case I_R_TYPE:
+		case I_J_TYPE:
+		case SYSTEM_TYPE:
+			uop.imm = (inst >> 20) & 0xFFF;
+			//Input is a negative number
+			if(uop.imm & 0x800)
+				uop.imm = uop.imm | 0xFFFFF000;
+			break;
+		case U_LU_TYPE:
+		case U_AU_TYPE:
+			uop.imm = inst & ~0xFFF;
+			break;
+		case UJ_TYPE:
+			uop.imm = uop.imm | ((inst >> 31) & 0x1) << 20;
+			uop.imm = uop.imm | ((inst >> 21) & 0x3FF) << 1;
+			uop.imm = uop.imm | ((inst >> 20) & 0x1) << 11;
+			uop.imm = uop.imm | (inst & 0xFF000);
+			// When the input is a negative number
+			if(uop.imm & 0x100000)
+				uop.imm = uop.imm | 0xFFE00000;
+			break;
+		case SB_TYPE:
+			uop.imm = uop.imm | ((inst >> 31) & 0x1) << 12;
+			uop.imm = uop.imm | ((inst >> 25) & 0x3F) << 5;
+			uop.imm = uop.imm | ((inst >> 8) & 0xF) << 1;
+			uop.imm = uop.imm | ((inst >> 7) & 0x1) << 11;
+			// When the input is a negative number
+			if(uop.imm & 0x1000)
+				uop.imm = uop.imm | 0xFFFFE000;
+			break;
+		case S_TYPE:
+			uop.imm = uop.imm | ((inst >> 7) & 0x1F);
+			uop.imm = uop.imm | ((inst >> 25) & 0x7F) << 5;
+			//Input is a negative number
+			if(uop.imm & 0x800)
+				uop.imm = uop.imm | 0xFFFFF000;
+			break;
+	}
+
+	// Registers actually read by the instruction
+	switch(uop.opcode){
+		case R_TYPE:
+		case S_TYPE:
+		case SB_TYPE:
+			uop.src_mask = SRC_RS1 | SRC_RS2;
+			break;
+		case I_L_TYPE:
+		case I_R_TYPE:
+		case I_J_TYPE:
+			uop.src_mask = SRC_RS1;
+			break;
+		case SYSTEM_TYPE:
+			if(uop.func3 == F3_CSRRW || uop.func3 == F3_CSRRS || uop.func3 == F3_CSRRC)
+				uop.src_mask = SRC_RS1;
+			break;
+	}
+
+	uop.alu_control = alu_control_gen(uop.opcode, uop.func3, uop.func7);
+	uop.op = decode_op(&uop);
+
+	return uop;
+}
+
+uint8_t decode_op(struct uop_t *uop) {
+	static const uint8_t op_branch[8] = {
+		OP_BEQ, OP_BNE, OP_NOP, OP_NOP, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU
+	};
+	static const uint8_t op_load[8] = {
+		OP_LB, OP_LH, OP_LW, OP_NOP, OP_LBU, OP_LHU, OP_NOP, OP_NOP
+	};
+	static const uint8_t op_store[8] = {
+		OP_SB, OP_SH, OP_SW, OP_NOP, OP_NOP, OP_NOP, OP_NOP, OP_NOP
+	};
+	static const uint8_t op_imm[8] = {
+		OP_ADDI, OP_SLLI, OP_SLTI, OP_SLTIU, OP_XORI, OP_SRLI, OP_ORI, OP_ANDI
+	};
+	static const uint8_t op_reg[8] = {
+		OP_ADD, OP_SLL, OP_SLT, OP_SLTU, OP_XOR, OP_SRL, OP_OR, OP_AND
+	};
+	static const uint8_t op_muldiv[8] = {
+		OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU, OP_DIV, OP_DIVU, OP_REM, OP_REMU
+	};
+
+	switch(uop->opcode){
+		case U_LU_TYPE:
+			return OP_LUI;
+		case U_AU_TYPE:
+			return OP_AUIPC;
+		case UJ_TYPE:
+			return OP_JAL;
+		case I_J_TYPE:
+			return OP_JALR;
+		case SB_TYPE:
+			return op_branch[uop->func3];
+		case I_L_TYPE:
+			return op_load[uop->func3];
+		case S_TYPE:
+			return op_store[uop->func3];
+		case I_R_TYPE:
+			if(uop->func3 == F3_SR && ((uop->func7 >> 5) & 1))
+				return OP_SRAI;
+			return op_imm[uop->func3];
+		case R_TYPE:
+			if(uop->func7 == F7_MULDIV)
+				return op_muldiv[uop->func3];
+			if(uop->func3 == F3_ADD_SUB && ((uop->func7 >> 5) & 1))
+				return OP_SUB;
+			if(uop->func3 == F3_SR && ((uop->func7 >> 5) & 1))
+				return OP_SRA;
+			return op_reg[uop->func3];
+		case SYSTEM_TYPE:
+			if(uop->func3 == F3_PRIV)
+				return (uop->imm & 0xFFF) == IMM_EBREAK ? OP_EBREAK : OP_ECALL;
+			if(uop->func3 & 0x3)
+				return OP_CSR;
+			return OP_NOP;
+	}
+	return OP_NOP;
+}
+
+// Instruction starting at parcel idx: 16 bits when compressed, else 32
+// bits that may straddle two words. Past the last word reads as zero.
+uint32_t imem_parcel(const uint32_t *imem_data, uint32_t depth, uint32_t idx) {
+	uint32_t word = idx / 2;
+	uint32_t lo = imem_data[word];
+	uint32_t hi;
+
+	if(!(idx & 1))
+		return rvc_is_compressed(lo) ? lo & 0xFFFF : lo;
+	lo >>= 16;
+	if(rvc_is_compressed(lo))
+		return lo;
+	hi = word + 1 < depth ? imem_data[word + 1] : 0;
+	return lo | hi << 16;
+}
+
+struct uop_t decode_at(const uint32_t *imem_data, uint32_t depth, uint32_t idx) {
+	uint32_t inst = imem_parcel(imem_data, depth, idx);
+	struct uop_t uop;
+
+	if(!rvc_is_compressed(inst))
+		return decode(inst);
+	uop = decode(rvc_expand(inst));
+	uop.len = PARCEL_SIZE;
+	return uop;
+}
+
+struct uop_t *decode_table_create(uint32_t *imem_data, uint32_t depth) {
+	struct uop_t *uop_table;
+	uint32_t n = DECODE_ENTRIES(depth);
+
+	uop_table = (struct uop_t*)malloc(n*sizeof(struct uop_t));
+	if(uop_table == NULL)
+		return NULL;
+
+	for(uint32_t i = 0; i < n; i++)
+		uop_table[i] = decode_at(imem_data, depth, i);
+
+	return uop_table;
+}
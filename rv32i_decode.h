@@ -0,0 +1,66 @@
+/* **************************************
+ * Module: pre-decoded instruction table
+ *
+ * imem_data is decoded once at load time into a table
+ * of micro-ops with one entry per 16-bit parcel, so an
+ * instruction may start at any halfword. Compressed
+ * instructions are expanded first (rv32i_rvc.h) and the
+ * entry keeps their length. imem and dmem are separate,
+ * so a store never changes code and the table stays valid
+ * until another program is loaded.
+ *
+ * **************************************
+ */
+#ifndef RV32I_DECODE_H
+#define RV32I_DECODE_H
+
+#include "rv32i.h"
+#include "rv32i_rvc.h"
+
+// Source usage mask
+#define SRC_RS1 0x1
+#define SRC_RS2 0x2
+
+// Instruction id (dispatch index of the functional engine)
+enum OP {
+  OP_NOP = 0,	// fence and unknown encodings
+  OP_LUI, OP_AUIPC, OP_JAL, OP_JALR,
+  OP_BEQ, OP_BNE, OP_BLT, OP_BGE, OP_BLTU, OP_BGEU,
+  OP_LB, OP_LH, OP_LW, OP_LBU, OP_LHU,
+  OP_SB, OP_SH, OP_SW,
+  OP_ADDI, OP_SLTI, OP_SLTIU, OP_XORI, OP_ORI, OP_ANDI,
+  OP_SLLI, OP_SRLI, OP_SRAI,
+  OP_ADD, OP_SUB, OP_SLL, OP_SLT, OP_SLTU,
+  OP_XOR, OP_SRL, OP_SRA, OP_OR, OP_AND,
+  OP_MUL, OP_MULH, OP_MULHSU, OP_MULHU,
+  OP_DIV, OP_DIVU, OP_REM, OP_REMU,
+  OP_ECALL, OP_EBREAK,
+  OP_CSR,	// csrrw/csrrs/csrrc and the immediate forms
+  OP_NUM
+};
+
+// decoded micro-op (16 bytes, four per cache line)
+struct uop_t {
+	uint32_t imm;
+	uint8_t op;
+	uint8_t opcode;
+	uint8_t func3;
+	uint8_t func7;
+	uint8_t rs1;
+	uint8_t rs2;
+	uint8_t rd;
+	uint8_t alu_control;
+	uint8_t src_mask;
+	uint8_t len;	// bytes, 2 for a compressed instruction
+};
+
+// Entries of the table of an imem of depth words
+#define DECODE_ENTRIES(depth) ((depth) * (WORD_SIZE / PARCEL_SIZE))
+
+struct uop_t decode(uint32_t inst);
+uint8_t decode_op(struct uop_t *uop);
+uint32_t imem_parcel(const uint32_t *imem_data, uint32_t depth, uint32_t idx);
+struct uop_t decode_at(const uint32_t *imem_data, uint32_t depth, uint32_t idx);
+struct uop_t *decode_table_create(uint32_t *imem_data, uint32_t depth);
+
+#endif
@@ -0,0 +1,288 @@
+/* **************************************
+ * Module: functional (ISA-only) execution engine
+ *
+ * Threaded dispatch with computed goto: every handler
+ * ends with its own indirect jump to the next handler.
+ * Results come from alu()/dmem() so the architectural
+ * state matches the pipeline model.
+ *
+ * With a JIT, taken jumps to hot targets continue in
+ * native code until it returns to the interpreter.
+ *
+ * **************************************
+ */
+#include "rv32i_func.h"
+#include "rv32i_units.h"
+
+#define RS1 reg_data[uop->rs1]
+#define RS2 reg_data[uop->rs2]
+
+#define ALU(a, b) func_alu((a), (b), uop->alu_control)
+
+#define WRITE_RD(v) \
+	do {\
+		if(uop->rd)\
+			reg_data[uop->rd] = (v);\
+	}while(0)
+
+#define DISPATCH() \
+	do {\
+		if(inst_cnt == max_inst || pc == func_in.stop_pc)\
+			goto done;\
+		if(((pc - imem_base) / 4) >= imem_size)\
+			goto pc_out;\
+		uop = &uop_table[(pc - imem_base) / PARCEL_SIZE];\
+		goto *labels[uop->op];\
+	}while(0)
+
+#define NEXT() \
+	do {\
+		inst_cnt++;\
+		pc += uop->len;\
+		DISPATCH();\
+	}while(0)
+
+#define JUMP(target) \
+	do {\
+		inst_cnt++;\
+		if((target) == pc)\
+			goto self_loop;\
+		pc = (target);\
+		if(jit)\
+			goto jit_enter;\
+		DISPATCH();\
+	}while(0)
+
+static inline struct alu_output_t func_alu(uint32_t in1, uint32_t in2, uint8_t alu_control) {
+	struct alu_input_t alu_in = { .in1 = in1, .in2 = in2, .alu_control = alu_control };
+	struct alu_output_t alu_out;
+
+	alu(&alu_in, &alu_out);
+	return alu_out;
+}
+
+struct func_output_t func_run(struct func_input_t func_in, uint32_t *reg_data,
+		struct mem_t *mem, struct uop_t *uop_table, uint32_t imem_size) {
+
+	static const void *labels[OP_NUM] = {
+		[OP_NOP] = &&op_nop,
+		[OP_LUI] = &&op_lui, [OP_AUIPC] = &&op_auipc,
+		[OP_JAL] = &&op_jal, [OP_JALR] = &&op_jalr,
+		[OP_BEQ] = &&op_beq, [OP_BNE] = &&op_bne,
+		[OP_BLT] = &&op_blt, [OP_BGE] = &&op_bge,
+		[OP_BLTU] = &&op_bltu, [OP_BGEU] = &&op_bgeu,
+		[OP_LB] = &&op_load, [OP_LH] = &&op_load, [OP_LW] = &&op_load,
+		[OP_LBU] = &&op_load, [OP_LHU] = &&op_load,
+		[OP_SB] = &&op_store, [OP_SH] = &&op_store, [OP_SW] = &&op_store,
+		[OP_ADDI] = &&op_alu_i, [OP_XORI] = &&op_alu_i, [OP_ORI] = &&op_alu_i,
+		[OP_ANDI] = &&op_alu_i, [OP_SLLI] = &&op_alu_i, [OP_SRLI] = &&op_alu_i,
+		[OP_SRAI] = &&op_alu_i,
+		[OP_SLTI] = &&op_slti, [OP_SLTIU] = &&op_sltiu,
+		[OP_ADD] = &&op_alu_r, [OP_SUB] = &&op_alu_r, [OP_XOR] = &&op_alu_r,
+		[OP_OR] = &&op_alu_r, [OP_AND] = &&op_alu_r, [OP_SLL] = &&op_alu_r,
+		[OP_SRL] = &&op_alu_r, [OP_SRA] = &&op_alu_r,
+		[OP_SLT] = &&op_slt, [OP_SLTU] = &&op_sltu,
+		[OP_MUL] = &&op_muldiv, [OP_MULH] = &&op_muldiv, [OP_MULHSU] = &&op_muldiv,
+		[OP_MULHU] = &&op_muldiv, [OP_DIV] = &&op_muldiv, [OP_DIVU] = &&op_muldiv,
+		[OP_REM] = &&op_muldiv, [OP_REMU] = &&op_muldiv,
+		[OP_ECALL] = &&op_ecall, [OP_EBREAK] = &&op_ebreak,
+		[OP_CSR] = &&op_csr
+	};
+
+	struct func_output_t func_out;
+	struct alu_output_t alu_out;
+	struct dmem_input_t dmem_in;
+	struct dmem_output_t dmem_out;
+	struct uop_t *uop;
+	struct jit_input_t jit_in;
+	struct jit_output_t jit_out;
+	struct jit_t *jit = func_in.stop_pc == FUNC_NO_PC ? func_in.jit : NULL;
+	uint32_t imem_base = func_in.imem_base;
+	uint64_t max_inst = func_in.max_inst ? func_in.max_inst : UINT64_MAX;
+	uint64_t inst_cnt = 0;
+	uint32_t pc = func_in.pc;
+	uint64_t csr_count[HPM_NUM];
+
+	if(func_in.csr)
+		memcpy(csr_count, func_in.csr_count, sizeof(csr_count));
+
+	func_out.halt = HALT_NONE;
+	func_out.tohost_val = 0;
+	func_out.fault_addr = 0;
+
+	DISPATCH();
+
+op_nop:
+	NEXT();
+
+op_lui:
+	WRITE_RD(uop->imm);
+	NEXT();
+
+op_auipc:
+	WRITE_RD(pc + uop->imm);
+	NEXT();
+
+op_jal:
+	WRITE_RD(pc + uop->len);
+	JUMP(pc + uop->imm);
+
+op_jalr:
+	alu_out = ALU(RS1, uop->imm);
+	WRITE_RD(pc + uop->len);
+	JUMP(alu_out.result & ~1u);
+
+	// Branch conditions follow the EX stage
+op_beq:
+	alu_out = ALU(RS1, RS2);
+	if(alu_out.zero)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_bne:
+	alu_out = ALU(RS1, RS2);
+	if(!alu_out.zero)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_blt:
+	alu_out = ALU(RS1, RS2);
+	if(!alu_out.zero && alu_out.sign)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_bge:
+	alu_out = ALU(RS1, RS2);
+	if(alu_out.zero || !alu_out.sign)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_bltu:
+	alu_out = ALU(RS1, RS2);
+	if(!alu_out.zero && alu_out.ucmp)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_bgeu:
+	alu_out = ALU(RS1, RS2);
+	if(alu_out.zero || !alu_out.ucmp)
+		JUMP(pc + uop->imm);
+	NEXT();
+
+op_load:
+	dmem_in.addr = ALU(RS1, uop->imm).result;
+	dmem_in.func3 = uop->func3;
+	dmem_in.mem_read = 1;
+	dmem_in.mem_write = 0;
+	dmem(&dmem_in, &dmem_out, mem);
+	if(dmem_out.fault)
+		goto fault;
+	WRITE_RD(dmem_out.dout);
+	NEXT();
+
+op_store:
+	dmem_in.addr = ALU(RS1, uop->imm).result;
+	dmem_in.din = RS2;
+	dmem_in.func3 = uop->func3;
+	dmem_in.mem_read = 0;
+	dmem_in.mem_write = 1;
+	dmem(&dmem_in, &dmem_out, mem);
+	if(dmem_out.fault)
+		goto fault;
+	if(dmem_in.addr == func_in.tohost){
+		func_out.tohost_val = dmem_in.din;
+		func_out.halt = HALT_TOHOST;
+		inst_cnt++;
+		pc += uop->len;
+		goto done;
+	}
+	NEXT();
+
+op_alu_i:
+	WRITE_RD(ALU(RS1, uop->imm).result);
+	NEXT();
+
+op_slti:
+	WRITE_RD(ALU(RS1, uop->imm).sign ? 1 : 0);
+	NEXT();
+
+op_sltiu:
+	WRITE_RD(ALU(RS1, uop->imm).ucmp ? 1 : 0);
+	NEXT();
+
+op_alu_r:
+	WRITE_RD(ALU(RS1, RS2).result);
+	NEXT();
+
+op_slt:
+	WRITE_RD(ALU(RS1, RS2).sign ? 1 : 0);
+	NEXT();
+
+op_sltu:
+	WRITE_RD(ALU(RS1, RS2).ucmp ? 1 : 0);
+	NEXT();
+
+op_muldiv:
+	WRITE_RD(muldiv(RS1, RS2, uop->func3));
+	NEXT();
+
+// No pipeline here: every instruction is one cycle and the other events stand still
+op_csr: {
+	uint32_t old = 0;
+
+	// the write happens with rd = x0 too
+	if(func_in.csr){
+		csr_count[HPM_CYCLE] = func_in.csr_count[HPM_CYCLE] + inst_cnt;
+		csr_count[HPM_INSTRET] = func_in.csr_count[HPM_INSTRET] + inst_cnt;
+		old = csr_op(func_in.csr, csr_count, uop->imm, uop->func3, uop->rs1, RS1);
+	}
+	WRITE_RD(old);
+	NEXT();
+}
+
+op_ecall:
+	inst_cnt++;
+	func_out.halt = HALT_ECALL;
+	goto done;
+
+op_ebreak:
+	inst_cnt++;
+	func_out.halt = HALT_EBREAK;
+	goto done;
+
+jit_enter:
+	if(inst_cnt != max_inst && jit_hot(jit, pc)){
+		jit_in.pc = pc;
+		jit_in.budget = max_inst - inst_cnt;
+		jit_in.tohost = func_in.tohost;
+		jit_out = jit_run(jit, jit_in);
+		inst_cnt += jit_out.inst_cnt;
+		pc = jit_out.pc;
+		if(jit_out.halt != HALT_NONE){
+			func_out.halt = jit_out.halt;
+			func_out.tohost_val = jit_out.tohost_val;
+			func_out.fault_addr = jit_out.fault_addr;
+			goto done;
+		}
+	}
+	DISPATCH();
+
+self_loop:
+	func_out.halt = HALT_SELF_LOOP;
+	goto done;
+
+pc_out:
+	func_out.halt = HALT_PC_OUT;
+	goto done;
+
+fault:
+	func_out.halt = HALT_FAULT;
+	func_out.fault_addr = dmem_in.addr;
+	goto done;
+
+done:
+	func_out.pc = pc;
+	func_out.inst_cnt = inst_cnt;
+
+	return func_out;
+}
@@ -0,0 +1,43 @@
+/* **************************************
+ * Module: functional (ISA-only) execution engine
+ *
+ * Executes pre-decoded RV32I instructions on the same
+ * reg_data/dmem state as the pipeline, without any
+ * pipeline registers, forwarding or hazard logic.
+ *
+ * **************************************
+ */
+#ifndef RV32I_FUNC_H
+#define RV32I_FUNC_H
+
+#include "rv32i.h"
+#include "rv32i_decode.h"
+#include "rv32i_mem.h"
+#include "rv32i_jit.h"
+#include "rv32i_csr.h"
+
+#define FUNC_NO_PC 0xFFFFFFFF
+
+struct func_input_t {
+	uint32_t pc;
+	uint64_t max_inst;	// 0: no limit
+	uint32_t stop_pc;	// FUNC_NO_PC: never stop
+	uint32_t tohost;
+	uint32_t imem_base;	// address of imem_data[0]
+	struct jit_t *jit;	// NULL: interpret only, bound to this state
+	struct csr_t *csr;	// NULL: CSRs read as zero
+	const uint64_t *csr_count;	// enum HPM_EVENT counts when the run starts
+};
+
+struct func_output_t {
+	uint32_t pc;		// next instruction to execute
+	uint64_t inst_cnt;
+	enum HALT halt;		// HALT_NONE when stopped at max_inst/stop_pc
+	uint32_t tohost_val;
+	uint32_t fault_addr;	// HALT_FAULT: data address
+};
+
+struct func_output_t func_run(struct func_input_t func_in, uint32_t *reg_data,
+		struct mem_t *mem, struct uop_t *uop_table, uint32_t imem_size);
+
+#endif
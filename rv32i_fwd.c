@@ -0,0 +1,55 @@
+/* **************************************
+ * Module: forwarding network and scoreboard
+ *
+ * **************************************
+ */
+#include "rv32i_fwd.h"
+#include "rv32i_bpred.h"
+
+// dist[src][use], use EX, STORE, ID
+static const struct fwd_t fwd_table[FWD_NUM] = {
+	// none
+	{ 0,
+		{ { 3, 3, 3 }, { 3, 3, 3 } }, BPRED_FLUSH_CYCLES },
+	// base: a load followed by its use costs one bubble
+	{ FWD_MEM_EX | FWD_WB_EX,
+		{ { 1, 1, 3 }, { 2, 2, 3 } }, BPRED_FLUSH_CYCLES },
+	// full: a branch waits one cycle on an ALU result, two on a load
+	{ FWD_MEM_EX | FWD_WB_EX | FWD_WB_MEM | FWD_MEM_ID,
+		{ { 1, 1, 2 }, { 2, 1, 3 } }, BPRED_FLUSH_CYCLES - 1 },
+};
+
+const struct fwd_t *fwd_get(enum FWD type) {
+	return &fwd_table[type < FWD_NUM ? type : FWD_BASE];
+}
+
+const char *fwd_name(enum FWD type) {
+	switch(type){
+		case FWD_NONE:
+			return "none";
+		case FWD_FULL:
+			return "full";
+		default:
+			return "base";
+	}
+}
+
+int fwd_parse(enum FWD *type, const char *str) {
+	if(!strcmp(str, "none"))
+		*type = FWD_NONE;
+	else if(!strcmp(str, "base"))
+		*type = FWD_BASE;
+	else if(!strcmp(str, "full"))
+		*type = FWD_FULL;
+	else {
+		printf("Unknown forwarding %s\n", str);
+		return -1;
+	}
+	return 0;
+}
+
+void sb_reset(struct scoreboard_t *sb) {
+	memset(sb, 0, sizeof(*sb));
+	// every register was written long ago
+	sb->tick = 3;
+}
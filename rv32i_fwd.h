@@ -0,0 +1,100 @@
+/* **************************************
+ * Module: forwarding network and scoreboard
+ *
+ * The bypass paths of the pipeline come from a table with
+ * one row per configuration:
+ *   none  no bypass, a value is read from the register
+ *         file in ID once its producer is in WB
+ *   base  EX/MEM and MEM/WB to the EX inputs (the paths
+ *         of the original design)
+ *   full  base, plus MEM/WB to the store data in MEM and
+ *         EX/MEM to a comparator in ID: branches and jumps
+ *         whose sources are ready there resolve in ID and a
+ *         mispredict flushes only IF, the others resolve in
+ *         EX as with base
+ *
+ * The scoreboard keeps the newest writer of every register.
+ * ID compares how far ahead it is with the distance the
+ * row needs for that producer and use, and stalls until
+ * the value can be bypassed.
+ *
+ * **************************************
+ */
+#ifndef RV32I_FWD_H
+#define RV32I_FWD_H
+
+#include "rv32i.h"
+
+enum FWD {
+  FWD_NONE = 0,
+  FWD_BASE,
+  FWD_FULL,
+  FWD_NUM
+};
+
+// Bypass paths, pipeline register -> consumer
+#define FWD_MEM_EX 0x1	// EX/MEM result to the EX inputs
+#define FWD_WB_EX 0x2	// MEM/WB result or loaded value to the EX inputs
+#define FWD_WB_MEM 0x4	// MEM/WB result or loaded value to the store data in MEM
+#define FWD_MEM_ID 0x8	// EX/MEM result to the comparator in ID, control resolves in ID
+
+// Producer of a register value
+enum FWD_SRC {
+  FWD_SRC_ALU = 0,	// ready after EX
+  FWD_SRC_LOAD,	// ready after MEM
+  FWD_SRC_NUM
+};
+
+// Consumer of a register value
+enum FWD_USE {
+  FWD_USE_EX = 0,	// ALU operand, address
+  FWD_USE_STORE,	// store data
+  FWD_USE_ID,	// branch and jalr operands with FWD_MEM_ID
+  FWD_USE_NUM
+};
+
+struct fwd_t {
+	uint8_t paths;
+	// instructions the producer must be ahead of the consumer in ID,
+	// 3 is the register file (written in WB before ID reads it)
+	uint8_t dist[FWD_SRC_NUM][FWD_USE_NUM];
+	uint32_t flush_cycles;	// IF and ID work lost per mispredict
+};
+
+// Newest writer of each register. The tick counts the cycles in
+// which ID runs, so a D-cache stall does not move instructions apart.
+struct scoreboard_t {
+	uint64_t tick;
+	uint64_t issue[32];	// tick the writer left ID
+	uint32_t late[32];	// cycles the writer takes beyond the ALU or the load
+	uint32_t pc[32];
+	uint32_t load;	// bit per register: the writer is a load
+};
+
+const struct fwd_t *fwd_get(enum FWD type);
+const char *fwd_name(enum FWD type);
+int fwd_parse(enum FWD *type, const char *str);
+
+void sb_reset(struct scoreboard_t *sb);
+
+// Register reg is not ready for use this cycle
+static inline uint8_t sb_wait(const struct scoreboard_t *sb, const struct fwd_t *fwd, uint8_t reg, enum FWD_USE use) {
+	if(reg == 0)
+		return 0;
+	return sb->tick - sb->issue[reg] < fwd->dist[(sb->load >> reg) & 1][use] + sb->late[reg];
+}
+
+// late: cycles of a multi-cycle unit beyond the first
+static inline void sb_write(struct scoreboard_t *sb, uint8_t reg, uint32_t pc, uint8_t load, uint32_t late) {
+	if(reg == 0)
+		return;
+	sb->issue[reg] = sb->tick;
+	sb->late[reg] = late;
+	sb->pc[reg] = pc;
+	if(load)
+		sb->load |= 1u << reg;
+	else
+		sb->load &= ~(1u << reg);
+}
+
+#endif
@@ -0,0 +1,235 @@
+/* **************************************
+ * Module: multi-core simulation
+ *
+ * **************************************
+ */
+#include <time.h>
+#include "rv32i_hart.h"
+
+// Host thread running the harts id, id + n_threads, ...
+struct hart_thread_t {
+	struct hart_group_t *group;
+	uint32_t id;
+};
+
+struct hart_group_t *hart_group_create(const struct sim_config_t *cfg, uint32_t n_harts, uint32_t quantum) {
+	struct hart_group_t *group;
+	struct sim_config_t hart_cfg = *cfg;
+
+	if(n_harts == 0 || n_harts > HART_MAX || quantum == 0)
+		return NULL;
+	if ( (group = (struct hart_group_t*)calloc(1, sizeof(struct hart_group_t))) == NULL )
+		return NULL;
+	pthread_mutex_init(&group->gate_lock, NULL);
+	pthread_cond_init(&group->gate_cond, NULL);
+
+	// a per-cycle trace of several threads would interleave
+	hart_cfg.trace_level = TRACE_NONE;
+	hart_cfg.trace_path = NULL;
+	hart_cfg.profile = 0;
+
+	group->n_harts = n_harts;
+	group->quantum = quantum;
+	for(uint32_t i = 0; i < n_harts; i++){
+		if ( (group->hart[i] = sim_create(&hart_cfg)) == NULL ) {
+			hart_group_destroy(group);
+			return NULL;
+		}
+		group->hart[i]->hartid = i;
+	}
+
+	return group;
+}
+
+void hart_group_destroy(struct hart_group_t *group) {
+	if(group == NULL)
+		return;
+
+	// hart 0 owns the image of the others
+	for(uint32_t i = group->n_harts; i-- > 0; )
+		sim_destroy(group->hart[i]);
+	mem_destroy(group->mem);
+	pthread_cond_destroy(&group->gate_cond);
+	pthread_mutex_destroy(&group->gate_lock);
+	free(group);
+}
+
+// Every hart runs the program, on a view of the data memory of hart 0
+int hart_group_load(struct hart_group_t *group, const char *imem_path, const char *dmem_path) {
+	if(group->mem || sim_load(group->hart[0], imem_path, dmem_path))
+		return -1;
+	for(uint32_t i = 1; i < group->n_harts; i++)
+		if(sim_attach_image(group->hart[i], group->hart[0]->image))
+			return -1;
+
+	group->mem = group->hart[0]->dmem;
+	group->hart[0]->dmem = NULL;
+	for(uint32_t i = 0; i < group->n_harts; i++){
+		struct mem_t *view = mem_view_create(group->mem);
+		if(view == NULL)
+			return -1;
+		mem_destroy(group->hart[i]->dmem);
+		group->hart[i]->dmem = view;
+	}
+
+	return 0;
+}
+
+// Clock count the next quantum runs to
+static void hart_group_next(struct hart_group_t *group) {
+	uint32_t max_cycles = group->hart[0]->cfg.max_cycles;
+
+	if(max_cycles > group->epoch_end && max_cycles - group->epoch_end > group->quantum)
+		group->epoch_end += group->quantum;
+	else
+		group->epoch_end = max_cycles;
+}
+
+// End of a quantum, on one thread while the others wait: the stores
+// become visible in hart order, then the run ends or goes on
+static void hart_group_sync(struct hart_group_t *group) {
+	uint32_t running = 0;
+	uint8_t max_cycles = 0;
+
+	for(uint32_t i = 0; i < group->n_harts; i++)
+		mem_log_commit(group->hart[i]->dmem);
+	for(uint32_t i = 0; i < group->n_harts; i++)
+		mem_view_sync(group->hart[i]->dmem);
+	group->quanta++;
+
+	for(uint32_t i = 0; i < group->n_harts; i++){
+		struct sim_t *sim = group->hart[i];
+
+		if(sim->halt == HALT_TOHOST && group->halt == HALT_NONE)
+			group->halt = HALT_TOHOST;
+		if(sim->halt == HALT_MAX_CYCLES)
+			max_cycles = 1;
+		if(!sim->halt)
+			running++;
+	}
+
+	if(group->halt == HALT_TOHOST || running == 0){
+		if(group->halt == HALT_NONE)
+			group->halt = max_cycles ? HALT_MAX_CYCLES : group->hart[0]->halt;
+		group->stop = 1;
+		return;
+	}
+
+	hart_group_next(group);
+}
+
+static void *hart_thread(void *arg) {
+	struct hart_thread_t *t = (struct hart_thread_t*)arg;
+	struct hart_group_t *group = t->group;
+
+	pthread_mutex_lock(&group->gate_lock);
+	while(group->n_threads == 0)
+		pthread_cond_wait(&group->gate_cond, &group->gate_lock);
+	pthread_mutex_unlock(&group->gate_lock);
+
+	while(!group->stop){
+		for(uint32_t i = t->id; i < group->n_harts; i += group->n_threads)
+			sim_run_until(group->hart[i], group->epoch_end);
+
+		if(pthread_barrier_wait(&group->barrier) == PTHREAD_BARRIER_SERIAL_THREAD)
+			hart_group_sync(group);
+		pthread_barrier_wait(&group->barrier);
+	}
+
+	return NULL;
+}
+
+// One thread per hart, fewer when the host refuses more threads
+enum HALT hart_group_run(struct hart_group_t *group) {
+	struct hart_thread_t thread[HART_MAX];
+	pthread_t tid[HART_MAX];
+	struct timespec t_start, t_end;
+	uint32_t n_started;
+
+	group->stop = 0;
+	group->halt = HALT_NONE;
+	group->n_threads = 0;
+	group->epoch_end = group->hart[0]->cc;
+	hart_group_next(group);
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+
+	// thread 0 is the calling one
+	for(uint32_t i = 0; i < group->n_harts; i++){
+		thread[i].group = group;
+		thread[i].id = i;
+	}
+	for(n_started = 1; n_started < group->n_harts; n_started++)
+		if(pthread_create(&tid[n_started], NULL, hart_thread, &thread[n_started]))
+			break;
+
+	pthread_barrier_init(&group->barrier, NULL, n_started);
+	pthread_mutex_lock(&group->gate_lock);
+	group->n_threads = n_started;
+	pthread_cond_broadcast(&group->gate_cond);
+	pthread_mutex_unlock(&group->gate_lock);
+
+	hart_thread(&thread[0]);
+	for(uint32_t i = 1; i < n_started; i++)
+		pthread_join(tid[i], NULL);
+	pthread_barrier_destroy(&group->barrier);
+
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+	group->host_sec += (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+
+	return group->halt;
+}
+
+void hart_group_stats(struct hart_group_t *group, struct sim_stats_t *stats) {
+	struct sim_stats_t hs;
+
+	sim_get_stats(group->hart[0], stats);
+	for(uint32_t i = 1; i < group->n_harts; i++){
+		sim_get_stats(group->hart[i], &hs);
+
+		if(hs.cycles > stats->cycles)
+			stats->cycles = hs.cycles;
+		stats->inst_cnt += hs.inst_cnt;
+		stats->hazard_cnt += hs.hazard_cnt;
+		stats->branch_cnt += hs.branch_cnt;
+		for(int c = 0; c < CPI_NUM; c++)
+			stats->cpi[c] += hs.cpi[c];
+		for(int c = 0; c < RC_NUM; c++)
+			stats->retired[c] += hs.retired[c];
+
+		stats->icache.hits += hs.icache.hits;
+		stats->icache.misses += hs.icache.misses;
+		stats->icache.evictions += hs.icache.evictions;
+		stats->icache.writebacks += hs.icache.writebacks;
+		stats->dcache.hits += hs.dcache.hits;
+		stats->dcache.misses += hs.dcache.misses;
+		stats->dcache.evictions += hs.dcache.evictions;
+		stats->dcache.writebacks += hs.dcache.writebacks;
+		stats->icache_stall_cnt += hs.icache_stall_cnt;
+		stats->dcache_stall_cnt += hs.dcache_stall_cnt;
+		stats->mul_cnt += hs.mul_cnt;
+		stats->div_cnt += hs.div_cnt;
+		stats->mul_stall_cnt += hs.mul_stall_cnt;
+		stats->div_stall_cnt += hs.div_stall_cnt;
+		stats->fetch_insts += hs.fetch_insts;
+		stats->fetch_rvc += hs.fetch_rvc;
+		stats->fetch_words += hs.fetch_words;
+
+		stats->bpred.branches += hs.bpred.branches;
+		stats->bpred.branch_miss += hs.bpred.branch_miss;
+		stats->bpred.jumps += hs.bpred.jumps;
+		stats->bpred.jump_miss += hs.bpred.jump_miss;
+		stats->bpred.btb_hits += hs.bpred.btb_hits;
+		stats->bpred.btb_lookups += hs.bpred.btb_lookups;
+	}
+
+	// the halt of the group, and the tohost value of the hart that stored it
+	stats->halt = group->halt;
+	for(uint32_t i = 0; i < group->n_harts; i++){
+		if(group->halt == HALT_TOHOST && group->hart[i]->halt == HALT_TOHOST){
+			stats->tohost_val = group->hart[i]->tohost_val;
+			stats->halt_pc = group->hart[i]->last_retire_pc;
+			break;
+		}
+	}
+}
@@ -0,0 +1,56 @@
+/* **************************************
+ * Module: multi-core simulation
+ *
+ * N harts, each a struct sim_t with its own pipeline,
+ * registers, caches and predictor, run one program on
+ * one shared data memory. Every hart has a host thread.
+ * Time advances in quanta of the same number of cycles
+ * for all harts, with a barrier after each one:
+ *   - during a quantum a hart reads the shared memory as
+ *     of the last barrier, and sees its own stores
+ *   - at the barrier the stores of hart 0, 1, ... are
+ *     applied in that order
+ * so the result does not depend on the host scheduling.
+ *
+ * A hart finds its number in a0 at reset. The run ends
+ * when all harts halted, or at the end of the quantum in
+ * which one of them stored to tohost.
+ *
+ * **************************************
+ */
+#ifndef RV32I_HART_H
+#define RV32I_HART_H
+
+#include <pthread.h>
+#include "rv32i_sim.h"
+
+#define HART_MAX 64
+#define HART_QUANTUM_DEFAULT 1000	// cycles
+
+struct hart_group_t {
+	struct sim_t *hart[HART_MAX];
+	uint32_t n_harts;
+	uint32_t quantum;
+	struct mem_t *mem;	// shared data memory
+
+	// run state, see hart_group_run()
+	pthread_mutex_t gate_lock;	// start gate, the barrier is set up
+	pthread_cond_t gate_cond;	// once the threads are known
+	pthread_barrier_t barrier;
+	uint32_t n_threads;
+	uint32_t epoch_end;	// clock count of the end of the quantum
+	uint8_t stop;
+	enum HALT halt;
+	uint64_t quanta;
+	double host_sec;
+};
+
+struct hart_group_t *hart_group_create(const struct sim_config_t *cfg, uint32_t n_harts, uint32_t quantum);
+void hart_group_destroy(struct hart_group_t *group);
+int hart_group_load(struct hart_group_t *group, const char *imem_path, const char *dmem_path);
+enum HALT hart_group_run(struct hart_group_t *group);
+
+// Sum of all harts, cycles of the slowest
+void hart_group_stats(struct hart_group_t *group, struct sim_stats_t *stats);
+
+#endif
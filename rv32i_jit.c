@@ -0,0 +1,816 @@
+/* **************************************
+ * Module: x86-64 translation of hot basic blocks
+ *
+ * **************************************
+ */
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "rv32i_jit.h"
+#include "rv32i_units.h"
+
+// x86-64 registers
+enum X_REG {
+  X_RAX = 0, X_RCX, X_RDX, X_RBX, X_RSP, X_RBP, X_RSI, X_RDI,
+  X_R8, X_R9, X_R10, X_R11, X_R12, X_R13, X_R14, X_R15
+};
+
+// Condition codes of jcc/setcc
+enum X_CC {
+  X_CC_B = 0x2, X_CC_AE = 0x3, X_CC_E = 0x4, X_CC_NE = 0x5, X_CC_A = 0x7,
+  X_CC_S = 0x8, X_CC_NS = 0x9, X_CC_L = 0xC, X_CC_GE = 0xD, X_CC_LE = 0xE
+};
+
+#define X_REG_DATA X_RBX
+#define X_CTX X_R12
+#define X_BUDGET X_R13
+#define X_MEM X_R14
+#define X_ADDR X_R15	// effective address, kept across helper calls
+
+#define GUEST(r) ((int32_t)(r) * 4)
+#define CTX(field) ((int32_t)offsetof(struct jit_ctx_t, field))
+#define MEM(field) ((int32_t)offsetof(struct mem_t, field))
+
+typedef uint32_t (*jit_enter_t)(struct jit_ctx_t *ctx, uint8_t *entry);
+
+// Exit of a block, emitted after its body
+struct jit_stub_t {
+	uint8_t *site[2];	// rel32 fields jumping to the stub
+	uint8_t kind;	// enum JIT_EXIT, CHAIN links to pc
+	uint32_t pc;
+	uint32_t addback;	// budget of the instructions not executed
+	uint8_t rs2;	// tohost: register stored
+};
+
+struct jit_block_t {
+	uint8_t *p;
+	struct jit_stub_t stub[JIT_BLOCK_MAX*2 + 2];
+	uint32_t stub_cnt;
+};
+
+/* ---------- encoder ---------- */
+
+static void x_byte(struct jit_block_t *b, uint8_t v) {
+	*b->p++ = v;
+}
+
+static void x_u32(struct jit_block_t *b, uint32_t v) {
+	memcpy(b->p, &v, 4);
+	b->p += 4;
+}
+
+static void x_u64(struct jit_block_t *b, uint64_t v) {
+	memcpy(b->p, &v, 8);
+	b->p += 8;
+}
+
+static void x_rex(struct jit_block_t *b, uint8_t w, int r, int base, uint8_t force) {
+	uint8_t rex = 0x40 | (w << 3) | ((r >> 3) & 1) << 2 | ((base >> 3) & 1);
+
+	if(rex != 0x40 || force)
+		x_byte(b, rex);
+}
+
+static void x_opcode(struct jit_block_t *b, uint32_t op) {
+	if(op > 0xFF)
+		x_byte(b, op >> 8);
+	x_byte(b, op & 0xFF);
+}
+
+// op reg, [base + disp]
+static void x_rm(struct jit_block_t *b, uint8_t w, uint32_t op, int r, int base, int32_t disp) {
+	x_rex(b, w, r, base, 0);
+	x_opcode(b, op);
+	if(disp >= -128 && disp <= 127){
+		x_byte(b, 0x40 | (r & 7) << 3 | (base & 7));
+		if((base & 7) == X_RSP)
+			x_byte(b, 0x24);
+		x_byte(b, (uint8_t)disp);
+	}
+	else {
+		x_byte(b, 0x80 | (r & 7) << 3 | (base & 7));
+		if((base & 7) == X_RSP)
+			x_byte(b, 0x24);
+		x_u32(b, (uint32_t)disp);
+	}
+}
+
+// op rm, reg (register form)
+static void x_rr(struct jit_block_t *b, uint8_t w, uint32_t op, int r, int rm) {
+	x_rex(b, w, r, rm, 0);
+	x_opcode(b, op);
+	x_byte(b, 0xC0 | (r & 7) << 3 | (rm & 7));
+}
+
+// ALU op with an immediate: 81 /digit
+static void x_ri(struct jit_block_t *b, uint8_t w, uint8_t digit, int rm, uint32_t imm) {
+	x_rex(b, w, 0, rm, 0);
+	x_byte(b, 0x81);
+	x_byte(b, 0xC0 | digit << 3 | (rm & 7));
+	x_u32(b, imm);
+}
+
+static void x_mov_imm(struct jit_block_t *b, int r, uint32_t imm) {
+	x_rex(b, 0, 0, r, 0);
+	x_byte(b, 0xB8 | (r & 7));
+	x_u32(b, imm);
+}
+
+static void x_mov_imm64(struct jit_block_t *b, int r, uint64_t imm) {
+	x_rex(b, 1, 0, r, 0);
+	x_byte(b, 0xB8 | (r & 7));
+	x_u64(b, imm);
+}
+
+// mov dword [base + disp], imm
+static void x_store_imm(struct jit_block_t *b, int base, int32_t disp, uint32_t imm) {
+	x_rm(b, 0, 0xC7, 0, base, disp);
+	x_u32(b, imm);
+}
+
+static void x_setcc(struct jit_block_t *b, uint8_t cc, int r) {
+	x_rex(b, 0, 0, r, 0);
+	x_byte(b, 0x0F);
+	x_byte(b, 0x90 | cc);
+	x_byte(b, 0xC0 | (r & 7));
+}
+
+// Jumps return their rel32 field, linked later with x_link()
+static uint8_t *x_jcc(struct jit_block_t *b, uint8_t cc) {
+	x_byte(b, 0x0F);
+	x_byte(b, 0x80 | cc);
+	x_u32(b, 0);
+	return b->p - 4;
+}
+
+static uint8_t *x_jmp(struct jit_block_t *b) {
+	x_byte(b, 0xE9);
+	x_u32(b, 0);
+	return b->p - 4;
+}
+
+static void x_link(uint8_t *site, const uint8_t *target) {
+	int32_t rel = (int32_t)(target - (site + 4));
+	memcpy(site, &rel, 4);
+}
+
+static void x_push(struct jit_block_t *b, int r) {
+	x_rex(b, 0, 0, r, 0);
+	x_byte(b, 0x50 | (r & 7));
+}
+
+static void x_pop(struct jit_block_t *b, int r) {
+	x_rex(b, 0, 0, r, 0);
+	x_byte(b, 0x58 | (r & 7));
+}
+
+static void x_call(struct jit_block_t *b, const void *fn) {
+	x_mov_imm64(b, X_RAX, (uint64_t)(uintptr_t)fn);
+	x_byte(b, 0xFF);
+	x_byte(b, 0xD0);	// call rax
+}
+
+/* ---------- helpers called from native code ---------- */
+
+// Loads and stores that miss the last page fast path, bit 32 set on a fault
+static uint64_t jit_load_slow(struct jit_ctx_t *ctx, uint32_t addr, uint32_t func3) {
+	struct dmem_input_t dmem_in;
+	struct dmem_output_t dmem_out;
+
+	dmem_in.addr = addr;
+	dmem_in.func3 = func3;
+	dmem_in.mem_read = 1;
+	dmem_in.mem_write = 0;
+	dmem(&dmem_in, &dmem_out, ctx->mem);
+	if(dmem_out.fault){
+		ctx->aux = addr;
+		return 1ULL << 32;
+	}
+	return dmem_out.dout;
+}
+
+static uint32_t jit_store_slow(struct jit_ctx_t *ctx, uint32_t addr, uint32_t din, uint32_t func3) {
+	struct dmem_input_t dmem_in;
+	struct dmem_output_t dmem_out;
+
+	dmem_in.addr = addr;
+	dmem_in.din = din;
+	dmem_in.func3 = func3;
+	dmem_in.mem_read = 0;
+	dmem_in.mem_write = 1;
+	dmem(&dmem_in, &dmem_out, ctx->mem);
+	if(dmem_out.fault){
+		ctx->aux = addr;
+		return 1;
+	}
+	return 0;
+}
+
+static uint32_t jit_muldiv(uint32_t in1, uint32_t in2, uint32_t func3) {
+	return muldiv(in1, in2, func3);
+}
+
+/* ---------- translation ---------- */
+
+static struct jit_stub_t *jit_stub(struct jit_block_t *b, uint8_t kind, uint32_t pc, uint32_t addback) {
+	struct jit_stub_t *s = &b->stub[b->stub_cnt++];
+
+	s->site[0] = s->site[1] = NULL;
+	s->kind = kind;
+	s->pc = pc;
+	s->addback = addback;
+	s->rs2 = 0;
+	return s;
+}
+
+// eax = eax op ecx, as alu() computes result
+static void jit_alu(struct jit_block_t *b, uint8_t alu_control) {
+	switch(alu_control){
+		case C_AND:
+			x_rr(b, 0, 0x21, X_RCX, X_RAX);
+			break;
+		case C_OR:
+			x_rr(b, 0, 0x09, X_RCX, X_RAX);
+			break;
+		case C_XOR:
+			x_rr(b, 0, 0x31, X_RCX, X_RAX);
+			break;
+		case C_SL:
+			x_rr(b, 0, 0xD3, 4, X_RAX);	// shl eax, cl
+			break;
+		case C_SR:
+			x_rr(b, 0, 0xD3, 5, X_RAX);	// shr eax, cl
+			break;
+		case C_SRA:
+			x_rr(b, 0, 0xD3, 7, X_RAX);	// sar eax, cl
+			break;
+		case C_SUB:
+			x_rr(b, 0, 0x29, X_RCX, X_RAX);
+			break;
+		default:
+			x_rr(b, 0, 0x01, X_RCX, X_RAX);
+			break;
+	}
+}
+
+// eax = rs1 op (rs2 or imm)
+static void jit_operands(struct jit_block_t *b, const struct uop_t *uop, uint8_t use_imm) {
+	x_rm(b, 0, 0x8B, X_RAX, X_REG_DATA, GUEST(uop->rs1));
+	if(use_imm)
+		x_mov_imm(b, X_RCX, uop->imm);
+	else
+		x_rm(b, 0, 0x8B, X_RCX, X_REG_DATA, GUEST(uop->rs2));
+}
+
+static void jit_write_rd(struct jit_block_t *b, const struct uop_t *uop) {
+	if(uop->rd)
+		x_rm(b, 0, 0x89, X_RAX, X_REG_DATA, GUEST(uop->rd));
+}
+
+// rdx = host address of [X_ADDR, +bytes) when it is in range and on the
+// last page used, otherwise jump to the returned slow path sites
+static void jit_fast_addr(struct jit_block_t *b, uint8_t bytes, uint8_t **slow) {
+	// (uint32_t)(addr - base) + bytes > size: fault, decided by dmem()
+	x_rr(b, 0, 0x89, X_ADDR, X_RDX);
+	x_rm(b, 0, 0x2B, X_RDX, X_MEM, MEM(base));
+	x_ri(b, 1, 0, X_RDX, bytes);
+	x_rm(b, 1, 0x3B, X_RDX, X_MEM, MEM(size));
+	slow[0] = x_jcc(b, X_CC_A);
+
+	// page of the last access, not crossing its end
+	x_rr(b, 0, 0x89, X_ADDR, X_RDX);
+	x_byte(b, 0xC1);
+	x_byte(b, 0xEA);
+	x_byte(b, MEM_PAGE_BITS);	// shr edx, 12
+	x_rm(b, 0, 0x3B, X_RDX, X_MEM, MEM(last_vpn));
+	slow[1] = x_jcc(b, X_CC_NE);
+	x_rr(b, 0, 0x89, X_ADDR, X_RDX);
+	x_ri(b, 0, 4, X_RDX, MEM_PAGE_MASK);
+	slow[2] = NULL;
+	if(bytes > 1){
+		x_ri(b, 0, 7, X_RDX, MEM_PAGE_SIZE - bytes);
+		slow[2] = x_jcc(b, X_CC_A);
+	}
+	x_rm(b, 1, 0x03, X_RDX, X_MEM, MEM(last_page));
+}
+
+static void jit_load(struct jit_block_t *b, const struct uop_t *uop, uint32_t pc, uint32_t addback) {
+	uint8_t bytes = 1 << (uop->func3 & 0x3);
+	uint8_t *slow[3], *done, *fault;
+
+	jit_operands(b, uop, 1);
+	jit_alu(b, uop->alu_control);
+	x_rr(b, 0, 0x89, X_RAX, X_ADDR);
+	jit_fast_addr(b, bytes, slow);
+
+	switch(uop->op){
+		case OP_LB:
+			x_rm(b, 0, 0x0FBE, X_RAX, X_RDX, 0);
+			break;
+		case OP_LBU:
+			x_rm(b, 0, 0x0FB6, X_RAX, X_RDX, 0);
+			break;
+		case OP_LH:
+			x_rm(b, 0, 0x0FBF, X_RAX, X_RDX, 0);
+			break;
+		case OP_LHU:
+			x_rm(b, 0, 0x0FB7, X_RAX, X_RDX, 0);
+			break;
+		default:
+			x_rm(b, 0, 0x8B, X_RAX, X_RDX, 0);
+			break;
+	}
+	done = x_jmp(b);
+
+	for(int i = 0; i < 3; i++)
+		if(slow[i])
+			x_link(slow[i], b->p);
+	x_rr(b, 1, 0x89, X_CTX, X_RDI);
+	x_rr(b, 0, 0x89, X_ADDR, X_RSI);
+	x_mov_imm(b, X_RDX, uop->func3);
+	x_call(b, (const void*)jit_load_slow);
+	x_rex(b, 1, 0, X_RAX, 0);
+	x_byte(b, 0x0F);
+	x_byte(b, 0xBA);
+	x_byte(b, 0xE0);
+	x_byte(b, 32);	// bt rax, 32
+	fault = x_jcc(b, X_CC_B);
+	jit_stub(b, JIT_EXIT_FAULT, pc, addback)->site[0] = fault;
+
+	x_link(done, b->p);
+	jit_write_rd(b, uop);
+}
+
+static void jit_store(struct jit_block_t *b, const struct uop_t *uop, uint32_t pc, uint32_t addback) {
+	uint8_t bytes = 1 << (uop->func3 & 0x3);
+	uint8_t *slow[3], *done, *fault;
+	struct jit_stub_t *s;
+
+	jit_operands(b, uop, 1);
+	jit_alu(b, uop->alu_control);
+	x_rr(b, 0, 0x89, X_RAX, X_ADDR);
+	x_rm(b, 0, 0x8B, X_RCX, X_REG_DATA, GUEST(uop->rs2));
+	jit_fast_addr(b, bytes, slow);
+
+	if(bytes == 1)
+		x_rm(b, 0, 0x88, X_RCX, X_RDX, 0);
+	else if(bytes == 2){
+		x_byte(b, 0x66);
+		x_rm(b, 0, 0x89, X_RCX, X_RDX, 0);
+	}
+	else
+		x_rm(b, 0, 0x89, X_RCX, X_RDX, 0);
+	done = x_jmp(b);
+
+	for(int i = 0; i < 3; i++)
+		if(slow[i])
+			x_link(slow[i], b->p);
+	x_rr(b, 0, 0x89, X_RCX, X_RDX);
+	x_rr(b, 1, 0x89, X_CTX, X_RDI);
+	x_rr(b, 0, 0x89, X_ADDR, X_RSI);
+	x_mov_imm(b, X_RCX, uop->func3);
+	x_call(b, (const void*)jit_store_slow);
+	x_rr(b, 0, 0x85, X_RAX, X_RAX);
+	fault = x_jcc(b, X_CC_NE);
+	jit_stub(b, JIT_EXIT_FAULT, pc, addback)->site[0] = fault;
+
+	// a store to tohost ends the run after it
+	x_link(done, b->p);
+	x_rm(b, 0, 0x3B, X_ADDR, X_CTX, CTX(tohost));
+	s = jit_stub(b, JIT_EXIT_TOHOST, pc + uop->len, addback - 1);
+	s->rs2 = uop->rs2;
+	s->site[0] = x_jcc(b, X_CC_E);
+}
+
+// Jump to target, a jump to itself stops the run
+static void jit_exit_to(struct jit_block_t *b, uint8_t *site, uint32_t pc, uint32_t target) {
+	if(target == pc)
+		jit_stub(b, JIT_EXIT_SELF_LOOP, pc, 0)->site[0] = site;
+	else
+		jit_stub(b, JIT_EXIT_CHAIN, target, 0)->site[0] = site;
+}
+
+static void jit_branch(struct jit_block_t *b, const struct uop_t *uop, uint32_t pc) {
+	uint8_t cc;
+
+	jit_operands(b, uop, 0);
+	x_rr(b, 0, 0x39, X_RCX, X_RAX);	// cmp rs1, rs2
+
+	// conditions of the EX stage on zero, sign (rs1 < rs2) and ucmp
+	switch(uop->op){
+		case OP_BEQ:
+			cc = X_CC_E;
+			break;
+		case OP_BNE:
+			cc = X_CC_NE;
+			break;
+		case OP_BLT:
+			cc = X_CC_L;
+			break;
+		case OP_BGE:
+			cc = X_CC_GE;
+			break;
+		case OP_BLTU:
+			cc = X_CC_B;
+			break;
+		default:
+			cc = X_CC_AE;
+			break;
+	}
+
+	jit_exit_to(b, x_jcc(b, cc), pc, pc + uop->imm);
+	jit_exit_to(b, x_jmp(b), pc, pc + uop->len);
+}
+
+static void jit_jalr(struct jit_block_t *b, struct jit_t *jit, const struct uop_t *uop, uint32_t pc) {
+	uint8_t *miss[2];
+	struct jit_stub_t *s;
+
+	jit_operands(b, uop, 1);
+	jit_alu(b, uop->alu_control);
+	x_byte(b, 0x83);
+	x_byte(b, 0xE0);
+	x_byte(b, 0xFE);	// and eax, ~1
+	if(uop->rd)
+		x_store_imm(b, X_REG_DATA, GUEST(uop->rd), pc + uop->len);
+
+	x_byte(b, 0x3D);
+	x_u32(b, pc);	// cmp eax, pc
+	jit_stub(b, JIT_EXIT_SELF_LOOP, pc, 0)->site[0] = x_jcc(b, X_CC_E);
+
+	// target in the entry table: jump there, else back to the dispatcher
+	x_rm(b, 0, 0x89, X_RAX, X_CTX, CTX(pc));
+	x_rr(b, 0, 0x89, X_RAX, X_RDX);
+	x_ri(b, 0, 5, X_RDX, jit->imem_base);
+	x_byte(b, 0xD1);
+	x_byte(b, 0xEA);	// shr edx, 1
+	x_ri(b, 0, 7, X_RDX, DECODE_ENTRIES(jit->imem_size));
+	miss[0] = x_jcc(b, X_CC_AE);
+	x_mov_imm64(b, X_RCX, (uint64_t)(uintptr_t)jit->entry);
+	x_byte(b, 0x48);
+	x_byte(b, 0x8B);
+	x_byte(b, 0x0C);
+	x_byte(b, 0xD1);	// mov rcx, [rcx + rdx*8]
+	x_rr(b, 1, 0x85, X_RCX, X_RCX);
+	miss[1] = x_jcc(b, X_CC_E);
+	x_byte(b, 0xFF);
+	x_byte(b, 0xE1);	// jmp rcx
+
+	s = jit_stub(b, JIT_EXIT_PC, 0, 0);
+	s->site[0] = miss[0];
+	s->site[1] = miss[1];
+}
+
+static void jit_stubs(struct jit_t *jit, struct jit_block_t *b) {
+	for(uint32_t i = 0; i < b->stub_cnt; i++){
+		struct jit_stub_t *s = &b->stub[i];
+
+		for(int k = 0; k < 2; k++)
+			if(s->site[k])
+				x_link(s->site[k], b->p);
+
+		if(s->addback)
+			x_ri(b, 1, 0, X_BUDGET, s->addback);
+		if(s->kind == JIT_EXIT_TOHOST){
+			x_rm(b, 0, 0x8B, X_RAX, X_REG_DATA, GUEST(s->rs2));
+			x_rm(b, 0, 0x89, X_RAX, X_CTX, CTX(aux));
+		}
+		// jalr misses already stored the pc
+		if(!(s->kind == JIT_EXIT_PC))
+			x_store_imm(b, X_CTX, CTX(pc), s->pc);
+		if(s->kind == JIT_EXIT_CHAIN){
+			x_mov_imm64(b, X_RAX, (uint64_t)(uintptr_t)s->site[0]);
+			x_rm(b, 1, 0x89, X_RAX, X_CTX, CTX(patch));
+		}
+		x_mov_imm(b, X_RAX, s->kind);
+		x_link(x_jmp(b), jit->epilogue);
+	}
+}
+
+static uint8_t jit_is_control(const struct uop_t *uop) {
+	return uop->op == OP_JAL || uop->op == OP_JALR || (uop->op >= OP_BEQ && uop->op <= OP_BGEU);
+}
+
+// Native code of the block at pc, NULL when its first instruction cannot be translated
+static uint8_t *jit_translate(struct jit_t *jit, uint32_t pc) {
+	struct jit_block_t *b = jit->block;
+	uint32_t idx = (pc - jit->imem_base) / PARCEL_SIZE;
+	uint32_t entries = DECODE_ENTRIES(jit->imem_size);
+	uint32_t n, k, i, ipc;
+	struct uop_t *uop = NULL;
+	uint8_t *entry;
+
+	// instructions of the block: up to a control instruction
+	for(n = 0, i = idx; n < JIT_BLOCK_MAX && i < entries; n++){
+		uop = &jit->uop_table[i];
+		if(uop->op == OP_ECALL || uop->op == OP_EBREAK || uop->op == OP_CSR)
+			break;
+		i += uop->len / PARCEL_SIZE;
+		if(jit_is_control(uop)){
+			n++;
+			break;
+		}
+	}
+	if(n == 0)
+		return NULL;
+
+	b->p = entry = jit->code + jit->code_used;
+	b->stub_cnt = 0;
+
+	// cmp r13, n; jl budget; sub r13, n
+	x_ri(b, 1, 7, X_BUDGET, n);
+	jit_stub(b, JIT_EXIT_BUDGET, pc, 0)->site[0] = x_jcc(b, X_CC_L);
+	x_ri(b, 1, 5, X_BUDGET, n);
+
+	for(k = 0, i = idx, ipc = pc; k < n; k++, i += uop->len / PARCEL_SIZE, ipc += uop->len){
+		uop = &jit->uop_table[i];
+
+		switch(uop->op){
+			case OP_NOP:
+				break;
+			case OP_LUI:
+				if(uop->rd)
+					x_store_imm(b, X_REG_DATA, GUEST(uop->rd), uop->imm);
+				break;
+			case OP_AUIPC:
+				if(uop->rd)
+					x_store_imm(b, X_REG_DATA, GUEST(uop->rd), ipc + uop->imm);
+				break;
+			case OP_JAL:
+				if(uop->rd)
+					x_store_imm(b, X_REG_DATA, GUEST(uop->rd), ipc + uop->len);
+				jit_exit_to(b, x_jmp(b), ipc, ipc + uop->imm);
+				break;
+			case OP_JALR:
+				jit_jalr(b, jit, uop, ipc);
+				break;
+			case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+				jit_branch(b, uop, ipc);
+				break;
+			case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU:
+				jit_load(b, uop, ipc, n - k);
+				break;
+			case OP_SB: case OP_SH: case OP_SW:
+				jit_store(b, uop, ipc, n - k);
+				break;
+			case OP_SLTI: case OP_SLT:
+				if(!uop->rd)
+					break;
+				jit_operands(b, uop, uop->op == OP_SLTI);
+				x_rr(b, 0, 0x39, X_RCX, X_RAX);
+				x_setcc(b, X_CC_L, X_RAX);	// sign
+				x_rr(b, 0, 0x0FB6, X_RAX, X_RAX);	// movzx eax, al
+				jit_write_rd(b, uop);
+				break;
+			case OP_SLTIU: case OP_SLTU:
+				if(!uop->rd)
+					break;
+				jit_operands(b, uop, uop->op == OP_SLTIU);
+				x_rr(b, 0, 0x39, X_RCX, X_RAX);
+				x_setcc(b, X_CC_B, X_RAX);	// ucmp
+				x_rr(b, 0, 0x0FB6, X_RAX, X_RAX);	// movzx eax, al
+				jit_write_rd(b, uop);
+				break;
+			case OP_MUL:
+				if(!uop->rd)
+					break;
+				jit_operands(b, uop, 0);
+				x_rr(b, 0, 0x0FAF, X_RAX, X_RCX);	// imul eax, ecx
+				jit_write_rd(b, uop);
+				break;
+			case OP_MULH: case OP_MULHSU: case OP_MULHU:
+			case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+				if(!uop->rd)
+					break;
+				jit_operands(b, uop, 0);
+				x_rr(b, 0, 0x89, X_RAX, X_RDI);
+				x_rr(b, 0, 0x89, X_RCX, X_RSI);
+				x_mov_imm(b, X_RDX, uop->func3);
+				x_call(b, (const void*)jit_muldiv);
+				jit_write_rd(b, uop);
+				break;
+			default:	// register and immediate ALU operations
+				if(!uop->rd)
+					break;
+				jit_operands(b, uop, uop->op < OP_ADD);
+				jit_alu(b, uop->alu_control);
+				jit_write_rd(b, uop);
+				break;
+		}
+	}
+
+	// block cut before ecall or at its size limit, ipc is past the last instruction
+	if(!jit_is_control(uop))
+		jit_stub(b, JIT_EXIT_CHAIN, ipc, 0)->site[0] = x_jmp(b);
+
+	jit_stubs(jit, b);
+
+	jit->code_used = b->p - jit->code;
+	jit->entry[idx] = entry;
+	jit->blocks++;
+	return entry;
+}
+
+/* ---------- run time ---------- */
+
+// Trampoline from C: saves the callee-saved registers, loads the fixed ones
+static void jit_emit_trampoline(struct jit_t *jit) {
+	struct jit_block_t *b = jit->block;
+
+	b->p = jit->code;
+	jit->enter = b->p;
+	x_push(b, X_RBX);
+	x_push(b, X_RBP);
+	x_push(b, X_R12);
+	x_push(b, X_R13);
+	x_push(b, X_R14);
+	x_push(b, X_R15);
+	x_rex(b, 1, 0, X_RSP, 0);
+	x_byte(b, 0x83);
+	x_byte(b, 0xEC);
+	x_byte(b, 8);	// sub rsp, 8: calls see an aligned stack
+	x_rr(b, 1, 0x89, X_RDI, X_CTX);
+	x_rm(b, 1, 0x8B, X_REG_DATA, X_CTX, CTX(reg_data));
+	x_rm(b, 1, 0x8B, X_BUDGET, X_CTX, CTX(budget));
+	x_rm(b, 1, 0x8B, X_MEM, X_CTX, CTX(mem));
+	x_byte(b, 0xFF);
+	x_byte(b, 0xE6);	// jmp rsi
+
+	jit->epilogue = b->p;
+	x_rm(b, 1, 0x89, X_BUDGET, X_CTX, CTX(budget));
+	x_rex(b, 1, 0, X_RSP, 0);
+	x_byte(b, 0x83);
+	x_byte(b, 0xC4);
+	x_byte(b, 8);	// add rsp, 8
+	x_pop(b, X_R15);
+	x_pop(b, X_R14);
+	x_pop(b, X_R13);
+	x_pop(b, X_R12);
+	x_pop(b, X_RBP);
+	x_pop(b, X_RBX);
+	x_byte(b, 0xC3);
+
+	jit->code_start = jit->code_used = b->p - jit->code;
+}
+
+// The code buffer is never writable and executable at once: it is
+// executable, and the pages of [p, p+len) are writable only while a
+// block is emitted there or an exit is linked
+static int jit_writable(uint8_t *p, size_t len, uint8_t on) {
+	uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+	uintptr_t start = (uintptr_t)p & ~(page - 1);
+	uintptr_t end = ((uintptr_t)p + len + page - 1) & ~(page - 1);
+
+	return mprotect((void*)start, end - start, on ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC);
+}
+
+// NULL when the host is not x86-64 or the code buffer cannot be mapped
+struct jit_t *jit_create(void) {
+#if !defined(__x86_64__)
+	return NULL;
+#else
+	struct jit_t *jit;
+
+	jit = (struct jit_t*)calloc(1, sizeof(struct jit_t));
+	if(jit == NULL)
+		return NULL;
+
+	jit->block = (struct jit_block_t*)malloc(sizeof(struct jit_block_t));
+	jit->code = (uint8_t*)mmap(NULL, JIT_CODE_SIZE, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(jit->block == NULL || jit->code == MAP_FAILED){
+		free(jit->block);
+		free(jit);
+		return NULL;
+	}
+	jit_emit_trampoline(jit);
+	if(jit_writable(jit->code, JIT_CODE_SIZE, 0)){
+		printf("The host does not allow executable JIT code\n");
+		munmap(jit->code, JIT_CODE_SIZE);
+		free(jit->block);
+		free(jit);
+		return NULL;
+	}
+
+	return jit;
+#endif
+}
+
+void jit_destroy(struct jit_t *jit) {
+	if(jit == NULL)
+		return;
+	munmap(jit->code, JIT_CODE_SIZE);
+	free(jit->block);
+	free(jit->entry);
+	free(jit->count);
+	free(jit);
+}
+
+// Drop every translation, the execution counts are kept
+void jit_flush(struct jit_t *jit) {
+	if(jit->entry)
+		memset(jit->entry, 0, DECODE_ENTRIES(jit->imem_size) * sizeof(uint8_t*));
+	jit->code_used = jit->code_start;
+	jit->gen++;
+	jit->flushes++;
+}
+
+// Run on this state and program, a new program drops the translations
+int jit_bind(struct jit_t *jit, uint32_t *reg_data, struct mem_t *mem, uint32_t *imem_data,
+		struct uop_t *uop_table, uint32_t imem_base, uint32_t imem_size) {
+	jit->ctx.reg_data = reg_data;
+	jit->ctx.mem = mem;
+
+	if(jit->imem_data == imem_data && jit->uop_table == uop_table && jit->imem_base == imem_base
+			&& jit->imem_size == imem_size)
+		return 0;
+
+	free(jit->entry);
+	free(jit->count);
+	jit->entry = (uint8_t**)calloc(DECODE_ENTRIES(imem_size) + 1, sizeof(uint8_t*));
+	jit->count = (uint32_t*)calloc(DECODE_ENTRIES(imem_size) + 1, sizeof(uint32_t));
+	jit->imem_data = imem_data;
+	jit->uop_table = uop_table;
+	jit->imem_base = imem_base;
+	jit->imem_size = imem_size;
+	jit->code_used = jit->code_start;
+	jit->gen++;
+	if(jit->entry == NULL || jit->count == NULL){
+		jit->imem_size = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+// Native code of pc, translated once pc is hot
+static uint8_t *jit_lookup(struct jit_t *jit, uint32_t pc) {
+	uint32_t idx = (pc - jit->imem_base) / PARCEL_SIZE;
+	uint8_t *code;
+
+	if(idx >= DECODE_ENTRIES(jit->imem_size) || (pc & 1))
+		return NULL;
+	if(jit->entry[idx])
+		return jit->entry[idx];
+	if(++jit->count[idx] < JIT_HOT)
+		return NULL;
+	// a full buffer is flushed, the block then goes at code_start
+	if(jit->code_used + JIT_CODE_MARGIN > JIT_CODE_SIZE)
+		jit_flush(jit);
+	code = jit->code + jit->code_used;
+	if(jit_writable(code, JIT_CODE_MARGIN, 1))
+		return NULL;
+	if(jit_translate(jit, pc) == NULL)
+		jit->count[idx] = 0;
+	jit_writable(code, JIT_CODE_MARGIN, 0);
+	return jit->entry[idx];
+}
+
+// Native execution from jit_in.pc while the code is translated
+struct jit_output_t jit_run(struct jit_t *jit, struct jit_input_t jit_in) {
+	struct jit_output_t jit_out;
+	struct jit_ctx_t *ctx = &jit->ctx;
+	jit_enter_t enter = (jit_enter_t)(void*)jit->enter;
+	uint32_t status = JIT_EXIT_BUDGET;
+	uint8_t *entry;
+
+	ctx->pc = jit_in.pc;
+	ctx->budget = jit_in.budget > INT64_MAX ? INT64_MAX : (int64_t)jit_in.budget;
+	ctx->tohost = jit_in.tohost;
+	ctx->aux = 0;
+
+	entry = jit_lookup(jit, ctx->pc);
+	while(entry){
+		uint32_t gen = jit->gen;
+
+		ctx->patch = NULL;
+		status = enter(ctx, entry);
+		if(status != JIT_EXIT_PC && status != JIT_EXIT_CHAIN)
+			break;
+
+		entry = jit_lookup(jit, ctx->pc);
+		if(entry && status == JIT_EXIT_CHAIN && gen == jit->gen && jit_writable(ctx->patch, 4, 1) == 0){
+			x_link(ctx->patch, entry);
+			jit_writable(ctx->patch, 4, 0);
+		}
+	}
+
+	jit_out.pc = ctx->pc;
+	jit_out.inst_cnt = (jit_in.budget > INT64_MAX ? INT64_MAX : (int64_t)jit_in.budget) - ctx->budget;
+	jit_out.halt = HALT_NONE;
+	jit_out.tohost_val = 0;
+	jit_out.fault_addr = 0;
+	if(status == JIT_EXIT_TOHOST){
+		jit_out.halt = HALT_TOHOST;
+		jit_out.tohost_val = ctx->aux;
+	}
+	else if(status == JIT_EXIT_FAULT){
+		jit_out.halt = HALT_FAULT;
+		jit_out.fault_addr = ctx->aux;
+	}
+	else if(status == JIT_EXIT_SELF_LOOP)
+		jit_out.halt = HALT_SELF_LOOP;
+	jit->native_insts += jit_out.inst_cnt;
+
+	return jit_out;
+}
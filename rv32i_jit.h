@@ -0,0 +1,119 @@
+/* **************************************
+ * Module: x86-64 translation of hot basic blocks
+ *
+ * The functional engine counts the targets of its taken
+ * jumps. Once a target is hot, the basic block starting
+ * there is translated to native code that works on
+ * reg_data and the sparse memory directly:
+ *   rbx  reg_data
+ *   r12  struct jit_ctx_t
+ *   r13  instruction budget left
+ *   r14  struct mem_t, for the last page fast path
+ * A block ends at a control instruction. Its exits jump
+ * back to the dispatcher first, which then patches them to
+ * jump straight to the translated target (chaining); jalr
+ * looks its target up in the entry table inline.
+ *
+ * Results follow alu()/dmem(): the flags of the ALU, the
+ * fault check and the tohost store are those of the
+ * interpreter. ecall/ebreak, the CSR instructions and the
+ * accesses missing the last page fast path go back to C
+ * code.
+ *
+ * imem and dmem are separate, so guest stores never hit
+ * code; translations are dropped when the image changes.
+ *
+ * **************************************
+ */
+#ifndef RV32I_JIT_H
+#define RV32I_JIT_H
+
+#include "rv32i.h"
+#include "rv32i_decode.h"
+#include "rv32i_mem.h"
+
+#define JIT_HOT 16	// taken jumps to a pc before it is translated
+#define JIT_BLOCK_MAX 64	// instructions per block
+#define JIT_CODE_SIZE (32 << 20)
+#define JIT_CODE_MARGIN (64 << 10)	// room kept for one more block
+
+// Why native code returned to the dispatcher
+enum JIT_EXIT {
+  JIT_EXIT_PC = 0,	// continue at ctx.pc
+  JIT_EXIT_CHAIN,	// continue at ctx.pc, the jump at ctx.patch can be linked
+  JIT_EXIT_BUDGET,	// not enough budget for the block at ctx.pc
+  JIT_EXIT_TOHOST,
+  JIT_EXIT_FAULT,
+  JIT_EXIT_SELF_LOOP
+};
+
+// Shared with the native code, which reaches it through r12
+struct jit_ctx_t {
+	uint32_t *reg_data;
+	struct mem_t *mem;
+	int64_t budget;
+	uint32_t pc;
+	uint32_t tohost;
+	uint32_t aux;	// tohost value, or fault address
+	uint8_t *patch;	// rel32 of the exit taken
+};
+
+struct jit_input_t {
+	uint32_t pc;
+	uint64_t budget;	// instructions at most
+	uint32_t tohost;
+};
+
+struct jit_output_t {
+	uint32_t pc;
+	uint64_t inst_cnt;
+	enum HALT halt;
+	uint32_t tohost_val;
+	uint32_t fault_addr;
+};
+
+struct jit_block_t;
+
+struct jit_t {
+	uint8_t *code;
+	size_t code_start;	// after the trampoline
+	size_t code_used;
+	uint8_t *enter;	// trampoline from C
+	uint8_t *epilogue;
+	uint32_t gen;	// bumped by every flush
+	struct jit_block_t *block;	// translation scratch
+
+	// program the translations belong to
+	uint32_t *imem_data;
+	struct uop_t *uop_table;
+	uint32_t imem_base;
+	uint32_t imem_size;
+
+	uint8_t **entry;	// native code per imem parcel, NULL: none
+	uint32_t *count;
+
+	struct jit_ctx_t ctx;
+
+	uint64_t blocks;	// translated
+	uint64_t flushes;
+	uint64_t native_insts;
+};
+
+struct jit_t *jit_create(void);
+void jit_destroy(struct jit_t *jit);
+void jit_flush(struct jit_t *jit);
+int jit_bind(struct jit_t *jit, uint32_t *reg_data, struct mem_t *mem, uint32_t *imem_data,
+		struct uop_t *uop_table, uint32_t imem_base, uint32_t imem_size);
+struct jit_output_t jit_run(struct jit_t *jit, struct jit_input_t jit_in);
+
+// Called on every taken jump of the interpreter: 1 when pc has native code,
+// or just became hot
+static inline uint8_t jit_hot(struct jit_t *jit, uint32_t pc) {
+	uint32_t idx = (pc - jit->imem_base) / PARCEL_SIZE;
+
+	if(idx >= DECODE_ENTRIES(jit->imem_size) || (pc & 1))
+		return 0;
+	return jit->entry[idx] || ++jit->count[idx] >= JIT_HOT;
+}
+
+#endif
@@ -0,0 +1,492 @@
+/* **************************************
+ * Module: program image loaders
+ *
+ * **************************************
+ */
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "rv32i_loader.h"
+
+int load_file_open(struct load_file_t *file, const char *path) {
+	struct stat st;
+	int fd;
+
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = 0;
+
+	if ( (fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0 ) {
+		printf("Cannot find %s\n", path);
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	file->size = st.st_size;
+
+	if(file->size >= LOAD_MMAP_MIN){
+		void *map = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		if(map != MAP_FAILED){
+			file->data = (const uint8_t*)map;
+			file->mapped = 1;
+			close(fd);
+			return 0;
+		}
+	}
+
+	// small file, or mmap failed
+	uint8_t *buf = (uint8_t*)malloc(file->size ? file->size : 1);
+	size_t done = 0;
+	while(done < file->size){
+		ssize_t n = read(fd, buf + done, file->size - done);
+		if(n <= 0)
+			break;
+		done += n;
+	}
+	close(fd);
+	if(done != file->size){
+		printf("Cannot read %s\n", path);
+		free(buf);
+		return -1;
+	}
+	file->data = buf;
+
+	return 0;
+}
+
+void load_file_close(struct load_file_t *file) {
+	if(file->mapped)
+		munmap((void*)file->data, file->size);
+	else
+		free((void*)file->data);
+	file->data = NULL;
+}
+
+// Skip white space and comments, returns the next token position
+static size_t load_skip(const struct load_file_t *file, size_t pos) {
+	const uint8_t *d = file->data;
+
+	while(pos < file->size){
+		if(d[pos] == ' ' || d[pos] == '\t' || d[pos] == '\r' || d[pos] == '\n')
+			pos++;
+		else if(d[pos] == '#' || (d[pos] == '/' && pos+1 < file->size && d[pos+1] == '/')){
+			while(pos < file->size && d[pos] != '\n')
+				pos++;
+		}
+		else
+			break;
+	}
+
+	return pos;
+}
+
+static int load_is_space(uint8_t c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+enum LOAD_FMT load_detect(const struct load_file_t *file, const char *path) {
+	size_t len = strlen(path);
+	size_t pos, end;
+
+	if(file->size >= SELFMAG && !memcmp(file->data, ELFMAG, SELFMAG))
+		return LOAD_ELF;
+	if(len >= 4 && !strcmp(path + len - 4, ".bin"))
+		return LOAD_BIN;
+
+	// text: 32 binary digits in the first word means bits
+	pos = load_skip(file, 0);
+	for(end = pos; end < file->size && !load_is_space(file->data[end]); end++){
+		if(file->data[end] != '0' && file->data[end] != '1')
+			return LOAD_HEX;
+	}
+
+	return (end - pos == REG_WIDTH) ? LOAD_BITS : LOAD_HEX;
+}
+
+static int load_hex_digit(uint8_t c) {
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Makes room for imem words [0, words)
+static int load_imem_reserve(struct sim_image_t *image, uint64_t words) {
+	uint64_t cap = image->imem_cap;
+	uint32_t *data;
+
+	if(words <= cap)
+		return 0;
+	if(words > MEM_SIZE_MAX / WORD_SIZE){
+		printf("Program does not fit in imem!!\n");
+		return -1;
+	}
+	while(cap < words)
+		cap *= 2;
+	if ( (data = (uint32_t*)realloc(image->imem_data, cap*sizeof(uint32_t))) == NULL ) {
+		printf("Out of host memory!!\n");
+		return -1;
+	}
+	memset(data + image->imem_cap, 0, (cap - image->imem_cap)*sizeof(uint32_t));
+	image->imem_data = data;
+	image->imem_cap = cap;
+
+	return 0;
+}
+
+// Text words into imem, or into dmem at 4*word from dmem_base,
+// returns the word address after the last word, -1 on error
+static int64_t load_text(const struct load_file_t *file, enum LOAD_FMT fmt, const char *path,
+		struct sim_image_t *image, uint8_t to_dmem) {
+	const uint8_t *d = file->data;
+	size_t pos = 0;
+	uint32_t addr = 0, end = 0;
+	uint32_t line = 1;
+
+	for(;;){
+		size_t tok = load_skip(file, pos);
+		for(; pos < tok; pos++)
+			line += d[pos] == '\n';
+		if(pos >= file->size)
+			break;
+
+		uint8_t at = d[pos] == '@';
+		uint32_t val = 0;
+		int n = 0, digit;
+
+		if(at)
+			pos++;
+		for(; pos < file->size && !load_is_space(d[pos]); pos++, n++){
+			if(fmt == LOAD_BITS && !at){
+				if(d[pos] != '0' && d[pos] != '1')
+					break;
+				val = (val << 1) | (d[pos] - '0');
+			}
+			else {
+				if((digit = load_hex_digit(d[pos])) < 0 || n == 8)
+					break;
+				val = (val << 4) | digit;
+			}
+		}
+		if(n == 0 || (pos < file->size && !load_is_space(d[pos]))
+				|| (fmt == LOAD_BITS && !at && n != REG_WIDTH)){
+			printf("%s:%d: Incorrect format!!\n", path, line);
+			return -1;
+		}
+
+		if(at){
+			addr = val;
+			continue;
+		}
+		if(addr >= MEM_SIZE_MAX / WORD_SIZE){
+			printf("%s:%d: address out of range!!\n", path, line);
+			return -1;
+		}
+		if(to_dmem)
+			mem_write(image->dmem, image->dmem_base + addr*WORD_SIZE, val, WORD_SIZE);
+		else {
+			if(load_imem_reserve(image, (uint64_t)addr + 1))
+				return -1;
+			image->imem_data[addr] = val;
+		}
+		addr++;
+		if(addr > end)
+			end = addr;
+	}
+
+	return end;
+}
+
+static void load_echo_imem(const struct sim_image_t *image, const char *path) {
+	printf("\n*** Reading %s ***\n", path);
+	for(uint32_t i = 0; i < image->imem_size; i++)
+		printf("imem[%03d]: %08X\n", i, image->imem_data[i]);
+}
+
+static void load_echo_dmem(const struct sim_image_t *image, const char *path) {
+	printf("\n*** Reading %s ***\n", path);
+	for(uint32_t i = 0; i < image->dmem_end; i += WORD_SIZE)
+		printf("dmem[%03d]: %08X\n", i, mem_read(image->dmem, image->dmem_base + i, WORD_SIZE));
+}
+
+int load_imem(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo) {
+	enum LOAD_FMT fmt = load_detect(file, path);
+	int64_t n;
+
+	if(fmt == LOAD_ELF)
+		return load_elf(image, file, path, echo);
+
+	if(fmt == LOAD_BIN){
+		n = (file->size + WORD_SIZE-1) / WORD_SIZE;
+		if(load_imem_reserve(image, n))
+			return -1;
+		// host is little-endian like the guest
+		memcpy(image->imem_data, file->data, file->size);
+	}
+	else if((n = load_text(file, fmt, path, image, 0)) < 0)
+		return -1;
+
+	image->imem_size = n;
+	if(echo)
+		load_echo_imem(image, path);
+
+	return 0;
+}
+
+int load_dmem(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo) {
+	enum LOAD_FMT fmt = load_detect(file, path);
+	int64_t n;
+
+	if(fmt == LOAD_ELF){
+		printf("%s: an ELF file goes in place of the imem file\n", path);
+		return -1;
+	}
+
+	if(fmt == LOAD_BIN){
+		if(file->size > MEM_SIZE_MAX - image->dmem_base){
+			printf("%s does not fit in dmem!!\n", path);
+			return -1;
+		}
+		mem_load(image->dmem, image->dmem_base, file->data, file->size);
+		n = file->size;
+	}
+	else {
+		if((n = load_text(file, fmt, path, image, 1)) < 0)
+			return -1;
+		n *= WORD_SIZE;
+	}
+
+	if(n > image->dmem_end)
+		image->dmem_end = n;
+	if(echo)
+		load_echo_dmem(image, path);
+
+	return 0;
+}
+
+static int sym_cmp(const void *a, const void *b) {
+	const struct sim_sym_t *x = (const struct sim_sym_t*)a;
+	const struct sim_sym_t *y = (const struct sim_sym_t*)b;
+
+	return (x->addr > y->addr) - (x->addr < y->addr);
+}
+
+// Address of "tohost", and the code symbols for the profiler
+static void load_elf_symtab(struct sim_image_t *image, const struct load_file_t *file, const Elf32_Ehdr *eh) {
+	const Elf32_Shdr *sh = (const Elf32_Shdr*)(file->data + eh->e_shoff);
+
+	if(eh->e_shoff == 0 || eh->e_shentsize != sizeof(Elf32_Shdr)
+			|| eh->e_shoff + (uint64_t)eh->e_shnum*sizeof(Elf32_Shdr) > file->size)
+		return;
+
+	for(int i = 0; i < eh->e_shnum; i++){
+		if(sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum)
+			continue;
+		const Elf32_Shdr *str = &sh[sh[i].sh_link];
+		if(sh[i].sh_offset + (uint64_t)sh[i].sh_size > file->size
+				|| str->sh_offset + (uint64_t)str->sh_size > file->size || str->sh_size == 0)
+			continue;
+
+		const Elf32_Sym *sym = (const Elf32_Sym*)(file->data + sh[i].sh_offset);
+		const char *strtab = (const char*)(file->data + str->sh_offset);
+		uint32_t n = sh[i].sh_size / sizeof(Elf32_Sym);
+
+		for(uint32_t k = 0; k < n; k++){
+			if(sym[k].st_name >= str->sh_size)
+				continue;
+			const char *name = strtab + sym[k].st_name;
+			size_t len = strnlen(name, str->sh_size - sym[k].st_name);
+
+			if(len == 6 && !strncmp(name, "tohost", 6))
+				image->tohost = sym[k].st_value;
+
+			// functions and labels in executable sections, without assembler locals
+			uint8_t type = ELF32_ST_TYPE(sym[k].st_info);
+			if((type != STT_FUNC && type != STT_NOTYPE) || len == 0 || name[0] == '$'
+					|| !strncmp(name, ".L", 2) || sym[k].st_shndx == SHN_UNDEF
+					|| sym[k].st_shndx >= eh->e_shnum || !(sh[sym[k].st_shndx].sh_flags & SHF_EXECINSTR))
+				continue;
+
+			if(image->sym_cnt == image->sym_cap){
+				uint32_t cap = image->sym_cap ? image->sym_cap*2 : 64;
+				struct sim_sym_t *grown = (struct sim_sym_t*)realloc(image->sym, cap*sizeof(struct sim_sym_t));
+				if(grown == NULL)
+					return;
+				image->sym = grown;
+				image->sym_cap = cap;
+			}
+			struct sim_sym_t *ss = &image->sym[image->sym_cnt];
+			if((ss->name = strndup(name, len)) == NULL)
+				return;
+			ss->addr = sym[k].st_value;
+			ss->size = sym[k].st_size;
+			image->sym_cnt++;
+		}
+	}
+
+	if(image->sym_cnt)
+		qsort(image->sym, image->sym_cnt, sizeof(struct sim_sym_t), sym_cmp);
+}
+
+// Every segment goes to dmem at its virtual address, executable ones
+// also to imem, which starts at the lowest of them
+int load_elf(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo) {
+	const Elf32_Ehdr *eh = (const Elf32_Ehdr*)file->data;
+	const Elf32_Phdr *ph;
+	uint64_t imem_lo = MEM_SIZE_MAX, imem_hi = 0, dmem_lo = MEM_SIZE_MAX;
+
+	if(file->size < sizeof(Elf32_Ehdr) || eh->e_ident[EI_CLASS] != ELFCLASS32
+			|| eh->e_ident[EI_DATA] != ELFDATA2LSB || eh->e_machine != EM_RISCV){
+		printf("%s is not a little-endian RV32 ELF\n", path);
+		return -1;
+	}
+	if(eh->e_phentsize != sizeof(Elf32_Phdr)
+			|| eh->e_phoff + (uint64_t)eh->e_phnum*sizeof(Elf32_Phdr) > file->size){
+		printf("%s: bad program headers\n", path);
+		return -1;
+	}
+
+	ph = (const Elf32_Phdr*)(file->data + eh->e_phoff);
+	for(int i = 0; i < eh->e_phnum; i++){
+		if(ph[i].p_type != PT_LOAD || ph[i].p_memsz == 0)
+			continue;
+
+		uint64_t end = (uint64_t)ph[i].p_vaddr + ph[i].p_memsz;
+		if(ph[i].p_offset + (uint64_t)ph[i].p_filesz > file->size || ph[i].p_filesz > ph[i].p_memsz
+				|| end > MEM_SIZE_MAX){
+			printf("%s: bad segment %d\n", path, i);
+			return -1;
+		}
+		if(ph[i].p_vaddr < dmem_lo)
+			dmem_lo = ph[i].p_vaddr;
+		if(ph[i].p_flags & PF_X){
+			if(ph[i].p_vaddr < imem_lo)
+				imem_lo = ph[i].p_vaddr & ~(uint32_t)(WORD_SIZE-1);
+			if(end > imem_hi)
+				imem_hi = end;
+		}
+		if(echo)
+			printf("%s: %s segment 0x%08X, %d bytes\n", path, (ph[i].p_flags & PF_X) ? "code" : "data",
+					ph[i].p_vaddr, ph[i].p_memsz);
+
+		// bss needs no pages, they read as zero until written
+		mem_load(image->dmem, ph[i].p_vaddr, file->data + ph[i].p_offset, ph[i].p_filesz);
+	}
+
+	if(imem_hi){
+		if(load_imem_reserve(image, (imem_hi - imem_lo + WORD_SIZE-1) / WORD_SIZE))
+			return -1;
+		image->imem_base = imem_lo;
+		image->imem_size = (imem_hi - imem_lo + WORD_SIZE-1) / WORD_SIZE;
+		for(uint32_t i = 0; i < image->imem_size; i++)
+			image->imem_data[i] = mem_read(image->dmem, imem_lo + i*WORD_SIZE, WORD_SIZE);
+	}
+	if(dmem_lo != MEM_SIZE_MAX)
+		image->dmem_base = dmem_lo & ~(uint32_t)MEM_PAGE_MASK;
+
+	image->entry = eh->e_entry;
+	load_elf_symtab(image, file, eh);
+	if(echo){
+		printf("%s: entry 0x%08X", path, image->entry);
+		if(image->tohost != TOHOST_NONE)
+			printf(", tohost 0x%08X", image->tohost);
+		printf("\n");
+	}
+
+	return 0;
+}
+
+struct sim_image_t *sim_image_create(void) {
+	struct sim_image_t *image;
+
+	image = (struct sim_image_t*)calloc(1, sizeof(struct sim_image_t));
+	if(image == NULL)
+		return NULL;
+
+	image->imem_cap = IMEM_DEPTH;
+	image->imem_data = (uint32_t*)calloc(IMEM_DEPTH, sizeof(uint32_t));
+	image->dmem = mem_create(0, MEM_SIZE_MAX);
+	image->entry = 0;
+	image->tohost = TOHOST_NONE;
+	if(image->imem_data == NULL || image->dmem == NULL){
+		sim_image_free(image);
+		return NULL;
+	}
+
+	return image;
+}
+
+// dmem_path may be NULL, or name a file laid over the ELF data
+struct sim_image_t *sim_image_load(const char *imem_path, const char *dmem_path, uint8_t echo) {
+	struct sim_image_t *image;
+	struct load_file_t file;
+	int ret;
+
+	if ( (image = sim_image_create()) == NULL )
+		return NULL;
+
+	if(load_file_open(&file, imem_path))
+		goto fail;
+	ret = load_imem(image, &file, imem_path, echo);
+	load_file_close(&file);
+	if(ret)
+		goto fail;
+
+	if(dmem_path){
+		if(load_file_open(&file, dmem_path))
+			goto fail;
+		ret = load_dmem(image, &file, dmem_path, echo);
+		load_file_close(&file);
+		if(ret)
+			goto fail;
+	}
+
+	// decode the instruction memory once
+	image->uop_table = decode_table_create(image->imem_data, image->imem_size ? image->imem_size : 1);
+	if(image->uop_table == NULL)
+		goto fail;
+
+	return image;
+
+fail:
+	sim_image_free(image);
+	return NULL;
+}
+
+void sim_image_free(struct sim_image_t *image) {
+	if(image == NULL)
+		return;
+	free(image->imem_data);
+	mem_destroy(image->dmem);
+	free(image->uop_table);
+	for(uint32_t i = 0; i < image->sym_cnt; i++)
+		free(image->sym[i].name);
+	free(image->sym);
+	free(image);
+}
+
+// Symbol that contains pc, NULL when there is none
+const struct sim_sym_t *sim_image_symbol(const struct sim_image_t *image, uint32_t pc) {
+	uint32_t lo = 0, hi = image->sym_cnt;
+
+	// last symbol at or below pc
+	while(lo < hi){
+		uint32_t mid = (lo + hi) / 2;
+		if(image->sym[mid].addr <= pc)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if(lo == 0)
+		return NULL;
+
+	const struct sim_sym_t *sym = &image->sym[lo-1];
+	if(sym->size && pc - sym->addr >= sym->size)
+		return NULL;
+	return sym;
+}
@@ -0,0 +1,48 @@
+/* **************************************
+ * Module: program image loaders
+ *
+ * The format of each file is detected from its content:
+ *   ELF     RV32 executable, PT_LOAD segments go to their
+ *           virtual address (executable ones to imem), the
+ *           entry point and the "tohost" symbol are kept
+ *   bits    one 32 character 0/1 word per line (imem.mem)
+ *   hex     one hex word per line (dmem.mem), "@ADDR" moves
+ *           to word address ADDR as in $readmemh
+ *   binary  raw little-endian bytes (*.bin)
+ *
+ * Files of LOAD_MMAP_MIN bytes or more are mapped instead
+ * of read.
+ *
+ * **************************************
+ */
+#ifndef RV32I_LOADER_H
+#define RV32I_LOADER_H
+
+#include "rv32i_sim.h"
+
+#define LOAD_MMAP_MIN (64 << 10)
+
+enum LOAD_FMT {
+  LOAD_AUTO = 0,
+  LOAD_BITS,
+  LOAD_HEX,
+  LOAD_BIN,
+  LOAD_ELF
+};
+
+// Whole file in memory, mapped or read
+struct load_file_t {
+	const uint8_t *data;
+	size_t size;
+	uint8_t mapped;
+};
+
+int load_file_open(struct load_file_t *file, const char *path);
+void load_file_close(struct load_file_t *file);
+enum LOAD_FMT load_detect(const struct load_file_t *file, const char *path);
+
+int load_elf(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo);
+int load_imem(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo);
+int load_dmem(struct sim_image_t *image, const struct load_file_t *file, const char *path, uint8_t echo);
+
+#endif
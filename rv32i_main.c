@@ -0,0 +1,668 @@
+/* **************************************
+ * Module: command line front end of the simulator
+ *
+ * **************************************
+ */
+#include <signal.h>
+#include "rv32i_sim.h"
+#include "rv32i_batch.h"
+#include "rv32i_bench.h"
+#include "rv32i_ckpt.h"
+#include "rv32i_sample.h"
+#include "rv32i_hart.h"
+#include "rv32i_sweep.h"
+
+// How often a checkpointing run looks at its triggers
+#define CKPT_POLL_INSTS (1ULL << 20)
+#define CKPT_POLL_CYCLES (1U << 18)
+
+// When to write a checkpoint, triggers fire once
+struct ckpt_req_t {
+	const char *path;	// NULL: no checkpoints
+	uint32_t cycle;	// 0: none
+	uint64_t inst;	// retired instructions, functional ones included
+};
+
+static volatile sig_atomic_t ckpt_signal;
+
+static void on_sigusr1(int sig) {
+	(void)sig;
+	ckpt_signal = 1;
+}
+
+static void print_cache_stats(const char *name, const struct cache_stats_t *cs, uint32_t stall) {
+	uint64_t acc = cs->hits + cs->misses;
+
+	printf("%s : %llu hits, %llu misses (%.2f%%), %llu evictions, %llu writebacks, %u stall cycles\n",
+			name, (unsigned long long)cs->hits, (unsigned long long)cs->misses,
+			acc ? 100.0 * cs->misses / acc : 0.0, (unsigned long long)cs->evictions,
+			(unsigned long long)cs->writebacks, stall);
+}
+
+// penalty: cycles lost to mispredicts
+static void print_bpred_stats(const struct sim_config_t *cfg, const struct bpred_stats_t *bs, uint64_t penalty) {
+	const struct bpred_config_t *bc = &cfg->bpred;
+	uint64_t miss = bs->branch_miss + bs->jump_miss;
+
+	printf("Branch predictor : %s, %llu branches (%.2f%% correct), %llu jumps (%.2f%% correct)\n",
+			bpred_name(bc->type),
+			(unsigned long long)bs->branches,
+			bs->branches ? 100.0 * (bs->branches - bs->branch_miss) / bs->branches : 0.0,
+			(unsigned long long)bs->jumps,
+			bs->jumps ? 100.0 * (bs->jumps - bs->jump_miss) / bs->jumps : 0.0);
+	if(bc->btb_entries)
+		printf("BTB : %llu lookups, %llu hits\n",
+				(unsigned long long)bs->btb_lookups, (unsigned long long)bs->btb_hits);
+	printf("Mispredicts : %llu, penalty %llu cycles\n",
+			(unsigned long long)miss, (unsigned long long)penalty);
+}
+
+// M extension activity, only for programs that use it
+static void print_muldiv_stats(const struct sim_stats_t *stats) {
+	if(stats->mul_cnt == 0 && stats->div_cnt == 0)
+		return;
+	printf("Mul/div : %u multiplies, %u divides, %u cycles waiting on the multiplier, %u on the divider\n",
+			stats->mul_cnt, stats->div_cnt, stats->mul_stall_cnt, stats->div_stall_cnt);
+}
+
+// Printed once compressed instructions were fetched
+static void print_fetch_stats(const struct sim_stats_t *stats) {
+	if(stats->fetch_rvc == 0)
+		return;
+	printf("Fetch : %u instructions in %u words, %u compressed (%.1f%%), %.1f%% of RV32I fetch bandwidth saved\n",
+			stats->fetch_insts, stats->fetch_words, stats->fetch_rvc, 100.0 * stats->fetch_rvc / stats->fetch_insts,
+			100.0 * (1.0 - (double)stats->fetch_words / stats->fetch_insts));
+}
+
+// sim: also print the final state hash of --bench, NULL for a hart group
+static void print_halt(enum HALT halt, const struct sim_stats_t *stats, const struct sim_t *sim) {
+	if(halt == HALT_TOHOST)
+		printf("Halt reason : %s (0x%08X)\n", halt_name(halt), stats->tohost_val);
+	else if(halt == HALT_FAULT)
+		printf("Halt reason : %s (pc 0x%X, addr 0x%08X)\n", halt_name(halt), stats->halt_pc, stats->fault_addr);
+	else
+		printf("Halt reason : %s (pc 0x%X)\n", halt_name(halt), stats->halt_pc);
+	if(sim)
+		printf("State hash : %08x\n", bench_state_hash(sim));
+}
+
+// The same program on the in-order pipeline, next to an out-of-order or a wide run
+static void print_baseline(const struct sim_config_t *cfg, const struct sim_t *sim,
+		const struct sim_stats_t *ooo, const char *name) {
+	struct sim_config_t base_cfg = *cfg;
+	struct sim_stats_t stats;
+	struct sim_t *base;
+	double ipc, ooo_ipc;
+
+	base_cfg.mode = MODE_PIPE;
+	base_cfg.trace_level = TRACE_NONE;
+	if((base = sim_create(&base_cfg)) == NULL || sim_attach_image(base, sim->image)){
+		sim_destroy(base);
+		printf("In-order baseline : cannot be run\n");
+		return;
+	}
+	sim_run(base);
+	sim_get_stats(base, &stats);
+
+	ipc = stats.cycles ? (double)stats.inst_cnt / stats.cycles : 0.0;
+	ooo_ipc = ooo->cycles ? (double)ooo->inst_cnt / ooo->cycles : 0.0;
+	printf("In-order baseline : %u instructions, %u cycles, IPC %.4f, %s speedup %.2fx\n",
+			stats.inst_cnt, stats.cycles, ipc, name, ipc > 0 ? ooo_ipc / ipc : 0.0);
+	sim_destroy(base);
+}
+
+// Hotspot report to a file, or to stdout for "-"
+static void write_profile(struct sim_t *sim, const char *path, uint32_t top) {
+	FILE *f = stdout;
+
+	if(strcmp(path, "-") && (f = fopen(path, "w")) == NULL){
+		printf("Cannot open %s\n", path);
+		return;
+	}
+	prof_report(f, sim->prof, sim->image, top);
+	if(f != stdout)
+		fclose(f);
+}
+
+// Multi-core run: per hart and aggregate results
+static enum HALT run_harts(const struct sim_config_t *cfg, uint32_t n_harts, uint32_t quantum,
+		const char *imem_path, const char *dmem_path, const char *stats_path, uint8_t show_bpred) {
+	struct hart_group_t *group;
+	struct sim_stats_t stats;
+	enum HALT halt;
+
+	if ( (group = hart_group_create(cfg, n_harts, quantum)) == NULL ) {
+		printf("Cannot allocate %u harts\n", n_harts);
+		exit(1);
+	}
+	if ( hart_group_load(group, imem_path, dmem_path) ) {
+		hart_group_destroy(group);
+		exit(1);
+	}
+
+	halt = hart_group_run(group);
+
+	for(uint32_t i = 0; i < n_harts; i++){
+		struct sim_t *sim = group->hart[i];
+
+		sim_get_stats(sim, &stats);
+		if(cfg->trace_level == TRACE_FULL){
+			printf("\nHart %u\n", i);
+			trace_print_state(stdout, sim->reg_data, group->mem);
+		}
+		printf("Hart %u : %u instructions, %u cycles, CPI %.4f, %s (pc 0x%X), state %08x\n", i, stats.inst_cnt,
+				stats.cycles, stats.inst_cnt ? (double)stats.cycles / stats.inst_cnt : 0.0,
+				stats.halt ? halt_name(stats.halt) : "stopped", stats.halt_pc, bench_state_hash(sim));
+	}
+
+	hart_group_stats(group, &stats);
+	printf("Harts : %u, %u quantum cycles, %llu quanta, %.2f host seconds\n", n_harts, quantum,
+			(unsigned long long)group->quanta, group->host_sec);
+	printf("Instruction count : %d\n", stats.inst_cnt);
+	printf("Cycle count : %d\n", stats.cycles);
+	printf("Aggregate IPC : %.4f\n", stats.cycles ? (double)stats.inst_cnt / stats.cycles : 0.0);
+	stats_print(stdout, &stats);
+	print_muldiv_stats(&stats);
+	print_fetch_stats(&stats);
+	if(cfg->icache.size)
+		print_cache_stats("I-cache", &stats.icache, stats.icache_stall_cnt);
+	if(cfg->dcache.size)
+		print_cache_stats("D-cache", &stats.dcache, stats.dcache_stall_cnt);
+	if(show_bpred)
+		print_bpred_stats(cfg, &stats.bpred, stats.cpi[CPI_BRANCH]);
+	print_halt(halt, &stats, NULL);
+
+	if(stats_path)
+		stats_write(stats_path, &stats);
+	hart_group_destroy(group);
+
+	return halt;
+}
+
+// Save when a trigger is reached, the run goes on afterwards
+static void ckpt_poll(struct sim_t *sim, struct ckpt_req_t *ck) {
+	uint64_t insts = sim->func_inst_cnt + sim->inst_cnt;
+	uint8_t save = 0;
+
+	if(sim->halt)
+		return;
+	if(ckpt_signal){
+		ckpt_signal = 0;
+		save = 1;
+	}
+	if(ck->cycle && sim->cc >= ck->cycle){
+		ck->cycle = 0;
+		save = 1;
+	}
+	if(ck->inst && insts >= ck->inst){
+		ck->inst = 0;
+		save = 1;
+	}
+	if(save && !ckpt_save(sim, ck->path))
+		printf("Checkpoint %s : cycle %u, %llu instructions, pc 0x%X\n", ck->path, sim->cc,
+				(unsigned long long)insts, sim->pc_next);
+}
+
+// sim_run_func() in slices, so the instruction trigger is hit exactly
+static enum HALT run_func(struct sim_t *sim, uint64_t max_inst, uint32_t stop_pc, struct ckpt_req_t *ck) {
+	uint64_t done = 0;
+
+	if(ck->path == NULL)
+		return sim_run_func(sim, max_inst, stop_pc);
+
+	for(;;){
+		uint64_t insts = sim->func_inst_cnt + sim->inst_cnt;
+		uint64_t start = sim->func_inst_cnt;
+		uint64_t n = CKPT_POLL_INSTS;
+
+		if(max_inst && max_inst - done < n)
+			n = max_inst - done;
+		if(ck->inst > insts && ck->inst - insts < n)
+			n = ck->inst - insts;
+
+		if(sim_run_func(sim, n, stop_pc))
+			return sim->halt;
+		done += sim->func_inst_cnt - start;
+		ckpt_poll(sim, ck);
+
+		// stopped at stop_pc, or at max_inst
+		if(sim->func_inst_cnt - start < n || (max_inst && done >= max_inst))
+			return HALT_NONE;
+	}
+}
+
+// sim_run_until() in slices, at most one instruction retires per cycle so
+// a slice never runs past the instruction trigger
+static enum HALT run_pipe(struct sim_t *sim, uint32_t max_cycles, struct ckpt_req_t *ck) {
+	if(ck->path == NULL)
+		return sim_run_until(sim, max_cycles);
+
+	while(!sim->halt && sim->cc < max_cycles){
+		uint64_t insts = sim->func_inst_cnt + sim->inst_cnt;
+		uint32_t until = max_cycles - sim->cc > CKPT_POLL_CYCLES ? sim->cc + CKPT_POLL_CYCLES : max_cycles;
+
+		if(ck->cycle > sim->cc && ck->cycle < until)
+			until = ck->cycle;
+		if(ck->inst > insts && ck->inst - insts < until - sim->cc)
+			until = sim->cc + (uint32_t)(ck->inst - insts);
+
+		sim_run_until(sim, until);
+		ckpt_poll(sim, ck);
+	}
+
+	return sim_run_until(sim, max_cycles);
+}
+
+int main (int argc, char *argv[]) {
+
+	// get input arguments
+	struct sim_config_t cfg;
+	char *batch_path = NULL;
+	char *sweep_path = NULL;
+	char *bench_path = NULL;
+	char *out_path = NULL;
+	uint32_t jobs = 0;
+	uint8_t show_bpred = 0;
+	char *stats_path = NULL;
+	char *prof_path = NULL;
+	uint32_t prof_top = PROF_TOP_DEFAULT;
+	struct ckpt_req_t ckpt = { NULL, 0, 0 };
+	char *restore_path = NULL;
+	struct sample_config_t sample_cfg;
+	uint8_t sample = 0;
+	uint32_t n_harts = 1;
+	uint32_t quantum = HART_QUANTUM_DEFAULT;
+
+	sim_config_default(&cfg);
+	sample_config_default(&sample_cfg);
+	cfg.trace_level = TRACE_FULL;
+
+	static struct option long_opts[] = {
+		{"max-cycles", required_argument, 0, 'c'},
+		{"tohost", required_argument, 0, 't'},
+		{"trace", required_argument, 0, 'l'},
+		{"trace-bin", required_argument, 0, 'b'},
+		{"mode", required_argument, 0, 'm'},
+		{"max-insts", required_argument, 0, 'n'},
+		{"ff", required_argument, 0, 'f'},
+		{"ff-pc", required_argument, 0, 'p'},
+		{"batch", required_argument, 0, 'B'},
+		{"jobs", required_argument, 0, 'j'},
+		{"out", required_argument, 0, 'o'},
+		{"echo-load", no_argument, 0, 'e'},
+		{"mem-size", required_argument, 0, 's'},
+		{"mem-base", required_argument, 0, 'a'},
+		{"icache", required_argument, 0, 'I'},
+		{"dcache", required_argument, 0, 'D'},
+		{"bpred", required_argument, 0, 'P'},
+		{"forward", required_argument, 0, 'F'},
+		{"stats", required_argument, 0, 'S'},
+		{"profile", required_argument, 0, 'R'},
+		{"profile-top", required_argument, 0, 'T'},
+		{"ckpt", required_argument, 0, 'K'},
+		{"ckpt-cycle", required_argument, 0, 'C'},
+		{"ckpt-inst", required_argument, 0, 'N'},
+		{"restore", required_argument, 0, 'r'},
+		{"sample", required_argument, 0, 'M'},
+		{"jit", no_argument, 0, 'J'},
+		{"harts", required_argument, 0, 'H'},
+		{"quantum", required_argument, 0, 'Q'},
+		{"config", required_argument, 0, 'G'},
+		{"sweep", required_argument, 0, 'W'},
+		{"bench", required_argument, 0, 'E'},
+		{"ooo", required_argument, 0, 'O'},
+		{"wide", required_argument, 0, 'X'},
+		{"muldiv", required_argument, 0, 'Y'},
+		{0, 0, 0, 0}
+	};
+	int opt;
+	while ((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1) {
+		switch (opt) {
+			case 'c':
+				cfg.max_cycles = strtoul(optarg, NULL, 0);
+				break;
+			case 't':
+				cfg.tohost = strtoul(optarg, NULL, 0);
+				break;
+			case 'l':
+				if(!strcmp(optarg, "none"))
+					cfg.trace_level = TRACE_NONE;
+				else if(!strcmp(optarg, "summary"))
+					cfg.trace_level = TRACE_SUMMARY;
+				else if(!strcmp(optarg, "full"))
+					cfg.trace_level = TRACE_FULL;
+				else {
+					printf("Unknown trace level %s\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'b':
+				cfg.trace_path = optarg;
+				break;
+			case 'm':
+				if(!strcmp(optarg, "pipe"))
+					cfg.mode = MODE_PIPE;
+				else if(!strcmp(optarg, "func"))
+					cfg.mode = MODE_FUNC;
+				else if(!strcmp(optarg, "ooo"))
+					cfg.mode = MODE_OOO;
+				else if(!strcmp(optarg, "wide"))
+					cfg.mode = MODE_WIDE;
+				else {
+					printf("Unknown mode %s\n", optarg);
+					exit(1);
+				}
+				break;
+			case 'n':
+				cfg.max_insts = strtoull(optarg, NULL, 0);
+				break;
+			case 'f':
+				cfg.ff_insts = strtoull(optarg, NULL, 0);
+				break;
+			case 'p':
+				cfg.ff_pc = strtoul(optarg, NULL, 0);
+				break;
+			case 'B':
+				batch_path = optarg;
+				break;
+			case 'j':
+				jobs = strtoul(optarg, NULL, 0);
+				break;
+			case 'o':
+				out_path = optarg;
+				break;
+			case 'e':
+				cfg.echo_load = 1;
+				break;
+			case 's':
+				cfg.mem_size = parse_size(optarg);
+				break;
+			case 'a':
+				cfg.mem_base = strtoul(optarg, NULL, 0);
+				break;
+			case 'I':
+				if(cache_config_parse(&cfg.icache, optarg))
+					exit(1);
+				break;
+			case 'D':
+				if(cache_config_parse(&cfg.dcache, optarg))
+					exit(1);
+				break;
+			case 'P':
+				if(bpred_config_parse(&cfg.bpred, optarg))
+					exit(1);
+				show_bpred = 1;
+				break;
+			case 'F':
+				if(fwd_parse(&cfg.forward, optarg))
+					exit(1);
+				break;
+			case 'S':
+				stats_path = optarg;
+				break;
+			case 'R':
+				prof_path = optarg;
+				cfg.profile = 1;
+				break;
+			case 'T':
+				prof_top = strtoul(optarg, NULL, 0);
+				break;
+			case 'K':
+				ckpt.path = optarg;
+				break;
+			case 'C':
+				ckpt.cycle = strtoul(optarg, NULL, 0);
+				break;
+			case 'N':
+				ckpt.inst = strtoull(optarg, NULL, 0);
+				break;
+			case 'r':
+				restore_path = optarg;
+				break;
+			case 'M':
+				if(sample_config_parse(&sample_cfg, optarg))
+					exit(1);
+				sample = 1;
+				break;
+			case 'J':
+				cfg.jit = 1;
+				break;
+			case 'H':
+				n_harts = strtoul(optarg, NULL, 0);
+				if(n_harts == 0 || n_harts > HART_MAX){
+					printf("--harts must be 1 to %d\n", HART_MAX);
+					exit(1);
+				}
+				break;
+			case 'G':
+				if(config_load(&cfg, optarg))
+					exit(1);
+				break;
+			case 'W':
+				sweep_path = optarg;
+				break;
+			case 'E':
+				bench_path = optarg;
+				break;
+			case 'O':
+				if(ooo_config_parse(&cfg.ooo, optarg))
+					exit(1);
+				cfg.mode = MODE_OOO;
+				break;
+			case 'X':
+				if(wide_config_parse(&cfg.wide, optarg))
+					exit(1);
+				cfg.mode = MODE_WIDE;
+				break;
+			case 'Y':
+				if(muldiv_config_parse(&cfg.muldiv, optarg))
+					exit(1);
+				break;
+			case 'Q':
+				if((quantum = strtoul(optarg, NULL, 0)) == 0){
+					printf("--quantum must be at least one cycle\n");
+					exit(1);
+				}
+				break;
+			default:
+				exit(1);
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
+
+	if(batch_path)
+		return batch_run(&cfg, batch_path, jobs, out_path) ? 1 : 0;
+
+	if(bench_path)
+		return bench_run(&cfg, bench_path) ? 1 : 0;
+
+	if(sweep_path && argc >= 2)
+		return sweep_run(&cfg, sweep_path, argv[1], argc > 2 ? argv[2] : NULL, jobs, out_path) ? 1 : 0;
+
+	if (argc < 2 && restore_path == NULL) {
+		printf("usage: %s [--max-cycles N] [--tohost ADDR] [--trace none|summary|full]"
+				" [--trace-bin FILE] [--mode pipe|func|ooo|wide] [--max-insts N] [--ff N] [--ff-pc ADDR]"
+				" [--echo-load] [--mem-size N[K|M|G]] [--mem-base ADDR]"
+				" [--icache CONFIG] [--dcache CONFIG] [--bpred CONFIG] [--forward none|base|full]"
+				" [--stats FILE.csv|FILE.json]"
+				" [--profile FILE|-] [--profile-top N] [--ckpt FILE [--ckpt-cycle N] [--ckpt-inst N]]"
+				" [--sample CONFIG] [--jit] [--harts N [--quantum N]] [--config FILE] [--ooo CONFIG] [--wide CONFIG]"
+				" [--muldiv CONFIG]"
+				" imem_data_file|elf_file [dmem_data_file] | --restore FILE\n"
+				"       %s --batch MANIFEST [--jobs N] [--out FILE.csv|FILE.json] [options]\n"
+				"       %s --sweep FILE [--jobs N] [--out FILE.csv|FILE.json] [options] imem_data_file|elf_file [dmem_data_file]\n"
+				"       %s --bench MANIFEST [options]\n",
+				argv[0], argv[0], argv[0], argv[0]);
+		exit(1);
+	}
+
+	struct sim_t *sim;
+	struct sim_stats_t stats;
+	enum HALT halt = HALT_NONE;
+
+	if((cfg.mode == MODE_OOO || cfg.mode == MODE_WIDE) && (n_harts > 1 || sample || ckpt.path || restore_path
+			|| prof_path || cfg.trace_path)){
+		printf("--mode %s has no --harts, --sample, --ckpt, --restore, --profile or --trace-bin\n",
+				cfg.mode == MODE_OOO ? "ooo" : "wide");
+		exit(1);
+	}
+	if(n_harts > 1){
+		if(cfg.mode == MODE_FUNC || cfg.ff_insts || cfg.ff_pc != FUNC_NO_PC || sample || ckpt.path
+				|| restore_path || prof_path || cfg.trace_path){
+			printf("--harts runs the pipeline only: no --mode func, --ff, --sample, --ckpt, --restore,"
+					" --profile or --trace-bin\n");
+			exit(1);
+		}
+		return run_harts(&cfg, n_harts, quantum, argv[1], argc > 2 ? argv[2] : NULL, stats_path, show_bpred);
+	}
+
+	if ( (sim = sim_create(&cfg)) == NULL ) {
+		printf("Cannot allocate the simulator\n");
+		exit(1);
+	}
+	if(restore_path){
+		if ( ckpt_restore(sim, restore_path) ) {
+			sim_destroy(sim);
+			exit(1);
+		}
+		printf("Restored %s : cycle %u, %llu instructions, pc 0x%X\n", restore_path, sim->cc,
+				(unsigned long long)(sim->func_inst_cnt + sim->inst_cnt), sim->pc_next);
+
+		// functional execution needs an empty pipeline
+		if(sim->cc != SIM_CC_START && (cfg.mode == MODE_FUNC || cfg.ff_insts || cfg.ff_pc != FUNC_NO_PC)){
+			printf("%s was taken in the pipeline, it cannot go on in functional mode\n", restore_path);
+			sim_destroy(sim);
+			exit(1);
+		}
+	}
+	else if ( sim_load(sim, argv[1], argc > 2 ? argv[2] : NULL) ) {
+		sim_destroy(sim);
+		exit(1);
+	}
+	if(ckpt.path)
+		signal(SIGUSR1, on_sigusr1);
+
+	static char out_buf[TRACE_BUF_SIZE];
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+	// Sampled run: functional fast-forward, detailed warm-up and
+	// measurement, repeated
+	if(sample){
+		struct sample_result_t res;
+
+		halt = sample_run(sim, &sample_cfg, &res);
+		sim_get_stats(sim, &stats);
+		if(cfg.trace_level == TRACE_FULL)
+			trace_print_state(stdout, sim->reg_data, sim->dmem);
+		sample_print(stdout, &sample_cfg, &res);
+		if(halt)
+			print_halt(halt, &stats, sim);
+		else
+			printf("Halt reason : %u samples taken (pc 0x%X)\n", res.samples, sim->pc_next);
+		sim_destroy(sim);
+		return halt;
+	}
+
+	// Functional execution: the whole run, or the fast-forward
+	// before the detailed pipeline takes over
+	if(cfg.mode == MODE_FUNC || cfg.ff_insts || cfg.ff_pc != FUNC_NO_PC){
+		if(cfg.mode == MODE_FUNC)
+			halt = run_func(sim, cfg.max_insts, FUNC_NO_PC, &ckpt);
+		else
+			halt = run_func(sim, cfg.ff_insts, cfg.ff_pc, &ckpt);
+
+		sim_get_stats(sim, &stats);
+		printf("\nFunctional instruction count : %llu\n", (unsigned long long)stats.func_inst_cnt);
+		printf("Functional MIPS : %.2f\n",
+				stats.func_sec > 0 ? stats.func_inst_cnt / stats.func_sec / 1e6 : 0.0);
+		if(sim->jit)
+			printf("JIT : %llu blocks, %.2f%% of instructions native, %llu flushes\n",
+					(unsigned long long)sim->jit->blocks,
+					stats.func_inst_cnt ? 100.0 * sim->jit->native_insts / stats.func_inst_cnt : 0.0,
+					(unsigned long long)sim->jit->flushes);
+
+		if(cfg.mode == MODE_FUNC || halt){
+			if(!halt)
+				halt = HALT_MAX_INSTS;
+
+			if(cfg.trace_level == TRACE_FULL)
+				trace_print_state(stdout, sim->reg_data, sim->dmem);
+			print_halt(halt, &stats, sim);
+
+			stats.halt = halt;
+			if(stats_path)
+				stats_write(stats_path, &stats);
+			sim_destroy(sim);
+			return halt;
+		}
+		printf("Switching to pipeline at pc 0x%X\n", stats.halt_pc);
+	}
+
+	if(cfg.mode == MODE_OOO || cfg.mode == MODE_WIDE){
+		char name[32];
+
+		halt = sim_run_until(sim, cfg.max_cycles);
+		sim_get_stats(sim, &stats);
+		if(cfg.trace_level == TRACE_FULL)
+			trace_print_state(stdout, sim->reg_data, sim->dmem);
+		printf("Instruction count : %d\n", stats.inst_cnt);
+		printf("Cycle count : %d\n", stats.cycles);
+		if(sim->ooo){
+			ooo_print(stdout, sim);
+			snprintf(name, sizeof(name), "out-of-order");
+		}
+		else{
+			printf("Hazard count : %d\n", stats.hazard_cnt);
+			printf("Branch count : %d\n", stats.branch_cnt);
+			wide_print(stdout, sim);
+			snprintf(name, sizeof(name), "%u-wide", cfg.wide.width);
+		}
+		print_baseline(&cfg, sim, &stats, name);
+		print_muldiv_stats(&stats);
+		print_fetch_stats(&stats);
+		if(cfg.icache.size)
+			print_cache_stats("I-cache", &stats.icache, stats.icache_stall_cnt);
+		if(cfg.dcache.size)
+			print_cache_stats("D-cache", &stats.dcache, stats.dcache_stall_cnt);
+		// the out-of-order front end waits for the branch and then
+		// refills decode and rename, a wide group loses width slots a cycle
+		if(show_bpred)
+			print_bpred_stats(&cfg, &stats.bpred, sim->ooo
+					? sim->ooo->stats.redirect_cycles + sim->ooo->stats.mispredicts * OOO_FRONT_CYCLES
+					: stats.cpi[CPI_BRANCH] / cfg.wide.width);
+		print_halt(halt, &stats, sim);
+
+		if(stats_path)
+			stats_write(stats_path, &stats);
+		sim_destroy(sim);
+		return halt;
+	}
+
+	halt = run_pipe(sim, cfg.max_cycles, &ckpt);
+	sim_get_stats(sim, &stats);
+
+	// Result
+	printf("Hazard count : %d\n", stats.hazard_cnt);
+	printf("Branch count : %d\n", stats.branch_cnt);
+	printf("Instruction count : %d\n", stats.inst_cnt);
+	printf("Cycle count : %d\n", stats.cycles);
+	stats_print(stdout, &stats);
+	print_muldiv_stats(&stats);
+	print_fetch_stats(&stats);
+	if(cfg.icache.size)
+		print_cache_stats("I-cache", &stats.icache, stats.icache_stall_cnt);
+	if(cfg.dcache.size)
+		print_cache_stats("D-cache", &stats.dcache, stats.dcache_stall_cnt);
+	if(show_bpred)
+		print_bpred_stats(&cfg, &stats.bpred, stats.cpi[CPI_BRANCH]);
+	print_halt(halt, &stats, sim);
+
+	if(stats_path)
+		stats_write(stats_path, &stats);
+	if(prof_path)
+		write_profile(sim, prof_path, prof_top);
+	sim_destroy(sim);
+
+	return halt;
+}
@@ -0,0 +1,364 @@
+/* **************************************
+ * Module: sparse paged data memory
+ *
+ * **************************************
+ */
+#include <sys/mman.h>
+#include "rv32i_mem.h"
+
+// Backs reads of pages that were never written
+static const uint8_t mem_zero_page[MEM_PAGE_SIZE];
+
+// Bytes stored to one word by a view
+struct mem_log_ent_t {
+	uint32_t addr;	// word aligned
+	uint32_t data;
+	uint32_t mask;	// bytes of data written, 0: free slot
+};
+
+// Open addressing table of the written words, and their
+// order of first write for the commit
+struct mem_log_t {
+	struct mem_log_ent_t *ent;
+	uint32_t *order;
+	uint32_t size;	// power of 2
+	uint32_t cnt;
+};
+
+#define MEM_LOG_SIZE 4096	// initial slots, doubled when half full
+
+struct mem_t *mem_create(uint32_t base, uint64_t size) {
+	struct mem_t *mem;
+
+	mem = (struct mem_t*)calloc(1, sizeof(struct mem_t));
+	if(mem == NULL)
+		return NULL;
+
+	mem->base = base;
+	mem->size = size > MEM_SIZE_MAX ? MEM_SIZE_MAX : size;
+	mem->last_vpn = MEM_NO_VPN;
+
+	return mem;
+}
+
+void mem_clear(struct mem_t *mem) {
+	// the pages of a view belong to its shared memory
+	if(mem->shared){
+		memset(mem->dir, 0, sizeof(mem->dir));
+		mem->last_vpn = MEM_NO_VPN;
+		mem->last_page = NULL;
+		mem->page_cnt = 0;
+		return;
+	}
+
+	for(int i = 0; i < MEM_L1_SIZE; i++){
+		if(mem->dir[i] == NULL)
+			continue;
+		for(int j = 0; j < MEM_L2_SIZE; j++){
+			uint8_t *page = mem->dir[i][j];
+			if(page && !(page >= mem->map && page < mem->map + mem->map_len))
+				free(page);
+		}
+		free(mem->dir[i]);
+		mem->dir[i] = NULL;
+	}
+
+	mem->last_vpn = MEM_NO_VPN;
+	mem->last_page = NULL;
+	mem->page_cnt = 0;
+
+	if(mem->map){
+		munmap(mem->map, mem->map_len);
+		mem->map = NULL;
+		mem->map_len = 0;
+	}
+}
+
+void mem_destroy(struct mem_t *mem) {
+	if(mem == NULL)
+		return;
+	mem_clear(mem);
+	if(mem->log){
+		free(mem->log->ent);
+		free(mem->log->order);
+		free(mem->log);
+	}
+	free(mem);
+}
+
+// Page of addr, allocated when alloc is set. Without alloc a missing
+// page reads as the shared zero page, which must not be written.
+uint8_t *mem_page_walk(struct mem_t *mem, uint32_t addr, uint8_t alloc) {
+	uint32_t vpn = addr >> MEM_PAGE_BITS;
+	uint8_t ***l2 = &mem->dir[vpn >> MEM_L2_BITS];
+	uint8_t **page;
+
+	if(*l2 == NULL){
+		if(!alloc)
+			return (uint8_t*)mem_zero_page;
+		if ( (*l2 = (uint8_t**)calloc(MEM_L2_SIZE, sizeof(uint8_t*))) == NULL ) {
+			printf("Out of host memory!!\n");
+			exit(1);
+		}
+	}
+
+	page = &(*l2)[vpn & (MEM_L2_SIZE-1)];
+	if(*page == NULL){
+		if(!alloc)
+			return (uint8_t*)mem_zero_page;
+		if ( (*page = (uint8_t*)aligned_alloc(MEM_PAGE_SIZE, MEM_PAGE_SIZE)) == NULL ) {
+			printf("Out of host memory!!\n");
+			exit(1);
+		}
+		memset(*page, 0, MEM_PAGE_SIZE);
+		mem->page_cnt++;
+	}
+
+	mem->last_vpn = vpn;
+	mem->last_page = *page;
+
+	return *page;
+}
+
+// First allocated page at or above *addr, NULL when there is none
+uint8_t *mem_next_page(const struct mem_t *mem, uint32_t *addr) {
+	uint64_t vpn;
+
+	for(vpn = *addr >> MEM_PAGE_BITS; vpn < (1ULL << (32 - MEM_PAGE_BITS)); vpn++){
+		uint8_t **l2 = mem->dir[vpn >> MEM_L2_BITS];
+		if(l2 == NULL){
+			vpn |= MEM_L2_SIZE-1;
+			continue;
+		}
+		if(l2[vpn & (MEM_L2_SIZE-1)]){
+			*addr = (uint32_t)(vpn << MEM_PAGE_BITS);
+			return l2[vpn & (MEM_L2_SIZE-1)];
+		}
+	}
+
+	return NULL;
+}
+
+// Another page than the last one: one walk, unless the access straddles two pages
+uint32_t mem_read_slow(struct mem_t *mem, uint32_t addr, uint8_t bytes) {
+	uint32_t off = addr & MEM_PAGE_MASK;
+	uint32_t val = 0;
+
+	if(off + bytes <= MEM_PAGE_SIZE){
+		memcpy(&val, mem_page_walk(mem, addr, 0) + off, bytes);	// host is little-endian
+		return val;
+	}
+	for(int i = 0; i < bytes; i++){
+		uint8_t *page = mem_page_walk(mem, addr + i, 0);
+		val |= (uint32_t)page[(addr + i) & MEM_PAGE_MASK] << i*BYTE_BIT;
+	}
+
+	return val;
+}
+
+void mem_write_slow(struct mem_t *mem, uint32_t addr, uint32_t val, uint8_t bytes) {
+	uint32_t off = addr & MEM_PAGE_MASK;
+
+	if(off + bytes <= MEM_PAGE_SIZE){
+		memcpy(mem_page_walk(mem, addr, 1) + off, &val, bytes);
+		return;
+	}
+	for(int i = 0; i < bytes; i++){
+		uint8_t *page = mem_page_walk(mem, addr + i, 1);
+		page[(addr + i) & MEM_PAGE_MASK] = (uint8_t)(val >> i*BYTE_BIT);
+	}
+}
+
+int mem_load(struct mem_t *mem, uint32_t addr, const uint8_t *buf, uint32_t len) {
+	if(len && ((uint64_t)(uint32_t)(addr - mem->base) + len > mem->size))
+		return -1;
+
+	while(len){
+		uint32_t off = addr & MEM_PAGE_MASK;
+		uint32_t n = MEM_PAGE_SIZE - off;
+		if(n > len)
+			n = len;
+
+		memcpy(mem_page_walk(mem, addr, 1) + off, buf, n);
+		addr += n;
+		buf += n;
+		len -= n;
+	}
+
+	return 0;
+}
+
+// dst gets the content of src, its own range is kept
+int mem_copy(struct mem_t *dst, const struct mem_t *src) {
+	uint32_t addr = 0;
+	uint8_t *page;
+
+	mem_clear(dst);
+	while((page = mem_next_page(src, &addr)) != NULL){
+		// a page partly in range is kept whole, the rest is never reached
+		if((uint64_t)addr >= dst->base + dst->size || (uint64_t)addr + MEM_PAGE_SIZE <= dst->base)
+			return -1;
+		memcpy(mem_page_walk(dst, addr, 1), page, MEM_PAGE_SIZE);
+		if(addr == (uint32_t)-MEM_PAGE_SIZE)
+			break;
+		addr += MEM_PAGE_SIZE;
+	}
+
+	return 0;
+}
+
+// The memory takes over a private mapping, its pages are added with
+// mem_adopt_page() and it is unmapped by mem_clear()
+int mem_adopt_map(struct mem_t *mem, uint8_t *map, size_t map_len) {
+	if(mem->map)
+		return -1;
+	mem->map = map;
+	mem->map_len = map_len;
+	return 0;
+}
+
+// Use page, inside the adopted mapping, as the page of addr
+int mem_adopt_page(struct mem_t *mem, uint32_t addr, uint8_t *page) {
+	uint32_t vpn = addr >> MEM_PAGE_BITS;
+	uint8_t ***l2 = &mem->dir[vpn >> MEM_L2_BITS];
+	uint8_t **slot;
+
+	if(page < mem->map || page + MEM_PAGE_SIZE > mem->map + mem->map_len)
+		return -1;
+	if(*l2 == NULL && (*l2 = (uint8_t**)calloc(MEM_L2_SIZE, sizeof(uint8_t*))) == NULL)
+		return -1;
+
+	slot = &(*l2)[vpn & (MEM_L2_SIZE-1)];
+	if(*slot){
+		if(!(*slot >= mem->map && *slot < mem->map + mem->map_len))
+			free(*slot);
+	}
+	else
+		mem->page_cnt++;
+	*slot = page;
+
+	mem->last_vpn = MEM_NO_VPN;
+	mem->last_page = NULL;
+
+	return 0;
+}
+
+// View of shared with an empty store log
+struct mem_t *mem_view_create(struct mem_t *shared) {
+	struct mem_t *view;
+	struct mem_log_t *log;
+
+	if((view = mem_create(shared->base, shared->size)) == NULL)
+		return NULL;
+	view->shared = shared;
+	if((log = view->log = (struct mem_log_t*)calloc(1, sizeof(struct mem_log_t))) == NULL
+			|| (log->ent = (struct mem_log_ent_t*)calloc(MEM_LOG_SIZE, sizeof(struct mem_log_ent_t))) == NULL
+			|| (log->order = (uint32_t*)malloc(MEM_LOG_SIZE/2 * sizeof(uint32_t))) == NULL){
+		mem_destroy(view);
+		return NULL;
+	}
+	log->size = MEM_LOG_SIZE;
+	mem_view_sync(view);
+
+	return view;
+}
+
+// Pick up the pages shared got since the last sync
+void mem_view_sync(struct mem_t *view) {
+	struct mem_t *shared = view->shared;
+
+	if(view->page_cnt == shared->page_cnt)
+		return;
+	memcpy(view->dir, shared->dir, sizeof(view->dir));
+	view->page_cnt = shared->page_cnt;
+}
+
+static struct mem_log_ent_t *mem_log_find(struct mem_log_t *log, uint32_t addr) {
+	uint32_t i = (addr >> 2) * 2654435761U;
+
+	for(i &= log->size - 1; log->ent[i].mask && log->ent[i].addr != addr; i = (i + 1) & (log->size - 1))
+		;
+	return &log->ent[i];
+}
+
+// Double the table, the order of first write is kept
+static void mem_log_grow(struct mem_log_t *log) {
+	struct mem_log_t old = *log;
+
+	log->size *= 2;
+	log->ent = (struct mem_log_ent_t*)calloc(log->size, sizeof(struct mem_log_ent_t));
+	log->order = (uint32_t*)malloc(log->size/2 * sizeof(uint32_t));
+	if(log->ent == NULL || log->order == NULL){
+		printf("Out of host memory!!\n");
+		exit(1);
+	}
+
+	for(uint32_t k = 0; k < old.cnt; k++){
+		struct mem_log_ent_t *e = mem_log_find(log, old.ent[old.order[k]].addr);
+		*e = old.ent[old.order[k]];
+		log->order[k] = e - log->ent;
+	}
+	free(old.ent);
+	free(old.order);
+}
+
+// Pages of the shared memory, then the bytes the view stored itself
+uint32_t mem_log_read(struct mem_t *view, uint32_t addr, uint8_t bytes) {
+	struct mem_log_t *log = view->log;
+	uint32_t val = mem_read_pages(view, addr, bytes);
+
+	if(log->cnt == 0)
+		return val;
+
+	for(int i = 0; i < bytes; i++){
+		uint32_t a = addr + i;
+		struct mem_log_ent_t *e = mem_log_find(log, a & ~3U);
+
+		if(e->mask & (1 << (a & 3))){
+			val &= ~(0xFFU << i*BYTE_BIT);
+			val |= ((e->data >> (a & 3)*BYTE_BIT) & 0xFF) << i*BYTE_BIT;
+		}
+	}
+
+	return val;
+}
+
+void mem_log_write(struct mem_t *view, uint32_t addr, uint32_t val, uint8_t bytes) {
+	struct mem_log_t *log = view->log;
+
+	for(int i = 0; i < bytes; i++){
+		uint32_t a = addr + i;
+		struct mem_log_ent_t *e = mem_log_find(log, a & ~3U);
+
+		if(e->mask == 0){
+			if(log->cnt == log->size/2){
+				mem_log_grow(log);
+				e = mem_log_find(log, a & ~3U);
+			}
+			e->addr = a & ~3U;
+			e->data = 0;
+			log->order[log->cnt++] = e - log->ent;
+		}
+		e->mask |= 1 << (a & 3);
+		e->data &= ~(0xFFU << (a & 3)*BYTE_BIT);
+		e->data |= ((val >> i*BYTE_BIT) & 0xFF) << (a & 3)*BYTE_BIT;
+	}
+}
+
+// Apply the stores of the view to the shared memory and empty the log
+void mem_log_commit(struct mem_t *view) {
+	struct mem_log_t *log = view->log;
+
+	for(uint32_t k = 0; k < log->cnt; k++){
+		struct mem_log_ent_t *e = &log->ent[log->order[k]];
+
+		if(e->mask == 0xF)
+			mem_write(view->shared, e->addr, e->data, 4);
+		else
+			for(int b = 0; b < 4; b++)
+				if(e->mask & (1 << b))
+					mem_write(view->shared, e->addr + b, e->data >> b*BYTE_BIT, 1);
+		e->mask = 0;
+	}
+	log->cnt = 0;
+}
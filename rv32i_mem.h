@@ -0,0 +1,127 @@
+/* **************************************
+ * Module: sparse paged data memory
+ *
+ * The 32-bit guest address space is split into 4 KiB
+ * pages found through a two-level radix table. Pages are
+ * allocated on the first write, reads of a missing page
+ * return zero. The page used last is cached so that
+ * consecutive accesses skip the table walk.
+ *
+ * Only [base, base+size) is valid, an access outside of
+ * it is a guest fault and leaves the memory untouched.
+ *
+ * Pages can also point into a private file mapping (a
+ * checkpoint), those are copied on write by the kernel and
+ * unmapped instead of freed.
+ *
+ * A view (mem_view_create()) reads the pages of a shared
+ * memory and keeps its own stores in a log, visible to
+ * itself only until mem_log_commit() applies them. Harts
+ * run on views so that a quantum only reads memory.
+ *
+ * **************************************
+ */
+#ifndef RV32I_MEM_H
+#define RV32I_MEM_H
+
+#include "rv32i.h"
+
+#define MEM_PAGE_BITS 12
+#define MEM_PAGE_SIZE (1 << MEM_PAGE_BITS)
+#define MEM_PAGE_MASK (MEM_PAGE_SIZE - 1)
+#define MEM_L2_BITS 10
+#define MEM_L2_SIZE (1 << MEM_L2_BITS)
+#define MEM_L1_SIZE (1 << (32 - MEM_PAGE_BITS - MEM_L2_BITS))
+#define MEM_NO_VPN 0xFFFFFFFF
+
+#define MEM_SIZE_DEFAULT (64ULL << 20)
+#define MEM_SIZE_MAX (1ULL << 32)
+#define MEM_BASE_AUTO 0xFFFFFFFF	// 0, or the lowest ELF segment
+
+struct mem_log_t;
+
+struct mem_t {
+	uint8_t **dir[MEM_L1_SIZE];	// L1 -> table of MEM_L2_SIZE pages
+
+	uint32_t base;
+	uint64_t size;
+
+	// fast path
+	uint32_t last_vpn;
+	uint8_t *last_page;
+
+	uint32_t page_cnt;
+
+	// mapping the adopted pages live in
+	uint8_t *map;
+	size_t map_len;
+
+	// view: dir is a copy of the one of shared, never written
+	struct mem_t *shared;
+	struct mem_log_t *log;
+};
+
+struct mem_t *mem_create(uint32_t base, uint64_t size);
+void mem_destroy(struct mem_t *mem);
+void mem_clear(struct mem_t *mem);
+int mem_copy(struct mem_t *dst, const struct mem_t *src);
+
+uint8_t *mem_page_walk(struct mem_t *mem, uint32_t addr, uint8_t alloc);
+uint8_t *mem_next_page(const struct mem_t *mem, uint32_t *addr);
+
+uint32_t mem_read_slow(struct mem_t *mem, uint32_t addr, uint8_t bytes);
+void mem_write_slow(struct mem_t *mem, uint32_t addr, uint32_t val, uint8_t bytes);
+int mem_load(struct mem_t *mem, uint32_t addr, const uint8_t *buf, uint32_t len);
+int mem_adopt_map(struct mem_t *mem, uint8_t *map, size_t map_len);
+int mem_adopt_page(struct mem_t *mem, uint32_t addr, uint8_t *page);
+
+struct mem_t *mem_view_create(struct mem_t *shared);
+void mem_view_sync(struct mem_t *view);
+uint32_t mem_log_read(struct mem_t *view, uint32_t addr, uint8_t bytes);
+void mem_log_write(struct mem_t *view, uint32_t addr, uint32_t val, uint8_t bytes);
+void mem_log_commit(struct mem_t *view);
+
+// 1 when [addr, addr+bytes) is not all inside the memory
+static inline uint8_t mem_fault(const struct mem_t *mem, uint32_t addr, uint8_t bytes) {
+	return (uint64_t)(uint32_t)(addr - mem->base) + bytes > mem->size;
+}
+
+// Little-endian read of 1, 2 or 4 bytes of the pages, no range check
+static inline uint32_t mem_read_pages(struct mem_t *mem, uint32_t addr, uint8_t bytes) {
+	uint32_t off = addr & MEM_PAGE_MASK;
+	uint32_t val = 0;
+
+	if((addr >> MEM_PAGE_BITS) != mem->last_vpn || off + bytes > MEM_PAGE_SIZE)
+		return mem_read_slow(mem, addr, bytes);
+
+	memcpy(&val, mem->last_page + off, bytes);	// host is little-endian
+	return val;
+}
+
+// Little-endian access of 1, 2 or 4 bytes, no range check
+static inline uint32_t mem_read(struct mem_t *mem, uint32_t addr, uint8_t bytes) {
+	if(mem->log)
+		return mem_log_read(mem, addr, bytes);
+	return mem_read_pages(mem, addr, bytes);
+}
+
+static inline void mem_write(struct mem_t *mem, uint32_t addr, uint32_t val, uint8_t bytes) {
+	uint32_t off = addr & MEM_PAGE_MASK;
+
+	if(mem->log){
+		mem_log_write(mem, addr, val, bytes);
+		return;
+	}
+	if((addr >> MEM_PAGE_BITS) != mem->last_vpn || off + bytes > MEM_PAGE_SIZE){
+		mem_write_slow(mem, addr, val, bytes);
+		return;
+	}
+
+	memcpy(mem->last_page + off, &val, bytes);
+}
+
+static inline uint8_t mem_read_byte(struct mem_t *mem, uint32_t addr) {
+	return (uint8_t)mem_read(mem, addr, 1);
+}
+
+#endif
@@ -0,0 +1,67 @@
+/* **************************************
+ * Module: multiply/divide unit timing
+ *
+ * **************************************
+ */
+#include "rv32i_muldiv.h"
+#include "rv32i_config.h"
+
+void muldiv_config_default(struct muldiv_config_t *cfg) {
+	cfg->mul = 3;
+	cfg->div = 34;
+	cfg->early = 1;
+}
+
+static enum CONFIG_OPT muldiv_option(void *obj, const char *key, const char *val) {
+	struct muldiv_config_t *cfg = (struct muldiv_config_t*)obj;
+	uint32_t early;
+
+	if(!strcmp(key, "mul"))
+		return config_u32(val, &cfg->mul);
+	if(!strcmp(key, "div"))
+		return config_u32(val, &cfg->div);
+	if(!strcmp(key, "early")){
+		if(config_u32(val, &early))
+			return CONFIG_BAD_VALUE;
+		cfg->early = early != 0;
+		return CONFIG_OK;
+	}
+	return CONFIG_UNKNOWN;
+}
+
+int muldiv_config_parse(struct muldiv_config_t *cfg, const char *str) {
+	if(config_spec_parse(str, "mul/div", 0, muldiv_option, cfg))
+		return -1;
+	if(cfg->mul == 0 || cfg->div == 0){
+		printf("Mul/div latencies must be at least one cycle\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+// Significant bits of v
+static inline uint32_t muldiv_bits(uint32_t v) {
+	return v ? 32 - __builtin_clz(v) : 0;
+}
+
+uint32_t muldiv_latency(const struct muldiv_config_t *cfg, uint8_t func3, uint32_t in1, uint32_t in2) {
+	uint32_t a = in1, b = in2;
+	uint32_t q, skip;
+
+	if(!muldiv_is_div(func3))
+		return cfg->mul;
+	if(!cfg->early)
+		return cfg->div;
+
+	// magnitudes of signed operands
+	if(func3 == F3_DIV || func3 == F3_REM){
+		a = (int32_t)in1 < 0 ? -in1 : in1;
+		b = (int32_t)in2 < 0 ? -in2 : in2;
+	}
+	// quotient bits left to compute, none for a zero divisor
+	q = (b && muldiv_bits(a) >= muldiv_bits(b)) ? muldiv_bits(a) - muldiv_bits(b) + 1 : 0;
+	skip = (32 - q) * cfg->div / 32;
+
+	return skip < cfg->div ? cfg->div - skip : 1;
+}
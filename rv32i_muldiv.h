@@ -0,0 +1,41 @@
+/* **************************************
+ * Module: multiply/divide unit timing
+ *
+ * The M extension runs on its own unit next to the ALU
+ * (muldiv() in rv32i_units.h). Only its latency is
+ * configured here:
+ *   mul    cycles of the multiplier. It is pipelined, a
+ *          multiply can start every cycle and only its
+ *          consumers wait for the result
+ *   div    cycles of the iterative divider for a full 32-bit
+ *          quotient. A division holds EX, and everything
+ *          behind it, until it is done
+ *   early  the divider skips the leading zero bits of the
+ *          quotient, so small operands finish early
+ *
+ *   muldiv_config_parse(&cfg.muldiv, "mul=3,div=34,early=1");
+ *
+ * **************************************
+ */
+#ifndef RV32I_MULDIV_H
+#define RV32I_MULDIV_H
+
+#include "rv32i.h"
+
+struct muldiv_config_t {
+	uint32_t mul;	// cycles
+	uint32_t div;	// cycles of a 32-bit quotient
+	uint8_t early;	// early-out of the divider
+};
+
+void muldiv_config_default(struct muldiv_config_t *cfg);
+int muldiv_config_parse(struct muldiv_config_t *cfg, const char *str);
+
+// Cycles of the operation func3 on these operands
+uint32_t muldiv_latency(const struct muldiv_config_t *cfg, uint8_t func3, uint32_t in1, uint32_t in2);
+
+static inline uint8_t muldiv_is_div(uint8_t func3) {
+	return (func3 & 0x4) != 0;
+}
+
+#endif
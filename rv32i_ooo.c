@@ -0,0 +1,672 @@
+/* **************************************
+ * Module: out-of-order back end
+ *
+ * **************************************
+ */
+#include "rv32i_ooo.h"
+#include "rv32i_sim.h"
+#include "rv32i_config.h"
+
+#define ROB(o, seq) (&(o)->rob[(seq) & (o)->rob_mask])
+
+// Mask of the smallest power of two ring holding n entries
+static uint32_t ooo_ring_mask(uint32_t n) {
+	uint32_t size = 1;
+
+	while(size < n)
+		size <<= 1;
+	return size - 1;
+}
+
+void ooo_config_default(struct ooo_config_t *cfg) {
+	cfg->width = 4;
+	cfg->issue = 4;
+	cfg->rob = 64;
+	cfg->rs = 32;
+	cfg->lsq = 16;
+	cfg->units[OOO_FU_ALU] = 2;
+	cfg->units[OOO_FU_BR] = 1;
+	cfg->units[OOO_FU_MEM] = 1;
+}
+
+static enum CONFIG_OPT ooo_option(void *obj, const char *key, const char *val) {
+	struct ooo_config_t *cfg = (struct ooo_config_t*)obj;
+
+	if(!strcmp(key, "width"))
+		return config_u32(val, &cfg->width);
+	if(!strcmp(key, "issue"))
+		return config_u32(val, &cfg->issue);
+	if(!strcmp(key, "rob"))
+		return config_u32(val, &cfg->rob);
+	if(!strcmp(key, "rs"))
+		return config_u32(val, &cfg->rs);
+	if(!strcmp(key, "lsq"))
+		return config_u32(val, &cfg->lsq);
+	if(!strcmp(key, "alu"))
+		return config_u32(val, &cfg->units[OOO_FU_ALU]);
+	if(!strcmp(key, "br"))
+		return config_u32(val, &cfg->units[OOO_FU_BR]);
+	if(!strcmp(key, "mem"))
+		return config_u32(val, &cfg->units[OOO_FU_MEM]);
+	return CONFIG_UNKNOWN;
+}
+
+int ooo_config_parse(struct ooo_config_t *cfg, const char *str) {
+	return config_spec_parse(str, "out-of-order", 0, ooo_option, cfg);
+}
+
+struct ooo_t *ooo_create(const struct ooo_config_t *cfg) {
+	struct ooo_t *o;
+
+	if(cfg->width == 0 || cfg->width > OOO_WIDTH_MAX || cfg->issue == 0 || cfg->issue > OOO_WIDTH_MAX){
+		printf("Out-of-order width and issue must be 1 to %d\n", OOO_WIDTH_MAX);
+		return NULL;
+	}
+	if(cfg->rob == 0 || cfg->rob > OOO_ROB_MAX || cfg->lsq == 0 || cfg->lsq > OOO_ROB_MAX || cfg->rs == 0){
+		printf("Out-of-order ROB and LSQ must have 1 to %d entries, RS at least one\n", OOO_ROB_MAX);
+		return NULL;
+	}
+	for(int i = 0; i < OOO_FU_NUM; i++){
+		if(cfg->units[i] == 0){
+			printf("Out-of-order cores need at least one unit of each class\n");
+			return NULL;
+		}
+	}
+
+	o = (struct ooo_t*)calloc(1, sizeof(struct ooo_t));
+	if(o == NULL)
+		return NULL;
+	o->cfg = *cfg;
+	// enough to keep rename busy behind the decode latency
+	o->fq_size = cfg->width * (OOO_FRONT_CYCLES + 1);
+	o->fq_mask = ooo_ring_mask(o->fq_size);
+	o->rob_mask = ooo_ring_mask(cfg->rob);
+	o->lsq_mask = ooo_ring_mask(cfg->lsq);
+	o->fq = (struct ooo_inst_t*)calloc(o->fq_mask + 1, sizeof(struct ooo_inst_t));
+	o->rob = (struct ooo_inst_t*)calloc(o->rob_mask + 1, sizeof(struct ooo_inst_t));
+	o->lsq = (uint64_t*)calloc(o->lsq_mask + 1, sizeof(uint64_t));
+	if(o->fq == NULL || o->rob == NULL || o->lsq == NULL){
+		ooo_destroy(o);
+		return NULL;
+	}
+
+	ooo_reset(o);
+
+	return o;
+}
+
+void ooo_destroy(struct ooo_t *o) {
+	if(o == NULL)
+		return;
+	free(o->fq);
+	free(o->rob);
+	free(o->lsq);
+	free(o);
+}
+
+void ooo_reset(struct ooo_t *o) {
+	// seq 0 stands for the register file
+	o->head = 1;
+	o->tail = 1;
+	o->fetch = 1;
+	o->wait = 1;
+	o->lsq_head = 0;
+	o->lsq_tail = 0;
+	memset(o->map, 0, sizeof(o->map));
+	o->rs_cnt = 0;
+	o->div_free = 0;
+
+	o->fetch_pc = 0;
+	o->fetch_wait = 0;
+	o->fetch_line = UINT32_MAX;
+	o->fetch_word = UINT32_MAX;
+	o->refill = 0;
+	o->redirect = 0;
+	o->fetch_stop = HALT_NONE;
+	o->started = 0;
+
+	memset(&o->stats, 0, sizeof(o->stats));
+}
+
+static inline struct alu_output_t ooo_alu(uint32_t in1, uint32_t in2, uint8_t alu_control) {
+	struct alu_input_t alu_in = { .in1 = in1, .in2 = in2, .alu_control = alu_control };
+	struct alu_output_t alu_out;
+
+	alu(&alu_in, &alu_out);
+	return alu_out;
+}
+
+// Result of seq is available in cycle now
+static inline uint8_t ooo_done(const struct ooo_t *o, uint64_t seq, uint32_t now) {
+	if(seq < o->head)
+		return 1;
+	return seq < o->tail && ROB(o, seq)->done <= now;
+}
+
+// Architectural execution at fetch, conditions follow the EX stage.
+// Returns 1 for a taken branch or jump.
+static uint8_t ooo_exec(struct sim_t *sim, struct ooo_inst_t *in, const struct uop_t *uop) {
+	uint32_t *reg_data = sim->reg_data;
+	uint32_t rs1 = reg_data[uop->rs1];
+	uint32_t rs2 = reg_data[uop->rs2];
+	uint32_t pc = in->pc;
+	uint32_t result = 0;
+	uint8_t taken = 0;
+	struct alu_output_t alu_out;
+	struct dmem_input_t dmem_in;
+	struct dmem_output_t dmem_out;
+
+	in->fu = OOO_FU_ALU;
+	in->rd = uop->rd;
+	in->next_pc = pc + uop->len;
+
+	switch(uop->op){
+		case OP_LUI:
+			result = uop->imm;
+			break;
+		case OP_AUIPC:
+			result = pc + uop->imm;
+			break;
+		case OP_JAL:
+			result = pc + uop->len;
+			in->next_pc = pc + uop->imm;
+			taken = 1;
+			break;
+		case OP_JALR:
+			result = pc + uop->len;
+			in->next_pc = ooo_alu(rs1, uop->imm, uop->alu_control).result & ~1u;
+			taken = 1;
+			break;
+
+		case OP_BEQ: case OP_BNE: case OP_BLT: case OP_BGE: case OP_BLTU: case OP_BGEU:
+			alu_out = ooo_alu(rs1, rs2, uop->alu_control);
+			switch(uop->op){
+				case OP_BEQ:
+					taken = alu_out.zero;
+					break;
+				case OP_BNE:
+					taken = !alu_out.zero;
+					break;
+				case OP_BLT:
+					taken = !alu_out.zero && alu_out.sign;
+					break;
+				case OP_BGE:
+					taken = alu_out.zero || !alu_out.sign;
+					break;
+				case OP_BLTU:
+					taken = !alu_out.zero && alu_out.ucmp;
+					break;
+				default:
+					taken = alu_out.zero || !alu_out.ucmp;
+					break;
+			}
+			if(taken)
+				in->next_pc = pc + uop->imm;
+			in->rd = 0;
+			break;
+
+		case OP_LB: case OP_LH: case OP_LW: case OP_LBU: case OP_LHU:
+		case OP_SB: case OP_SH: case OP_SW:
+			in->store = uop->opcode == S_TYPE;
+			in->addr = ooo_alu(rs1, uop->imm, uop->alu_control).result;
+			in->bytes = 1 << (uop->func3 & 0x3);
+			dmem_in.addr = in->addr;
+			dmem_in.din = rs2;
+			dmem_in.func3 = uop->func3;
+			dmem_in.mem_read = !in->store;
+			dmem_in.mem_write = in->store;
+			dmem(&dmem_in, &dmem_out, sim->dmem);
+			result = dmem_out.dout;
+			if(dmem_out.fault){
+				in->halt = HALT_FAULT;
+				in->val = in->addr;
+				in->rd = 0;
+			}
+			else if(in->store && in->addr == sim->tohost){
+				in->halt = HALT_TOHOST;
+				in->val = rs2;
+			}
+			if(in->store)
+				in->rd = 0;
+			in->fu = OOO_FU_MEM;
+			break;
+
+		case OP_SLTI:
+			result = ooo_alu(rs1, uop->imm, uop->alu_control).sign ? 1 : 0;
+			break;
+		case OP_SLTIU:
+			result = ooo_alu(rs1, uop->imm, uop->alu_control).ucmp ? 1 : 0;
+			break;
+		case OP_SLT:
+			result = ooo_alu(rs1, rs2, uop->alu_control).sign ? 1 : 0;
+			break;
+		case OP_SLTU:
+			result = ooo_alu(rs1, rs2, uop->alu_control).ucmp ? 1 : 0;
+			break;
+		case OP_ADDI: case OP_XORI: case OP_ORI: case OP_ANDI:
+		case OP_SLLI: case OP_SRLI: case OP_SRAI:
+			result = ooo_alu(rs1, uop->imm, uop->alu_control).result;
+			break;
+		case OP_ADD: case OP_SUB: case OP_XOR: case OP_OR: case OP_AND:
+		case OP_SLL: case OP_SRL: case OP_SRA:
+			result = ooo_alu(rs1, rs2, uop->alu_control).result;
+			break;
+
+		case OP_MUL: case OP_MULH: case OP_MULHSU: case OP_MULHU:
+		case OP_DIV: case OP_DIVU: case OP_REM: case OP_REMU:
+			result = muldiv(rs1, rs2, uop->func3);
+			in->lat = muldiv_latency(&sim->cfg.muldiv, uop->func3, rs1, rs2);
+			in->div = muldiv_is_div(uop->func3);
+			if(in->div)
+				sim->div_cnt++;
+			else
+				sim->mul_cnt++;
+			break;
+
+		// read at fetch: the older instructions still in flight have
+		// not retired; fetch_insts already counts this one
+		case OP_CSR: {
+			uint64_t count[HPM_NUM];
+
+			sim_csr_count(sim, sim->fetch_insts - 1 - sim->inst_cnt, count);
+			result = csr_op(&sim->csr, count, uop->imm, uop->func3, uop->rs1, rs1);
+			break;
+		}
+
+		case OP_ECALL:
+			in->halt = HALT_ECALL;
+			in->rd = 0;
+			break;
+		case OP_EBREAK:
+			in->halt = HALT_EBREAK;
+			in->rd = 0;
+			break;
+		default:
+			in->rd = 0;
+			break;
+	}
+
+	if(uop->opcode == SB_TYPE || uop->opcode == UJ_TYPE || uop->opcode == I_J_TYPE){
+		in->fu = OOO_FU_BR;
+		if(taken && in->next_pc == pc)
+			in->halt = HALT_SELF_LOOP;
+	}
+	if(in->rd)
+		reg_data[in->rd] = result;
+
+	return taken;
+}
+
+// One instruction on the correct path: predicted, executed, and the
+// prediction checked right away. Also the fetch of the wide pipeline.
+// *word is the last imem word in the fetch buffer, only the words
+// after it are read; a taken or mispredicted branch empties it.
+// Returns 1 when the fetch group ends after it.
+uint8_t ooo_fetch_inst(struct sim_t *sim, struct ooo_inst_t *in, uint32_t pc, uint32_t *word) {
+	struct uop_t *uop = &sim->uop_table[(pc - sim->imem_base) / PARCEL_SIZE];
+	uint32_t first = (pc - sim->imem_base) / WORD_SIZE;
+	uint32_t last = (pc - sim->imem_base + uop->len - 1) / WORD_SIZE;
+	uint8_t control = uop->opcode == SB_TYPE || uop->opcode == UJ_TYPE || uop->opcode == I_J_TYPE;
+	struct bpred_output_t pred;
+	uint8_t taken;
+
+	if(control)
+		pred = bpred_predict(sim->bpred, pc, uop);
+
+	sim->fetch_insts++;
+	sim->fetch_rvc += uop->len == PARCEL_SIZE;
+	sim->fetch_words += last - first + (first != *word);
+	*word = last;
+
+	memset(in, 0, sizeof(*in));
+	in->pc = pc;
+	in->opcode = uop->opcode;
+	in->rs[0] = (uop->src_mask & SRC_RS1) ? uop->rs1 : 0;
+	in->rs[1] = (uop->src_mask & SRC_RS2) ? uop->rs2 : 0;
+	in->done = OOO_NOT_DONE;
+	taken = ooo_exec(sim, in, uop);
+
+	if(in->halt)
+		return 1;
+	if(control){
+		struct regfile_input_t regs = { uop->rs1, uop->rs2, uop->rd, 0 };
+		uint32_t target = taken ? in->next_pc : pc + uop->imm;
+
+		sim->taken_cnt += taken;
+		in->mispredict = bpred_update(sim->bpred, pc, &regs, uop->opcode, taken, target, &pred);
+		if(in->mispredict || taken)
+			*word = UINT32_MAX;
+		return in->mispredict || taken;
+	}
+	return 0;
+}
+
+// Fetch along the correct path, width per cycle, up to a taken branch
+static void ooo_fetch(struct sim_t *sim, struct ooo_t *o) {
+	uint32_t now = sim->cc;
+
+	if(o->fetch_stop)
+		return;
+	if(o->redirect){
+		if(!ooo_done(o, o->redirect, now)){
+			o->stats.redirect_cycles++;
+			return;
+		}
+		o->redirect = 0;
+		o->refill = now + OOO_FRONT_CYCLES + 1;
+	}
+	if(now < o->fetch_wait)
+		return;
+
+	for(uint32_t n = 0; n < o->cfg.width && o->fetch - o->tail < o->fq_size; n++){
+		uint32_t pc = o->fetch_pc;
+		struct ooo_inst_t *in = &o->fq[o->fetch & o->fq_mask];
+		uint8_t end;
+
+		if((pc - sim->imem_base) / 4 >= sim->imem_size){
+			o->fetch_stop = HALT_PC_OUT;
+			break;
+		}
+
+		// one I-cache line per cycle
+		if(sim->icache && (pc >> sim->icache->line_bits) != o->fetch_line){
+			uint32_t lat;
+
+			if(n)
+				break;
+			lat = cache_access(sim->icache, pc, 0);
+			o->fetch_line = pc >> sim->icache->line_bits;
+			if(lat > 1){
+				o->fetch_wait = now + lat - 1;
+				sim->icache_stall_cnt += lat - 1;
+				break;
+			}
+		}
+
+		end = ooo_fetch_inst(sim, in, pc, &o->fetch_word);
+		in->ready = now + OOO_FRONT_CYCLES;
+
+		o->fetch_pc = in->next_pc;
+		if(in->halt)
+			o->fetch_stop = in->halt;
+		if(in->mispredict){
+			o->redirect = o->fetch;
+			o->stats.mispredicts++;
+			sim->branch_cnt++;
+		}
+		o->fetch++;
+		if(end)
+			break;
+	}
+}
+
+// Rename in order into the ROB, the RS and the LSQ
+static void ooo_rename(struct sim_t *sim, struct ooo_t *o) {
+	for(uint32_t n = 0; n < o->cfg.width && o->tail < o->fetch; n++){
+		struct ooo_inst_t *fq = &o->fq[o->tail & o->fq_mask];
+		struct ooo_inst_t *in;
+
+		if(fq->ready > sim->cc)
+			break;
+		if(o->tail - o->head == o->cfg.rob){
+			o->stats.rob_full++;
+			break;
+		}
+		if(o->rs_cnt == o->cfg.rs){
+			o->stats.rs_full++;
+			break;
+		}
+		if(fq->fu == OOO_FU_MEM && o->lsq_tail - o->lsq_head == o->cfg.lsq){
+			o->stats.lsq_full++;
+			break;
+		}
+
+		in = ROB(o, o->tail);
+		*in = *fq;
+		for(int i = 0; i < 2; i++){
+			uint64_t w = o->map[in->rs[i]];
+			in->src[i] = (in->rs[i] && w >= o->head) ? w : 0;
+		}
+		if(in->rd)
+			o->map[in->rd] = o->tail;
+		if(in->fu == OOO_FU_MEM){
+			in->lsq_pos = o->lsq_tail;
+			o->lsq[o->lsq_tail++ & o->lsq_mask] = o->tail;
+		}
+		o->rs_cnt++;
+		o->tail++;
+	}
+}
+
+// Issue latency of a load, 0 while an older store holds it back
+static uint32_t ooo_load(struct sim_t *sim, struct ooo_t *o, struct ooo_inst_t *in, uint32_t now) {
+	uint32_t lat = OOO_LOAD_CYCLES;
+
+	for(uint64_t p = in->lsq_pos; p-- > o->lsq_head; ){
+		const struct ooo_inst_t *st = ROB(o, o->lsq[p & o->lsq_mask]);
+
+		if(!st->store)
+			continue;
+		// the address of an older store is not known yet
+		if(!st->issued){
+			o->stats.load_blocked++;
+			return 0;
+		}
+		if(st->addr < in->addr + in->bytes && in->addr < st->addr + st->bytes){
+			// partial overlaps wait for the store to retire
+			if(st->done > now || st->addr > in->addr || st->addr + st->bytes < in->addr + in->bytes){
+				o->stats.load_blocked++;
+				return 0;
+			}
+			o->stats.load_fwd++;
+			return lat;
+		}
+	}
+
+	if(sim->dcache && in->halt != HALT_FAULT){
+		uint32_t acc = cache_access(sim->dcache, in->addr, 0);
+		if(acc > 1){
+			lat += acc - 1;
+			in->dmiss = 1;
+			sim->dcache_stall_cnt += acc - 1;
+		}
+	}
+
+	return lat;
+}
+
+// Oldest ready first, within the issue width and the free units
+static void ooo_issue(struct sim_t *sim, struct ooo_t *o) {
+	uint32_t now = sim->cc;
+	uint32_t free[OOO_FU_NUM];
+	uint32_t waiting = o->rs_cnt;
+	uint32_t n = 0;
+
+	memcpy(free, o->cfg.units, sizeof(free));
+
+	if(o->wait < o->head)
+		o->wait = o->head;
+	while(o->wait < o->tail && ROB(o, o->wait)->issued)
+		o->wait++;
+
+	for(uint64_t seq = o->wait; seq < o->tail && waiting && n < o->cfg.issue; seq++){
+		struct ooo_inst_t *in = ROB(o, seq);
+		uint32_t lat = 1;
+
+		if(in->issued)
+			continue;
+		waiting--;
+		if(!free[in->fu] || !ooo_done(o, in->src[0], now) || !ooo_done(o, in->src[1], now))
+			continue;
+		if(in->fu == OOO_FU_MEM && !in->store && (lat = ooo_load(sim, o, in, now)) == 0)
+			continue;
+		if(in->lat){
+			if(in->div){
+				if(now < o->div_free)
+					continue;
+				o->div_free = now + in->lat;
+			}
+			lat = in->lat;
+		}
+
+		in->issued = 1;
+		in->done = now + lat;
+		free[in->fu]--;
+		o->stats.unit_busy[in->fu]++;
+		o->rs_cnt--;
+		n++;
+	}
+
+	o->stats.issued += n;
+	o->stats.issue_hist[n]++;
+}
+
+// What holds up the oldest instruction, div tells the divider from the multiplier
+static enum CPI_CAT ooo_stall(const struct sim_t *sim, const struct ooo_t *o, uint8_t *div) {
+	const struct ooo_inst_t *in;
+
+	if(o->head == o->tail){
+		if(o->redirect || sim->cc < o->refill)
+			return CPI_BRANCH;
+		if(sim->cc < o->fetch_wait)
+			return CPI_ICACHE;
+		return CPI_EMPTY;
+	}
+
+	in = ROB(o, o->head);
+	if(in->fu == OOO_FU_MEM && !in->store && in->issued)
+		return in->dmiss ? CPI_DCACHE : CPI_LOAD_USE;
+	if(in->lat && (in->issued || (in->div && sim->cc < o->div_free))){
+		*div = in->div;
+		return CPI_MULDIV;
+	}
+	for(int i = 0; i < 2; i++){
+		if(in->src[i] >= o->head){
+			const struct ooo_inst_t *w = ROB(o, in->src[i]);
+			if(w->fu == OOO_FU_MEM && !w->store && w->done > sim->cc)
+				return CPI_LOAD_USE;
+			if(w->lat && w->done > sim->cc){
+				*div = w->div;
+				return CPI_MULDIV;
+			}
+		}
+	}
+	return CPI_RAW;
+}
+
+// In order, width per cycle
+static void ooo_retire(struct sim_t *sim, struct ooo_t *o) {
+	uint32_t n = 0;
+
+	while(n < o->cfg.width && o->head < o->tail){
+		struct ooo_inst_t *in = ROB(o, o->head);
+
+		if(in->done > sim->cc)
+			break;
+		if(in->halt == HALT_FAULT){
+			sim->fault_pc = in->pc;
+			sim->fault_addr = in->val;
+			sim->halt = HALT_FAULT;
+			break;
+		}
+
+		if(in->fu == OOO_FU_MEM){
+			o->lsq_head++;
+			if(in->store && sim->dcache)
+				cache_access(sim->dcache, in->addr, 1);
+		}
+		sim->last_retire_pc = in->pc;
+		sim->pc_next = in->next_pc;
+		sim->inst_cnt++;
+		sim->retired[retire_class(in->opcode)]++;
+		o->head++;
+		n++;
+
+		if(in->halt){
+			sim->halt = in->halt;
+			sim->tohost_val = in->val;
+			break;
+		}
+	}
+
+	if(n < o->cfg.width){
+		uint8_t div = 0;
+		enum CPI_CAT cause = ooo_stall(sim, o, &div);
+
+		sim->cpi[cause] += o->cfg.width - n;
+		if(cause == CPI_MULDIV && div)
+			sim->div_stall_cnt++;
+		else if(cause == CPI_MULDIV)
+			sim->mul_stall_cnt++;
+	}
+	sim->cpi[CPI_BASE] += n;
+}
+
+void ooo_cycle(struct sim_t *sim) {
+	struct ooo_t *o = sim->ooo;
+
+	if(!o->started){
+		o->fetch_pc = sim->pc_next;
+		o->started = 1;
+	}
+
+	ooo_retire(sim, o);
+	ooo_issue(sim, o);
+	ooo_rename(sim, o);
+	ooo_fetch(sim, o);
+
+	o->stats.cycles++;
+	o->stats.rob_occ += o->tail - o->head;
+	o->stats.rs_occ += o->rs_cnt;
+	o->stats.lsq_occ += o->lsq_tail - o->lsq_head;
+
+	sim->cc++;
+
+	if(!sim->halt && o->fetch_stop == HALT_PC_OUT && o->head == o->fetch){
+		sim->pc_next = o->fetch_pc;
+		sim->halt = HALT_PC_OUT;
+	}
+}
+
+void ooo_print(FILE *f, const struct sim_t *sim) {
+	static const char *unit_name[OOO_FU_NUM] = { "alu", "br", "mem" };
+	const struct ooo_t *o = sim->ooo;
+	const struct ooo_config_t *cfg = &o->cfg;
+	const struct ooo_stats_t *st = &o->stats;
+	double cycles = st->cycles ? (double)st->cycles : 1.0;
+	uint64_t slots = 0;
+
+	fprintf(f, "Out-of-order : width %u, issue %u, ROB %u, RS %u, LSQ %u, units alu %u br %u mem %u\n",
+			cfg->width, cfg->issue, cfg->rob, cfg->rs, cfg->lsq,
+			cfg->units[OOO_FU_ALU], cfg->units[OOO_FU_BR], cfg->units[OOO_FU_MEM]);
+	fprintf(f, "IPC : %.4f (%u instructions, %llu cycles)\n", sim->inst_cnt / cycles,
+			sim->inst_cnt, (unsigned long long)st->cycles);
+	fprintf(f, "Occupancy : ROB %.2f/%u, RS %.2f/%u, LSQ %.2f/%u\n",
+			st->rob_occ / cycles, cfg->rob, st->rs_occ / cycles, cfg->rs, st->lsq_occ / cycles, cfg->lsq);
+	fprintf(f, "Rename stalls : ROB full %llu, RS full %llu, LSQ full %llu cycles\n",
+			(unsigned long long)st->rob_full, (unsigned long long)st->rs_full,
+			(unsigned long long)st->lsq_full);
+
+	fprintf(f, "Issue : %.3f per cycle, %.2f%% of %u slots used\n", st->issued / cycles,
+			100.0 * st->issued / (cycles * cfg->issue), cfg->issue);
+	fprintf(f, "Issued per cycle :");
+	for(uint32_t i = 0; i <= cfg->issue; i++)
+		fprintf(f, " %u %.1f%%", i, 100.0 * st->issue_hist[i] / cycles);
+	fprintf(f, "\n");
+	fprintf(f, "Unit utilization :");
+	for(int i = 0; i < OOO_FU_NUM; i++)
+		fprintf(f, " %s %.1f%%", unit_name[i], 100.0 * st->unit_busy[i] / (cycles * cfg->units[i]));
+	fprintf(f, "\n");
+
+	fprintf(f, "Mispredicts : %llu, fetch waited %llu cycles\n",
+			(unsigned long long)st->mispredicts, (unsigned long long)st->redirect_cycles);
+	fprintf(f, "Loads : %llu forwarded from a store, %llu issue attempts held back by a store\n",
+			(unsigned long long)st->load_fwd, (unsigned long long)st->load_blocked);
+
+	for(int i = 0; i < CPI_NUM; i++)
+		slots += sim->cpi[i];
+	fprintf(f, "Retire slots : %llu (%u per cycle)\n", (unsigned long long)slots, cfg->width);
+	for(int i = 0; i < CPI_NUM; i++)
+		fprintf(f, "  %-9s %10llu slots  %6.2f%%\n", cpi_name(i), (unsigned long long)sim->cpi[i],
+				slots ? 100.0 * sim->cpi[i] / slots : 0.0);
+}
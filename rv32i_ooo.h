@@ -0,0 +1,156 @@
+/* **************************************
+ * Module: out-of-order back end
+ *
+ * A timing model of a superscalar core with register
+ * renaming, reservation stations and a reorder buffer,
+ * selected with mode ooo in place of the 5-stage pipeline.
+ *
+ * Instructions are executed at fetch with alu()/dmem(), so
+ * fetch always follows the correct path and the architectural
+ * state is the one of the functional engine (cut at max
+ * cycles, it includes fetched instructions that have not
+ * retired). The back end
+ * only decides when things happen:
+ *   fetch    width instructions per cycle into the fetch
+ *            queue, a mispredicted branch stops it until the
+ *            branch has executed
+ *   rename   in order, after OOO_FRONT_CYCLES of decode;
+ *            takes a ROB entry, an RS entry and for loads and
+ *            stores an LSQ entry, sources are mapped to the
+ *            ROB entry of their newest in-flight writer
+ *   issue    oldest ready first, up to issue per cycle and
+ *            the number of units of each class; a load waits
+ *            for the address of every older store and takes
+ *            the data of an older store to the same bytes;
+ *            the M extension runs on the ALUs with the
+ *            latencies of cfg.muldiv, one division at a time
+ *   retire   in order, width per cycle, halts take effect here
+ *
+ * The CPI stack counts retire slots, width per cycle: an
+ * empty slot is charged to what holds up the oldest
+ * instruction.
+ *
+ *   cfg.mode = MODE_OOO;
+ *   ooo_config_parse(&cfg.ooo, "width=4,rob=64,alu=2");
+ *
+ * **************************************
+ */
+#ifndef RV32I_OOO_H
+#define RV32I_OOO_H
+
+#include "rv32i.h"
+#include "rv32i_decode.h"
+
+#define OOO_WIDTH_MAX 8
+#define OOO_ROB_MAX 1024
+#define OOO_FRONT_CYCLES 2	// fetch to rename: decode and rename
+#define OOO_LOAD_CYCLES 2	// address and D-cache hit, also a forwarded store
+#define OOO_NOT_DONE UINT32_MAX
+
+// Functional unit classes
+enum OOO_FU {
+  OOO_FU_ALU = 0,	// arithmetic, upper immediates, system
+  OOO_FU_BR,	// branches and jumps
+  OOO_FU_MEM,	// loads and stores
+  OOO_FU_NUM
+};
+
+struct ooo_config_t {
+	uint32_t width;	// fetch, rename and retire per cycle
+	uint32_t issue;	// issue per cycle
+	uint32_t rob;	// reorder buffer entries
+	uint32_t rs;	// reservation station entries, shared by all units
+	uint32_t lsq;	// loads and stores in flight
+	uint32_t units[OOO_FU_NUM];
+};
+
+struct ooo_stats_t {
+	uint64_t cycles;
+	uint64_t rob_occ;	// summed over cycles
+	uint64_t rs_occ;
+	uint64_t lsq_occ;
+	uint64_t rob_full;	// cycles rename stopped on a full ROB
+	uint64_t rs_full;
+	uint64_t lsq_full;
+	uint64_t issued;
+	uint64_t issue_hist[OOO_WIDTH_MAX + 1];	// cycles by instructions issued
+	uint64_t unit_busy[OOO_FU_NUM];	// instructions issued to each class
+	uint64_t mispredicts;
+	uint64_t redirect_cycles;	// fetch waited on a mispredicted branch
+	uint64_t load_fwd;	// loads served by an older store
+	uint64_t load_blocked;	// issue attempts held back by an older store
+};
+
+// Fetch queue and ROB entry
+struct ooo_inst_t {
+	uint64_t src[2];	// seq of the producers, 0: read from the register file
+	uint64_t lsq_pos;	// loads and stores
+	uint32_t pc;
+	uint32_t next_pc;
+	uint32_t addr;	// loads and stores
+	uint32_t val;	// tohost value, fault address
+	uint32_t ready;	// cycle it leaves the front end
+	uint32_t done;	// cycle the result is available, OOO_NOT_DONE before issue
+	uint32_t lat;	// cycles in the multiply/divide unit, 0: other units
+	uint8_t opcode;
+	uint8_t fu;	// enum OOO_FU
+	uint8_t rs[2];	// architectural sources, 0: none
+	uint8_t rd;	// 0: no result
+	uint8_t bytes;
+	uint8_t store;
+	uint8_t issued;
+	uint8_t div;	// takes the iterative divider
+	uint8_t mispredict;	// the predictor sent fetch elsewhere
+	uint8_t dmiss;	// load missed the D-cache
+	uint8_t halt;	// enum HALT when it retires
+};
+
+struct ooo_t {
+	struct ooo_config_t cfg;
+
+	// rings of a power of two, the config bounds their occupancy
+	struct ooo_inst_t *fq;	// fetch queue, by seq
+	struct ooo_inst_t *rob;	// by seq
+	uint64_t *lsq;	// seq of the loads and stores in order, by position
+	uint32_t fq_size;
+	uint32_t fq_mask;
+	uint32_t rob_mask;
+	uint32_t lsq_mask;
+
+	// seq numbers, head <= tail <= fetch
+	uint64_t head;	// oldest in the ROB
+	uint64_t tail;	// next to rename, oldest in the fetch queue
+	uint64_t fetch;	// next to fetch
+	uint64_t wait;	// oldest not issued, issue starts looking here
+	uint64_t lsq_head;	// positions
+	uint64_t lsq_tail;
+	uint64_t map[32];	// seq of the newest writer of each register
+	uint32_t rs_cnt;	// renamed, not issued
+	uint32_t div_free;	// cycle the divider takes a new division
+
+	uint32_t fetch_pc;
+	uint32_t fetch_wait;	// cycle the I-cache delivers the line
+	uint32_t fetch_line;	// I-cache line of the last access
+	uint32_t fetch_word;	// last imem word in the fetch buffer
+	uint32_t refill;	// cycle the front end is full again after a redirect
+	uint64_t redirect;	// seq of a mispredicted branch in flight, 0: none
+	uint8_t fetch_stop;	// enum HALT: nothing more to fetch
+	uint8_t started;	// fetch_pc was taken from pc_next
+
+	struct ooo_stats_t stats;
+};
+
+struct sim_t;
+
+void ooo_config_default(struct ooo_config_t *cfg);
+int ooo_config_parse(struct ooo_config_t *cfg, const char *str);
+
+struct ooo_t *ooo_create(const struct ooo_config_t *cfg);
+void ooo_destroy(struct ooo_t *o);
+void ooo_reset(struct ooo_t *o);
+
+uint8_t ooo_fetch_inst(struct sim_t *sim, struct ooo_inst_t *in, uint32_t pc, uint32_t *word);
+void ooo_cycle(struct sim_t *sim);
+void ooo_print(FILE *f, const struct sim_t *sim);
+
+#endif
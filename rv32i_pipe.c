@@ -5,748 +5,697 @@
  *
  * **************************************
  */
-#define DEBUG 0
-
-#include "rv32i.h"
-
-#define D_PRINTF(x, ...) \
-	do {\
-		if(DEBUG){ \
-		printf("%s: ", x);\
-		printf(__VA_ARGS__);\
-		printf("\n");\
-		}\
-	}while(0)\
-
-
-struct imem_output_t imem(struct imem_input_t imem_in, uint32_t *imem_data);
-struct regfile_output_t regfile(struct regfile_input_t regfile_in, uint32_t *reg_data, enum REG regwrite);
-struct alu_output_t alu(struct alu_input_t alu_in);
-uint8_t alu_control_gen(uint8_t opcode, uint8_t func3, uint8_t func7);
-struct dmem_output_t dmem(struct dmem_input_t dmem_in, uint8_t *dmem_data);
-
-
-int main (int argc, char *argv[]) {
+#include "rv32i_sim.h"
+
+static void stage_wb(struct sim_t *sim);
+static void stage_mem(struct sim_t *sim);
+static void stage_ex(struct sim_t *sim);
+static void stage_id(struct sim_t *sim);
+static void stage_if(struct sim_t *sim);
+
+// Address after the instruction at pc, pc + 4 outside of imem
+static inline uint32_t pipe_pc_after(const struct sim_t *sim, uint32_t pc) {
+	uint32_t idx = (pc - sim->imem_base) / PARCEL_SIZE;
+	return pc + (idx < DECODE_ENTRIES(sim->imem_size) ? sim->uop_table[idx].len : WORD_SIZE);
+}
 
-	// get input arguments
-	FILE *f_imem, *f_dmem;
-	if (argc < 3) {
-		printf("usage: %s imem_data_file dmem_data_file\n", argv[0]);
-		exit(1);
-	}
+void pipe_reset(struct sim_t *sim) {
+    // Initialize variable
+    sim->id_flush = 0;
+    sim->id_stall = 0;
+    sim->if_flush = 0;
+    sim->if_stall = 0;
+    sim->pc_write = 1;
+    sim->branch_taken = 0;
+    sim->branch_early = 0;
+    sim->drain = 0;
+    sb_reset(&sim->sb);
+
+    // caches start cold
+    sim->if_wait = 0;
+    sim->mem_wait = 0;
+    sim->if_busy = 0;
+    sim->mem_busy = 0;
+    sim->div_wait = 0;
+    sim->div_busy = 0;
+    sim->fb_fill = 0;
+    if(sim->icache)
+        cache_reset(sim->icache);
+    if(sim->dcache)
+        cache_reset(sim->dcache);
+    bpred_reset(sim->bpred);
+
+	sim->wb.enable = 0;
+	sim->mem.enable = 0;
+	sim->ex.enable = 0;
+	sim->id.enable = 0;
+	sim->wb.cause = CPI_EMPTY;
+	sim->mem.cause = CPI_EMPTY;
+	sim->ex.cause = CPI_EMPTY;
+	sim->id.cause = CPI_EMPTY;
+}
 
-	if ( (f_imem = fopen(argv[1], "r")) == NULL ) {
-		printf("Cannot find %s\n", argv[1]);
-		exit(1);
-	}
-	if ( (f_dmem = fopen(argv[2], "r")) == NULL ) {
-		printf("Cannot find %s\n", argv[2]);
-		exit(1);
+// One clock cycle, the stages run from WB back to IF. Each pipeline
+// register is read by its consumer before its producer fills it in
+// place, so one copy of them stands for both sides of the clock edge.
+void pipe_cycle(struct sim_t *sim) {
+
+	if(sim->cfg.trace_level == TRACE_FULL)
+		printf("\n*** CLK : %d ***\n", sim->cc);
+	else if(sim->cfg.trace_level == TRACE_SUMMARY){
+		// PC handled by each stage in this cycle
+		printf("CLK %d:", sim->cc);
+		if(sim->wb.enable) printf(" WB %X", sim->wb.pc_curr); else printf(" WB -");
+		if(sim->mem.enable) printf(" MEM %X", sim->mem.pc_curr); else printf(" MEM -");
+		if(sim->ex.enable && !sim->id_flush) printf(" EX %X", sim->ex.pc_curr); else printf(" EX -");
+		if(sim->id.enable && !sim->if_flush) printf(" ID %X", sim->id.pc_curr); else printf(" ID -");
+		if(sim->pc_write) printf(" IF %X\n", sim->pc_next); else printf(" IF -\n");
 	}
 
-	// memory data (global)
-	uint32_t *reg_data;
-	uint32_t *imem_data;
-	uint8_t *dmem_data;
-
-	reg_data = (uint32_t*)malloc(32*sizeof(uint32_t));
-	imem_data = (uint32_t*)malloc(IMEM_DEPTH*sizeof(uint32_t));
-	dmem_data = (uint8_t*)malloc(DMEM_DEPTH*sizeof(uint32_t));
-
-	// initialize memory data
-	int i, j, k;
-	for (i = 0; i < 32; i++) reg_data[i] = 0;
-	for (i = 0; i < IMEM_DEPTH; i++) imem_data[i] = 0;
-	for (i = 0; i < DMEM_DEPTH*WORD_SIZE; i++) dmem_data[i] = 0;
-
-	uint32_t d, buf;
-	i = 0;
-	printf("\n*** Reading %s ***\n", argv[1]);
-	while (fscanf(f_imem, "%1d", &buf) != EOF) {
-		d = buf << 31;
-		for (k = 30; k >= 0; k--) {
-			if (fscanf(f_imem, "%1d", &buf) != EOF) {
-				d |= buf << k;
-			} else {
-				printf("Incorrect format!!\n");
-				exit(1);
-			}
-		}
-		imem_data[i] = d;
-		printf("imem[%03d]: %08X\n", i, imem_data[i]);
-		i++;
-	}
- // For hex input
- //	while (fscanf(f_imem, "%8x", &buf) != EOF) {
- //		imem_data[i] = buf;
- //		printf("imem[%03d]: %08X\n", i, imem_data[i]);
- //		i++;
- //	}
-
-	i = 0;
-	printf("\n*** Reading %s ***\n", argv[2]);
-	while (fscanf(f_dmem, "%8x", &buf) != EOF) {
-		printf("dmem[%03d]: ", i);
-	while (fscanf(f_imem, "%8x", &buf) != EOF) {
-		imem_data[i] = buf;
-		printf("imem[%03d]: %08X\n", i, imem_data[i]);
-		i++;
+	stage_wb(sim);
+	stage_mem(sim);
+	stage_ex(sim);
+	stage_id(sim);
+	stage_if(sim);
+
+	// Print state
+	if(sim->cfg.trace_level == TRACE_FULL)
+		trace_print_state(stdout, sim->reg_data, sim->dmem);
+	if(sim->trace)
+		trace_cycle(sim->trace, sim->cc, sim->reg_data);
+
+	sim->cc++;
+
+	if(sim->halt)
+		return;
+	if(!sim->id.enable && !sim->ex.enable && !sim->mem.enable && !sim->wb.enable
+			&& !sim->branch_taken && ((sim->pc_next - sim->imem_base) / 4) >= sim->imem_size){
+		sim->halt = HALT_PC_OUT;
 	}
-		for(int j = 0; j < WORD_SIZE; j++){
-			dmem_data[i+j] = (buf & (0xFF << j*BYTE_BIT)) >> j*BYTE_BIT;
-		}
-		for(int j = WORD_SIZE-1; j >= 0; j--){
-			printf("%02X", dmem_data[i+j]);
-		}
-		printf("\n");
-		i += WORD_SIZE;
-	}
-
-	fclose(f_imem);
-	fclose(f_dmem);
+}
 
-	// processor model
-	uint32_t pc_curr, pc_next;	// program counter
+// Writeback stage
+static void stage_wb(struct sim_t *sim) {
+	struct pipe_id_ex_t *ex = &sim->ex;
+	struct pipe_ex_mem_t *mem = &sim->mem;
+	struct pipe_mem_wb_t *wb = &sim->wb;
 
-	// IF
-	struct imem_input_t imem_in;
-	struct imem_output_t imem_out;
+	uint8_t opcode = wb->opcode;
+	uint8_t rd;
+	uint32_t rd_din;
 
-	// ID
-	struct regfile_input_t regfile_in;
-	struct regfile_output_t regfile_out;
-	uint8_t opcode;
-	uint8_t func3;
-	uint8_t func7;
-	uint32_t imm;
-
-	// EX
-	struct alu_input_t alu_in;
-	struct alu_output_t alu_out;
+    if(wb->enable){
+        D_PRINTF("WB", "PC - ************[%x]************", wb->pc_curr);
+        if(!(opcode == SB_TYPE || opcode == S_TYPE)){
+            // Main logic
+            rd = wb->regfile_in.rd;
+            rd_din = (opcode == I_L_TYPE) ? wb->dmem_out.dout : wb->regfile_in.rd_din;
 
-	// MEM
-	struct dmem_input_t dmem_in;
-	struct dmem_output_t dmem_out;
-
-	// Pipeline registers
-	struct pipe_if_id_t id;
-	struct pipe_id_ex_t ex;
-	struct pipe_ex_mem_t mem;
-	struct pipe_mem_wb_t wb;
-
-    // Hazard variable
-    uint8_t id_flush;
-    uint8_t id_stall;
-    uint8_t if_flush;
-    uint8_t if_stall;
-    uint8_t pc_write;
-    uint8_t branch_taken;
-    
-    // Result variable
-    uint32_t hazard_cnt;
-    uint32_t inst_cnt;
-    uint32_t branch_cnt;
-
-    //Clock count
-	uint32_t cc = 2;	
+            D_PRINTF("WB", "[I]rd - %d", rd);
+            D_PRINTF("WB", "[I]rd_din - 0x%X", rd_din);
 
+            regfile_write(sim->reg_data, rd, rd_din);
 
-    // Initialize variable
-    pc_next = 0;
-    id_flush = 0;
-    id_stall = 0;
-    if_flush = 0;
-    if_stall = 0;
-    pc_write = 1;
-    branch_taken = 0;
-
-	wb.enable = 0;
-	mem.enable = 0;
-	ex.enable = 0;
-	id.enable = 0;
-
-	
-
-    hazard_cnt = 0;
-	inst_cnt = 0;
-    branch_cnt = 0;
-
-	while (cc < CLK_NUM) {
-		printf("\n*** CLK : %d ***\n", cc);
-
-		// Writeback stage
-        if(wb.enable){
-            D_PRINTF("WB", "PC - ************[%x]************", wb.pc_curr);
-            if(!(wb.opcode == SB_TYPE || wb.opcode == S_TYPE)){
-                // Get data from pipeline register
-                pc_curr = wb.pc_curr;
-                opcode = wb.opcode;
-                imm = wb.imm;
-                func3 = wb.func3;
-                alu_out = wb.alu_out;
-                dmem_out = wb.dmem_out;
-                regfile_in = wb.regfile_in;
-
-                // Main logic
-                if(opcode == I_L_TYPE){
-                    regfile_in.rd_din = dmem_out.dout;
+            // Forwarding to EX stage (MEM hazard)
+            // Check destination register num is not zero
+            if(rd && (sim->fwd->paths & FWD_WB_EX)){
+                if(rd == ex->regfile_in.rs1){
+                    ex->alu_in.in1 = rd_din;
+                    D_PRINTF("WB", "rs1 forwarding %d", rd_din);
                 }
-                
-                D_PRINTF("WB", "[I]rd - %d", regfile_in.rd);
-                D_PRINTF("WB", "[I]rd_din - 0x%X", regfile_in.rd_din);
-
-                regfile_out = regfile(regfile_in, reg_data, WRITE);
-
-                // Forwarding to EX stage (MEM hazard)
-                // Check destination register num is not zero
-                if(regfile_in.rd){
-                    if(regfile_in.rd == ex.regfile_in.rs1){
-                        ex.alu_in.in1 = regfile_in.rd_din;
-                        D_PRINTF("WB", "rs1 forwarding %d", regfile_in.rd_din);
+                if(rd == ex->regfile_in.rs2){
+                    if(ex->opcode == R_TYPE || ex->opcode == SB_TYPE){
+                        ex->alu_in.in2 = rd_din;
+                        D_PRINTF("WB", "rs2 forwarding %d", rd_din);
                     }
-                    if(ex.opcode == R_TYPE && (regfile_in.rd == ex.regfile_in.rs2)){
-                        ex.alu_in.in2 = regfile_in.rd_din;
-                        D_PRINTF("WB", "rs2 forwarding %d", regfile_in.rd_din);
+                    else if(ex->opcode == S_TYPE){
+                        ex->regfile_out.rs2_dout = rd_din;
+                        D_PRINTF("WB", "rs2 forwarding(S_TYPE) %d", rd_din);
                     }
                 }
             }
-			inst_cnt++;
+            // Store data of the store in MEM
+            if(rd && (sim->fwd->paths & FWD_WB_MEM)
+                    && mem->enable && mem->opcode == S_TYPE && rd == mem->regfile_in.rs2){
+                mem->regfile_out.rs2_dout = rd_din;
+                D_PRINTF("WB", "store data forwarding %d", rd_din);
+            }
         }
 
-		// Memory stage
-        if(mem.enable){
-            D_PRINTF("MEM", "PC - ************[%x]************", mem.pc_curr);
-            // Get data from pipeline register
-            pc_curr = mem.pc_curr;
-            opcode = mem.opcode;
-            imm = mem.imm;
-            func3 = mem.func3;
-            regfile_out = mem.regfile_out;
-            alu_out = mem.alu_out;
-            regfile_in = mem.regfile_in;
-            
-            // Main Logic
-            if(opcode == S_TYPE || opcode == I_L_TYPE || opcode == I_J_TYPE){
-                dmem_in.addr = alu_out.result;
-                D_PRINTF("MEM", "[I]addr - 0x%X", dmem_in.addr);
-                dmem_in.din = regfile_out.rs2_dout;
-                D_PRINTF("MEM", "[I]din - 0x%X", dmem_in.din);
-                dmem_in.func3 = func3;
-                D_PRINTF("MEM", "[I]func3 - 0x%X", dmem_in.func3);
-
-                if(opcode == S_TYPE){
-                    dmem_in.mem_write = 1;
-                    dmem_in.mem_read = 0;
-                }
-                else if(opcode == I_L_TYPE){
-                    dmem_in.mem_read = 1;
-                    dmem_in.mem_write = 0;
-                }
-                else{
-                    dmem_in.mem_read = 0;
-                    dmem_in.mem_write = 0;
-                }
+        // Halt detection at retire
+        if(opcode == SYSTEM_TYPE && wb->func3 == F3_PRIV){
+            sim->halt = ((wb->imm & 0xFFF) == IMM_EBREAK) ? HALT_EBREAK : HALT_ECALL;
+        }
+        else if((opcode == UJ_TYPE || opcode == SB_TYPE || opcode == I_J_TYPE)
+                && wb->pc_curr == sim->last_retire_pc && sim->inst_cnt != sim->pipe_start_inst){
+            // Same control instruction retired twice in a row: jump to itself
+            sim->halt = HALT_SELF_LOOP;
+        }
+        if(sim->prof){
+            uint32_t k = prof_idx(sim->prof, wb->pc_curr);
+            sim->prof->retired[k]++;
+            if(wb->pc_curr != pipe_pc_after(sim, sim->last_retire_pc))
+                sim->prof->leader[k] = 1;
+        }
+        sim->last_retire_pc = wb->pc_curr;
+        sim->inst_cnt++;
+        sim->cpi[CPI_BASE]++;
+        sim->retired[retire_class(opcode)]++;
+    }
+    else{
+        sim->cpi[wb->cause]++;
+    }
+}
 
-                dmem_out = dmem(dmem_in, dmem_data);
-            }
+// Memory stage
+static void stage_mem(struct sim_t *sim) {
+	struct pipe_id_ex_t *ex = &sim->ex;
+	struct pipe_ex_mem_t *mem = &sim->mem;
+	struct pipe_mem_wb_t *wb = &sim->wb;
 
-            // Forwarding to EX stage (EX hazard)
-            // Check write to register
-            if(!(opcode == SB_TYPE || opcode == S_TYPE)){
-                if(regfile_in.rd){
-                    if(regfile_in.rd == ex.regfile_in.rs1){
-                        ex.alu_in.in1 = alu_out.result;
-                        D_PRINTF("MEM", "rs1 forwarding %d", alu_out.result);
-                    }
-                    if(ex.opcode == R_TYPE || ex.opcode == SB_TYPE){
-                        if(regfile_in.rd == ex.regfile_in.rs2){
-                            if(opcode == I_L_TYPE){
-                                ex.alu_in.in2 = dmem_out.dout;
-                                D_PRINTF("MEM", "rs2 forwarding(I_L_TYPE) %d", dmem_out.dout);
-                            }
-                            else{
-                                ex.alu_in.in2 = alu_out.result;
-                                D_PRINTF("MEM", "rs2 forwarding %d", alu_out.result);
-                            }
-                        }
-                    }
-                    else if(ex.opcode == S_TYPE){
-                        if(regfile_in.rd == ex.regfile_in.rs2){
-                            ex.regfile_out.rs2_dout = alu_out.result;
-                            D_PRINTF("MEM", "rs2 forwarding(S_TYPE) %d", alu_out.result);
-                        }
-                    }
+	struct dmem_input_t dmem_in;
+	uint8_t opcode = mem->opcode;
+	uint8_t func3 = mem->func3;
+	uint8_t rd;
+
+    // Stall requests of the previous cycle are over
+    sim->id_stall = 0;
+    sim->if_stall = 0;
+
+    if(mem->enable){
+        D_PRINTF("MEM", "PC - ************[%x]************", mem->pc_curr);
+
+        // Main Logic
+        if(opcode == S_TYPE || opcode == I_L_TYPE){
+            dmem_in.addr = mem->alu_out.result;
+            D_PRINTF("MEM", "[I]addr - 0x%X", dmem_in.addr);
+            dmem_in.din = mem->regfile_out.rs2_dout;
+            D_PRINTF("MEM", "[I]din - 0x%X", dmem_in.din);
+            dmem_in.func3 = func3;
+            D_PRINTF("MEM", "[I]func3 - 0x%X", dmem_in.func3);
+            dmem_in.mem_write = (opcode == S_TYPE);
+            dmem_in.mem_read = !dmem_in.mem_write;
+
+            // D-cache miss: MEM keeps the access and freezes EX, ID and IF
+            if(sim->dcache && !mem_fault(sim->dmem, dmem_in.addr, 1 << (func3 & 0x3))){
+                if(!sim->mem_busy){
+                    sim->mem_wait = cache_access(sim->dcache, dmem_in.addr, dmem_in.mem_write) - 1;
+                    sim->mem_busy = 1;
+                }
+                if(sim->mem_wait){
+                    D_PRINTF("MEM", "D-cache wait %d", sim->mem_wait);
+                    sim->mem_wait--;
+                    sim->dcache_stall_cnt++;
+                    if(sim->prof)
+                        sim->prof->dcache[prof_idx(sim->prof, mem->pc_curr)]++;
+                    sim->id_stall = 1;
+                    sim->if_stall = 1;
+                    sim->pc_write = 0;
+                    wb->enable = 0;
+                    wb->cause = CPI_DCACHE;
+                    return;
                 }
+                sim->mem_busy = 0;
             }
 
-            //Update pipeline register
-            wb.enable = 1;
-            wb.pc_curr = pc_curr;
-            wb.opcode = opcode;
-            wb.imm = imm;
-            wb.func3 = func3;
-            wb.alu_out = alu_out;
-            wb.dmem_out = dmem_out;
-            wb.regfile_in = regfile_in;
+            if(sim->trace && dmem_in.mem_write && !mem_fault(sim->dmem, dmem_in.addr, 1 << (func3 & 0x3)))
+                trace_store(sim->trace, sim->dmem, sim->cc, dmem_in.addr, dmem_in.func3, dmem_in.din);
 
+            dmem(&dmem_in, &wb->dmem_out, sim->dmem);
+
+            if(wb->dmem_out.fault){
+                sim->fault_pc = mem->pc_curr;
+                sim->fault_addr = dmem_in.addr;
+                sim->halt = HALT_FAULT;
+            }
+            else if(dmem_in.mem_write && dmem_in.addr == sim->tohost){
+                sim->tohost_val = dmem_in.din;
+                sim->halt = HALT_TOHOST;
+            }
         }
         else{
-            wb.enable = 0;
+            wb->dmem_out.dout = 0;
+            wb->dmem_out.fault = 0;
         }
 
-		// Execute stage
-        if(ex.enable && !id_flush && !id_stall){
-            D_PRINTF("EX", "PC - ************[%x]************", ex.pc_curr);
-                
-            // Get data from pipeline register
-            pc_curr = ex.pc_curr;
-            opcode = ex.opcode;
-            imm = ex.imm;
-            func3 = ex.func3;
-            func7 = ex.func7;
-            alu_in = ex.alu_in;
-            regfile_in = ex.regfile_in;
-
+        // Forwarding to EX stage (EX hazard)
+        // Check write to register
+        rd = mem->regfile_in.rd;
+        if(rd && !(opcode == SB_TYPE || opcode == S_TYPE) && (sim->fwd->paths & FWD_MEM_EX)){
+            // Value the instruction will write back
+            uint32_t fwd = (opcode == I_L_TYPE) ? wb->dmem_out.dout : mem->regfile_in.rd_din;
 
-            // Main logic
-            alu_in.alu_control = alu_control_gen(opcode, func3, func7);
-
-            D_PRINTF("EX", "[I]in1 - %d", alu_in.in1);
-            D_PRINTF("EX", "[I]in2 - %d", (int32_t) alu_in.in2);
-            D_PRINTF("EX", "[I]alu_cont - %x", alu_in.alu_control);
-
-            alu_out = alu(alu_in);
-
-            int8_t pc_next_sel = 0;
-
-            // Check the branch is taken
-            if(opcode == SB_TYPE){
-                switch(func3){
-                    case F3_BEQ:
-                        pc_next_sel = alu_out.zero ? 1 : 0;
-                        break;
-                    case F3_BNE:
-                        pc_next_sel = alu_out.zero ? 0 : 1;
-                        break;
-                    case F3_BLT:
-                        pc_next_sel = (!alu_out.zero && alu_out.sign) 
-                            ? 1 : 0;
-                        break;
-                    case F3_BGE:
-                        pc_next_sel = (alu_out.zero || !alu_out.sign) 
-                            ? 1 : 0;
-                        break;
-                    case F3_BLTU:
-                        pc_next_sel = (!alu_out.zero && alu_out.ucmp) 
-                            ? 1 : 0;
-                        break;
-                    case F3_BGEU:
-                        pc_next_sel = (alu_out.zero || !alu_out.ucmp) 
-                            ? 1 : 0;
-                        break;
-                }
-            }
-
-            // When the branch is taken, Calculate taken address
-            if(pc_next_sel){
-                pc_next = pc_curr + (int32_t)imm;
-                branch_taken = 1;
-            }
-            else if(opcode == UJ_TYPE){
-                pc_next = pc_curr + (int32_t)imm;
-                branch_taken = 1;
+            if(rd == ex->regfile_in.rs1){
+                ex->alu_in.in1 = fwd;
+                D_PRINTF("MEM", "rs1 forwarding %d", fwd);
             }
-            else if(opcode == I_J_TYPE){
-                pc_next = alu_out.result;
-                branch_taken = 1;
-            }
-
-            //Calculate register write value
-            if(!(opcode == SB_TYPE || opcode == S_TYPE)){
-                if(opcode == UJ_TYPE || opcode == I_J_TYPE)
-                    regfile_in.rd_din = pc_curr + 4;
-                else if(opcode == U_LU_TYPE)
-                    regfile_in.rd_din = imm;
-                else if(opcode == U_AU_TYPE)
-                    regfile_in.rd_din = pc_curr + imm;
-                else if(opcode == R_TYPE || opcode == I_R_TYPE){
-                    if(func3 == F3_SLT){
-                        regfile_in.rd_din = alu_out.sign ? 1 : 0;
-                    }
-                    else if(func3 == F3_SLTU){
-                        regfile_in.rd_din = alu_out.ucmp ? 1 : 0;
-                    }
-                    else
-                        regfile_in.rd_din = alu_out.result;
+            if(ex->opcode == R_TYPE || ex->opcode == SB_TYPE){
+                if(rd == ex->regfile_in.rs2){
+                    ex->alu_in.in2 = fwd;
+                    D_PRINTF("MEM", "rs2 forwarding %d", fwd);
                 }
-                else if(opcode == I_L_TYPE){
-                    regfile_in.rd_din = dmem_out.dout;
+            }
+            else if(ex->opcode == S_TYPE){
+                if(rd == ex->regfile_in.rs2){
+                    ex->regfile_out.rs2_dout = fwd;
+                    D_PRINTF("MEM", "rs2 forwarding(S_TYPE) %d", fwd);
                 }
-                else
-                    regfile_in.rd_din = alu_out.result;
             }
-
-            D_PRINTF("EX", "branch_taken - %d", branch_taken);
-            D_PRINTF("EX", "[I]rd_din - %d", regfile_in.rd_din);
-            D_PRINTF("EX", "[I]result - %d", alu_out.result);
-            D_PRINTF("EX", "[I]zero - %d", alu_out.zero);
-            D_PRINTF("EX", "[I]sign - %d", alu_out.sign);
-
-            // Update pipeline register
-            mem.enable = 1;
-            mem.pc_curr = pc_curr;
-            mem.opcode = opcode;
-            mem.imm = imm;
-            mem.func3 = func3;
-            mem.alu_out = alu_out; 
-            mem.regfile_in = regfile_in;
-            //Not use in this stage
-            mem.regfile_out = ex.regfile_out;
-        }
-        else{
-            mem.enable = 0;
         }
 
-		// Instruction decode stage
-        if(id.enable && !if_flush && !if_stall){
-            D_PRINTF("ID", "PC - ************[%x]************", id.pc_curr);
+        //Update pipeline register, dmem_out is already in place
+        wb->enable = 1;
+        wb->pc_curr = mem->pc_curr;
+        wb->opcode = opcode;
+        wb->imm = mem->imm;
+        wb->func3 = func3;
+        wb->alu_out = mem->alu_out;
+        wb->regfile_in = mem->regfile_in;
+    }
+    else{
+        wb->enable = 0;
+        wb->cause = mem->cause;
+    }
+}
 
-            // Get data from pipeline register
-            pc_curr = id.pc_curr;
-            imem_out = id.imem_out;
+// Outcome of a branch or jump in EX, or in ID with FWD_MEM_ID.
+// The fetch is redirected when the prediction made in IF was wrong.
+static void pipe_resolve(struct sim_t *sim, uint32_t pc_curr, uint8_t len, uint8_t opcode, uint8_t func3,
+		uint32_t imm, const struct regfile_input_t *regfile_in, const struct alu_output_t *alu_out,
+		const struct bpred_output_t *pred, uint8_t early) {
+    int8_t pc_next_sel = 0;
+
+    // Check the branch is taken
+    if(opcode == SB_TYPE){
+        switch(func3){
+            case F3_BEQ:
+                pc_next_sel = alu_out->zero ? 1 : 0;
+                break;
+            case F3_BNE:
+                pc_next_sel = alu_out->zero ? 0 : 1;
+                break;
+            case F3_BLT:
+                pc_next_sel = (!alu_out->zero && alu_out->sign)
+                    ? 1 : 0;
+                break;
+            case F3_BGE:
+                pc_next_sel = (alu_out->zero || !alu_out->sign)
+                    ? 1 : 0;
+                break;
+            case F3_BLTU:
+                pc_next_sel = (!alu_out->zero && alu_out->ucmp)
+                    ? 1 : 0;
+                break;
+            case F3_BGEU:
+                pc_next_sel = (alu_out->zero || !alu_out->ucmp)
+                    ? 1 : 0;
+                break;
+        }
+    }
+
+    uint8_t taken = pc_next_sel || opcode != SB_TYPE;
+    uint32_t target = (opcode == I_J_TYPE) ? alu_out->result & ~1u : pc_curr + (int32_t)imm;
+
+    sim->taken_cnt += taken;
+
+    if(bpred_update(sim->bpred, pc_curr, regfile_in, opcode, taken, target, pred)){
+        sim->pc_next = taken ? target : pc_curr + len;
+        sim->branch_taken = 1;
+        sim->branch_early = early;
+        if(sim->prof)
+            sim->prof->flush[prof_idx(sim->prof, pc_curr)] += early ? sim->fwd->flush_cycles : BPRED_FLUSH_CYCLES;
+    }
+    if(sim->prof){
+        if(taken)
+            sim->prof->taken[prof_idx(sim->prof, pc_curr)]++;
+        else
+            sim->prof->not_taken[prof_idx(sim->prof, pc_curr)]++;
+    }
+}
 
-            // Main logic
-            opcode = imem_out.dout & 0x7F;
-            D_PRINTF("ID", "[I]opcode- %x", opcode);
-
-            if (!(opcode == U_LU_TYPE || opcode == U_AU_TYPE 
-                        || opcode == UJ_TYPE))
-                func3 = (imem_out.dout >> 12) & 0x7;
-            if (opcode == R_TYPE)
-                func7 = (imem_out.dout >> 25) & 0x7F;
-
-            regfile_in.rs1 = (imem_out.dout >> 15) & 0x1F;
-            D_PRINTF("ID", "[I]rs1 - %d", regfile_in.rs1);
-            regfile_in.rd = (imem_out.dout >> 7) & 0x1F;
-            D_PRINTF("ID", "[I]rd - %d", regfile_in.rd);
-
-            if (opcode == SB_TYPE || opcode == R_TYPE || opcode == S_TYPE){
-                regfile_in.rs2 = (imem_out.dout >> 20) & 0x1F;
-                D_PRINTF("ID", "[I]rs2 - %d", regfile_in.rs2);
+// Execute stage
+static void stage_ex(struct sim_t *sim) {
+	struct pipe_id_ex_t *ex = &sim->ex;
+	struct pipe_ex_mem_t *mem = &sim->mem;
+
+	uint32_t pc_curr = ex->pc_curr;
+	uint8_t opcode = ex->opcode;
+	uint8_t func3 = ex->func3;
+	uint32_t imm = ex->imm;
+	uint32_t rd_din;
+	uint8_t m_ext = opcode == R_TYPE && ex->func7 == F7_MULDIV;
+
+    // MEM is stalled, the EX/MEM register is kept
+    if(sim->id_stall)
+        return;
+
+    if(ex->enable && !sim->id_flush){
+        D_PRINTF("EX", "PC - ************[%x]************", pc_curr);
+
+        // Iterative divider: the division holds EX and freezes ID and IF
+        if(m_ext && muldiv_is_div(func3)){
+            if(!sim->div_busy){
+                sim->div_wait = muldiv_latency(&sim->cfg.muldiv, func3, ex->alu_in.in1, ex->alu_in.in2) - 1;
+                sim->div_busy = 1;
+                sim->div_cnt++;
             }
-
-            // Register Read
-            regfile_out = regfile(regfile_in, reg_data, READ);
-
-
-            D_PRINTF("ID", "[O]rs1_dout - %d", regfile_out.rs1_dout);
-            if (opcode == SB_TYPE || opcode == R_TYPE || opcode == S_TYPE)
-                D_PRINTF("ID", "[O]rs2_dout - %d", regfile_out.rs2_dout);
-            
-            alu_in.in1 = regfile_out.rs1_dout;
-
-            //Immediate generation
-            if (opcode == I_L_TYPE || opcode == I_R_TYPE || opcode == I_J_TYPE){
-                imm = (imem_out.dout >> 20) & 0xFFF;
-                //Input is a negative number
-                if(imm & 0x800)
-                    imm = imm | 0xFFFFF000;
-                alu_in.in2 = imm;
+            if(sim->div_wait){
+                D_PRINTF("EX", "Divider wait %d", sim->div_wait);
+                sim->div_wait--;
+                sim->div_stall_cnt++;
+                sim->if_stall = 1;
+                sim->pc_write = 0;
+                mem->enable = 0;
+                mem->cause = CPI_MULDIV;
+                return;
             }
-            else if (opcode == U_LU_TYPE || opcode == U_AU_TYPE)
-                imm = imem_out.dout & ~0xFFF;
-            else if (opcode == UJ_TYPE){
-                imm = 0;
-                imm = imm | ((imem_out.dout >> 31) & 0x1) << 20;
-                imm = imm | ((imem_out.dout >> 21) & 0x3FF) << 1;
-                imm = imm | ((imem_out.dout >> 20) & 0x1) << 11;
-                imm = imm | (imem_out.dout & 0xFF000);
-
-                // When the input is a negative number
-                if(imm & 0x100000)
-                    imm = imm | 0xFFE00000;
+            sim->div_busy = 0;
+        }
+        else if(m_ext)
+            sim->mul_cnt++;
+
+        // Main logic
+        D_PRINTF("EX", "[I]in1 - %d", ex->alu_in.in1);
+        D_PRINTF("EX", "[I]in2 - %d", (int32_t) ex->alu_in.in2);
+        D_PRINTF("EX", "[I]alu_cont - %x", ex->alu_in.alu_control);
+
+        alu(&ex->alu_in, &mem->alu_out);
+
+        // Check the prediction made in IF, unless ID already did
+        if(!ex->resolved && (opcode == SB_TYPE || opcode == UJ_TYPE || opcode == I_J_TYPE))
+            pipe_resolve(sim, pc_curr, ex->len, opcode, func3, imm, &ex->regfile_in, &mem->alu_out, &ex->pred, 0);
+
+        //Calculate register write value
+        rd_din = ex->regfile_in.rd_din;
+        if(!(opcode == SB_TYPE || opcode == S_TYPE)){
+            if(opcode == UJ_TYPE || opcode == I_J_TYPE)
+                rd_din = pc_curr + ex->len;
+            else if(opcode == U_LU_TYPE)
+                rd_din = imm;
+            else if(opcode == U_AU_TYPE)
+                rd_din = pc_curr + imm;
+            else if(m_ext)
+                rd_din = muldiv(ex->alu_in.in1, ex->alu_in.in2, func3);
+            else if(opcode == R_TYPE || opcode == I_R_TYPE){
+                if(func3 == F3_SLT){
+                    rd_din = mem->alu_out.sign ? 1 : 0;
+                }
+                else if(func3 == F3_SLTU){
+                    rd_din = mem->alu_out.ucmp ? 1 : 0;
+                }
+                else
+                    rd_din = mem->alu_out.result;
             }
-            else if (opcode == SB_TYPE){
-                imm = 0;
-                imm = imm | ((imem_out.dout >> 31) & 0x1) << 12;
-                imm = imm | ((imem_out.dout >> 25) & 0x3F) << 5;
-                imm = imm | ((imem_out.dout >> 8) & 0xF) << 1;
-                imm = imm | ((imem_out.dout >> 7) & 0x1) << 11;
-
-                // When the input is a negative number
-                if(imm & 0x1000)
-                    imm = imm | 0xFFFFE000;
-
-                alu_in.in2 = regfile_out.rs2_dout;
+            else if(opcode == I_L_TYPE){
+                // Loaded value is selected in WB
+                rd_din = 0;
             }
-            else if (opcode == S_TYPE){
-                imm = 0;
-                imm = imm | ((imem_out.dout >> 7) & 0x1F);
-                imm = imm | ((imem_out.dout >> 25) & 0x7F) << 5;
-                //Input is a negative number
-                if(imm & 0x800)
-                    imm = imm | 0xFFFFF000;
-                alu_in.in2 = imm;
+            else if(opcode == SYSTEM_TYPE && (func3 & 0x3)){
+                // The CSRs are read and written here, the instruction
+                // in the MEM/WB register has not retired yet
+                uint64_t count[HPM_NUM];
+
+                sim_csr_count(sim, sim->wb.enable, count);
+                rd_din = csr_op(&sim->csr, count, imm, func3, ex->regfile_in.rs1, ex->alu_in.in1);
             }
             else
-                alu_in.in2 = regfile_out.rs2_dout;
-
-            D_PRINTF("ID", "[I]imm - %d", imm);
-
-            //Hazard Detection Unit
-            if(mem.opcode == I_L_TYPE){
-                if(mem.regfile_in.rd == regfile_in.rs1 || 
-                        mem.regfile_in.rd == regfile_in.rs2){
-                    D_PRINTF("ID", "Hazard Detect: [%x]", mem.pc_curr);
-                    //id_stall = 1;
-                    if_stall = 1;
-                    //pre_pc_write = 0;
-                    pc_write = 0;
-                    hazard_cnt++;
-                }
-            }
-
-            // Update pipeline register
-            ex.enable = 1;
-            ex.pc_curr = pc_curr;
-            ex.opcode = opcode;
-            ex.imm = imm;
-            ex.func3 = func3;
-            ex.func7 = func7;
-            ex.alu_in = alu_in; 
-            ex.regfile_in = regfile_in;
-            ex.regfile_out = regfile_out;
-        }
-        else{
-            ex.enable = 0;
-            if_stall = 0;
+                rd_din = mem->alu_out.result;
         }
 
-		// Instruction fetch stage
-        if(pc_write){
-            D_PRINTF("IF", "PC - ****************************");
-            pc_curr = pc_next;
-
-            D_PRINTF("IF", "pc_curr : %X", pc_curr);
-            imem_in.addr = pc_curr;
-
-            imem_out = imem(imem_in, imem_data);
-            D_PRINTF("IF", "imem_out.dout: 0x%08X", imem_out.dout);
-
-            // Program counter
-
-            // Handle the flush signal
-            if(branch_taken){
-                //Flush
-                id_flush = 1;
-                if_flush = 1;
-
-                branch_taken = 0;
-				branch_cnt++;
+        D_PRINTF("EX", "branch_taken - %d", sim->branch_taken);
+        D_PRINTF("EX", "[I]rd_din - %d", rd_din);
+        D_PRINTF("EX", "[I]result - %d", mem->alu_out.result);
+        D_PRINTF("EX", "[I]zero - %d", mem->alu_out.zero);
+        D_PRINTF("EX", "[I]sign - %d", mem->alu_out.sign);
+
+        // Update pipeline register, alu_out is already in place
+        mem->enable = 1;
+        mem->pc_curr = pc_curr;
+        mem->opcode = opcode;
+        mem->imm = imm;
+        mem->func3 = func3;
+        mem->regfile_in = ex->regfile_in;
+        mem->regfile_in.rd_din = rd_din;
+        //Not use in this stage
+        mem->regfile_out = ex->regfile_out;
+    }
+    else{
+        mem->enable = 0;
+        mem->cause = ex->enable ? CPI_BRANCH : ex->cause;
+    }
+}
 
-                D_PRINTF("PC", "Take branch");
-            }
-            else{
-                //Not taken
-                pc_next = pc_curr + 4;
-                id_flush = 0;
-                if_flush = 0;
-            }
+// Instruction decode stage
+static void stage_id(struct sim_t *sim) {
+	struct pipe_if_id_t *id = &sim->id;
+	struct pipe_id_ex_t *ex = &sim->ex;
+	struct pipe_mem_wb_t *wb = &sim->wb;
 
-            D_PRINTF("PC", "pc_next : %X", pc_next);
+	struct regfile_input_t *regfile_in = &ex->regfile_in;
+	struct alu_input_t *alu_in = &ex->alu_in;
+	struct alu_output_t alu_out;
+	const struct uop_t *uop;
+	uint32_t pc_curr;
+	uint8_t opcode;
+	uint32_t imm;
 
-            // Update pipeline register
-            id.enable = 1;
-            id.pc_curr = pc_curr;
-            id.imem_out= imem_out;
+    // MEM is stalled, the ID/EX register is kept
+    if(sim->if_stall)
+        return;
+    sim->sb.tick++;
+
+    if(id->enable && !sim->if_flush){
+        D_PRINTF("ID", "PC - ************[%x]************", id->pc_curr);
+
+        // Get data from pipeline register
+        pc_curr = id->pc_curr;
+
+        // Main logic, the ID/EX register is filled in place
+        uop = &sim->uop_table[(pc_curr - sim->imem_base)/PARCEL_SIZE];
+        opcode = uop->opcode;
+        imm = uop->imm;
+        D_PRINTF("ID", "[I]opcode- %x", opcode);
+
+        regfile_in->rs1 = uop->rs1;
+        D_PRINTF("ID", "[I]rs1 - %d", regfile_in->rs1);
+        regfile_in->rs2 = uop->rs2;
+        D_PRINTF("ID", "[I]rs2 - %d", regfile_in->rs2);
+        regfile_in->rd = uop->rd;
+        D_PRINTF("ID", "[I]rd - %d", regfile_in->rd);
+        regfile_in->rd_din = 0;
+
+        // Register Read
+        regfile_read(sim->reg_data, regfile_in, &ex->regfile_out);
+
+        D_PRINTF("ID", "[O]rs1_dout - %d", ex->regfile_out.rs1_dout);
+        if (uop->src_mask & SRC_RS2)
+            D_PRINTF("ID", "[O]rs2_dout - %d", ex->regfile_out.rs2_dout);
+
+        alu_in->in1 = ex->regfile_out.rs1_dout;
+        alu_in->alu_control = uop->alu_control;
+
+        // Second ALU operand: immediate except for R-type and branches
+        if (opcode == I_L_TYPE || opcode == I_R_TYPE || opcode == I_J_TYPE
+                || opcode == SYSTEM_TYPE || opcode == S_TYPE)
+            alu_in->in2 = imm;
+        else
+            alu_in->in2 = ex->regfile_out.rs2_dout;
+
+        D_PRINTF("ID", "[I]imm - %d", imm);
+
+        //Hazard Detection Unit
+        //A source whose newest writer is too close ahead for the bypass
+        //network keeps the instruction in ID, a bubble goes to EX.
+        //Behind a branch EX redirected this cycle the instruction is
+        //on the wrong path and only goes on to be flushed.
+        //A branch or jump whose sources cannot reach the comparator in
+        //ID yet goes on to resolve in EX, so it never waits longer than
+        //without the comparator.
+        struct scoreboard_t *sb = &sim->sb;
+        uint8_t early = (sim->fwd->paths & FWD_MEM_ID)
+                && (opcode == SB_TYPE || opcode == UJ_TYPE || opcode == I_J_TYPE)
+                && !((uop->src_mask & SRC_RS1) && sb_wait(sb, sim->fwd, regfile_in->rs1, FWD_USE_ID))
+                && !((uop->src_mask & SRC_RS2) && sb_wait(sb, sim->fwd, regfile_in->rs2, FWD_USE_ID));
+        uint8_t wrong_path = sim->branch_taken;
+        int8_t raw = -1;
+        if(!wrong_path){
+            if((uop->src_mask & SRC_RS1)
+                    && sb_wait(sb, sim->fwd, regfile_in->rs1, early ? FWD_USE_ID : FWD_USE_EX))
+                raw = regfile_in->rs1;
+            if((uop->src_mask & SRC_RS2)
+                    && sb_wait(sb, sim->fwd, regfile_in->rs2,
+                        opcode == S_TYPE ? FWD_USE_STORE : early ? FWD_USE_ID : FWD_USE_EX))
+                raw = regfile_in->rs2;
         }
-        else{
-            pc_write = 1;
+        if(raw >= 0){
+            D_PRINTF("ID", "Hazard Detect: [%x]", sb->pc[raw]);
+            sim->pc_write = 0;
+            sim->hazard_cnt++;
+            if(sb->late[raw])
+                sim->mul_stall_cnt++;
+            if(sim->prof)
+                sim->prof->load_use[prof_idx(sim->prof, sb->pc[raw])]++;
+        }
+        else if(!wrong_path){
+            // a multiply is pipelined, its consumers wait for the result
+            if(!(opcode == SB_TYPE || opcode == S_TYPE))
+                sb_write(sb, regfile_in->rd, pc_curr, opcode == I_L_TYPE,
+                        (opcode == R_TYPE && uop->func7 == F7_MULDIV && !muldiv_is_div(uop->func3))
+                        ? sim->cfg.muldiv.mul - 1 : 0);
+
+            // Comparator in ID, fed by the register file and by the
+            // result in EX/MEM (the instruction now in the MEM/WB register)
+            if(early){
+                if(wb->enable && !(wb->opcode == SB_TYPE || wb->opcode == S_TYPE) && wb->regfile_in.rd){
+                    if(wb->regfile_in.rd == regfile_in->rs1)
+                        alu_in->in1 = wb->regfile_in.rd_din;
+                    if(wb->regfile_in.rd == regfile_in->rs2 && opcode == SB_TYPE)
+                        alu_in->in2 = wb->regfile_in.rd_din;
+                }
+                alu(alu_in, &alu_out);
+                pipe_resolve(sim, pc_curr, uop->len, opcode, uop->func3, imm, regfile_in, &alu_out, &id->pred, 1);
+            }
         }
 
-        // Print state
-		//for(int i = 0; i < REG_WIDTH; i++){
-		for(int i = 0; i < 32; i++){
-			printf("reg[%02d]: %08X\n", i, reg_data[i]);
-		}
-		printf("\n");
-		for(int i = 0; i < 40; i += 4){
-			printf("dmem[%02d]: ", i);
-			for(int j = 3; j >= 0; j--)
-				printf("%02X", dmem_data[i+j]);
-			printf("\n");
-		}
-		
-		cc++;
-	}
-
-    // Result
-    printf("Hazard count : %d\n", hazard_cnt);
-    printf("Branch count : %d\n", branch_cnt);
-    printf("Instruction count : %d\n", inst_cnt);
-
-	free(reg_data);
-	free(imem_data);
-	free(dmem_data);
-
-
-	return 1;
-}
-
-struct imem_output_t imem(struct imem_input_t imem_in, uint32_t *imem_data) {
-	
-	struct imem_output_t imem_out;
-
-	imem_out.dout = imem_data[imem_in.addr/4];
-
-	return imem_out;
+        // Update pipeline register
+        ex->enable = raw < 0;
+        ex->cause = raw < 0 ? CPI_RAW : sb->late[raw] ? CPI_MULDIV
+                : ((sb->load >> raw) & 1) ? CPI_LOAD_USE : CPI_RAW;
+        ex->pc_curr = pc_curr;
+        ex->pred = id->pred;
+        ex->opcode = opcode;
+        ex->imm = imm;
+        ex->func3 = uop->func3;
+        ex->func7 = uop->func7;
+        ex->len = uop->len;
+        ex->resolved = early && raw < 0;
+    }
+    else{
+        ex->enable = 0;
+        ex->cause = id->enable ? CPI_BRANCH : id->cause;
+    }
 }
 
-struct regfile_output_t regfile(struct regfile_input_t regfile_in, uint32_t *reg_data, enum REG regwrite){
+// Instruction fetch stage. Aligned imem words go into a fetch buffer
+// that realigns them, ID gets one 16- or 32-bit instruction per cycle.
+// A word is only read when the buffer lacks part of the instruction
+// at pc, so a 32-bit instruction straddling two words right after a
+// redirect takes two cycles.
+static void stage_if(struct sim_t *sim) {
+	struct pipe_if_id_t *id = &sim->id;
 
-	struct regfile_output_t regfile_out;
+	struct imem_input_t imem_in;
+	uint32_t pc_curr, fetch_off;
+	uint8_t need = 0, fill;
 
-	if(regwrite == READ){
-		regfile_out.rs1_dout = reg_data[regfile_in.rs1];
-		if(regfile_in.rs2 < REG_WIDTH)
-			regfile_out.rs2_dout = reg_data[regfile_in.rs2];
-	}
-	else if(regwrite == WRITE){
-		reg_data[regfile_in.rd] = regfile_in.rd_din;
-	}
+    if(sim->pc_write){
+        D_PRINTF("IF", "PC - ****************************");
+        pc_curr = sim->pc_next;
 
-	return regfile_out;
-}
+        D_PRINTF("IF", "pc_curr : %X", pc_curr);
+        fetch_off = pc_curr - sim->imem_base;
 
-struct alu_output_t alu(struct alu_input_t alu_in){
+        // PC left the loaded image, or sim_drain(): fetch bubbles until the pipeline drains
+        uint8_t fetch_valid = !sim->drain && (fetch_off / 4) < sim->imem_size;
 
-	struct alu_output_t alu_out;
+        // a redirect drops a fetch still waiting on the I-cache, and the buffer
+        if(sim->branch_taken){
+            sim->if_wait = 0;
+            sim->if_busy = 0;
+            sim->fb_fill = 0;
+        }
+        fill = sim->fb_fill;
+
+        // parcels of the instruction at pc, told by the low bits of the first
+        // one, and the word after the buffer
+        if(fetch_valid)
+            need = rvc_is_compressed(sim->imem_data[fetch_off / WORD_SIZE] >> (fetch_off & 2) * 8) ? 1 : 2;
+        fetch_off += fill * PARCEL_SIZE;
+        imem_in.addr = fetch_off & ~(WORD_SIZE - 1);
+        uint8_t fetch_read = fetch_valid && fill < need;
+
+        // I-cache miss: the fetch is repeated until the line arrives
+        uint8_t fetch_wait = 0;
+        if(fetch_read && sim->icache){
+            if(!sim->if_busy){
+                sim->if_wait = cache_access(sim->icache, sim->imem_base + imem_in.addr, 0) - 1;
+                sim->if_busy = 1;
+            }
+            if(sim->if_wait){
+                D_PRINTF("IF", "I-cache wait %d", sim->if_wait);
+                sim->if_wait--;
+                fetch_wait = 1;
+            }
+            else
+                sim->if_busy = 0;
+        }
 
-	alu_out.zero = 1;
-	alu_out.sign = 1;
-	alu_out.ucmp = 0;
-
-	switch(alu_in.alu_control){
-		case C_AND:
-			alu_out.result = alu_in.in1 & alu_in.in2;
-			break;
-		case C_OR:
-			alu_out.result = alu_in.in1 | alu_in.in2;
-			break;
-		case C_XOR:
-			alu_out.result = alu_in.in1 ^ alu_in.in2;
-			break;
-		case C_SL:
-			alu_out.result = alu_in.in1 << (int32_t)alu_in.in2;
-			break;
-		case C_SR:
-			alu_out.result = alu_in.in1 >> (int32_t)alu_in.in2;
-			break;
-		case C_SRA:
-			alu_out.result = (int32_t)alu_in.in1 >> (int32_t)alu_in.in2;
-			break;
-		case C_SUB:
-			alu_out.result = (int32_t)alu_in.in1 - (int32_t)alu_in.in2;
-			break;
-		default:
-			alu_out.result = (int32_t)alu_in.in1 + (int32_t)alu_in.in2;
-			break;
-	}
+        // The IF/ID register is filled in place
+        id->imem_out.dout = 0;
+        memset(&id->pred, 0, sizeof(id->pred));
+        if(fetch_read && !fetch_wait){
+            // past the last word reads as zero, like imem_parcel()
+            if(imem_in.addr / WORD_SIZE < sim->imem_size)
+                imem(&imem_in, &id->imem_out, sim->imem_data);
+            D_PRINTF("IF", "imem_out.dout: 0x%08X", id->imem_out.dout);
+            fill += (WORD_SIZE - (fetch_off & (WORD_SIZE - 1))) / PARCEL_SIZE;
+            sim->fetch_words++;
+        }
+        uint8_t fetch_split = fetch_valid && !fetch_wait && fill < need;
+        uint8_t fetch_ok = fetch_valid && !fetch_wait && !fetch_split;
+        if(fetch_ok){
+            sim->fetch_insts++;
+            if(need == 1)
+                sim->fetch_rvc++;
+        }
 
-	//does not handle the case of sign = 1 when result is zero
-	if(alu_out.result)
-		alu_out.zero = 0;
-	if((int32_t)alu_out.result > 0)
-		alu_out.sign = 0;
-	if(alu_in.in1 < alu_in.in2)
-		alu_out.ucmp = 1; 
+        // Program counter
 
-	return alu_out;
-}
+        // Handle the flush signal
+        if(sim->branch_taken){
+            //Flush, the branch itself is in EX when it resolved in ID
+            sim->id_flush = !sim->branch_early;
+            sim->if_flush = 1;
 
-uint8_t alu_control_gen(uint8_t opcode, uint8_t func3, uint8_t func7){
-
-	if(opcode == I_L_TYPE || opcode == S_TYPE)
-		return C_ADD;
-	else if(opcode == SB_TYPE)
-		return C_SUB;
-	else {
-		switch(func3){
-		//Arithmetic & Shifts
-			case F3_SL:
-				return C_SL;
-			case F3_ADD_SUB:
-				if(((func7 >> 5) & 1))
-					return C_SUB;
-				else
-					return C_ADD;
-			case F3_SR:
-				if(((func7 >> 5) & 1))
-					return C_SRA;
-				else
-					return C_SR;
-			case F3_XOR:
-				return C_XOR;
-			case F3_OR:
-				return C_OR;
-			case F3_AND:
-				return C_AND;
-			case F3_SLT:
-			case F3_SLTU:
-				return C_SUB;
-		}
-	}
-    //For Error case
-    return 0b1111;
-}
+            sim->branch_taken = 0;
+            sim->branch_cnt++;
+            // the target is fetched again next cycle
+            fill = 0;
 
-struct dmem_output_t dmem(struct dmem_input_t dmem_in, uint8_t *dmem_data) {
-	struct dmem_output_t dmem_out;
-
-	if(dmem_in.mem_read){
-		switch(dmem_in.func3){
-			case LB:
-			case LBU:
-				dmem_out.dout = dmem_data[dmem_in.addr];
-				//Negative number
-				if(dmem_in.func3 == LB && dmem_out.dout & 0x80)
-					dmem_out.dout |= 0xFFFFFF00;
-				break;
-			case LH:
-			case LHU:
-				dmem_out.dout = dmem_data[dmem_in.addr];
-				dmem_out.dout |= dmem_data[dmem_in.addr+1] << BYTE_BIT;
-				//Negative number
-				if(dmem_in.func3 == LH && dmem_out.dout & 0x8000)
-					dmem_out.dout |= 0xFFFF0000;
-				break;
-			case LW:
-				dmem_out.dout = dmem_data[dmem_in.addr];
-				dmem_out.dout |= dmem_data[dmem_in.addr+1] << BYTE_BIT;
-				dmem_out.dout |= dmem_data[dmem_in.addr+2] << BYTE_BIT*2;
-				dmem_out.dout |= dmem_data[dmem_in.addr+3] << BYTE_BIT*3;
-				break;
-		}
-				D_PRINTF("MEM", "Read : %x", dmem_out.dout);
-	}
-	if(dmem_in.mem_write){
-		switch(dmem_in.func3){
-			case SB:
-				dmem_data[dmem_in.addr] = (uint8_t)dmem_in.din;
-				break;
-			case SH:
-				dmem_data[dmem_in.addr] = (uint8_t)dmem_in.din;
-				dmem_data[dmem_in.addr+1] = (uint8_t)(dmem_in.din >> BYTE_BIT);
-				break;
-			case SW:
-				dmem_data[dmem_in.addr] = (uint8_t)dmem_in.din;
-				dmem_data[dmem_in.addr+1] = (uint8_t)(dmem_in.din >> BYTE_BIT);
-				dmem_data[dmem_in.addr+2] = (uint8_t)(dmem_in.din >> BYTE_BIT*2);
-				dmem_data[dmem_in.addr+3] = (uint8_t)(dmem_in.din >> BYTE_BIT*3);
-				break;
-		}
-				D_PRINTF("MEM", "Write : %08X", *(uint32_t*)(&dmem_data[dmem_in.addr]));
-	}
+            D_PRINTF("PC", "Take branch");
+        }
+        else{
+            //Not taken
+            if(fetch_wait){
+                sim->icache_stall_cnt++;
+                if(sim->prof)
+                    sim->prof->icache[prof_idx(sim->prof, pc_curr)]++;
+            }
+            else if(fetch_ok){
+                fill -= need;
+                sim->pc_next = pc_curr + need * PARCEL_SIZE;
+                if(sim->bpred->active){
+                    id->pred = bpred_predict(sim->bpred, pc_curr,
+                            &sim->uop_table[(pc_curr - sim->imem_base) / PARCEL_SIZE]);
+                    sim->pc_next = id->pred.target;
+                    // the rest of the buffer is past a predicted taken branch
+                    if(id->pred.taken)
+                        fill = 0;
+                }
+            }
+            sim->id_flush = 0;
+            sim->if_flush = 0;
+        }
 
-	return dmem_out;
+        D_PRINTF("PC", "pc_next : %X", sim->pc_next);
+
+        // Update pipeline register
+        id->enable = fetch_ok;
+        id->cause = sim->if_flush ? CPI_BRANCH : fetch_wait ? CPI_ICACHE : fetch_split ? CPI_STRUCT : CPI_EMPTY;
+        id->pc_curr = pc_curr;
+        sim->fb_fill = fill;
+    }
+    else{
+        sim->pc_write = 1;
+    }
 }
@@ -0,0 +1,140 @@
+/* **************************************
+ * Module: worker thread pool with work stealing
+ *
+ * **************************************
+ */
+#include <pthread.h>
+#include <unistd.h>
+#include "rv32i_pool.h"
+
+struct pool_deque_t {
+	pthread_mutex_t lock;
+	uint32_t head;	// next task of the owner
+	uint32_t tail;	// one past the last task, thieves take tail-1
+} __attribute__((aligned(64)));
+
+struct pool_t {
+	struct pool_deque_t *deque;
+	uint32_t n_workers;
+	void (*task)(void *arg, uint32_t worker, uint32_t idx);
+	void *arg;
+};
+
+struct pool_worker_t {
+	struct pool_t *pool;
+	uint32_t id;
+};
+
+static int pool_pop(struct pool_deque_t *dq, uint32_t *idx) {
+	int ret = 0;
+
+	pthread_mutex_lock(&dq->lock);
+	if(dq->head < dq->tail){
+		*idx = dq->head++;
+		ret = 1;
+	}
+	pthread_mutex_unlock(&dq->lock);
+
+	return ret;
+}
+
+static int pool_steal(struct pool_deque_t *dq, uint32_t *idx) {
+	int ret = 0;
+
+	pthread_mutex_lock(&dq->lock);
+	if(dq->head < dq->tail){
+		*idx = --dq->tail;
+		ret = 1;
+	}
+	pthread_mutex_unlock(&dq->lock);
+
+	return ret;
+}
+
+static void *pool_worker(void *p) {
+	struct pool_worker_t *w = (struct pool_worker_t*)p;
+	struct pool_t *pool = w->pool;
+	uint32_t idx = 0, victim;
+
+	for(;;){
+		if(pool_pop(&pool->deque[w->id], &idx)){
+			pool->task(pool->arg, w->id, idx);
+			continue;
+		}
+
+		// Own deque is empty, tasks are never added so
+		// one empty round over the others means done
+		for(victim = 1; victim < pool->n_workers; victim++){
+			if(pool_steal(&pool->deque[(w->id + victim) % pool->n_workers], &idx))
+				break;
+		}
+		if(victim == pool->n_workers)
+			break;
+		pool->task(pool->arg, w->id, idx);
+	}
+
+	return NULL;
+}
+
+uint32_t pool_default_workers(void) {
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	return n > 0 ? (uint32_t)n : 1;
+}
+
+int pool_run(uint32_t n_tasks, uint32_t n_workers,
+		void (*task)(void *arg, uint32_t worker, uint32_t idx), void *arg) {
+	struct pool_t pool;
+	struct pool_worker_t *worker;
+	pthread_t *thread;
+	uint32_t i, n_started;
+	int ret = 0;
+
+	if(n_tasks == 0)
+		return 0;
+	if(n_workers == 0)
+		n_workers = pool_default_workers();
+	if(n_workers > n_tasks)
+		n_workers = n_tasks;
+
+	pool.n_workers = n_workers;
+	pool.task = task;
+	pool.arg = arg;
+	pool.deque = (struct pool_deque_t*)aligned_alloc(64, n_workers*sizeof(struct pool_deque_t));
+	worker = (struct pool_worker_t*)malloc(n_workers*sizeof(struct pool_worker_t));
+	thread = (pthread_t*)malloc(n_workers*sizeof(pthread_t));
+	if(pool.deque == NULL || worker == NULL || thread == NULL){
+		printf("Out of host memory!!\n");
+		ret = -1;
+		goto out;
+	}
+
+	// contiguous slices keep neighbouring tasks on one worker
+	for(i = 0; i < n_workers; i++){
+		pthread_mutex_init(&pool.deque[i].lock, NULL);
+		pool.deque[i].head = (uint64_t)n_tasks * i / n_workers;
+		pool.deque[i].tail = (uint64_t)n_tasks * (i+1) / n_workers;
+		worker[i].pool = &pool;
+		worker[i].id = i;
+	}
+
+	// worker 0 runs on the calling thread, the tasks of a
+	// worker that failed to start get stolen
+	for(n_started = 1; n_started < n_workers; n_started++){
+		if(pthread_create(&thread[n_started], NULL, pool_worker, &worker[n_started]))
+			break;
+	}
+	pool_worker(&worker[0]);
+	for(i = 1; i < n_started; i++)
+		pthread_join(thread[i], NULL);
+
+	for(i = 0; i < n_workers; i++)
+		pthread_mutex_destroy(&pool.deque[i].lock);
+
+out:
+	free(pool.deque);
+	free(worker);
+	free(thread);
+
+	return ret;
+}
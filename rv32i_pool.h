@@ -0,0 +1,24 @@
+/* **************************************
+ * Module: worker thread pool with work stealing
+ *
+ * The tasks 0..n_tasks-1 are split into one deque per
+ * worker. A worker takes tasks from the front of its own
+ * deque and, once it is empty, steals from the back of
+ * the others, so long tasks do not leave cores idle.
+ *
+ * **************************************
+ */
+#ifndef RV32I_POOL_H
+#define RV32I_POOL_H
+
+#include "rv32i.h"
+
+uint32_t pool_default_workers(void);
+
+// Calls task(arg, worker, idx) once for every idx, worker is
+// 0..n_workers-1 (0: one per online cpu). Returns when all are done,
+// -1 without running any task when the pool cannot be allocated.
+int pool_run(uint32_t n_tasks, uint32_t n_workers,
+		void (*task)(void *arg, uint32_t worker, uint32_t idx), void *arg);
+
+#endif
@@ -0,0 +1,255 @@
+/* **************************************
+ * Module: per-pc profiler of the pipeline
+ *
+ * **************************************
+ */
+#include "rv32i_prof.h"
+#include "rv32i_sim.h"
+
+struct prof_rank_t {
+	uint32_t idx;
+	uint32_t end;	// basic blocks: last entry
+	uint32_t cnt;	// basic blocks: static instructions
+	uint64_t key;
+	uint64_t insts;
+};
+
+struct prof_t *prof_create(uint32_t base, uint32_t size) {
+	struct prof_t *prof;
+
+	prof = (struct prof_t*)calloc(1, sizeof(struct prof_t));
+	if(prof == NULL)
+		return NULL;
+
+	prof->base = base;
+	prof->size = size;
+
+	// one more entry takes the events of pcs outside of imem
+	prof->retired = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->load_use = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->flush = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->icache = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->dcache = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->taken = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->not_taken = (uint32_t*)calloc(size + 1, sizeof(uint32_t));
+	prof->leader = (uint8_t*)calloc(size + 1, 1);
+	if(prof->retired == NULL || prof->load_use == NULL || prof->flush == NULL || prof->icache == NULL
+			|| prof->dcache == NULL || prof->taken == NULL || prof->not_taken == NULL || prof->leader == NULL){
+		prof_destroy(prof);
+		return NULL;
+	}
+
+	return prof;
+}
+
+void prof_destroy(struct prof_t *prof) {
+	if(prof == NULL)
+		return;
+	free(prof->retired);
+	free(prof->load_use);
+	free(prof->flush);
+	free(prof->icache);
+	free(prof->dcache);
+	free(prof->taken);
+	free(prof->not_taken);
+	free(prof->leader);
+	free(prof);
+}
+
+void prof_reset(struct prof_t *prof) {
+	uint32_t n = prof->size + 1;
+
+	memset(prof->retired, 0, n*sizeof(uint32_t));
+	memset(prof->load_use, 0, n*sizeof(uint32_t));
+	memset(prof->flush, 0, n*sizeof(uint32_t));
+	memset(prof->icache, 0, n*sizeof(uint32_t));
+	memset(prof->dcache, 0, n*sizeof(uint32_t));
+	memset(prof->taken, 0, n*sizeof(uint32_t));
+	memset(prof->not_taken, 0, n*sizeof(uint32_t));
+	memset(prof->leader, 0, n);
+}
+
+// Cycles charged to entry i
+static uint64_t prof_cycles(const struct prof_t *prof, uint32_t i) {
+	return (uint64_t)prof->retired[i] + prof->load_use[i] + prof->flush[i] + prof->icache[i] + prof->dcache[i];
+}
+
+static int rank_cmp(const void *a, const void *b) {
+	const struct prof_rank_t *x = (const struct prof_rank_t*)a;
+	const struct prof_rank_t *y = (const struct prof_rank_t*)b;
+
+	if(x->key != y->key)
+		return x->key < y->key ? 1 : -1;
+	return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+static uint8_t is_control(uint8_t opcode) {
+	return opcode == SB_TYPE || opcode == UJ_TYPE || opcode == I_J_TYPE || opcode == SYSTEM_TYPE;
+}
+
+// Entry of the instruction after the one at entry i
+static uint32_t prof_next(const struct sim_image_t *image, uint32_t i) {
+	return i + decode_at(image->imem_data, image->imem_size, i).len / PARCEL_SIZE;
+}
+
+// "name+0x10", or "" without symbols
+static const char *prof_where(const struct sim_image_t *image, uint32_t pc, char *buf, size_t len) {
+	const struct sim_sym_t *sym = image ? sim_image_symbol(image, pc) : NULL;
+
+	if(sym == NULL)
+		return "";
+	if(pc == sym->addr)
+		snprintf(buf, len, "%s", sym->name);
+	else
+		snprintf(buf, len, "%s+0x%X", sym->name, pc - sym->addr);
+	return buf;
+}
+
+// Block leaders: jump targets seen at run time, plus the static ones
+static uint8_t *prof_leaders(const struct prof_t *prof, const struct sim_image_t *image) {
+	uint8_t *leader = (uint8_t*)malloc(prof->size + 1);
+
+	if(leader == NULL)
+		return NULL;
+	memcpy(leader, prof->leader, prof->size + 1);
+	leader[0] = 1;
+
+	for(uint32_t i = 0, next; i < prof->size; i = next){
+		struct uop_t uop = decode_at(image->imem_data, image->imem_size, i);
+
+		next = i + uop.len / PARCEL_SIZE;
+		if(!is_control(uop.opcode))
+			continue;
+		leader[next < prof->size ? next : prof->size] = 1;
+		if(uop.opcode == SB_TYPE || uop.opcode == UJ_TYPE){
+			uint32_t t = prof_idx(prof, prof->base + i*PARCEL_SIZE + uop.imm);
+			leader[t] = 1;
+		}
+	}
+
+	return leader;
+}
+
+void prof_report(FILE *f, const struct prof_t *prof, const struct sim_image_t *image, uint32_t top) {
+	struct prof_rank_t *rank;
+	uint8_t *leader;
+	uint64_t total_insts = 0, total_cycles = 0;
+	uint32_t n, i;
+	char where[128];
+
+	rank = (struct prof_rank_t*)malloc((prof->size + 1)*sizeof(struct prof_rank_t));
+	leader = prof_leaders(prof, image);
+	if(rank == NULL || leader == NULL){
+		free(rank);
+		free(leader);
+		return;
+	}
+
+	for(i = 0; i < prof->size; i++){
+		total_insts += prof->retired[i];
+		total_cycles += prof_cycles(prof, i);
+	}
+	for(n = 0, i = 0; i < prof->size; i = prof_next(image, i))
+		n++;
+	fprintf(f, "Profile : %llu instructions, %llu cycles charged to %u static instructions\n",
+			(unsigned long long)total_insts, (unsigned long long)total_cycles, n);
+
+	// Hotspots
+	for(n = 0, i = 0; i < prof->size; i++){
+		if(prof_cycles(prof, i) == 0)
+			continue;
+		rank[n].idx = i;
+		rank[n].key = prof_cycles(prof, i);
+		n++;
+	}
+	qsort(rank, n, sizeof(struct prof_rank_t), rank_cmp);
+
+	fprintf(f, "\nHotspots (cycles = retired + stall cycles charged to the pc)\n");
+	fprintf(f, "%-10s %-8s %10s %10s %6s %9s %9s %9s %9s %10s %10s  %s\n", "pc", "inst", "cycles", "retired", "%",
+			"load_use", "flush", "icache", "dcache", "taken", "not_taken", "symbol");
+	for(i = 0; i < n && i < top; i++){
+		uint32_t k = rank[i].idx;
+		uint32_t inst = imem_parcel(image->imem_data, image->imem_size, k);
+		char raw[12];
+
+		// compressed instructions as their 4 hex digits
+		snprintf(raw, sizeof(raw), "%0*X", rvc_is_compressed(inst) ? 4 : 8, inst);
+		fprintf(f, "0x%08X %-8s %10llu %10u %6.2f %9u %9u %9u %9u %10u %10u  %s\n",
+				prof->base + k*PARCEL_SIZE, raw, (unsigned long long)rank[i].key,
+				prof->retired[k], total_cycles ? 100.0 * rank[i].key / total_cycles : 0.0,
+				prof->load_use[k], prof->flush[k], prof->icache[k], prof->dcache[k],
+				prof->taken[k], prof->not_taken[k],
+				prof_where(image, prof->base + k*PARCEL_SIZE, where, sizeof(where)));
+	}
+
+	// Basic blocks: from a leader up to a control instruction or the next leader
+	for(n = 0, i = 0; i < prof->size; ){
+		uint32_t start = i, last, cnt = 0;
+		uint64_t insts = 0, cycles = 0;
+
+		do {
+			insts += prof->retired[i];
+			cycles += prof_cycles(prof, i);
+			last = i;
+			i = prof_next(image, i);
+			cnt++;
+		} while(i < prof->size && !leader[i]
+				&& !is_control(decode_at(image->imem_data, image->imem_size, last).opcode));
+
+		if(insts == 0)
+			continue;
+		rank[n].idx = start;
+		rank[n].end = last;
+		rank[n].cnt = cnt;
+		rank[n].key = cycles;
+		rank[n].insts = insts;
+		n++;
+	}
+	qsort(rank, n, sizeof(struct prof_rank_t), rank_cmp);
+
+	fprintf(f, "\nBasic blocks (%u executed)\n", n);
+	fprintf(f, "%-10s %-10s %6s %10s %12s %12s %6s  %s\n", "start", "end", "insts", "entries",
+			"instructions", "cycles", "%", "symbol");
+	for(i = 0; i < n && i < top; i++){
+		uint32_t k = rank[i].idx;
+		fprintf(f, "0x%08X 0x%08X %6u %10u %12llu %12llu %6.2f  %s\n",
+				prof->base + k*PARCEL_SIZE, prof->base + rank[i].end*PARCEL_SIZE, rank[i].cnt,
+				prof->retired[k], (unsigned long long)rank[i].insts, (unsigned long long)rank[i].key,
+				total_cycles ? 100.0 * rank[i].key / total_cycles : 0.0,
+				prof_where(image, prof->base + k*PARCEL_SIZE, where, sizeof(where)));
+	}
+
+	// Functions, when the image has symbols
+	if(image->sym_cnt){
+		for(n = 0, i = 0; i < image->sym_cnt; i++){
+			const struct sim_sym_t *sym = &image->sym[i];
+			uint64_t insts = 0, cycles = 0;
+			for(uint32_t k = prof_idx(prof, sym->addr); k < prof->size; k++){
+				uint32_t pc = prof->base + k*PARCEL_SIZE;
+				if(sim_image_symbol(image, pc) != sym)
+					break;
+				insts += prof->retired[k];
+				cycles += prof_cycles(prof, k);
+			}
+			if(cycles == 0)
+				continue;
+			rank[n].idx = i;
+			rank[n].key = cycles;
+			rank[n].insts = insts;
+			n++;
+		}
+		qsort(rank, n, sizeof(struct prof_rank_t), rank_cmp);
+
+		fprintf(f, "\nFunctions\n");
+		fprintf(f, "%-24s %12s %12s %6s %6s\n", "symbol", "instructions", "cycles", "CPI", "%");
+		for(i = 0; i < n && i < top; i++){
+			fprintf(f, "%-24s %12llu %12llu %6.2f %6.2f\n", image->sym[rank[i].idx].name,
+					(unsigned long long)rank[i].insts, (unsigned long long)rank[i].key,
+					rank[i].insts ? (double)rank[i].key / rank[i].insts : 0.0,
+					total_cycles ? 100.0 * rank[i].key / total_cycles : 0.0);
+		}
+	}
+
+	free(rank);
+	free(leader);
+}
@@ -0,0 +1,54 @@
+/* **************************************
+ * Module: per-pc profiler of the pipeline
+ *
+ * One flat counter array per event, indexed by the parcel
+ * (halfword) address of the instruction in imem. The pipeline adds to
+ * them where the event happens:
+ *   retired    WB
+ *   load_use   ID, RAW bubbles charged to the producer
+ *   flush      EX or ID, cycles lost to a mispredicted branch/jump
+ *   icache     IF, cycles the fetch of pc waited
+ *   dcache     MEM, cycles the access of pc waited
+ *   taken      EX or ID, control instruction outcome
+ *
+ * Basic blocks are built when the report is written, from
+ * the control instructions of the image and the targets
+ * seen at run time.
+ *
+ * **************************************
+ */
+#ifndef RV32I_PROF_H
+#define RV32I_PROF_H
+
+#include "rv32i.h"
+
+#define PROF_TOP_DEFAULT 20
+
+struct sim_image_t;
+
+struct prof_t {
+	uint32_t base;	// pc of entry 0
+	uint32_t size;	// entries
+
+	uint32_t *retired;
+	uint32_t *load_use;
+	uint32_t *flush;
+	uint32_t *icache;
+	uint32_t *dcache;
+	uint32_t *taken;
+	uint32_t *not_taken;
+	uint8_t *leader;	// reached by a jump at run time
+};
+
+struct prof_t *prof_create(uint32_t base, uint32_t size);
+void prof_destroy(struct prof_t *prof);
+void prof_reset(struct prof_t *prof);
+void prof_report(FILE *f, const struct prof_t *prof, const struct sim_image_t *image, uint32_t top);
+
+// Entry of pc, prof->size when pc is outside of imem
+static inline uint32_t prof_idx(const struct prof_t *prof, uint32_t pc) {
+	uint32_t idx = (pc - prof->base) / PARCEL_SIZE;
+	return idx < prof->size ? idx : prof->size;
+}
+
+#endif
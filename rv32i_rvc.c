@@ -0,0 +1,167 @@
+/* **************************************
+ * Module: compressed (RVC) instruction expansion
+ *
+ * **************************************
+ */
+#include "rv32i_rvc.h"
+
+#define BITS(x, hi, lo) (((x) >> (lo)) & ((1u << ((hi) - (lo) + 1)) - 1))
+
+// Sign extension of the low n bits of v
+static inline uint32_t sext(uint32_t v, int n) {
+	return (uint32_t)((int32_t)(v << (32 - n)) >> (32 - n));
+}
+
+// 32-bit encodings
+static inline uint32_t enc_i(uint32_t imm, uint8_t rs1, uint8_t func3, uint8_t rd, uint8_t opcode) {
+	return (imm & 0xFFF) << 20 | rs1 << 15 | func3 << 12 | rd << 7 | opcode;
+}
+
+static inline uint32_t enc_r(uint8_t func7, uint8_t rs2, uint8_t rs1, uint8_t func3, uint8_t rd) {
+	return func7 << 25 | rs2 << 20 | rs1 << 15 | func3 << 12 | rd << 7 | R_TYPE;
+}
+
+static inline uint32_t enc_s(uint32_t imm, uint8_t rs2, uint8_t rs1, uint8_t func3) {
+	return BITS(imm, 11, 5) << 25 | rs2 << 20 | rs1 << 15 | func3 << 12 | BITS(imm, 4, 0) << 7 | S_TYPE;
+}
+
+static inline uint32_t enc_b(uint32_t imm, uint8_t rs2, uint8_t rs1, uint8_t func3) {
+	return BITS(imm, 12, 12) << 31 | BITS(imm, 10, 5) << 25 | rs2 << 20 | rs1 << 15 | func3 << 12
+		| BITS(imm, 4, 1) << 8 | BITS(imm, 11, 11) << 7 | SB_TYPE;
+}
+
+static inline uint32_t enc_j(uint32_t imm, uint8_t rd) {
+	return BITS(imm, 20, 20) << 31 | BITS(imm, 10, 1) << 21 | BITS(imm, 11, 11) << 20
+		| BITS(imm, 19, 12) << 12 | rd << 7 | UJ_TYPE;
+}
+
+// Quadrant 0: stack-relative addi and the x8-x15 loads and stores
+static uint32_t rvc_q0(uint16_t c) {
+	uint8_t rd = 8 + BITS(c, 4, 2);
+	uint8_t rs1 = 8 + BITS(c, 9, 7);
+	uint32_t off = BITS(c, 12, 10) << 3 | BITS(c, 6, 6) << 2 | BITS(c, 5, 5) << 6;
+
+	switch(BITS(c, 15, 13)){
+		case 0: {	// c.addi4spn
+			uint32_t imm = BITS(c, 12, 11) << 4 | BITS(c, 10, 7) << 6 | BITS(c, 6, 6) << 2 | BITS(c, 5, 5) << 3;
+			if(imm == 0)
+				return RVC_ILLEGAL;
+			return enc_i(imm, 2, F3_ADD_SUB, rd, I_R_TYPE);
+		}
+		case 2:	// c.lw
+			return enc_i(off, rs1, LW, rd, I_L_TYPE);
+		case 6:	// c.sw
+			return enc_s(off, rd, rs1, SW);
+	}
+	return RVC_ILLEGAL;
+}
+
+// Quadrant 1: immediates, x8-x15 ALU operations, jumps and branches
+static uint32_t rvc_q1(uint16_t c) {
+	uint8_t rd = BITS(c, 11, 7);
+	uint8_t rdp = 8 + BITS(c, 9, 7);
+	uint8_t rs2p = 8 + BITS(c, 4, 2);
+	uint32_t imm = sext(BITS(c, 12, 12) << 5 | BITS(c, 6, 2), 6);
+	uint32_t joff = sext(BITS(c, 12, 12) << 11 | BITS(c, 11, 11) << 4 | BITS(c, 10, 9) << 8
+			| BITS(c, 8, 8) << 10 | BITS(c, 7, 7) << 6 | BITS(c, 6, 6) << 7
+			| BITS(c, 5, 3) << 1 | BITS(c, 2, 2) << 5, 12);
+	uint32_t boff = sext(BITS(c, 12, 12) << 8 | BITS(c, 11, 10) << 3 | BITS(c, 6, 5) << 6
+			| BITS(c, 4, 3) << 1 | BITS(c, 2, 2) << 5, 9);
+
+	switch(BITS(c, 15, 13)){
+		case 0:	// c.addi, c.nop
+			return enc_i(imm, rd, F3_ADD_SUB, rd, I_R_TYPE);
+		case 1:	// c.jal
+			return enc_j(joff, 1);
+		case 2:	// c.li
+			return enc_i(imm, 0, F3_ADD_SUB, rd, I_R_TYPE);
+		case 3:
+			if(rd == 2){	// c.addi16sp
+				uint32_t sp = sext(BITS(c, 12, 12) << 9 | BITS(c, 6, 6) << 4 | BITS(c, 5, 5) << 6
+						| BITS(c, 4, 3) << 7 | BITS(c, 2, 2) << 5, 10);
+				if(sp == 0)
+					return RVC_ILLEGAL;
+				return enc_i(sp, 2, F3_ADD_SUB, 2, I_R_TYPE);
+			}
+			if(imm == 0)	// c.lui
+				return RVC_ILLEGAL;
+			return (imm << 12) | rd << 7 | U_LU_TYPE;
+		case 4:
+			switch(BITS(c, 11, 10)){
+				case 0:	// c.srli
+					if(BITS(c, 12, 12))
+						return RVC_ILLEGAL;
+					return enc_i(BITS(c, 6, 2), rdp, F3_SR, rdp, I_R_TYPE);
+				case 1:	// c.srai
+					if(BITS(c, 12, 12))
+						return RVC_ILLEGAL;
+					return enc_i(0x400 | BITS(c, 6, 2), rdp, F3_SR, rdp, I_R_TYPE);
+				case 2:	// c.andi
+					return enc_i(imm, rdp, F3_AND, rdp, I_R_TYPE);
+			}
+			if(BITS(c, 12, 12))
+				return RVC_ILLEGAL;
+			switch(BITS(c, 6, 5)){
+				case 0:	// c.sub
+					return enc_r(0x20, rs2p, rdp, F3_ADD_SUB, rdp);
+				case 1:	// c.xor
+					return enc_r(0, rs2p, rdp, F3_XOR, rdp);
+				case 2:	// c.or
+					return enc_r(0, rs2p, rdp, F3_OR, rdp);
+			}
+			// c.and
+			return enc_r(0, rs2p, rdp, F3_AND, rdp);
+		case 5:	// c.j
+			return enc_j(joff, 0);
+		case 6:	// c.beqz
+			return enc_b(boff, 0, rdp, F3_BEQ);
+	}
+	// c.bnez
+	return enc_b(boff, 0, rdp, F3_BNE);
+}
+
+// Quadrant 2: shifts, stack-relative loads and stores, mv/add and jr/jalr
+static uint32_t rvc_q2(uint16_t c) {
+	uint8_t rd = BITS(c, 11, 7);
+	uint8_t rs2 = BITS(c, 6, 2);
+
+	switch(BITS(c, 15, 13)){
+		case 0:	// c.slli
+			if(BITS(c, 12, 12))
+				return RVC_ILLEGAL;
+			return enc_i(rs2, rd, F3_SL, rd, I_R_TYPE);
+		case 2:	// c.lwsp
+			return enc_i(BITS(c, 12, 12) << 5 | BITS(c, 6, 4) << 2 | BITS(c, 3, 2) << 6, 2, LW, rd, I_L_TYPE);
+		case 4:
+			if(!BITS(c, 12, 12)){
+				if(rs2)	// c.mv
+					return enc_r(0, rs2, 0, F3_ADD_SUB, rd);
+				if(rd == 0)
+					return RVC_ILLEGAL;
+				// c.jr
+				return enc_i(0, rd, 0, 0, I_J_TYPE);
+			}
+			if(rs2)	// c.add
+				return enc_r(0, rs2, rd, F3_ADD_SUB, rd);
+			if(rd == 0)	// c.ebreak
+				return enc_i(IMM_EBREAK, 0, F3_PRIV, 0, SYSTEM_TYPE);
+			// c.jalr
+			return enc_i(0, rd, 0, 1, I_J_TYPE);
+		case 6:	// c.swsp
+			return enc_s(BITS(c, 12, 9) << 2 | BITS(c, 8, 7) << 6, rs2, 2, SW);
+	}
+	return RVC_ILLEGAL;
+}
+
+// The 32-bit instruction c stands for, RVC_ILLEGAL when there is none
+uint32_t rvc_expand(uint16_t c) {
+	switch(c & 0x3){
+		case 0:
+			return rvc_q0(c);
+		case 1:
+			return rvc_q1(c);
+		case 2:
+			return rvc_q2(c);
+	}
+	return RVC_ILLEGAL;
+}
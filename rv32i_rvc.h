@@ -0,0 +1,30 @@
+/* **************************************
+ * Module: compressed (RVC) instruction expansion
+ *
+ * A 16-bit instruction is any parcel whose low two bits are
+ * not 11. Each one is expanded to the 32-bit instruction it
+ * stands for before decode, so the engines and the pipeline
+ * only ever see RV32I/M micro-ops; the uop records the
+ * length for the next pc and the link value.
+ *
+ * Only the RV32C integer subset is expanded. The float
+ * loads and stores and the reserved encodings come out as
+ * RVC_ILLEGAL, which decodes as a nop like every other
+ * unknown instruction.
+ *
+ * **************************************
+ */
+#ifndef RV32I_RVC_H
+#define RV32I_RVC_H
+
+#include "rv32i.h"
+
+#define RVC_ILLEGAL 0
+
+static inline uint8_t rvc_is_compressed(uint32_t parcel) {
+	return (parcel & 0x3) != 0x3;
+}
+
+uint32_t rvc_expand(uint16_t c);
+
+#endif
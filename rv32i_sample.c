@@ -0,0 +1,166 @@
+/* **************************************
+ * Module: sampled simulation (SMARTS)
+ *
+ * **************************************
+ */
+#include <math.h>
+#include "rv32i_sample.h"
+#include "rv32i_config.h"
+
+// Two-sided normal quantiles of the supported confidence levels
+static const struct {
+	double conf;
+	double z;
+} sample_z[] = {
+	{ 90.0, 1.645 },
+	{ 95.0, 1.960 },
+	{ 99.0, 2.576 },
+	{ 99.7, 3.000 },
+};
+
+static double sample_zval(double conf) {
+	for(uint32_t i = 0; i < sizeof(sample_z)/sizeof(sample_z[0]); i++)
+		if(fabs(sample_z[i].conf - conf) < 1e-6)
+			return sample_z[i].z;
+	return 0;
+}
+
+void sample_config_default(struct sample_config_t *cfg) {
+	cfg->ff = 1000000;
+	cfg->warm = 2000;
+	cfg->window = 1000;
+	cfg->max_samples = 0;
+	cfg->conf = 99.7;
+}
+
+static enum CONFIG_OPT sample_option(void *obj, const char *key, const char *val) {
+	struct sample_config_t *cfg = (struct sample_config_t*)obj;
+
+	if(!strcmp(key, "ff"))
+		return config_size(val, &cfg->ff);
+	if(!strcmp(key, "warm"))
+		return config_size(val, &cfg->warm);
+	if(!strcmp(key, "window"))
+		return config_size(val, &cfg->window);
+	if(!strcmp(key, "max"))
+		return config_u32(val, &cfg->max_samples);
+	if(!strcmp(key, "conf"))
+		return config_double(val, &cfg->conf);
+	return CONFIG_UNKNOWN;
+}
+
+// "ff=1M,warm=2000,window=1000,max=N,conf=99.7"
+int sample_config_parse(struct sample_config_t *cfg, const char *str) {
+	if(config_spec_parse(str, "sample", 0, sample_option, cfg))
+		return -1;
+
+	if(cfg->window == 0){
+		printf("Sample window must be at least one instruction\n");
+		return -1;
+	}
+	if(sample_zval(cfg->conf) == 0){
+		printf("Confidence %g%% is not one of 90, 95, 99, 99.7\n", cfg->conf);
+		return -1;
+	}
+
+	return 0;
+}
+
+// Pipeline until n more instructions retired, at most one retires per cycle
+static enum HALT sample_pipe(struct sim_t *sim, uint64_t n) {
+	uint32_t start = sim->inst_cnt;
+	uint32_t done;
+
+	while(!sim->halt && (done = sim->inst_cnt - start) < n)
+		sim_run_until(sim, sim->cc + (uint32_t)(n - done));
+
+	return sim->halt;
+}
+
+enum HALT sample_run(struct sim_t *sim, const struct sample_config_t *cfg, struct sample_result_t *res) {
+	double sum = 0, sum_sq = 0;
+	uint32_t inst0 = sim->inst_cnt;
+
+	memset(res, 0, sizeof(*res));
+	res->z = sample_zval(cfg->conf);
+
+	while(!sim->halt && (cfg->max_samples == 0 || res->samples < cfg->max_samples)){
+		uint64_t cpi0[CPI_NUM], retired0[RC_NUM];
+		uint32_t cc0, insts0;
+
+		if(cfg->ff && sim_run_func(sim, cfg->ff, FUNC_NO_PC))
+			break;
+
+		if(sample_pipe(sim, cfg->warm))
+			break;
+
+		cc0 = sim->cc;
+		insts0 = sim->inst_cnt;
+		memcpy(cpi0, sim->cpi, sizeof(cpi0));
+		memcpy(retired0, sim->retired, sizeof(retired0));
+
+		// a window cut short by the end of the program is not a sample
+		if(sample_pipe(sim, cfg->window))
+			break;
+
+		double cpi = (double)(sim->cc - cc0) / (sim->inst_cnt - insts0);
+		sum += cpi;
+		sum_sq += cpi * cpi;
+		res->samples++;
+		res->measured_cycles += sim->cc - cc0;
+		res->measured_insts += sim->inst_cnt - insts0;
+		for(int i = 0; i < CPI_NUM; i++)
+			res->cpi[i] += sim->cpi[i] - cpi0[i];
+		for(int i = 0; i < RC_NUM; i++)
+			res->retired[i] += sim->retired[i] - retired0[i];
+
+		if(sim_drain(sim))
+			break;
+	}
+
+	res->halt = sim->halt;
+	res->detailed_insts = (uint32_t)(sim->inst_cnt - inst0);
+	res->insts = sim->func_inst_cnt + sim->inst_cnt;
+
+	if(res->samples){
+		double n = res->samples;
+		res->cpi_mean = sum / n;
+		if(res->samples > 1){
+			double var = (sum_sq - sum * sum / n) / (n - 1);
+			res->cpi_stddev = var > 0 ? sqrt(var) : 0;
+			res->cpi_ci = res->z * res->cpi_stddev / sqrt(n);
+		}
+	}
+
+	return res->halt;
+}
+
+void sample_print(FILE *f, const struct sample_config_t *cfg, const struct sample_result_t *res) {
+	struct sim_stats_t stats;
+	double cv = res->cpi_mean ? res->cpi_stddev / res->cpi_mean : 0;
+
+	fprintf(f, "Sampling : ff %llu, warm-up %llu, window %llu instructions, %u samples\n",
+			(unsigned long long)cfg->ff, (unsigned long long)cfg->warm,
+			(unsigned long long)cfg->window, res->samples);
+	fprintf(f, "Instructions : %llu, %llu detailed (%.2f%%), %llu measured\n",
+			(unsigned long long)res->insts, (unsigned long long)res->detailed_insts,
+			res->insts ? 100.0 * res->detailed_insts / res->insts : 0.0,
+			(unsigned long long)res->measured_insts);
+	if(res->samples == 0){
+		fprintf(f, "CPI estimate : no complete window\n");
+		return;
+	}
+
+	fprintf(f, "CPI estimate : %.4f +- %.4f (%g%% confidence, +-%.2f%%)\n", res->cpi_mean, res->cpi_ci,
+			cfg->conf, 100.0 * res->cpi_ci / res->cpi_mean);
+	fprintf(f, "Sample CPI : stddev %.4f, coefficient of variation %.4f\n", res->cpi_stddev, cv);
+	if(res->samples > 1)
+		fprintf(f, "Samples for +-3%% at %g%% : %.0f\n", cfg->conf, ceil(pow(res->z * cv / 0.03, 2)));
+	fprintf(f, "Estimated cycles : %.0f\n", res->cpi_mean * res->insts);
+
+	// CPI stack of the measured windows
+	memset(&stats, 0, sizeof(stats));
+	memcpy(stats.cpi, res->cpi, sizeof(stats.cpi));
+	memcpy(stats.retired, res->retired, sizeof(stats.retired));
+	stats_print(f, &stats);
+}
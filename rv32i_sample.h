@@ -0,0 +1,50 @@
+/* **************************************
+ * Module: sampled simulation (SMARTS)
+ *
+ * The run is cut into periods of
+ *   ff      instructions on the functional engine
+ *   warm    instructions on the pipeline, not measured,
+ *           to warm the caches, predictor and pipeline
+ *   window  instructions on the pipeline, measured
+ * after which the pipeline is drained and the next period
+ * starts. Every window gives one CPI sample; their mean is
+ * the CPI estimate and its confidence interval comes from
+ * the sample variance.
+ *
+ * **************************************
+ */
+#ifndef RV32I_SAMPLE_H
+#define RV32I_SAMPLE_H
+
+#include "rv32i_sim.h"
+
+struct sample_config_t {
+	uint64_t ff;	// instructions per period
+	uint64_t warm;
+	uint64_t window;
+	uint32_t max_samples;	// 0: up to the end of the program
+	double conf;	// confidence level, %
+};
+
+struct sample_result_t {
+	uint32_t samples;
+	double cpi_mean;
+	double cpi_stddev;	// of the sample CPIs
+	double cpi_ci;	// half width of the interval at conf
+	double z;
+	uint64_t insts;	// whole run
+	uint64_t detailed_insts;	// warm-up, windows and drains
+	uint64_t measured_insts;
+	uint64_t measured_cycles;
+	uint64_t cpi[CPI_NUM];	// CPI stack over the windows
+	uint64_t retired[RC_NUM];
+	enum HALT halt;
+};
+
+void sample_config_default(struct sample_config_t *cfg);
+int sample_config_parse(struct sample_config_t *cfg, const char *str);
+
+enum HALT sample_run(struct sim_t *sim, const struct sample_config_t *cfg, struct sample_result_t *res);
+void sample_print(FILE *f, const struct sample_config_t *cfg, const struct sample_result_t *res);
+
+#endif
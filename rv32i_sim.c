@@ -0,0 +1,434 @@
+/* **************************************
+ * Module: simulator context and library API
+ *
+ * **************************************
+ */
+#include "rv32i_sim.h"
+
+void sim_config_default(struct sim_config_t *cfg) {
+	cfg->max_cycles = SIM_MAX_CYCLES_DEFAULT;
+	cfg->tohost = TOHOST_NONE;
+	cfg->trace_level = TRACE_NONE;
+	cfg->trace_path = NULL;
+	cfg->echo_load = 0;
+	cfg->mem_base = MEM_BASE_AUTO;
+	cfg->mem_size = MEM_SIZE_DEFAULT;
+	cache_config_default(&cfg->icache);
+	cache_config_default(&cfg->dcache);
+	bpred_config_default(&cfg->bpred);
+	cfg->forward = FWD_BASE;
+	cfg->profile = 0;
+	cfg->mode = MODE_PIPE;
+	cfg->max_insts = 0;
+	cfg->ff_insts = 0;
+	cfg->ff_pc = FUNC_NO_PC;
+	cfg->jit = 0;
+	muldiv_config_default(&cfg->muldiv);
+	ooo_config_default(&cfg->ooo);
+	wide_config_default(&cfg->wide);
+}
+
+struct sim_t *sim_create(const struct sim_config_t *cfg) {
+	struct sim_t *sim;
+
+	// sizeof is a multiple of the alignment of the pipeline registers
+	sim = (struct sim_t*)aligned_alloc(SIM_LINE, sizeof(struct sim_t));
+	if(sim == NULL)
+		return NULL;
+	memset(sim, 0, sizeof(struct sim_t));
+
+	if(cfg)
+		sim->cfg = *cfg;
+	else
+		sim_config_default(&sim->cfg);
+	sim->tohost = sim->cfg.tohost;
+
+	sim->reg_data = (uint32_t*)calloc(32, sizeof(uint32_t));
+	sim->dmem = mem_create(sim->cfg.mem_base == MEM_BASE_AUTO ? 0 : sim->cfg.mem_base,
+			sim->cfg.mem_size);
+	if(sim->reg_data == NULL || sim->dmem == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+
+	if((sim->bpred = bpred_create(&sim->cfg.bpred)) == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+	sim->fwd = fwd_get(sim->cfg.forward);
+	if(sim->cfg.icache.size && (sim->icache = cache_create(&sim->cfg.icache)) == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+	if(sim->cfg.dcache.size && (sim->dcache = cache_create(&sim->cfg.dcache)) == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+	if(sim->cfg.mode == MODE_OOO && (sim->ooo = ooo_create(&sim->cfg.ooo)) == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+	if(sim->cfg.mode == MODE_WIDE && (sim->wide = wide_create(&sim->cfg.wide)) == NULL){
+		sim_destroy(sim);
+		return NULL;
+	}
+
+	sim_reset(sim);
+
+	return sim;
+}
+
+void sim_destroy(struct sim_t *sim) {
+	if(sim == NULL)
+		return;
+	if(sim->trace)
+		trace_close(sim->trace, sim->cc);
+
+	free(sim->reg_data);
+	mem_destroy(sim->dmem);
+	cache_destroy(sim->icache);
+	cache_destroy(sim->dcache);
+	bpred_destroy(sim->bpred);
+	ooo_destroy(sim->ooo);
+	wide_destroy(sim->wide);
+	prof_destroy(sim->prof);
+	jit_destroy(sim->jit);
+	sim_image_free(sim->own_image);
+	free(sim);
+}
+
+// The sim keeps the image and frees it with the next load or sim_destroy
+int sim_own_image(struct sim_t *sim, struct sim_image_t *image) {
+	if(sim_attach_image(sim, image)){
+		sim_image_free(image);
+		return -1;
+	}
+	sim->own_image = image;
+
+	return 0;
+}
+
+int sim_load(struct sim_t *sim, const char *imem_path, const char *dmem_path) {
+	struct sim_image_t *image;
+
+	if ( (image = sim_image_load(imem_path, dmem_path, sim->cfg.echo_load)) == NULL )
+		return -1;
+
+	return sim_own_image(sim, image);
+}
+
+// imem words from address 0, dmem bytes from address 0
+int sim_load_image(struct sim_t *sim, const uint32_t *imem, uint32_t imem_words,
+		const uint8_t *dmem, uint32_t dmem_bytes) {
+	struct sim_image_t *image;
+
+	if ( (image = sim_image_create()) == NULL )
+		return -1;
+
+	if(imem_words > image->imem_cap){
+		free(image->imem_data);
+		image->imem_data = (uint32_t*)malloc(imem_words*sizeof(uint32_t));
+		image->imem_cap = imem_words;
+	}
+	if(image->imem_data == NULL || mem_load(image->dmem, 0, dmem, dmem_bytes)){
+		sim_image_free(image);
+		return -1;
+	}
+	memcpy(image->imem_data, imem, imem_words*sizeof(uint32_t));
+	image->imem_size = imem_words;
+	image->dmem_end = dmem_bytes;
+
+	// decode the instruction memory once
+	image->uop_table = decode_table_create(image->imem_data, imem_words ? imem_words : 1);
+
+	return sim_own_image(sim, image);
+}
+
+// Run on a shared image: imem and the decoded table are used in place,
+// only dmem is copied
+int sim_attach_image(struct sim_t *sim, const struct sim_image_t *image) {
+
+	if(image->uop_table == NULL)
+		return -1;
+
+	sim->dmem->base = (sim->cfg.mem_base == MEM_BASE_AUTO) ? image->dmem_base : sim->cfg.mem_base;
+	if(mem_copy(sim->dmem, image->dmem)){
+		printf("Program does not fit in memory 0x%08X-0x%08llX!!\n", sim->dmem->base,
+				(unsigned long long)sim->dmem->base + sim->dmem->size);
+		mem_clear(sim->dmem);
+		return -1;
+	}
+
+	if(sim->own_image && sim->own_image != image){
+		sim_image_free(sim->own_image);
+		sim->own_image = NULL;
+	}
+	sim->image = image;
+	sim->imem_data = image->imem_data;
+	sim->imem_size = image->imem_size;
+	sim->imem_base = image->imem_base;
+	sim->uop_table = image->uop_table;
+	sim->entry = image->entry;
+	sim->tohost = (sim->cfg.tohost == TOHOST_NONE) ? image->tohost : sim->cfg.tohost;
+
+	if(sim->cfg.profile){
+		prof_destroy(sim->prof);
+		if ( (sim->prof = prof_create(image->imem_base, DECODE_ENTRIES(image->imem_size))) == NULL )
+			return -1;
+	}
+
+	sim_reset(sim);
+
+	return 0;
+}
+
+void sim_reset(struct sim_t *sim) {
+	memset(sim->reg_data, 0, 32*sizeof(uint32_t));
+	sim->reg_data[SIM_REG_HARTID] = sim->hartid;
+
+	sim->pc_next = sim->entry;
+	pipe_reset(sim);
+	if(sim->ooo)
+		ooo_reset(sim->ooo);
+	if(sim->wide)
+		wide_reset(sim->wide);
+
+	sim->hazard_cnt = 0;
+	sim->inst_cnt = 0;
+	sim->branch_cnt = 0;
+	sim->icache_stall_cnt = 0;
+	sim->dcache_stall_cnt = 0;
+	sim->mul_cnt = 0;
+	sim->div_cnt = 0;
+	sim->mul_stall_cnt = 0;
+	sim->div_stall_cnt = 0;
+	sim->fetch_insts = 0;
+	sim->fetch_rvc = 0;
+	sim->fetch_words = 0;
+	sim->taken_cnt = 0;
+	memset(sim->cpi, 0, sizeof(sim->cpi));
+	memset(sim->retired, 0, sizeof(sim->retired));
+	sim->func_inst_cnt = 0;
+	sim->func_sec = 0;
+
+	sim->halt = HALT_NONE;
+	sim->last_retire_pc = 0;
+	sim->pipe_start_inst = 0;
+	sim->tohost_val = 0;
+	sim->fault_pc = 0;
+	sim->fault_addr = 0;
+
+	sim->cc = SIM_CC_START;
+	csr_reset(&sim->csr, sim->hartid);
+
+	if(sim->prof)
+		prof_reset(sim->prof);
+}
+
+// Run up to n cycles of the pipeline, stops early on a halt
+enum HALT sim_step(struct sim_t *sim, uint32_t n) {
+
+	if(sim->trace == NULL && sim->cfg.trace_path){
+		sim->trace = trace_open(sim->cfg.trace_path, sim->cc, sim->reg_data, sim->dmem);
+		if(sim->trace == NULL){
+			printf("Cannot open %s\n", sim->cfg.trace_path);
+			sim->cfg.trace_path = NULL;
+		}
+	}
+
+	for(uint32_t i = 0; i < n && !sim->halt; i++){
+		if(sim->cc >= sim->cfg.max_cycles){
+			sim->halt = HALT_MAX_CYCLES;
+			break;
+		}
+		if(sim->ooo)
+			ooo_cycle(sim);
+		else if(sim->wide)
+			wide_cycle(sim);
+		else
+			pipe_cycle(sim);
+	}
+
+	return sim->halt;
+}
+
+// Run the pipeline until the clock count reaches cycle
+enum HALT sim_run_until(struct sim_t *sim, uint32_t cycle) {
+	if(cycle > sim->cfg.max_cycles)
+		cycle = sim->cfg.max_cycles;
+	if(sim->cc < cycle)
+		sim_step(sim, cycle - sim->cc);
+	if(!sim->halt && sim->cc >= sim->cfg.max_cycles)
+		sim->halt = HALT_MAX_CYCLES;
+
+	return sim->halt;
+}
+
+// Functional execution from pc_next, only while the pipeline is empty
+enum HALT sim_run_func(struct sim_t *sim, uint64_t max_inst, uint32_t stop_pc) {
+	struct func_input_t func_in;
+	struct func_output_t func_out;
+	struct timespec t_start, t_end;
+	uint64_t csr_count[HPM_NUM];
+
+	func_in.pc = sim->pc_next;
+	func_in.max_inst = max_inst;
+	func_in.stop_pc = stop_pc;
+	func_in.tohost = sim->tohost;
+	func_in.imem_base = sim->imem_base;
+	func_in.jit = NULL;
+	sim_csr_count(sim, 0, csr_count);
+	func_in.csr = &sim->csr;
+	func_in.csr_count = csr_count;
+
+	if(sim->cfg.jit && sim->jit == NULL && (sim->jit = jit_create()) == NULL){
+		printf("No JIT on this host, interpreting\n");
+		sim->cfg.jit = 0;
+	}
+	if(sim->jit && jit_bind(sim->jit, sim->reg_data, sim->dmem, sim->imem_data, sim->uop_table,
+			sim->imem_base, sim->imem_size) == 0)
+		func_in.jit = sim->jit;
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	func_out = func_run(func_in, sim->reg_data, sim->dmem, sim->uop_table, sim->imem_size);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	sim->func_sec += (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	sim->func_inst_cnt += func_out.inst_cnt;
+
+	sim->pc_next = func_out.pc;
+	sim->last_retire_pc = func_out.pc;
+	sim->pipe_start_inst = sim->inst_cnt;
+	sim->tohost_val = func_out.tohost_val;
+	sim->halt = func_out.halt;
+	if(sim->halt == HALT_FAULT){
+		sim->fault_pc = func_out.pc;
+		sim->fault_addr = func_out.fault_addr;
+	}
+
+	return sim->halt;
+}
+
+// Stop fetching and run until the instructions in flight have retired, so
+// sim_run_func() can take over at pc_next
+enum HALT sim_drain(struct sim_t *sim) {
+	sim->drain = 1;
+	while(!sim->halt && (sim->id.enable || sim->ex.enable || sim->mem.enable || sim->wb.enable
+			|| sim->branch_taken))
+		sim_step(sim, 1);
+	sim->drain = 0;
+
+	// a fetch still waiting on the I-cache is dropped like on a redirect
+	sim->if_wait = 0;
+	sim->if_busy = 0;
+	sim->fb_fill = 0;
+
+	return sim->halt;
+}
+
+// Whole run as set up in the config
+enum HALT sim_run(struct sim_t *sim) {
+	if(sim->cfg.mode == MODE_FUNC){
+		if(!sim_run_func(sim, sim->cfg.max_insts, FUNC_NO_PC))
+			sim->halt = HALT_MAX_INSTS;
+		return sim->halt;
+	}
+
+	if(sim->cfg.ff_insts || sim->cfg.ff_pc != FUNC_NO_PC){
+		if(sim_run_func(sim, sim->cfg.ff_insts, sim->cfg.ff_pc))
+			return sim->halt;
+	}
+
+	return sim_run_until(sim, sim->cfg.max_cycles);
+}
+
+void sim_get_stats(struct sim_t *sim, struct sim_stats_t *stats) {
+	stats->cycles = sim->cc - SIM_CC_START;
+	stats->inst_cnt = sim->inst_cnt;
+	stats->hazard_cnt = sim->hazard_cnt;
+	stats->branch_cnt = sim->branch_cnt;
+
+	memset(&stats->icache, 0, sizeof(stats->icache));
+	memset(&stats->dcache, 0, sizeof(stats->dcache));
+	if(sim->icache)
+		stats->icache = sim->icache->stats;
+	if(sim->dcache)
+		stats->dcache = sim->dcache->stats;
+	stats->icache_stall_cnt = sim->icache_stall_cnt;
+	stats->dcache_stall_cnt = sim->dcache_stall_cnt;
+	stats->mul_cnt = sim->mul_cnt;
+	stats->div_cnt = sim->div_cnt;
+	stats->mul_stall_cnt = sim->mul_stall_cnt;
+	stats->div_stall_cnt = sim->div_stall_cnt;
+	stats->fetch_insts = sim->fetch_insts;
+	stats->fetch_rvc = sim->fetch_rvc;
+	stats->fetch_words = sim->fetch_words;
+	stats->bpred = sim->bpred->stats;
+	memcpy(stats->cpi, sim->cpi, sizeof(stats->cpi));
+	memcpy(stats->retired, sim->retired, sizeof(stats->retired));
+
+	stats->func_inst_cnt = sim->func_inst_cnt;
+	stats->func_sec = sim->func_sec;
+
+	stats->halt = sim->halt;
+	if(sim->halt == HALT_PC_OUT)
+		stats->halt_pc = sim->pc_next;
+	else if(sim->halt == HALT_FAULT)
+		stats->halt_pc = sim->fault_pc;
+	else
+		stats->halt_pc = sim->last_retire_pc;
+	stats->tohost_val = sim->tohost_val;
+	stats->fault_addr = sim->fault_addr;
+}
+
+// Event counts the CSRs read, by enum HPM_EVENT, for an instruction
+// with in_flight older ones not retired yet. The instructions run by
+// sim_run_func() take one cycle each.
+void sim_csr_count(const struct sim_t *sim, uint32_t in_flight, uint64_t *count) {
+	count[HPM_NONE] = 0;
+	count[HPM_LOAD_USE] = sim->hazard_cnt;
+	count[HPM_TAKEN] = sim->taken_cnt;
+	count[HPM_FLUSH] = sim->branch_cnt;
+	count[HPM_MEM] = sim->retired[RC_LOAD] + sim->retired[RC_STORE];
+	count[HPM_CYCLE] = sim->func_inst_cnt + sim->cc - SIM_CC_START;
+	count[HPM_INSTRET] = sim->func_inst_cnt + sim->inst_cnt + in_flight;
+}
+
+const char *halt_name(enum HALT halt) {
+	switch(halt){
+		case HALT_ECALL:
+			return "ecall";
+		case HALT_EBREAK:
+			return "ebreak";
+		case HALT_TOHOST:
+			return "tohost";
+		case HALT_PC_OUT:
+			return "pc out of image";
+		case HALT_SELF_LOOP:
+			return "jump to self";
+		case HALT_MAX_CYCLES:
+			return "max cycles";
+		case HALT_MAX_INSTS:
+			return "max instructions";
+		case HALT_FAULT:
+			return "guest fault";
+		default:
+			return "none";
+	}
+}
+
+// N with an optional K, M or G suffix
+uint64_t parse_size(const char *str) {
+	char *end;
+	uint64_t n = strtoull(str, &end, 0);
+
+	switch(*end){
+		case 'k': case 'K':
+			return n << 10;
+		case 'm': case 'M':
+			return n << 20;
+		case 'g': case 'G':
+			return n << 30;
+	}
+	return n;
+}
@@ -0,0 +1,244 @@
+/* **************************************
+ * Module: simulator context and library API
+ *
+ * All the state of one simulated processor lives in a
+ * struct sim_t, so any number of them can run in one
+ * process.
+ *
+ *   sim = sim_create(&cfg);
+ *   sim_load(sim, "imem.mem", "dmem.mem");
+ *   sim_run(sim);
+ *   sim_get_stats(sim, &stats);
+ *   sim_destroy(sim);
+ *
+ * **************************************
+ */
+#ifndef RV32I_SIM_H
+#define RV32I_SIM_H
+
+#include "rv32i.h"
+#include "rv32i_units.h"
+#include "rv32i_trace.h"
+#include "rv32i_decode.h"
+#include "rv32i_func.h"
+#include "rv32i_mem.h"
+#include "rv32i_cache.h"
+#include "rv32i_bpred.h"
+#include "rv32i_fwd.h"
+#include "rv32i_muldiv.h"
+#include "rv32i_csr.h"
+#include "rv32i_stats.h"
+#include "rv32i_prof.h"
+#include "rv32i_ooo.h"
+#include "rv32i_wide.h"
+
+// First clock count of a run
+#define SIM_CC_START 2
+#define SIM_MAX_CYCLES_DEFAULT 1000000	// max_cycles of rv32i_config.h
+#define SIM_REG_HARTID 10	// a0
+#define SIM_LINE 64	// host cache line, each pipeline register starts one
+
+struct sim_config_t {
+	uint32_t max_cycles;
+	uint32_t tohost;
+	enum TRACE_LEVEL trace_level;
+	const char *trace_path;
+	uint8_t echo_load;	// print the memory images while loading
+
+	uint32_t mem_base;	// MEM_BASE_AUTO: from the image
+	uint64_t mem_size;	// valid dmem bytes from mem_base
+
+	struct cache_config_t icache;	// size 0: no cache
+	struct cache_config_t dcache;
+	struct bpred_config_t bpred;
+	enum FWD forward;	// bypass network of the pipeline
+	struct muldiv_config_t muldiv;	// M extension unit latencies
+	uint8_t profile;	// count events per pc
+
+	enum MODE mode;
+	uint64_t max_insts;	// functional mode, 0: no limit
+	uint64_t ff_insts;	// fast-forward before the pipeline
+	uint32_t ff_pc;
+	uint8_t jit;	// translate hot code of sim_run_func() runs
+	struct ooo_config_t ooo;	// back end of MODE_OOO
+	struct wide_config_t wide;	// pipeline of MODE_WIDE
+};
+
+struct sim_stats_t {
+	uint32_t cycles;	// simulated, without the SIM_CC_START offset
+	uint32_t inst_cnt;
+	uint32_t hazard_cnt;
+	uint32_t branch_cnt;
+
+	uint64_t cpi[CPI_NUM];	// pipeline cycles by enum CPI_CAT
+	uint64_t retired[RC_NUM];	// by enum RETIRE_CLASS
+
+	struct cache_stats_t icache;
+	struct cache_stats_t dcache;
+	uint32_t icache_stall_cnt;	// cycles IF waited on the I-cache
+	uint32_t dcache_stall_cnt;	// cycles MEM waited on the D-cache
+	uint32_t mul_cnt;	// multiplies and divisions executed
+	uint32_t div_cnt;
+	uint32_t mul_stall_cnt;	// cycles lost waiting on a multiplier result
+	uint32_t div_stall_cnt;	// cycles lost waiting on the divider
+	uint32_t fetch_insts;	// instructions fetched
+	uint32_t fetch_rvc;	// of them compressed
+	uint32_t fetch_words;	// imem words read to fetch them
+	struct bpred_stats_t bpred;
+
+	uint64_t func_inst_cnt;
+	double func_sec;
+
+	enum HALT halt;
+	uint32_t halt_pc;
+	uint32_t tohost_val;
+	uint32_t fault_addr;
+};
+
+// Code symbol of an ELF image
+struct sim_sym_t {
+	uint32_t addr;
+	uint32_t size;	// 0: up to the next symbol
+	char *name;
+};
+
+// Program image, read-only once loaded so one copy can back many sims
+struct sim_image_t {
+	uint32_t *imem_data;
+	uint32_t imem_size;	// number of loaded instruction words
+	uint32_t imem_base;	// address of imem_data[0]
+	uint32_t imem_cap;
+	struct uop_t *uop_table;
+
+	struct mem_t *dmem;	// loaded data at its guest address
+	uint32_t dmem_base;	// lowest loaded address (ELF), else 0
+	uint32_t dmem_end;	// end of the data of a dmem file
+
+	uint32_t entry;
+	uint32_t tohost;	// TOHOST_NONE: no tohost symbol
+
+	struct sim_sym_t *sym;	// sorted by address
+	uint32_t sym_cnt;
+	uint32_t sym_cap;
+};
+
+struct sim_t {
+	struct sim_config_t cfg;
+
+	// memory data
+	uint32_t *reg_data;
+	struct mem_t *dmem;
+	const struct sim_image_t *image;	// imem_data/uop_table come from here
+	struct sim_image_t *own_image;	// loaded by the sim itself, freed with it
+	uint32_t *imem_data;
+	uint32_t imem_size;
+	uint32_t imem_base;
+	struct uop_t *uop_table;
+	uint32_t entry;
+	uint32_t tohost;	// cfg.tohost, or the one of the image
+	uint32_t hartid;	// in a0 at reset
+	struct csr_t csr;	// Zicsr counters
+
+	// processor model
+	uint32_t pc_next;
+
+	// Pipeline registers, updated in place by the stages
+	struct pipe_if_id_t id __attribute__((aligned(SIM_LINE)));
+	struct pipe_id_ex_t ex __attribute__((aligned(SIM_LINE)));
+	struct pipe_ex_mem_t mem __attribute__((aligned(SIM_LINE)));
+	struct pipe_mem_wb_t wb __attribute__((aligned(SIM_LINE)));
+
+	// Hazard variable
+	uint8_t id_flush;
+	uint8_t id_stall;
+	uint8_t if_flush;
+	uint8_t if_stall;
+	uint8_t pc_write;
+	uint8_t branch_taken;
+	uint8_t branch_early;	// the redirect comes from ID, only IF is flushed
+	uint8_t drain;	// IF fetches nothing, see sim_drain()
+
+	// Cache model, NULL when disabled
+	struct cache_t *icache;
+	struct cache_t *dcache;
+	uint32_t if_wait;	// stall cycles left of the current access
+	uint32_t mem_wait;
+	uint8_t if_busy;	// access already sent to the cache
+	uint8_t mem_busy;
+	uint32_t div_wait;	// cycles left of the division in EX
+	uint8_t div_busy;	// the division in EX has started
+	uint8_t fb_fill;	// parcels from pc_next on already in the fetch buffer
+
+	struct bpred_t *bpred;
+	const struct fwd_t *fwd;	// row of cfg.forward
+	struct scoreboard_t sb;
+	struct prof_t *prof;	// NULL unless cfg.profile
+	struct jit_t *jit;	// created by the first sim_run_func() with cfg.jit
+	struct ooo_t *ooo;	// NULL unless cfg.mode is MODE_OOO
+	struct wide_t *wide;	// NULL unless cfg.mode is MODE_WIDE
+
+	// Result variable
+	uint32_t hazard_cnt;
+	uint32_t inst_cnt;
+	uint32_t branch_cnt;
+	uint32_t icache_stall_cnt;
+	uint32_t dcache_stall_cnt;
+	uint32_t mul_cnt;
+	uint32_t div_cnt;
+	uint32_t mul_stall_cnt;
+	uint32_t div_stall_cnt;
+	uint32_t fetch_insts;
+	uint32_t fetch_rvc;
+	uint32_t fetch_words;
+	uint32_t taken_cnt;	// branches and jumps taken, for the CSRs
+	uint64_t cpi[CPI_NUM];
+	uint64_t retired[RC_NUM];
+	uint64_t func_inst_cnt;
+	double func_sec;
+
+	// Halt variable
+	enum HALT halt;
+	uint32_t last_retire_pc;
+	uint32_t pipe_start_inst;	// inst_cnt when the pipeline took over from sim_run_func()
+	uint32_t tohost_val;
+	uint32_t fault_pc;
+	uint32_t fault_addr;
+
+	//Clock count
+	uint32_t cc;
+
+	struct trace_t *trace;
+};
+
+void sim_config_default(struct sim_config_t *cfg);
+
+struct sim_t *sim_create(const struct sim_config_t *cfg);
+void sim_destroy(struct sim_t *sim);
+
+int sim_load(struct sim_t *sim, const char *imem_path, const char *dmem_path);
+int sim_load_image(struct sim_t *sim, const uint32_t *imem, uint32_t imem_words,
+		const uint8_t *dmem, uint32_t dmem_bytes);
+int sim_attach_image(struct sim_t *sim, const struct sim_image_t *image);
+int sim_own_image(struct sim_t *sim, struct sim_image_t *image);
+void sim_reset(struct sim_t *sim);
+
+// rv32i_loader.c, dmem_path may be NULL
+struct sim_image_t *sim_image_create(void);
+struct sim_image_t *sim_image_load(const char *imem_path, const char *dmem_path, uint8_t echo);
+void sim_image_free(struct sim_image_t *image);
+const struct sim_sym_t *sim_image_symbol(const struct sim_image_t *image, uint32_t pc);
+
+enum HALT sim_step(struct sim_t *sim, uint32_t n);
+enum HALT sim_run_until(struct sim_t *sim, uint32_t cycle);
+enum HALT sim_run_func(struct sim_t *sim, uint64_t max_inst, uint32_t stop_pc);
+enum HALT sim_run(struct sim_t *sim);
+enum HALT sim_drain(struct sim_t *sim);
+
+void sim_get_stats(struct sim_t *sim, struct sim_stats_t *stats);
+void sim_csr_count(const struct sim_t *sim, uint32_t in_flight, uint64_t *count);
+
+// rv32i_pipe.c
+void pipe_reset(struct sim_t *sim);
+void pipe_cycle(struct sim_t *sim);
+
+#endif
@@ -0,0 +1,142 @@
+/* **************************************
+ * Module: CPI stack and run statistics
+ *
+ * **************************************
+ */
+#include "rv32i_sim.h"
+
+const char *cpi_name(enum CPI_CAT cat) {
+	static const char *name[CPI_NUM] = {
+		"base", "empty", "load_use", "branch", "icache", "dcache", "raw", "struct", "muldiv"
+	};
+	return cat < CPI_NUM ? name[cat] : "none";
+}
+
+const char *retire_class_name(enum RETIRE_CLASS rc) {
+	static const char *name[RC_NUM] = {
+		"alu", "upper", "load", "store", "branch", "jump", "system", "other"
+	};
+	return rc < RC_NUM ? name[rc] : "none";
+}
+
+static uint64_t stats_cycles(const struct sim_stats_t *stats) {
+	uint64_t total = 0;
+
+	for(int i = 0; i < CPI_NUM; i++)
+		total += stats->cpi[i];
+	return total;
+}
+
+// CPI stack and the retired instruction mix
+void stats_print(FILE *f, const struct sim_stats_t *stats) {
+	uint64_t cycles = stats_cycles(stats);
+	uint64_t insts = stats->cpi[CPI_BASE];
+
+	fprintf(f, "CPI : %.3f (%llu cycles, %llu instructions)\n",
+			insts ? (double)cycles / insts : 0.0,
+			(unsigned long long)cycles, (unsigned long long)insts);
+	for(int i = 0; i < CPI_NUM; i++){
+		fprintf(f, "  %-9s %10llu cycles  %7.3f CPI  %6.2f%%\n", cpi_name(i),
+				(unsigned long long)stats->cpi[i],
+				insts ? (double)stats->cpi[i] / insts : 0.0,
+				cycles ? 100.0 * stats->cpi[i] / cycles : 0.0);
+	}
+
+	fprintf(f, "Retired :");
+	for(int i = 0; i < RC_NUM; i++){
+		if(stats->retired[i])
+			fprintf(f, " %s %llu (%.1f%%)", retire_class_name(i), (unsigned long long)stats->retired[i],
+					100.0 * stats->retired[i] / insts);
+	}
+	fprintf(f, "\n");
+}
+
+static void stats_write_json(FILE *f, const struct sim_stats_t *stats) {
+	uint64_t cycles = stats_cycles(stats);
+	uint64_t insts = stats->cpi[CPI_BASE];
+	int i;
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"halt\": \"%s\",\n  \"halt_pc\": %u,\n  \"tohost_val\": %u,\n",
+			halt_name(stats->halt), stats->halt_pc, stats->tohost_val);
+	fprintf(f, "  \"cycles\": %llu,\n  \"instructions\": %llu,\n  \"cpi\": %.6f,\n",
+			(unsigned long long)cycles, (unsigned long long)insts, insts ? (double)cycles / insts : 0.0);
+	fprintf(f, "  \"func_instructions\": %llu,\n", (unsigned long long)stats->func_inst_cnt);
+
+	fprintf(f, "  \"cpi_stack\": {");
+	for(i = 0; i < CPI_NUM; i++)
+		fprintf(f, "%s\"%s\": %llu", i ? ", " : "", cpi_name(i), (unsigned long long)stats->cpi[i]);
+	fprintf(f, "},\n");
+
+	fprintf(f, "  \"retired\": {");
+	for(i = 0; i < RC_NUM; i++)
+		fprintf(f, "%s\"%s\": %llu", i ? ", " : "", retire_class_name(i), (unsigned long long)stats->retired[i]);
+	fprintf(f, "},\n");
+
+	fprintf(f, "  \"hazards\": %u,\n  \"branches\": %u,\n", stats->hazard_cnt, stats->branch_cnt);
+
+	fprintf(f, "  \"icache\": {\"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"writebacks\": %llu},\n",
+			(unsigned long long)stats->icache.hits, (unsigned long long)stats->icache.misses,
+			(unsigned long long)stats->icache.evictions, (unsigned long long)stats->icache.writebacks);
+	fprintf(f, "  \"dcache\": {\"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"writebacks\": %llu},\n",
+			(unsigned long long)stats->dcache.hits, (unsigned long long)stats->dcache.misses,
+			(unsigned long long)stats->dcache.evictions, (unsigned long long)stats->dcache.writebacks);
+	fprintf(f, "  \"bpred\": {\"branches\": %llu, \"branch_miss\": %llu, \"jumps\": %llu, \"jump_miss\": %llu, "
+			"\"btb_lookups\": %llu, \"btb_hits\": %llu}\n",
+			(unsigned long long)stats->bpred.branches, (unsigned long long)stats->bpred.branch_miss,
+			(unsigned long long)stats->bpred.jumps, (unsigned long long)stats->bpred.jump_miss,
+			(unsigned long long)stats->bpred.btb_lookups, (unsigned long long)stats->bpred.btb_hits);
+	fprintf(f, "}\n");
+}
+
+// One header line and one value line
+static void stats_write_csv(FILE *f, const struct sim_stats_t *stats) {
+	uint64_t cycles = stats_cycles(stats);
+	uint64_t insts = stats->cpi[CPI_BASE];
+	int i;
+
+	fprintf(f, "halt,halt_pc,tohost_val,cycles,instructions,cpi,func_instructions");
+	for(i = 0; i < CPI_NUM; i++)
+		fprintf(f, ",cpi_%s", cpi_name(i));
+	for(i = 0; i < RC_NUM; i++)
+		fprintf(f, ",retired_%s", retire_class_name(i));
+	fprintf(f, ",hazards,branches,icache_hits,icache_misses,icache_evictions,icache_writebacks"
+			",dcache_hits,dcache_misses,dcache_evictions,dcache_writebacks"
+			",bpred_branches,bpred_branch_miss,bpred_jumps,bpred_jump_miss,btb_lookups,btb_hits\n");
+
+	fprintf(f, "%s,0x%X,0x%08X,%llu,%llu,%.6f,%llu", halt_name(stats->halt), stats->halt_pc,
+			stats->tohost_val, (unsigned long long)cycles, (unsigned long long)insts,
+			insts ? (double)cycles / insts : 0.0, (unsigned long long)stats->func_inst_cnt);
+	for(i = 0; i < CPI_NUM; i++)
+		fprintf(f, ",%llu", (unsigned long long)stats->cpi[i]);
+	for(i = 0; i < RC_NUM; i++)
+		fprintf(f, ",%llu", (unsigned long long)stats->retired[i]);
+	fprintf(f, ",%u,%u,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu,%llu\n",
+			stats->hazard_cnt, stats->branch_cnt,
+			(unsigned long long)stats->icache.hits, (unsigned long long)stats->icache.misses,
+			(unsigned long long)stats->icache.evictions, (unsigned long long)stats->icache.writebacks,
+			(unsigned long long)stats->dcache.hits, (unsigned long long)stats->dcache.misses,
+			(unsigned long long)stats->dcache.evictions, (unsigned long long)stats->dcache.writebacks,
+			(unsigned long long)stats->bpred.branches, (unsigned long long)stats->bpred.branch_miss,
+			(unsigned long long)stats->bpred.jumps, (unsigned long long)stats->bpred.jump_miss,
+			(unsigned long long)stats->bpred.btb_lookups, (unsigned long long)stats->bpred.btb_hits);
+}
+
+// JSON when path ends in .json, CSV otherwise
+int stats_write(const char *path, const struct sim_stats_t *stats) {
+	FILE *f;
+	size_t len = strlen(path);
+
+	if ( (f = fopen(path, "w")) == NULL ) {
+		printf("Cannot open %s\n", path);
+		return -1;
+	}
+
+	if(len >= 5 && !strcmp(path + len - 5, ".json"))
+		stats_write_json(f, stats);
+	else
+		stats_write_csv(f, stats);
+
+	fclose(f);
+	return 0;
+}
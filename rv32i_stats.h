@@ -0,0 +1,74 @@
+/* **************************************
+ * Module: CPI stack and run statistics
+ *
+ * Every pipeline cycle is charged to exactly one category
+ * when it reaches WB: a retiring instruction is a base
+ * cycle, a bubble is charged to the stage event that made
+ * it. The cause of a bubble travels with it in the
+ * pipeline registers, so the accounting is one increment
+ * per cycle.
+ *
+ * **************************************
+ */
+#ifndef RV32I_STATS_H
+#define RV32I_STATS_H
+
+#include "rv32i.h"
+
+// Owner of a cycle
+enum CPI_CAT {
+  CPI_BASE = 0,	// an instruction retired
+  CPI_EMPTY,	// pipeline fill, or fetch outside of the image
+  CPI_LOAD_USE,	// RAW bubble waiting on a load
+  CPI_BRANCH,	// instruction fetched behind a mispredicted branch
+  CPI_ICACHE,	// IF waiting on the I-cache
+  CPI_DCACHE,	// MEM waiting on the D-cache
+  CPI_RAW,	// other RAW bubble, the bypass network cannot supply the value yet
+  CPI_STRUCT,	// slot of a wide group cut by the fetch group or the pairing rules
+  CPI_MULDIV,	// waiting on the multiplier result or on the divider
+  CPI_NUM
+};
+
+// Retired instruction class
+enum RETIRE_CLASS {
+  RC_ALU = 0,	// register and immediate arithmetic
+  RC_UPPER,	// lui, auipc
+  RC_LOAD,
+  RC_STORE,
+  RC_BRANCH,
+  RC_JUMP,	// jal, jalr
+  RC_SYSTEM,
+  RC_OTHER,
+  RC_NUM
+};
+
+struct sim_stats_t;
+
+const char *cpi_name(enum CPI_CAT cat);
+const char *retire_class_name(enum RETIRE_CLASS rc);
+
+static inline enum RETIRE_CLASS retire_class(uint8_t opcode) {
+	switch(opcode){
+		case R_TYPE: case I_R_TYPE:
+			return RC_ALU;
+		case U_LU_TYPE: case U_AU_TYPE:
+			return RC_UPPER;
+		case I_L_TYPE:
+			return RC_LOAD;
+		case S_TYPE:
+			return RC_STORE;
+		case SB_TYPE:
+			return RC_BRANCH;
+		case UJ_TYPE: case I_J_TYPE:
+			return RC_JUMP;
+		case SYSTEM_TYPE:
+			return RC_SYSTEM;
+		default:
+			return RC_OTHER;
+	}
+}
+
+void stats_print(FILE *f, const struct sim_stats_t *stats);
+int stats_write(const char *path, const struct sim_stats_t *stats);
+
+#endif
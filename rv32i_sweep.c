@@ -0,0 +1,183 @@
+/* **************************************
+ * Module: parallel design-space sweep
+ *
+ * **************************************
+ */
+#include "rv32i_sweep.h"
+#include "rv32i_batch.h"
+#include "rv32i_pool.h"
+
+struct sweep_t {
+	struct sim_config_t cfg;
+	struct config_file_t *space;
+	struct sim_image_t *image;
+	struct sweep_result_t *res;
+	uint64_t n_points;
+};
+
+static void sweep_task(void *arg, uint32_t worker, uint32_t idx) {
+	struct sweep_t *sweep = (struct sweep_t*)arg;
+	struct sweep_result_t *res = &sweep->res[idx];
+	struct sim_config_t cfg = sweep->cfg;
+	struct sim_t *sim;
+	struct timespec t_start, t_end;
+
+	(void)worker;
+	// every point was applied once before the run, it cannot fail here
+	config_apply_point(&cfg, sweep->space, idx);
+	if((sim = sim_create(&cfg)) == NULL || sim_attach_image(sim, sweep->image)){
+		sim_destroy(sim);
+		res->err = 1;
+		return;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	sim_run(sim);
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	res->host_sec = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	sim_get_stats(sim, &res->stats);
+	res->reg_hash = batch_reg_hash(sim->reg_data);
+	sim_destroy(sim);
+}
+
+// Value of key i at a point
+static const char *sweep_value(const struct sweep_t *sweep, uint64_t point, uint32_t key) {
+	const struct config_file_t *space = sweep->space;
+
+	for(uint32_t i = space->n_params; --i > key; )
+		point /= space->param[i].n_val;
+	return space->param[key].val[point % space->param[key].n_val];
+}
+
+static void sweep_write(struct sweep_t *sweep, FILE *f, uint8_t json) {
+	const struct config_file_t *space = sweep->space;
+
+	if(json)
+		fprintf(f, "[\n");
+	else {
+		for(uint32_t k = 0; k < space->n_params; k++)
+			fprintf(f, "%s,", space->param[k].key);
+		fprintf(f, "halt,cycles,instructions,cpi,func_instructions,icache_misses,dcache_misses,"
+				"mispredicts,reg_hash,host_sec\n");
+	}
+
+	for(uint64_t i = 0; i < sweep->n_points; i++){
+		const struct sweep_result_t *res = &sweep->res[i];
+		const struct sim_stats_t *st = &res->stats;
+		const char *halt = res->err ? "error" : halt_name(st->halt);
+		double cpi = st->inst_cnt ? (double)st->cycles / st->inst_cnt : 0.0;
+		unsigned long long miss = st->bpred.branch_miss + st->bpred.jump_miss;
+
+		if(json){
+			fprintf(f, "  {");
+			for(uint32_t k = 0; k < space->n_params; k++){
+				batch_json_string(f, space->param[k].key);
+				fprintf(f, ": ");
+				batch_json_string(f, sweep_value(sweep, i, k));
+				fprintf(f, ", ");
+			}
+			fprintf(f, "\"halt\": \"%s\", \"cycles\": %u, \"instructions\": %u, \"cpi\": %.4f, "
+					"\"func_instructions\": %llu, \"icache_misses\": %llu, \"dcache_misses\": %llu, "
+					"\"mispredicts\": %llu, \"reg_hash\": \"%08x\", \"host_sec\": %.6f}%s\n",
+					halt, st->cycles, st->inst_cnt, cpi, (unsigned long long)st->func_inst_cnt,
+					(unsigned long long)st->icache.misses, (unsigned long long)st->dcache.misses,
+					miss, res->reg_hash, res->host_sec, i+1 < sweep->n_points ? "," : "");
+		}
+		else {
+			// unit specs hold commas
+			for(uint32_t k = 0; k < space->n_params; k++){
+				const char *val = sweep_value(sweep, i, k);
+				fprintf(f, strchr(val, ',') ? "\"%s\"," : "%s,", val);
+			}
+			fprintf(f, "%s,%u,%u,%.4f,%llu,%llu,%llu,%llu,%08x,%.6f\n",
+					halt, st->cycles, st->inst_cnt, cpi, (unsigned long long)st->func_inst_cnt,
+					(unsigned long long)st->icache.misses, (unsigned long long)st->dcache.misses,
+					miss, res->reg_hash, res->host_sec);
+		}
+	}
+
+	if(json)
+		fprintf(f, "]\n");
+}
+
+int sweep_run(const struct sim_config_t *cfg, const char *space_path, const char *imem_path,
+		const char *dmem_path, uint32_t n_workers, const char *out_path) {
+	struct sweep_t sweep;
+	struct timespec t_start, t_end;
+	FILE *f_out = stdout;
+	int n_err = 0;
+
+	memset(&sweep, 0, sizeof(sweep));
+	sweep.cfg = *cfg;
+	// runs go side by side, they must not print or share a trace file
+	sweep.cfg.trace_level = TRACE_NONE;
+	sweep.cfg.trace_path = NULL;
+	sweep.cfg.echo_load = 0;
+	sweep.cfg.profile = 0;
+
+	if(n_workers == 0)
+		n_workers = pool_default_workers();
+
+	if ( (sweep.space = config_file_load(space_path)) == NULL ) {
+		n_err = -1;
+		goto out;
+	}
+	sweep.n_points = config_points(sweep.space);
+	if(sweep.n_points > SWEEP_POINTS_MAX){
+		printf("%s has %llu configurations, at most %d are run\n", space_path,
+				(unsigned long long)sweep.n_points, SWEEP_POINTS_MAX);
+		n_err = -1;
+		goto out;
+	}
+
+	// unknown keys and malformed values stop the sweep before it starts
+	for(uint64_t i = 0; i < sweep.n_points; i++){
+		struct sim_config_t check = sweep.cfg;
+		if(config_apply_point(&check, sweep.space, i)){
+			n_err = -1;
+			goto out;
+		}
+	}
+
+	if ( (sweep.image = sim_image_load(imem_path, dmem_path, 0)) == NULL ) {
+		n_err = -1;
+		goto out;
+	}
+	if(out_path && (f_out = fopen(out_path, "w")) == NULL){
+		printf("Cannot open %s\n", out_path);
+		n_err = -1;
+		goto out;
+	}
+	if ( (sweep.res = (struct sweep_result_t*)calloc(sweep.n_points, sizeof(struct sweep_result_t))) == NULL ) {
+		printf("Out of host memory!!\n");
+		n_err = -1;
+		goto out;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &t_start);
+	if(pool_run((uint32_t)sweep.n_points, n_workers, sweep_task, &sweep)){
+		n_err = -1;
+		goto out;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &t_end);
+
+	for(uint64_t i = 0; i < sweep.n_points; i++)
+		n_err += sweep.res[i].err;
+
+	size_t len = out_path ? strlen(out_path) : 0;
+	sweep_write(&sweep, f_out, len >= 5 && !strcmp(out_path + len - 5, ".json"));
+
+	double sec = (t_end.tv_sec - t_start.tv_sec) + (t_end.tv_nsec - t_start.tv_nsec) / 1e9;
+	fprintf(stderr, "Sweep : %llu configurations on %u workers in %.3f s, %d failed\n",
+			(unsigned long long)sweep.n_points, n_workers, sec, n_err);
+
+out:
+	if(f_out && f_out != stdout)
+		fclose(f_out);
+	sim_image_free(sweep.image);
+	config_file_free(sweep.space);
+	free(sweep.res);
+
+	return n_err;
+}
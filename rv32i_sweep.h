@@ -0,0 +1,31 @@
+/* **************************************
+ * Module: parallel design-space sweep
+ *
+ * Runs one program on every configuration of a config
+ * file (rv32i_config.h) with several values per key, on
+ * the worker pool. The program is loaded once and shared
+ * read-only by all the runs. The result table has one row
+ * per configuration, in the order of config_apply_point().
+ *
+ * **************************************
+ */
+#ifndef RV32I_SWEEP_H
+#define RV32I_SWEEP_H
+
+#include "rv32i_config.h"
+
+#define SWEEP_POINTS_MAX 1000000
+
+struct sweep_result_t {
+	int err;	// configuration could not be built
+	struct sim_stats_t stats;
+	uint32_t reg_hash;
+	double host_sec;
+};
+
+// Writes CSV (JSON when out_path ends with .json, stdout when NULL).
+// Returns the number of failed configurations, -1 on error.
+int sweep_run(const struct sim_config_t *cfg, const char *space_path, const char *imem_path,
+		const char *dmem_path, uint32_t n_workers, const char *out_path);
+
+#endif
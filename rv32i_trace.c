@@ -0,0 +1,181 @@
+/* **************************************
+ * Module: per-cycle state trace
+ *
+ * Binary layout (little endian)
+ *  header : magic, version, start cc, dmem base,
+ *           32 registers, {u32 addr, page bytes} for
+ *           every non-zero page, u32 TRACE_PAGE_END
+ *  cycle  : tag, varint cc delta,
+ *           u8 nreg, {u8 idx, u32 val} * nreg,
+ *           u8 nmem, {varint addr, u8 val} * nmem
+ *  end    : tag, varint cc delta
+ * Cycles without any change are not written at all. A
+ * cycle storing more than TRACE_MEM_MAX bytes continues in
+ * further cycle records with a cc delta of 0.
+ *
+ * **************************************
+ */
+#include "rv32i_trace.h"
+
+static void trace_flush(struct trace_t *tr) {
+	if(tr->len){
+		fwrite(tr->buf, 1, tr->len, tr->fp);
+		tr->len = 0;
+	}
+}
+
+static inline void put_u8(struct trace_t *tr, uint8_t v) {
+	if(tr->len == TRACE_BUF_SIZE)
+		trace_flush(tr);
+	tr->buf[tr->len++] = v;
+}
+
+static inline void put_u32(struct trace_t *tr, uint32_t v) {
+	for(int i = 0; i < WORD_SIZE; i++)
+		put_u8(tr, (uint8_t)(v >> i*BYTE_BIT));
+}
+
+static inline void put_varint(struct trace_t *tr, uint32_t v) {
+	while(v >= 0x80){
+		put_u8(tr, (uint8_t)(v | 0x80));
+		v >>= 7;
+	}
+	put_u8(tr, (uint8_t)v);
+}
+
+struct trace_t *trace_open(const char *path, uint32_t cc, uint32_t *reg_data,
+		struct mem_t *mem) {
+	struct trace_t *tr;
+	uint32_t addr;
+	uint8_t *page;
+
+	tr = (struct trace_t*)calloc(1, sizeof(struct trace_t));
+	if(tr == NULL)
+		return NULL;
+	if((tr->fp = fopen(path, "wb")) == NULL){
+		free(tr);
+		return NULL;
+	}
+	if((tr->buf = (uint8_t*)malloc(TRACE_BUF_SIZE)) == NULL){
+		fclose(tr->fp);
+		free(tr);
+		return NULL;
+	}
+
+	put_u32(tr, TRACE_MAGIC);
+	put_u32(tr, TRACE_VERSION);
+	put_u32(tr, cc);
+	put_u32(tr, mem->base);
+	for(int i = 0; i < 32; i++)
+		put_u32(tr, reg_data[i]);
+
+	// Only the pages holding data are stored
+	addr = 0;
+	while((page = mem_next_page(mem, &addr)) != NULL){
+		int k;
+		for(k = 0; k < MEM_PAGE_SIZE && !page[k]; k++);
+		if(k < MEM_PAGE_SIZE){
+			put_u32(tr, addr);
+			for(k = 0; k < MEM_PAGE_SIZE; k++)
+				put_u8(tr, page[k]);
+		}
+		if(addr == (uint32_t)-MEM_PAGE_SIZE)
+			break;
+		addr += MEM_PAGE_SIZE;
+	}
+	put_u32(tr, TRACE_PAGE_END);
+
+	memcpy(tr->shadow_reg, reg_data, sizeof(tr->shadow_reg));
+	tr->last_cc = cc;
+
+	return tr;
+}
+
+// Cycle record of cc with the nreg registers in changed and the logged bytes
+static void trace_record(struct trace_t *tr, uint32_t cc, const uint32_t *reg_data,
+		const uint8_t *changed, uint8_t nreg) {
+	put_u8(tr, TRACE_TAG_CYCLE);
+	put_varint(tr, cc - tr->last_cc);
+	put_u8(tr, nreg);
+	for(int i = 0; i < nreg; i++){
+		put_u8(tr, changed[i]);
+		put_u32(tr, reg_data[changed[i]]);
+		tr->shadow_reg[changed[i]] = reg_data[changed[i]];
+	}
+	put_u8(tr, (uint8_t)tr->mem_cnt);
+	for(uint32_t i = 0; i < tr->mem_cnt; i++){
+		put_varint(tr, tr->mem[i].addr);
+		put_u8(tr, tr->mem[i].val);
+	}
+
+	tr->mem_cnt = 0;
+	tr->last_cc = cc;
+}
+
+// Called in cycle cc before the store is performed, logs the bytes that
+// will change
+void trace_store(struct trace_t *tr, struct mem_t *mem, uint32_t cc, uint32_t addr,
+		uint8_t func3, uint32_t din) {
+	int bytes;
+
+	switch(func3){
+		case SB:
+			bytes = 1;
+			break;
+		case SH:
+			bytes = 2;
+			break;
+		default:
+			bytes = 4;
+			break;
+	}
+
+	for(int i = 0; i < bytes; i++){
+		uint8_t val = (uint8_t)(din >> i*BYTE_BIT);
+		if(mem_read_byte(mem, addr+i) != val){
+			if(tr->mem_cnt == TRACE_MEM_MAX)
+				trace_record(tr, cc, NULL, NULL, 0);
+			tr->mem[tr->mem_cnt].addr = addr + i;
+			tr->mem[tr->mem_cnt].val = val;
+			tr->mem_cnt++;
+		}
+	}
+}
+
+void trace_cycle(struct trace_t *tr, uint32_t cc, uint32_t *reg_data) {
+	uint8_t changed[32];
+	uint8_t nreg = 0;
+
+	for(int i = 0; i < 32; i++){
+		if(reg_data[i] != tr->shadow_reg[i])
+			changed[nreg++] = i;
+	}
+	if(!nreg && !tr->mem_cnt)
+		return;
+	trace_record(tr, cc, reg_data, changed, nreg);
+}
+
+// cc is the first cycle that was not simulated
+void trace_close(struct trace_t *tr, uint32_t cc) {
+	put_u8(tr, TRACE_TAG_END);
+	put_varint(tr, cc - tr->last_cc);
+	trace_flush(tr);
+
+	fclose(tr->fp);
+	free(tr->buf);
+	free(tr);
+}
+
+// dmem is shown from the base of the memory
+void trace_print_state(FILE *fp, uint32_t *reg_data, struct mem_t *mem) {
+	for(int i = 0; i < 32; i++){
+		fprintf(fp, "reg[%02d]: %08X\n", i, reg_data[i]);
+	}
+	fprintf(fp, "\n");
+	for(int i = 0; i < TRACE_DMEM_SHOW; i += 4){
+		fprintf(fp, "dmem[%02d]: ", i);
+		for(int j = 3; j >= 0; j--)
+			fprintf(fp, "%02X", mem_read_byte(mem, mem->base+i+j));
+		fprintf(fp, "\n");
+	}
+}
@@ -0,0 +1,61 @@
+/* **************************************
+ * Module: per-cycle state trace
+ *
+ * Text dump of the architectural state and a compact
+ * binary trace that only records what changed per cycle.
+ *
+ * **************************************
+ */
+#ifndef RV32I_TRACE_H
+#define RV32I_TRACE_H
+
+#include "rv32i.h"
+#include "rv32i_mem.h"
+
+// defines
+#define TRACE_MAGIC 0x52545652	// "RVTR"
+#define TRACE_VERSION 2
+#define TRACE_BUF_SIZE (1 << 20)
+#define TRACE_MEM_MAX 16	// changed memory bytes per cycle record
+#define TRACE_DMEM_SHOW 40	// dmem bytes in the text layout
+#define TRACE_PAGE_END 0xFFFFFFFF	// ends the page list of the header
+
+// Record tags
+#define TRACE_TAG_CYCLE 0x01
+#define TRACE_TAG_END 0x02
+
+// Trace level
+enum TRACE_LEVEL {
+  TRACE_NONE = 0,
+  TRACE_SUMMARY,
+  TRACE_FULL
+};
+
+struct trace_mem_t {
+	uint32_t addr;
+	uint8_t val;
+};
+
+struct trace_t {
+	FILE *fp;
+	uint8_t *buf;
+	uint32_t len;
+
+	uint32_t last_cc;
+	uint32_t shadow_reg[32];
+
+	// memory bytes changed in the current cycle
+	struct trace_mem_t mem[TRACE_MEM_MAX];
+	uint32_t mem_cnt;
+};
+
+struct trace_t *trace_open(const char *path, uint32_t cc, uint32_t *reg_data,
+		struct mem_t *mem);
+void trace_store(struct trace_t *tr, struct mem_t *mem, uint32_t cc, uint32_t addr,
+		uint8_t func3, uint32_t din);
+void trace_cycle(struct trace_t *tr, uint32_t cc, uint32_t *reg_data);
+void trace_close(struct trace_t *tr, uint32_t cc);
+
+void trace_print_state(FILE *fp, uint32_t *reg_data, struct mem_t *mem);
+
+#endif
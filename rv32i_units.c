@@ -0,0 +1,46 @@
+/* **************************************
+ * Module: functional units of rv32i processor
+ *         (alu control, the units are in rv32i_units.h)
+ *
+ * Author: Sanghyeon Park
+ *
+ * **************************************
+ */
+#include "rv32i_units.h"
+
+uint8_t alu_control_gen(uint8_t opcode, uint8_t func3, uint8_t func7){
+
+	// loads, stores, and M extension operations, which use muldiv()
+	if(opcode == I_L_TYPE || opcode == S_TYPE || (opcode == R_TYPE && func7 == F7_MULDIV))
+		return C_ADD;
+	else if(opcode == SB_TYPE)
+		return C_SUB;
+	else {
+		switch(func3){
+		//Arithmetic & Shifts
+			case F3_SL:
+				return C_SL;
+			case F3_ADD_SUB:
+				if(((func7 >> 5) & 1))
+					return C_SUB;
+				else
+					return C_ADD;
+			case F3_SR:
+				if(((func7 >> 5) & 1))
+					return C_SRA;
+				else
+					return C_SR;
+			case F3_XOR:
+				return C_XOR;
+			case F3_OR:
+				return C_OR;
+			case F3_AND:
+				return C_AND;
+			case F3_SLT:
+			case F3_SLTU:
+				return C_SUB;
+		}
+	}
+    //For Error case
+    return 0b1111;
+}
@@ -0,0 +1,155 @@
+/* **************************************
+ * Module: functional units of rv32i processor
+ *         (imem, register file, alu, dmem)
+ *
+ * The units are inline so the stages of the pipeline and
+ * the functional engine run them without a call. Inputs
+ * and outputs go by pointer, a stage points them straight
+ * at the fields of its pipeline registers.
+ *
+ * **************************************
+ */
+#ifndef RV32I_UNITS_H
+#define RV32I_UNITS_H
+
+#include "rv32i.h"
+#include "rv32i_mem.h"
+
+static inline void imem(const struct imem_input_t *imem_in, struct imem_output_t *imem_out,
+		const uint32_t *imem_data) {
+	imem_out->dout = imem_data[imem_in->addr/4];
+}
+
+static inline void regfile_read(const uint32_t *reg_data, const struct regfile_input_t *regfile_in,
+		struct regfile_output_t *regfile_out) {
+	regfile_out->rs1_dout = reg_data[regfile_in->rs1];
+	regfile_out->rs2_dout = (regfile_in->rs2 < REG_WIDTH) ? reg_data[regfile_in->rs2] : 0;
+}
+
+static inline void regfile_write(uint32_t *reg_data, uint8_t rd, uint32_t rd_din) {
+	//x0 is hard-wired to zero
+	if(rd)
+		reg_data[rd] = rd_din;
+}
+
+static inline void alu(const struct alu_input_t *alu_in, struct alu_output_t *alu_out) {
+	uint32_t in1 = alu_in->in1;
+	uint32_t in2 = alu_in->in2;
+	uint32_t result;
+
+	// shift amounts are the low 5 bits, the rest of an I-type immediate is func7
+	switch(alu_in->alu_control){
+		case C_AND:
+			result = in1 & in2;
+			break;
+		case C_OR:
+			result = in1 | in2;
+			break;
+		case C_XOR:
+			result = in1 ^ in2;
+			break;
+		case C_SL:
+			result = in1 << (in2 & 0x1F);
+			break;
+		case C_SR:
+			result = in1 >> (in2 & 0x1F);
+			break;
+		case C_SRA:
+			result = (uint32_t)((int32_t)in1 >> (in2 & 0x1F));
+			break;
+		case C_SUB:
+			result = in1 - in2;
+			break;
+		default:
+			result = in1 + in2;
+			break;
+	}
+
+	//sign and ucmp compare the operands, so in1 - in2 may overflow
+	alu_out->result = result;
+	alu_out->zero = result == 0;
+	alu_out->sign = (int32_t)in1 < (int32_t)in2;
+	alu_out->ucmp = in1 < in2;
+}
+
+// Multiply/divide unit of the M extension, func3 selects the operation.
+// Division by zero and overflow give the results of the spec, no trap.
+static inline uint32_t muldiv(uint32_t in1, uint32_t in2, uint8_t func3) {
+	switch(func3){
+		case F3_MUL:
+			return in1 * in2;
+		case F3_MULH:
+			return (uint32_t)(((int64_t)(int32_t)in1 * (int32_t)in2) >> 32);
+		case F3_MULHSU:
+			return (uint32_t)(((int64_t)(int32_t)in1 * (int64_t)in2) >> 32);
+		case F3_MULHU:
+			return (uint32_t)(((uint64_t)in1 * in2) >> 32);
+		case F3_DIV:
+			if(in2 == 0)
+				return UINT32_MAX;
+			if(in1 == 0x80000000 && in2 == UINT32_MAX)
+				return in1;
+			return (uint32_t)((int32_t)in1 / (int32_t)in2);
+		case F3_DIVU:
+			return in2 ? in1 / in2 : UINT32_MAX;
+		case F3_REM:
+			if(in2 == 0)
+				return in1;
+			if(in1 == 0x80000000 && in2 == UINT32_MAX)
+				return 0;
+			return (uint32_t)((int32_t)in1 % (int32_t)in2);
+		default:
+			return in2 ? in1 % in2 : in1;
+	}
+}
+
+static inline void dmem(const struct dmem_input_t *dmem_in, struct dmem_output_t *dmem_out,
+		struct mem_t *mem) {
+	uint8_t bytes = 1 << (dmem_in->func3 & 0x3);
+
+	dmem_out->dout = 0;
+	dmem_out->fault = 0;
+
+	if((dmem_in->mem_read || dmem_in->mem_write) && mem_fault(mem, dmem_in->addr, bytes)){
+		dmem_out->fault = 1;
+		D_PRINTF("MEM", "Fault : %08X", dmem_in->addr);
+		return;
+	}
+
+	if(dmem_in->mem_read){
+		switch(dmem_in->func3){
+			case LB:
+				dmem_out->dout = (uint32_t)(int8_t)mem_read(mem, dmem_in->addr, 1);
+				break;
+			case LBU:
+				dmem_out->dout = mem_read(mem, dmem_in->addr, 1);
+				break;
+			case LH:
+				dmem_out->dout = (uint32_t)(int16_t)mem_read(mem, dmem_in->addr, 2);
+				break;
+			case LHU:
+				dmem_out->dout = mem_read(mem, dmem_in->addr, 2);
+				break;
+			case LW:
+				dmem_out->dout = mem_read(mem, dmem_in->addr, 4);
+				break;
+		}
+				D_PRINTF("MEM", "Read : %x", dmem_out->dout);
+	}
+	if(dmem_in->mem_write){
+		switch(dmem_in->func3){
+			case SB:
+				mem_write(mem, dmem_in->addr, dmem_in->din, 1);
+				break;
+			case SH:
+				mem_write(mem, dmem_in->addr, dmem_in->din, 2);
+				break;
+			case SW:
+				mem_write(mem, dmem_in->addr, dmem_in->din, 4);
+				break;
+		}
+				D_PRINTF("MEM", "Write : %08X", dmem_in->din);
+	}
+}
+
+#endif
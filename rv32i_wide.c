@@ -0,0 +1,410 @@
+/* **************************************
+ * Module: wide in-order pipeline
+ *
+ * **************************************
+ */
+#include "rv32i_wide.h"
+#include "rv32i_sim.h"
+#include "rv32i_config.h"
+
+// CPI category of an unused slot, hazards are looked up by producer
+static const uint8_t wide_slot_cpi[WIDE_SLOT_NUM] = {
+	CPI_BASE, CPI_EMPTY, CPI_STRUCT, CPI_ICACHE, CPI_BRANCH, CPI_DCACHE,
+	CPI_LOAD_USE, CPI_RAW, CPI_RAW, CPI_STRUCT, CPI_STRUCT, CPI_MULDIV
+};
+
+static const char *wide_slot_name(enum WIDE_SLOT slot) {
+	static const char *name[WIDE_SLOT_NUM] = {
+		"used", "empty", "fetch", "icache", "branch", "dcache", "load_use", "raw", "dep", "mem", "br", "muldiv"
+	};
+	return slot < WIDE_SLOT_NUM ? name[slot] : "none";
+}
+
+void wide_config_default(struct wide_config_t *cfg) {
+	cfg->width = 2;
+	cfg->mem = 1;
+	cfg->br = 1;
+}
+
+static enum CONFIG_OPT wide_option(void *obj, const char *key, const char *val) {
+	struct wide_config_t *cfg = (struct wide_config_t*)obj;
+
+	if(!strcmp(key, "width"))
+		return config_u32(val, &cfg->width);
+	if(!strcmp(key, "mem"))
+		return config_u32(val, &cfg->mem);
+	if(!strcmp(key, "br"))
+		return config_u32(val, &cfg->br);
+	return CONFIG_UNKNOWN;
+}
+
+int wide_config_parse(struct wide_config_t *cfg, const char *str) {
+	return config_spec_parse(str, "wide pipeline", 0, wide_option, cfg);
+}
+
+struct wide_t *wide_create(const struct wide_config_t *cfg) {
+	struct wide_t *w;
+
+	if(cfg->width == 0 || cfg->width > OOO_WIDTH_MAX){
+		printf("Wide pipeline width must be 1 to %d\n", OOO_WIDTH_MAX);
+		return NULL;
+	}
+	if(cfg->mem == 0 || cfg->br == 0){
+		printf("Wide pipelines need at least one memory and one branch slot per group\n");
+		return NULL;
+	}
+
+	w = (struct wide_t*)calloc(1, sizeof(struct wide_t));
+	if(w == NULL)
+		return NULL;
+	w->cfg = *cfg;
+	wide_reset(w);
+
+	return w;
+}
+
+void wide_destroy(struct wide_t *w) {
+	free(w);
+}
+
+void wide_reset(struct wide_t *w) {
+	w->fb_n = 0;
+	w->fb_slot = WIDE_SLOT_EMPTY;
+	w->ex.n = 0;
+	w->mem.n = 0;
+	w->wb.n = 0;
+	w->ex.cause = CPI_EMPTY;
+	w->mem.cause = CPI_EMPTY;
+	w->wb.cause = CPI_EMPTY;
+
+	w->fetch_pc = 0;
+	w->fetch_word = UINT32_MAX;
+	w->resume = 0;
+	w->redirect = 0;
+	w->frozen = 0;
+	w->fetch_stop = HALT_NONE;
+	w->started = 0;
+
+	memset(&w->stats, 0, sizeof(w->stats));
+}
+
+static inline void wide_move(struct wide_group_t *dst, const struct wide_group_t *src) {
+	memcpy(dst->inst, src->inst, src->n * sizeof(src->inst[0]));
+	dst->n = src->n;
+	dst->cause = src->cause;
+}
+
+// The first n instructions of g leave the pipeline
+static void wide_retire(struct sim_t *sim, const struct wide_group_t *g, uint32_t n) {
+	for(uint32_t i = 0; i < n; i++){
+		const struct ooo_inst_t *in = &g->inst[i];
+
+		sim->last_retire_pc = in->pc;
+		sim->pc_next = in->next_pc;
+		sim->inst_cnt++;
+		sim->retired[retire_class(in->opcode)]++;
+		if(in->halt)
+			sim->halt = in->halt;
+	}
+	sim->cpi[CPI_BASE] += n;
+}
+
+// Writeback stage, width retire slots
+static void wide_wb(struct sim_t *sim, struct wide_t *w) {
+	wide_retire(sim, &w->wb, w->wb.n);
+	sim->cpi[w->wb.cause] += w->cfg.width - w->wb.n;
+}
+
+// Memory stage, the D-cache ports serve the group in parallel
+static void wide_mem(struct sim_t *sim, struct wide_t *w) {
+	struct wide_group_t *mem = &w->mem;
+
+	w->frozen = 0;
+
+	if(sim->dcache && !sim->mem_busy){
+		uint32_t lat = 1;
+
+		for(uint32_t i = 0; i < mem->n; i++){
+			const struct ooo_inst_t *in = &mem->inst[i];
+
+			if(in->fu == OOO_FU_MEM && in->halt != HALT_FAULT){
+				uint32_t acc = cache_access(sim->dcache, in->addr, in->store);
+				if(acc > lat)
+					lat = acc;
+			}
+		}
+		sim->mem_wait = lat - 1;
+		sim->mem_busy = 1;
+	}
+	if(sim->mem_wait){
+		sim->mem_wait--;
+		sim->dcache_stall_cnt++;
+		w->frozen = WIDE_SLOT_DCACHE;
+		w->wb.n = 0;
+		w->wb.cause = CPI_DCACHE;
+		return;
+	}
+	sim->mem_busy = 0;
+
+	// a fault or a tohost store stops the run here, the older lanes retire
+	for(uint32_t i = 0; i < mem->n; i++){
+		const struct ooo_inst_t *in = &mem->inst[i];
+
+		if(in->halt == HALT_FAULT){
+			sim->fault_pc = in->pc;
+			sim->fault_addr = in->val;
+		}
+		else if(in->halt == HALT_TOHOST)
+			sim->tohost_val = in->val;
+		else
+			continue;
+		wide_retire(sim, mem, i);
+		sim->halt = in->halt;
+		w->wb.n = 0;
+		return;
+	}
+
+	wide_move(&w->wb, mem);
+}
+
+// A mispredict is known: fetch the correct path from the next cycle on
+static void wide_redirect(struct sim_t *sim, struct wide_t *w) {
+	w->redirect = 0;
+	w->resume = sim->cc + 1;
+	sim->branch_cnt++;
+}
+
+// Execute stage, branches not resolved in ID check their prediction here
+static void wide_ex(struct sim_t *sim, struct wide_t *w) {
+	struct wide_group_t *ex = &w->ex;
+
+	if(w->frozen)
+		return;
+
+	// one divider, the divisions of a group take it in turn
+	if(!sim->div_busy){
+		uint32_t lat = 0;
+
+		for(uint32_t i = 0; i < ex->n; i++)
+			if(ex->inst[i].div)
+				lat += ex->inst[i].lat;
+		sim->div_wait = lat ? lat - 1 : 0;
+		sim->div_busy = 1;
+	}
+	if(sim->div_wait){
+		sim->div_wait--;
+		sim->div_stall_cnt++;
+		w->frozen = WIDE_SLOT_MULDIV;
+		w->mem.n = 0;
+		w->mem.cause = CPI_MULDIV;
+		return;
+	}
+	sim->div_busy = 0;
+
+	for(uint32_t i = 0; i < ex->n; i++)
+		if(ex->inst[i].mispredict)
+			wide_redirect(sim, w);
+	wide_move(&w->mem, ex);
+}
+
+// Instruction decode stage, issues an in-order prefix of the fetch buffer
+static void wide_id(struct sim_t *sim, struct wide_t *w) {
+	struct scoreboard_t *sb = &sim->sb;
+	struct wide_group_t *ex = &w->ex;
+	uint32_t n_mem = 0, n_br = 0;
+	uint8_t slot = w->fb_slot;
+	uint8_t cause;
+	uint32_t n;
+
+	if(w->frozen){
+		w->stats.slot[w->frozen] += w->cfg.width;
+		w->stats.issue_hist[0]++;
+		return;
+	}
+	sb->tick++;
+
+	for(n = 0; n < w->fb_n; n++){
+		struct ooo_inst_t *in = &w->fb[n];
+		// a branch not ready for the comparator resolves in EX instead
+		uint8_t early = (sim->fwd->paths & FWD_MEM_ID) && in->fu == OOO_FU_BR
+				&& !sb_wait(sb, sim->fwd, in->rs[0], FWD_USE_ID) && !sb_wait(sb, sim->fwd, in->rs[1], FWD_USE_ID);
+		int8_t raw = -1;
+
+		if(in->fu == OOO_FU_MEM && n_mem == w->cfg.mem){
+			slot = WIDE_SLOT_MEM;
+			break;
+		}
+		if(in->fu == OOO_FU_BR && n_br == w->cfg.br){
+			slot = WIDE_SLOT_BR;
+			break;
+		}
+
+		if(sb_wait(sb, sim->fwd, in->rs[0], early ? FWD_USE_ID : FWD_USE_EX))
+			raw = in->rs[0];
+		if(sb_wait(sb, sim->fwd, in->rs[1], in->store ? FWD_USE_STORE : early ? FWD_USE_ID : FWD_USE_EX))
+			raw = in->rs[1];
+		if(raw >= 0){
+			sim->hazard_cnt++;
+			if(sb->issue[raw] == sb->tick)
+				slot = WIDE_SLOT_DEP;
+			else if(sb->late[raw])
+				slot = WIDE_SLOT_MULDIV;
+			else
+				slot = ((sb->load >> raw) & 1) ? WIDE_SLOT_LOAD_USE : WIDE_SLOT_RAW;
+			if(sb->late[raw]){
+				cause = CPI_MULDIV;
+				sim->mul_stall_cnt++;
+			}
+			else
+				cause = ((sb->load >> raw) & 1) ? CPI_LOAD_USE : CPI_RAW;
+			break;
+		}
+
+		sb_write(sb, in->rd, in->pc, in->fu == OOO_FU_MEM && !in->store,
+				(in->lat && !in->div) ? in->lat - 1 : 0);
+		ex->inst[n] = *in;
+		n_mem += in->fu == OOO_FU_MEM;
+		n_br += in->fu == OOO_FU_BR;
+
+		// comparator in ID
+		if(early && in->mispredict){
+			wide_redirect(sim, w);
+			ex->inst[n].mispredict = 0;
+			w->stats.early++;
+		}
+	}
+	if(n == w->fb_n || slot == WIDE_SLOT_MEM || slot == WIDE_SLOT_BR)
+		cause = wide_slot_cpi[slot];
+
+	ex->n = n;
+	ex->cause = cause;
+	w->fb_n -= n;
+	memmove(w->fb, w->fb + n, w->fb_n * sizeof(w->fb[0]));
+
+	w->stats.slot[WIDE_SLOT_USED] += n;
+	w->stats.slot[slot] += w->cfg.width - n;
+	w->stats.issue_hist[n]++;
+}
+
+// Instruction fetch stage, fills the buffer from one I-cache line
+static void wide_if(struct sim_t *sim, struct wide_t *w) {
+	uint32_t line = 0;
+
+	if(w->frozen || w->fb_n == w->cfg.width)
+		return;
+	if(w->fetch_stop){
+		w->fb_slot = WIDE_SLOT_EMPTY;
+		return;
+	}
+	if(w->redirect || sim->cc < w->resume){
+		w->fb_slot = WIDE_SLOT_BRANCH;
+		return;
+	}
+	if((w->fetch_pc - sim->imem_base) / 4 >= sim->imem_size){
+		w->fetch_stop = HALT_PC_OUT;
+		w->fb_slot = WIDE_SLOT_EMPTY;
+		return;
+	}
+
+	// I-cache miss: the fetch is repeated until the line arrives
+	if(sim->icache){
+		if(!sim->if_busy){
+			sim->if_wait = cache_access(sim->icache, w->fetch_pc, 0) - 1;
+			sim->if_busy = 1;
+		}
+		if(sim->if_wait){
+			sim->if_wait--;
+			sim->icache_stall_cnt++;
+			w->fb_slot = WIDE_SLOT_ICACHE;
+			return;
+		}
+		sim->if_busy = 0;
+		line = w->fetch_pc >> sim->icache->line_bits;
+	}
+
+	w->fb_slot = WIDE_SLOT_FETCH;
+	while(w->fb_n < w->cfg.width){
+		uint32_t pc = w->fetch_pc;
+		struct ooo_inst_t *in = &w->fb[w->fb_n];
+		uint8_t end;
+
+		if((pc - sim->imem_base) / 4 >= sim->imem_size){
+			w->fetch_stop = HALT_PC_OUT;
+			w->fb_slot = WIDE_SLOT_EMPTY;
+			break;
+		}
+		if(sim->icache && (pc >> sim->icache->line_bits) != line)
+			break;
+
+		end = ooo_fetch_inst(sim, in, pc, &w->fetch_word);
+		w->fetch_pc = in->next_pc;
+		w->fb_n++;
+		if(in->halt){
+			w->fetch_stop = in->halt;
+			w->fb_slot = WIDE_SLOT_EMPTY;
+		}
+		if(in->mispredict){
+			w->redirect = 1;
+			w->stats.mispredicts++;
+			w->fb_slot = WIDE_SLOT_BRANCH;
+		}
+		if(end)
+			break;
+	}
+}
+
+void wide_cycle(struct sim_t *sim) {
+	struct wide_t *w = sim->wide;
+
+	if(!w->started){
+		w->fetch_pc = sim->pc_next;
+		w->started = 1;
+	}
+
+	wide_wb(sim, w);
+	wide_mem(sim, w);
+	wide_ex(sim, w);
+	wide_id(sim, w);
+	wide_if(sim, w);
+
+	w->stats.cycles++;
+	sim->cc++;
+
+	if(!sim->halt && w->fetch_stop == HALT_PC_OUT
+			&& !w->fb_n && !w->ex.n && !w->mem.n && !w->wb.n){
+		sim->pc_next = w->fetch_pc;
+		sim->halt = HALT_PC_OUT;
+	}
+}
+
+void wide_print(FILE *f, const struct sim_t *sim) {
+	const struct wide_t *w = sim->wide;
+	const struct wide_config_t *cfg = &w->cfg;
+	const struct wide_stats_t *st = &w->stats;
+	double cycles = st->cycles ? (double)st->cycles : 1.0;
+	uint64_t slots = st->cycles * cfg->width;
+
+	fprintf(f, "Wide in-order : width %u, mem %u, br %u per group, forward %s\n",
+			cfg->width, cfg->mem, cfg->br, fwd_name(sim->cfg.forward));
+	fprintf(f, "IPC : %.4f (%u instructions, %llu cycles)\n", sim->inst_cnt / cycles,
+			sim->inst_cnt, (unsigned long long)st->cycles);
+	fprintf(f, "Issued per cycle :");
+	for(uint32_t i = 0; i <= cfg->width; i++)
+		fprintf(f, " %u %.1f%%", i, 100.0 * st->issue_hist[i] / cycles);
+	fprintf(f, "\n");
+	fprintf(f, "Mispredicts : %llu, %llu resolved in ID\n",
+			(unsigned long long)st->mispredicts, (unsigned long long)st->early);
+
+	fprintf(f, "Issue slots : %llu (%u per cycle)\n", (unsigned long long)slots, cfg->width);
+	for(int i = 0; i < WIDE_SLOT_NUM; i++)
+		fprintf(f, "  %-9s %10llu slots  %6.2f%%\n", wide_slot_name(i), (unsigned long long)st->slot[i],
+				slots ? 100.0 * st->slot[i] / slots : 0.0);
+
+	slots = 0;
+	for(int i = 0; i < CPI_NUM; i++)
+		slots += sim->cpi[i];
+	fprintf(f, "Retire slots : %llu (%u per cycle)\n", (unsigned long long)slots, cfg->width);
+	for(int i = 0; i < CPI_NUM; i++)
+		fprintf(f, "  %-9s %10llu slots  %6.2f%%\n", cpi_name(i), (unsigned long long)sim->cpi[i],
+				slots ? 100.0 * sim->cpi[i] / slots : 0.0);
+}
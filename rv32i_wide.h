@@ -0,0 +1,108 @@
+/* **************************************
+ * Module: wide in-order pipeline
+ *
+ * The 5-stage pipeline with width lanes, selected with mode
+ * wide. IF fetches up to width instructions of one I-cache
+ * line per cycle into a fetch buffer, and ID issues the
+ * longest in-order prefix of the buffer that obeys:
+ *   pairing  at most mem loads and stores and br branches
+ *            and jumps per group
+ *   hazards  every source is far enough ahead for the
+ *            bypass network of --forward; the EX/MEM and
+ *            MEM/WB paths reach every lane, a result is never
+ *            bypassed to a younger lane of its own group
+ * What ID leaves in the buffer pairs with the next fetch.
+ * A group moves through EX, MEM and WB together, a D-cache
+ * miss of any lane holds the whole group in MEM, a division
+ * holds it in EX.
+ *
+ * As in the out-of-order core, instructions execute at fetch
+ * (ooo_fetch_inst) and the stages only model the timing.
+ *
+ * Every cycle each of the width issue slots of ID is either
+ * used or charged to the reason it was left empty. The CPI
+ * stack counts retire slots, width per cycle.
+ *
+ *   cfg.mode = MODE_WIDE;
+ *   wide_config_parse(&cfg.wide, "width=2,mem=1,br=1");
+ *
+ * **************************************
+ */
+#ifndef RV32I_WIDE_H
+#define RV32I_WIDE_H
+
+#include "rv32i.h"
+#include "rv32i_ooo.h"
+
+// Use of an issue slot of ID
+enum WIDE_SLOT {
+  WIDE_SLOT_USED = 0,	// an instruction issued
+  WIDE_SLOT_EMPTY,	// pipeline fill, or fetch past the end of the image
+  WIDE_SLOT_FETCH,	// fetch group cut by a taken branch or an I-cache line
+  WIDE_SLOT_ICACHE,	// IF waiting on the I-cache
+  WIDE_SLOT_BRANCH,	// fetch waiting on a mispredicted branch
+  WIDE_SLOT_DCACHE,	// ID frozen by a D-cache miss
+  WIDE_SLOT_LOAD_USE,	// source loaded by an older group
+  WIDE_SLOT_RAW,	// source computed by an older group
+  WIDE_SLOT_DEP,	// source written by an older lane of the same group
+  WIDE_SLOT_MEM,	// one load or store too many for the group
+  WIDE_SLOT_BR,	// one branch or jump too many for the group
+  WIDE_SLOT_MULDIV,	// source computed by the multiplier, or ID frozen by the divider
+  WIDE_SLOT_NUM
+};
+
+struct wide_config_t {
+	uint32_t width;	// fetch, issue and retire per cycle
+	uint32_t mem;	// loads and stores per group
+	uint32_t br;	// branches and jumps per group
+};
+
+struct wide_stats_t {
+	uint64_t cycles;
+	uint64_t slot[WIDE_SLOT_NUM];	// issue slots by use
+	uint64_t issue_hist[OOO_WIDTH_MAX + 1];	// cycles by instructions issued
+	uint64_t mispredicts;
+	uint64_t early;	// mispredicts resolved in ID
+};
+
+// Instructions that move down the pipeline together
+struct wide_group_t {
+	struct ooo_inst_t inst[OOO_WIDTH_MAX];
+	uint32_t n;
+	uint8_t cause;	// enum CPI_CAT of the unused slots
+};
+
+struct wide_t {
+	struct wide_config_t cfg;
+
+	struct ooo_inst_t fb[OOO_WIDTH_MAX];	// fetch buffer, oldest first
+	uint32_t fb_n;
+	uint8_t fb_slot;	// enum WIDE_SLOT: why IF left the buffer short
+	struct wide_group_t ex;	// ID/EX, EX/MEM and MEM/WB
+	struct wide_group_t mem;
+	struct wide_group_t wb;
+
+	uint32_t fetch_pc;
+	uint32_t fetch_word;	// last imem word in the fetch buffer
+	uint32_t resume;	// first cycle of the fetch after a mispredict
+	uint8_t redirect;	// a mispredicted branch is in flight
+	uint8_t frozen;	// enum WIDE_SLOT: MEM or EX holds its group this cycle, 0: none
+	uint8_t fetch_stop;	// enum HALT: nothing more to fetch
+	uint8_t started;	// fetch_pc was taken from pc_next
+
+	struct wide_stats_t stats;
+};
+
+struct sim_t;
+
+void wide_config_default(struct wide_config_t *cfg);
+int wide_config_parse(struct wide_config_t *cfg, const char *str);
+
+struct wide_t *wide_create(const struct wide_config_t *cfg);
+void wide_destroy(struct wide_t *w);
+void wide_reset(struct wide_t *w);
+
+void wide_cycle(struct sim_t *sim);
+void wide_print(FILE *f, const struct sim_t *sim);
+
+#endif
@@ -0,0 +1,18 @@
+#!/bin/sh
+# Rebuilds the test images NAME.mem from NAME.s, run from tests/isa/.
+# Needs llvm-mc and llvm-objcopy; the images are checked in.
+set -e
+for s in ${@:-*.s}; do
+	k=${s%.s}
+	llvm-mc -triple=riscv32 -mattr=+m,+c,-relax -filetype=obj $k.s -o $k.o
+	llvm-objcopy -O binary -j .text $k.o $k.bin
+	od -An -v -tu2 -w2 $k.bin | awk '{ h[n++] = $1 } END {
+		for (i = 0; i < n; i += 2) {
+			w = h[i] + 65536 * (i + 1 < n ? h[i + 1] : 0)
+			b = ""
+			for (j = 0; j < 32; j++) { b = (w % 2) b; w = int(w / 2) }
+			print b
+		}
+	}' > $k.mem
+	rm -f $k.o $k.bin
+done
@@ -0,0 +1,68 @@
+# Zicsr reads and writes: the read-modify-write forms, writes with
+# rd = x0, the dropped writes, and counters that only move forward.
+# Every check holds on all engines, whatever they count in flight.
+	.include "test.inc"
+	.option norvc
+
+	csrr t0, mhartid
+	CHECK t0, 0, 1
+	csrr t0, 0x7c0			# not implemented: reads as zero
+	CHECK t0, 0, 2
+	li t1, 5
+	csrw 0x7c0, t1			# and drops the write
+	csrr t0, 0x7c0
+	CHECK t0, 0, 3
+
+	li t1, 2
+	csrw mhpmevent3, t1		# csrrw with rd = x0 still writes
+	csrr t0, mhpmevent3
+	CHECK t0, 2, 4
+	csrrsi t0, mhpmevent3, 4
+	CHECK t0, 2, 5
+	csrrci t0, mhpmevent3, 2
+	CHECK t0, 6, 6
+	csrrw t0, mhpmevent3, zero
+	CHECK t0, 4, 7
+	csrr t0, mhpmevent3
+	CHECK t0, 0, 8
+	csrwi mhpmevent4, 3
+	li t1, 1
+	csrrs zero, mhpmevent4, t1	# rd = x0, rs1 != x0: writes
+	csrr t0, mhpmevent4
+	CHECK t0, 3, 9
+	li t1, 2
+	csrrc zero, mhpmevent4, t1
+	csrr t0, mhpmevent4
+	CHECK t0, 1, 10
+
+	# writes to the read-only views are dropped
+	li t1, 7
+	csrw mcycleh, t1
+	csrr t0, cycleh
+	CHECK t0, 7, 11
+	csrw cycleh, zero
+	csrr t0, cycleh
+	CHECK t0, 7, 12
+	csrw mcycleh, zero
+
+	# counters
+	csrwi minstret, 0
+	csrr t0, instreth
+	CHECK t0, 0, 13
+	rdinstret s0
+	rdcycle s1
+	li t1, 10
+1:	addi t1, t1, -1
+	bnez t1, 1b
+	rdinstret s2
+	rdcycle s3
+	sub t0, s2, s0			# 22 instructions between the reads
+	addi t0, t0, -20
+	sltiu t0, t0, 8			# give or take the reads themselves
+	CHECK t0, 1, 14
+	sltu t0, s0, s2
+	CHECK t0, 1, 15
+	sltu t0, s1, s3
+	CHECK t0, 1, 16
+
+	PASS
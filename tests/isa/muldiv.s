@@ -0,0 +1,79 @@
+# M extension edge cases: division by zero, the INT_MIN / -1 overflow,
+# rounding toward zero and the sign cases of the high products. The
+# checks run 64 times so that the JIT translates them.
+	.include "test.inc"
+	.option norvc
+
+	li s11, 64
+loop:
+	li a0, 0x80000000
+	li a1, -1
+	li a2, 7
+	li a3, -7
+	li a4, 2
+	li a5, -2
+
+	# division by zero
+	div t0, a2, zero
+	CHECK t0, -1, 1
+	divu t0, a2, zero
+	CHECK t0, 0xffffffff, 2
+	rem t0, a3, zero
+	CHECK t0, -7, 3
+	remu t0, a3, zero
+	CHECK t0, -7, 4
+
+	# overflow
+	div t0, a0, a1
+	CHECK t0, 0x80000000, 5
+	rem t0, a0, a1
+	CHECK t0, 0, 6
+	mul t0, a0, a1
+	CHECK t0, 0x80000000, 7
+
+	# quotients round toward zero, the remainder has the sign of the dividend
+	div t0, a3, a4
+	CHECK t0, -3, 8
+	rem t0, a3, a4
+	CHECK t0, -1, 9
+	div t0, a2, a5
+	CHECK t0, -3, 10
+	rem t0, a2, a5
+	CHECK t0, 1, 11
+	divu t0, a3, a4
+	CHECK t0, 0x7ffffffc, 12
+	remu t0, a3, a4
+	CHECK t0, 1, 13
+	mul t0, a3, a4
+	CHECK t0, -14, 14
+
+	# high products: signed x signed, signed x unsigned, unsigned x unsigned
+	mulh t0, a1, a1
+	CHECK t0, 0, 15
+	mulhu t0, a1, a1
+	CHECK t0, 0xfffffffe, 16
+	mulhsu t0, a1, a1
+	CHECK t0, 0xffffffff, 17
+	mulh t0, a0, a0
+	CHECK t0, 0x40000000, 18
+	mulhu t0, a0, a0
+	CHECK t0, 0x40000000, 19
+	mulh t0, a0, a4
+	CHECK t0, -1, 20
+	mulhsu t0, a4, a0
+	CHECK t0, 1, 21
+	mulhsu t0, a0, a4
+	CHECK t0, -1, 22
+	mulhsu t0, a5, a2
+	CHECK t0, -1, 23
+	mulhsu t0, a2, a5
+	CHECK t0, 6, 24
+	mulh t0, a3, a2
+	CHECK t0, -1, 25
+	li t1, 0x7fffffff
+	mulh t0, t1, t1
+	CHECK t0, 0x3fffffff, 26
+
+	addi s11, s11, -1
+	bnez s11, loop
+	PASS
@@ -0,0 +1,94 @@
+# Decode of the C extension: every compressed form the simulator
+# expands, 32-bit instructions at odd halfwords, and the pc + 2 link
+# of a compressed call.
+	.include "test.inc"
+
+	li sp, 0x200
+	c.li s0, -7
+	CHECK s0, -7, 1
+	c.addi s0, 12
+	CHECK s0, 5, 2
+	c.lui s1, 0xfffe1		# sign-extended 6-bit immediate
+	CHECK s1, 0xfffe1000, 3
+	c.addi16sp sp, -64
+	CHECK sp, 0x1c0, 4
+	c.addi4spn a0, sp, 16
+	CHECK a0, 0x1d0, 5
+	c.li a1, -1
+	c.srli a1, 4
+	CHECK a1, 0x0fffffff, 6
+	c.slli a1, 4
+	CHECK a1, 0xfffffff0, 7
+	c.srai a1, 2
+	CHECK a1, 0xfffffffc, 8
+	c.andi a1, 0xa
+	CHECK a1, 0x8, 9
+	c.li a2, 6
+	c.li a3, 3
+	c.sub a2, a3
+	CHECK a2, 3, 10
+	c.li a2, 6
+	c.xor a2, a3
+	CHECK a2, 5, 11
+	c.li a2, 6
+	c.or a2, a3
+	CHECK a2, 7, 12
+	c.li a2, 6
+	c.and a2, a3
+	CHECK a2, 2, 13
+	c.mv a4, a3
+	c.add a4, a2
+	CHECK a4, 5, 14
+
+	# loads and stores, sp-relative and register-relative
+	c.li a5, -3
+	c.sw a5, 4(a0)
+	c.lw s1, 4(a0)
+	CHECK s1, -3, 15
+	c.swsp a3, 8(sp)
+	c.lwsp t0, 8(sp)
+	CHECK t0, 3, 16
+
+	# 32-bit instructions that start at an odd halfword
+	c.nop
+	lui t1, 0x12345
+	addi t1, t1, 0x678
+	CHECK t1, 0x12345678, 17
+
+	# compressed jumps and branches
+	c.li s0, 0
+	c.j 1f
+	c.li s0, 1
+1:	c.beqz s0, 1f
+	c.li s0, 2
+1:	c.li a5, 1
+	c.bnez a5, 1f
+	c.li s0, 3
+1:	CHECK s0, 0, 18
+
+	# calls link the next halfword
+	c.jal 1f
+1:	lla s1, 1b
+	bne ra, s1, bad
+	lla t2, 1f
+	c.jalr t2
+1:	lla s1, 1b
+	bne ra, s1, bad
+	lla t2, 1f
+	c.jr t2
+	c.j bad
+
+	# jalr clears bit 0 of the target
+1:	lla t2, 1f
+	jalr ra, 1(t2)
+	c.j bad
+1:	lla t2, 1f
+	addi t2, t2, 1
+	c.jr t2
+	c.j bad
+1:
+	PASS
+
+bad:
+	li a0, 21
+	j fail
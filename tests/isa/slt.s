@@ -0,0 +1,76 @@
+# slt, sltu and the signed and unsigned branches at the edges of the
+# 32-bit range. The checks run 20 times so that the JIT translates them.
+	.include "test.inc"
+	.option norvc
+
+	li s11, 20
+loop:
+	li a0, 5
+	li a1, 5
+	li a2, 0x80000000
+	li a3, 1
+	li a4, 0x7fffffff
+	li a5, -1
+
+	slt t0, a0, a1		# equal
+	CHECK t0, 0, 1
+	slti t0, a0, 6
+	CHECK t0, 1, 2
+	slt t0, a2, a3		# a2 - a3 overflows
+	CHECK t0, 1, 3
+	sltu t0, a2, a3
+	CHECK t0, 0, 4
+	slt t0, a4, a5
+	CHECK t0, 0, 5
+	slt t0, a5, a4
+	CHECK t0, 1, 6
+	sltu t0, a5, a4
+	CHECK t0, 0, 7
+	sltiu t0, a5, -1	# the immediate is sign-extended, then compared unsigned
+	CHECK t0, 0, 8
+	sltiu t0, zero, 1
+	CHECK t0, 1, 9
+	slti t0, a2, -1
+	CHECK t0, 1, 10
+	slt t0, a4, a2
+	CHECK t0, 0, 11
+	sltu t0, zero, a5
+	CHECK t0, 1, 12
+
+	# every fall-through sets a bit: only the not-taken ones
+	li s0, 0
+	blt a2, a3, 1f
+	ori s0, s0, 1
+1:	bge a4, a5, 1f
+	ori s0, s0, 2
+1:	blt a0, a1, 1f
+	ori s0, s0, 4
+1:	bge a2, a3, 1f
+	ori s0, s0, 8
+1:	bltu a3, a2, 1f
+	ori s0, s0, 16
+1:	bgeu a2, a3, 1f
+	ori s0, s0, 32
+1:	bltu a5, a4, 1f
+	ori s0, s0, 64
+1:	bge a1, a0, 1f
+	ori s0, s0, 128
+1:	CHECK s0, 76, 13
+
+	# operands straight from the ALU and from a load
+	addi t1, a2, -1		# 0x7fffffff
+	blt t1, a2, bad
+	li t3, 0x100
+	sw a2, 0(t3)
+	lw t2, 0(t3)
+	bge t2, zero, bad
+	lw t2, 0(t3)
+	bltu t2, a4, bad
+
+	addi s11, s11, -1
+	bnez s11, loop
+	PASS
+
+bad:
+	li a0, 14
+	j fail
@@ -0,0 +1,78 @@
+#!/bin/sh
+# Regression tests, run from the repository root after compile.sh:
+#   sh tests/run.sh
+# - the kernels of bench/ end in the hash of bench/bench.list on every
+#   engine, with --harts, --sample and through a checkpoint
+# - the directed tests of tests/isa/ store 1 to tohost on every engine
+# Prints one line per failure and exits with 1 if there was any.
+P=./PipelineCPU
+TMP=${TMPDIR:-/tmp}/rv32i_tests.$$
+n=0
+fail=0
+
+mkdir -p $TMP
+trap 'rm -rf $TMP' EXIT
+
+# result NAME: counts the check that just ran, $? is its status
+result() {
+	if [ $? -ne 0 ]; then
+		echo "FAIL: $1"
+		fail=$((fail+1))
+	fi
+	n=$((n+1))
+}
+
+# Every engine and bypass network on the benchmark manifest
+for opt in "" "--forward none" "--forward full" "--mode func" "--mode func --jit" \
+		"--mode ooo" "--mode wide" "--mode wide --wide width=4,mem=2,br=2" \
+		"--bpred gshare,btb=256,ras=8 --icache size=1K --dcache size=1K,assoc=2"; do
+	$P --bench bench/bench.list $opt > $TMP/bench.txt 2>&1
+	result "--bench $opt"
+done
+
+# The final state printed by the modes --bench does not cover
+while read name hash imem dmem; do
+	case $name in ''|\#*) continue ;; esac
+	prog="bench/$imem ${dmem:+bench/$dmem}"
+	run="$P --trace none --max-cycles 100000000"
+
+	$run --harts 2 $prog > $TMP/out.txt 2>&1
+	[ "$(grep -c "state $hash" $TMP/out.txt)" = 2 ]
+	result "$name --harts 2"
+
+	$run --sample ff=200K,warm=1000,window=2000 --jit $prog > $TMP/out.txt 2>&1
+	grep -q "^State hash : $hash" $TMP/out.txt
+	result "$name --sample"
+
+	rm -f $TMP/pipe.ckpt $TMP/func.ckpt
+	$run --ckpt $TMP/pipe.ckpt --ckpt-inst 500000 $prog > /dev/null 2>&1
+	$run --restore $TMP/pipe.ckpt > $TMP/out.txt 2>&1
+	grep -q "^State hash : $hash" $TMP/out.txt
+	result "$name pipeline checkpoint"
+
+	# the restore keeps the network the pipeline was running with
+	rm -f $TMP/pipe.ckpt
+	$run --forward full --ckpt $TMP/pipe.ckpt --ckpt-cycle 77777 $prog > /dev/null 2>&1
+	$run --forward none --restore $TMP/pipe.ckpt > $TMP/out.txt 2>&1
+	grep -q "^State hash : $hash" $TMP/out.txt
+	result "$name pipeline checkpoint, other --forward"
+
+	$run --mode func --ckpt $TMP/func.ckpt --ckpt-inst 500000 $prog > /dev/null 2>&1
+	$run --restore $TMP/func.ckpt --forward full > $TMP/out.txt 2>&1
+	grep -q "^State hash : $hash" $TMP/out.txt
+	result "$name functional checkpoint"
+done < bench/bench.list
+
+# Directed ISA tests
+for t in tests/isa/*.mem; do
+	for opt in "" "--forward none" "--forward full" "--mode func" "--mode func --jit" \
+			"--mode ooo" "--mode wide" "--mode wide --wide width=4,mem=2,br=2" \
+			"--bpred gshare,btb=64,ras=4" "--muldiv mul=1,div=8,early=0"; do
+		$P --trace none --tohost 0x1000 $opt $t > $TMP/out.txt 2>&1
+		grep -q "^Halt reason : tohost (0x00000001)" $TMP/out.txt
+		result "$t $opt: $(grep '^Halt' $TMP/out.txt)"
+	done
+done
+
+echo "$n checks, $fail failed"
+[ $fail -eq 0 ]
@@ -0,0 +1,108 @@
+/* **************************************
+ * Module: binary trace decoder
+ *
+ * Replays a trace written with --trace-bin and prints
+ * the per-cycle state in the same text layout as the
+ * simulator's full trace level.
+ *
+ * **************************************
+ */
+#include "rv32i_trace.h"
+
+static FILE *f_trace;
+
+static uint8_t get_u8(void) {
+	int c = fgetc(f_trace);
+	if(c == EOF){
+		printf("Unexpected end of trace!!\n");
+		exit(1);
+	}
+	return (uint8_t)c;
+}
+
+static uint32_t get_u32(void) {
+	uint32_t v = 0;
+	for(int i = 0; i < WORD_SIZE; i++)
+		v |= (uint32_t)get_u8() << i*BYTE_BIT;
+	return v;
+}
+
+static uint32_t get_varint(void) {
+	uint32_t v = 0;
+	uint8_t b;
+	int shift = 0;
+	do {
+		b = get_u8();
+		v |= (uint32_t)(b & 0x7F) << shift;
+		shift += 7;
+	} while(b & 0x80);
+	return v;
+}
+
+int main (int argc, char *argv[]) {
+
+	if (argc < 2) {
+		printf("usage: %s trace_file\n", argv[0]);
+		exit(1);
+	}
+	if ( (f_trace = fopen(argv[1], "rb")) == NULL ) {
+		printf("Cannot find %s\n", argv[1]);
+		exit(1);
+	}
+
+	if(get_u32() != TRACE_MAGIC || get_u32() != TRACE_VERSION){
+		printf("Incorrect format!!\n");
+		exit(1);
+	}
+
+	uint32_t reg_data[32];
+	struct mem_t *mem;
+	uint32_t cc, addr;
+
+	cc = get_u32();
+	mem = mem_create(get_u32(), MEM_SIZE_MAX);
+	for(int i = 0; i < 32; i++)
+		reg_data[i] = get_u32();
+
+	while((addr = get_u32()) != TRACE_PAGE_END){
+		for(int i = 0; i < MEM_PAGE_SIZE; i++)
+			mem_write(mem, addr + i, get_u8(), 1);
+	}
+
+	static char out_buf[TRACE_BUF_SIZE];
+	setvbuf(stdout, out_buf, _IOFBF, sizeof(out_buf));
+
+	int tag;
+	while((tag = fgetc(f_trace)) != EOF){
+		uint32_t next_cc = cc + get_varint();
+
+		// Unchanged cycles repeat the current state
+		for(; cc < next_cc; cc++){
+			printf("\n*** CLK : %d ***\n", cc);
+			trace_print_state(stdout, reg_data, mem);
+		}
+		if(tag == TRACE_TAG_END)
+			break;
+		if(tag != TRACE_TAG_CYCLE){
+			printf("Incorrect format!!\n");
+			exit(1);
+		}
+
+		uint8_t nreg = get_u8();
+		for(int i = 0; i < nreg; i++){
+			uint8_t idx = get_u8();
+			reg_data[idx & 0x1F] = get_u32();
+		}
+		uint8_t nmem = get_u8();
+		for(int i = 0; i < nmem; i++){
+			uint32_t addr = get_varint();
+			uint8_t val = get_u8();
+			mem_write(mem, addr, val, 1);
+		}
+	}
+
+	fclose(f_trace);
+	mem_destroy(mem);
+
+	return 0;
+}